@@ -42,6 +42,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace rtabmap {
 
 class DBDriver;
+class DBReaderReadAhead;
 
 class RTABMAP_EXP DBReader : public Camera {
 public:
@@ -69,6 +70,15 @@ public:
 	virtual std::string getSerial() const;
 	virtual bool odomProvided() const {return !_odometryIgnored;}
 
+	/**
+	 * Read and uncompress the next "size" nodes in a separated thread
+	 * (images of the window are uncompressed in parallel). Frames are
+	 * still returned in database order. 0 means disabled: data are read
+	 * on the capture thread. Should be set before init().
+	 */
+	void setReadAheadSize(int size) {_readAheadSize = size;}
+	int getReadAheadSize() const {return _readAheadSize;}
+
 protected:
 	virtual SensorData captureImage(CameraInfo * info = 0);
 
@@ -82,8 +92,10 @@ private:
 	bool _goalsIgnored;
 	int _startIndex;
 	int _cameraIndex;
+	int _readAheadSize;
 
 	DBDriver * _dbDriver;
+	DBReaderReadAhead * _readAhead;
 	UTimer _timer;
 	std::set<int> _ids;
 	std::set<int>::iterator _currentId;
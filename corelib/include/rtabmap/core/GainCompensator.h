@@ -89,6 +89,10 @@ public:
 			int id,
 			cv::Mat & image,
 			bool rgb = true) const;
+	// apply on all clouds (in parallel)
+	void apply(
+			std::map<int, std::pair<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr, pcl::IndicesPtr> > & clouds,
+			bool rgb = true) const;
 
 	double getGain(int id, double * r=0, double * g=0, double * b=0) const;
 	int getIndex(int id) const;
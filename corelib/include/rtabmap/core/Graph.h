@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/RtabmapExp.h" // DLL export/import defines
 
 #include <map>
+#include <set>
 #include <list>
 #include <rtabmap/core/Link.h>
 
@@ -176,12 +177,17 @@ std::list<int> RTABMAP_EXP computePath(
 			bool useSameCostForAllLinks = false);
 
 /**
- * Perform Dijkstra path planning in the graph.
+ * Perform Dijkstra path planning in the graph. If poses are set, the cost of a
+ * link is the distance between the poses of its nodes (its length if a node
+ * doesn't have a pose) and, if all nodes have a pose, A* is used with the
+ * euclidean distance to the final node as heuristic (admissible as it is
+ * computed from the same poses).
  * @param fromId initial node
  * @param toId final node
  * @param memory The graph's memory
  * @param lookInDatabase check links in database
  * @param updateNewCosts Keep up-to-date costs while traversing the graph.
+ * @param poses optional poses (e.g., optimized poses) used for link costs and the A* heuristic.
  * @return the path ids from id "fromId" to id "toId" including initial and final nodes (Identity pose for the first node).
  */
 std::list<std::pair<int, Transform> > RTABMAP_EXP computePath(
@@ -191,7 +197,95 @@ std::list<std::pair<int, Transform> > RTABMAP_EXP computePath(
 		bool lookInDatabase = true,
 		bool updateNewCosts = false,
 		float linearVelocity = 0.0f,   // m/sec
-		float angularVelocity = 0.0f); // rad/sec
+		float angularVelocity = 0.0f,  // rad/sec
+		const std::map<int, Transform> * poses = 0);
+
+/**
+ * Incremental path planning with D* Lite (Koenig and Likhachev, 2002).
+ * The search is done backward from the goal, so when the start node moves or
+ * when links are added, removed or their costs change, only the affected nodes
+ * are re-expanded instead of planning from scratch. The graph is given on init(),
+ * then changes are fed with addLink()/removeLink() (see Memory::setPathPlanner())
+ * and updatePoses().
+ *
+ * The cost of a link is the distance between the poses of its nodes, or its
+ * length if one of them doesn't have a pose (divided by linearVelocity if set).
+ * The heuristic is the distance between the poses, computed from the same poses
+ * as the costs so that it is admissible. It is used only when all nodes of the
+ * graph have a pose, otherwise the search is a Dijkstra search.
+ */
+class RTABMAP_EXP DStarLite
+{
+public:
+	DStarLite();
+
+	void init(int goal,
+			const std::multimap<int, Link> & links,
+			const std::map<int, Transform> & poses = std::map<int, Transform>(),
+			float linearVelocity = 0.0f); // m/sec
+	void clear();
+	int goal() const {return goal_;}
+
+	// Ignored if not initialized. Links are undirected.
+	void addLink(const Link & link);
+	void removeLink(int from, int to);
+
+	/**
+	 * Set new poses (e.g., after graph optimization). Costs of the links of
+	 * nodes that moved are updated.
+	 */
+	void updatePoses(const std::map<int, Transform> & poses);
+
+	/**
+	 * Repair the search with the changes since the last call and return the path
+	 * from "start" to the goal, including initial and final nodes, with their poses
+	 * relative to "start" composed from the link transforms. Empty if the
+	 * goal cannot be reached.
+	 */
+	std::list<std::pair<int, Transform> > computePath(int start);
+
+private:
+	typedef std::pair<float, float> Key;
+	struct State
+	{
+		State();
+		float g;
+		float rhs;
+		Key key; // key in the queue if queued
+		bool queued;
+	};
+	struct Edge
+	{
+		Edge() : length(0.0f), cost(0.0f) {}
+		Transform transform; // from -> to
+		float length;
+		float cost;
+	};
+
+	float heuristic(int a, int b) const;
+	float cost(int from, int to, float length) const;
+	void setEdge(int from, int to, const Transform & transform);
+	void eraseEdge(int from, int to);
+	State & state(int id);
+	Key computeKey(int id, const State & s) const;
+	void updateKeys();
+	void updateVertex(int id);
+	void computeShortestPath();
+
+private:
+	int goal_;
+	int start_;
+	float km_;
+	float linearVelocity_;
+	std::map<int, Transform> poses_;
+	std::map<int, std::map<int, Edge> > edges_; // from -> (to, edge), both directions
+	int nodesWithoutPose_; // nodes of the graph without pose
+	bool heuristicUsed_;
+	bool keysChanged_; // heuristic changed since the keys were computed
+	std::set<int> changed_; // nodes with changed links since the last search
+	std::map<int, State> states_;
+	std::set<std::pair<Key, int> > queue_;
+};
 
 int RTABMAP_EXP findNearestNode(
 		const std::map<int, rtabmap::Transform> & nodes,
@@ -56,6 +56,10 @@ class RegistrationInfo;
 class RegistrationIcp;
 class Stereo;
 class OccupancyGrid;
+class LinkTopology;
+namespace graph {
+class DStarLite;
+}
 
 class RTABMAP_EXP Memory
 {
@@ -127,6 +131,8 @@ public:
 	void deleteLocation(int locationId, std::list<int> * deletedWords = 0);
 	void removeLink(int idA, int idB);
 	void removeRawData(int id, bool image = true, bool scan = true, bool userData = true);
+	// Links added, updated or removed are forwarded to this planner (not owned, 0=disabled)
+	void setPathPlanner(graph::DStarLite * planner) {_pathPlanner = planner;}
 
 	//getters
 	const std::map<int, double> & getWorkingMem() const {return _workingMem;}
@@ -210,6 +216,8 @@ public:
 
 	Transform computeTransform(Signature & fromS, Signature & toS, Transform guess, RegistrationInfo * info = 0, bool useKnownCorrespondencesIfPossible = false) const;
 	Transform computeTransform(int fromId, int toId, Transform guess, RegistrationInfo * info = 0, bool useKnownCorrespondencesIfPossible = false);
+	std::vector<Transform> computeTransforms(const std::vector<std::pair<const Signature *, const Signature *> > & pairs, std::vector<RegistrationInfo> * infos = 0) const;
+	bool isLoopClosureParallelized() const {return _loopClosureParallelized;}
 	Transform computeIcpTransform(int fromId, int toId, Transform guess, RegistrationInfo * info = 0);
 	Transform computeIcpTransformMulti(
 			int newId,
@@ -275,6 +283,7 @@ private:
 	float _laserScanDownsampleStepSize;
 	int _laserScanNormalK;
 	bool _reextractLoopClosureFeatures;
+	bool _loopClosureParallelized;
 	float _rehearsalMaxDistance;
 	float _rehearsalMaxAngle;
 	bool _rehearsalWeightIgnoredWhileMoving;
@@ -305,6 +314,9 @@ private:
 	RegistrationIcp * _registrationIcp;
 
 	OccupancyGrid * _occupancy;
+
+	LinkTopology * _ltmLinks; // links of the nodes in LTM, kept in RAM
+	graph::DStarLite * _pathPlanner; // incremental planner fed with link changes
 };
 
 } // namespace rtabmap
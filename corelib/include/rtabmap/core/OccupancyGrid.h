@@ -47,6 +47,7 @@ public:
 	float getMinMapSize() const {return minMapSize_;}
 	bool isGridFromDepth() const {return occupancyFromCloud_;}
 	bool isFullUpdate() const {return fullUpdate_;}
+	int getLocalMapEncoding() const {return localMapEncoding_;}
 	const std::map<int, Transform> & addedNodes() const {return addedNodes_;}
 	int cacheSize() const {return (int)cache_.size();}
 
@@ -67,6 +68,10 @@ public:
 			cv::Point3f & viewPoint) const;
 
 	void clear();
+	/**
+	 * Local maps are encoded following Grid/LocalMapEncoding. Local maps already
+	 * encoded (see util3d::encodeLocalMapCells()) should have been created with the same cell size.
+	 */
 	void addToCache(
 			int nodeId,
 			const cv::Mat & ground,
@@ -107,6 +112,7 @@ private:
 	float minMapSize_;
 	bool erode_;
 	float footprintRadius_;
+	int localMapEncoding_;
 
 	std::map<int, std::pair<cv::Mat, cv::Mat> > cache_;
 	cv::Mat map_;
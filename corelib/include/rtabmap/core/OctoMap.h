@@ -40,6 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace rtabmap {
 
@@ -55,9 +56,26 @@ public:
 	bool isObstacle_;
 };
 
+// Keys updated by the cloud of a node, used to remove its contribution
+// from the octree when the node is relocated.
+class OcTreeNodeCells
+{
+public:
+	OcTreeNodeCells() : radius_(0.0f) {}
+	std::vector<octomap::OcTreeKey> hits_;
+	std::vector<octomap::OcTreeKey> misses_;
+	float radius_; // farthest point from the node (m)
+};
+
 class RTABMAP_EXP OctoMap {
 public:
-	OctoMap(float voxelSize = 0.1f, float occupancyThr = 0.5f, bool fullUpdate = false);
+	/**
+	 * @param updateMovedNodesThr if >0, on loop closure only the nodes whose
+	 *        points moved more than this distance (m) are removed and re-inserted
+	 *        in the octree (the cache is kept). If 0, the octree is shifted (or
+	 *        rebuilt if fullUpdate is true).
+	 */
+	OctoMap(float voxelSize = 0.1f, float occupancyThr = 0.5f, bool fullUpdate = false, float updateMovedNodesThr = 0.0f);
 
 	const std::map<int, Transform> & addedNodes() const {return addedNodes_;}
 	void addToCache(int nodeId,
@@ -72,6 +90,11 @@ public:
 
 	const octomap::ColorOcTree * octree() const {return octree_;}
 
+	// statistics of the last update()
+	int lastNodesAdded() const {return lastNodesAdded_;}
+	int lastNodesMoved() const {return lastNodesMoved_;}
+	double lastRayCastingTime() const {return lastRayCastingTime_;} // sec
+
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr createCloud(
 			unsigned int treeDepth = 0,
 			std::vector<int> * obstacleIndices = 0,
@@ -96,9 +119,13 @@ private:
 	octomap::ColorOcTree * octree_;
 	std::map<octomap::ColorOcTreeNode*, OcTreeNodeInfo> occupiedCells_;
 	std::map<int, Transform> addedNodes_;
-	octomap::KeyRay keyRay_;
+	std::map<int, OcTreeNodeCells> contributions_;
 	bool hasColor_;
 	bool fullUpdate_;
+	float updateMovedNodesThr_;
+	int lastNodesAdded_;
+	int lastNodesMoved_;
+	double lastRayCastingTime_;
 };
 
 } /* namespace rtabmap */
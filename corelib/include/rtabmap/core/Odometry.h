@@ -37,7 +37,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace rtabmap {
 
 class OdometryInfo;
-class ParticleFilter;
+class ParticleFilter6DoF;
 
 class RTABMAP_EXP Odometry
 {
@@ -49,7 +49,8 @@ public:
 		kTypeFovis = 2,
 		kTypeViso2 = 3,
 		kTypeDVO = 4,
-		kTypeORBSLAM2 = 5
+		kTypeORBSLAM2 = 5,
+		kTypeDense = 6
 	};
 
 public:
@@ -99,7 +100,7 @@ private:
 	Transform previousGroundTruthPose_;
 	float distanceTravelled_;
 
-	std::vector<ParticleFilter *> particleFilters_;
+	ParticleFilter6DoF * particleFilter_;
 	cv::KalmanFilter kalmanFilter_;
 
 protected:
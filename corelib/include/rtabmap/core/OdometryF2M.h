@@ -39,6 +39,8 @@ namespace rtabmap {
 class Signature;
 class Registration;
 class Optimizer;
+class LocalBundleThread;
+class LocalMapIndex;
 
 class RTABMAP_EXP OdometryF2M : public Odometry
 {
@@ -54,6 +56,8 @@ public:
 
 private:
 	virtual Transform computeTransform(SensorData & data, const Transform & guess = Transform(), OdometryInfo * info = 0);
+	void postLocalBundleAdjustment();
+	bool cullLocalMap(const Transform & pose, Signature & visibleMap, std::vector<int> & visibleIndices) const;
 
 private:
 	//Parameters
@@ -64,12 +68,15 @@ private:
 	float scanKeyFrameThr_;
 	int scanMaximumMapSize_;
 	float scanSubtractRadius_;
+	bool frustumCulling_;
 	int bundleAdjustment_;
 	int bundleMaxFrames_;
+	bool bundleAsync_;
 
 	Registration * regPipeline_;
 	Signature * map_;
 	Signature * lastFrame_;
+	LocalMapIndex * mapIndex_;
 	std::vector<std::pair<pcl::PointCloud<pcl::PointNormal>::Ptr, pcl::IndicesPtr> > scansBuffer_;
 
 	std::map<int, std::map<int, cv::Point3f> > bundleWordReferences_; //<WordId, <FrameId, pt2D+depth>>
@@ -79,6 +86,9 @@ private:
 	std::map<int, int> bundlePoseReferences_;
 	int bundleSeq_;
 	Optimizer * sba_;
+	LocalBundleThread * bundleThread_;
+	int bundleVersion_;
+	int bundleResetVersion_;
 };
 
 }
@@ -170,6 +170,8 @@ class RTABMAP_EXP Parameters
     // Rtabmap parameters
     RTABMAP_PARAM(Rtabmap, VhStrategy,                   int, 0,      "None 0, Similarity 1, Epipolar 2.");
     RTABMAP_PARAM(Rtabmap, PublishStats,                 bool, true,  "Publishing statistics.");
+    RTABMAP_PARAM(Rtabmap, PublishStatsDelta,            bool, false, "Publish only the poses and links added, changed or removed since the previous statistics instead of the full local graph. Receivers should maintain the graph with Statistics::updateGraph().");
+    RTABMAP_PARAM(Rtabmap, PublishStatsKeyframe,         int, 100,    "With Rtabmap/PublishStatsDelta, the full local graph is published every X statistics (0=only on reset), so that receivers missing a delta can recover.");
     RTABMAP_PARAM(Rtabmap, PublishLastSignature,         bool, true,  "Publishing last signature.");
     RTABMAP_PARAM(Rtabmap, PublishPdf,                   bool, true,  "Publishing pdf.");
     RTABMAP_PARAM(Rtabmap, PublishLikelihood,            bool, true,  "Publishing likelihood.");
@@ -183,6 +185,7 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(Rtabmap, StatisticLogsBufferedInRAM,   bool, true,  "Statistic logs buffered in RAM instead of written to hard drive after each iteration.");
     RTABMAP_PARAM(Rtabmap, StatisticLogged,              bool, false, "Logging enabled.");
     RTABMAP_PARAM(Rtabmap, StatisticLoggedHeaders,       bool, true,  "Add column header description to log files.");
+    RTABMAP_PARAM(Rtabmap, TraceLogged,                  bool, false, "Record the time spent in the main processing stages of all threads (camera, odometry, rtabmap, memory, database, graph optimization) in \"Trace.bin\" of the working directory. The trace is written with the statistic logs (see StatisticLogsBufferedInRAM) and can be converted to Chrome trace format (JSON) with rtabmap-trace.");
     RTABMAP_PARAM(Rtabmap, StartNewMapOnLoopClosure,     bool, false, "Start a new map only if there is a global loop closure with a previous map.");
 
     // Hypotheses selection
@@ -316,6 +319,7 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(RGBD, PlanStuckIterations,      int, 0,      "Mark the current goal node on the path as unreachable if it is not updated after X iterations (0=disabled). If all upcoming nodes on the path are unreachabled, the plan fails.");
     RTABMAP_PARAM(RGBD, PlanLinearVelocity,       float, 0,    "Linear velocity (m/sec) used to compute path weights.");
     RTABMAP_PARAM(RGBD, PlanAngularVelocity,      float, 0,    "Angular velocity (rad/sec) used to compute path weights.");
+    RTABMAP_PARAM(RGBD, PlanIncremental,          bool, false, uFormat("Plan global paths to a node with D* Lite. Link changes are fed to the planner by the memory, and when a path to the same goal is requested again, the previous search is repaired (only nodes with new, removed or moved links are re-expanded) instead of planning from scratch. \"%s\" is ignored in this mode.", kRGBDPlanAngularVelocity().c_str()));
     RTABMAP_PARAM(RGBD, GoalsSavedInUserData,     bool, false, "When a goal is received and processed with success, it is saved in user data of the location with this format: \"GOAL:#\".");
     RTABMAP_PARAM(RGBD, MaxLocalRetrieved,        unsigned int, 2, "Maximum local locations retrieved (0=disabled) near the current pose in the local map or on the current planned path (those on the planned path have priority).");
     RTABMAP_PARAM(RGBD, LocalRadius,              float, 10,   "Local radius (m) for nodes selection in the local map. This parameter is used in some approaches about the local map management.");
@@ -323,6 +327,7 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(RGBD, ScanMatchingIdsSavedInLinks, bool, true,    "Save scan matching IDs in link's user data.");
     RTABMAP_PARAM(RGBD, NeighborLinkRefining,         bool, false,  uFormat("When a new node is added to the graph, the transformation of its neighbor link to the previous node is refined using registration approach selected (%s).", kRegStrategy().c_str()));
     RTABMAP_PARAM(RGBD, LoopClosureReextractFeatures, bool, false,  "Extract features even if there are some already in the nodes.");
+    RTABMAP_PARAM(RGBD, LoopClosureParallelized,      bool, true,   "Registration of multiple loop closure candidates (proximity detection in space, post-processing) is multi-threaded. Accepted links are still added in candidates order.");
     RTABMAP_PARAM(RGBD, CreateOccupancyGrid,          bool, false,  "Create local occupancy grid maps. See \"Grid\" group for parameters.");
 
     // Local/Proximity loop closure detection
@@ -334,6 +339,10 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(RGBD, ProximityPathMaxNeighbors,    int, 0,      "Maximum neighbor nodes compared on each path. Set to 0 to disable merging the laser scans.");
     RTABMAP_PARAM(RGBD, ProximityPathRawPosesUsed,    bool, true,  "When comparing to a local path, merge the scan using the odometry poses (with neighbor link optimizations) instead of the ones in the optimized local graph.");
     RTABMAP_PARAM(RGBD, ProximityAngle,               float, 45,   "Maximum angle (degrees) for visual proximity detection.");
+    RTABMAP_PARAM(RGBD, LikelihoodRadius,             float, 0,    uFormat("Spatial prefilter of the loop closure hypotheses: the likelihood is computed only with locations of the local optimized graph inside this radius (m) around the current pose, 0 means disabled. Other locations get a null likelihood (neutral for the Bayes filter), except those sampled with \"%s\" and \"%s\". In localization mode, the filter is used only once localized.", kRGBDLikelihoodRandomSamples().c_str(), kRGBDLikelihoodPosteriorSamples().c_str()));
+    RTABMAP_PARAM(RGBD, LikelihoodFov,                float, 0,    uFormat("Horizontal field of view (degrees) used with \"%s\": a location inside the radius is kept if it is in front of the current pose inside this angle or if it has the same orientation (yaw difference under half this angle). 0 means that only the radius is used.", kRGBDLikelihoodRadius().c_str()));
+    RTABMAP_PARAM(RGBD, LikelihoodRandomSamples,      int, 10,     uFormat("Locations outside \"%s\" randomly kept for likelihood computation on each update, so that the robot can still relocalize globally.", kRGBDLikelihoodRadius().c_str()));
+    RTABMAP_PARAM(RGBD, LikelihoodPosteriorSamples,   int, 10,     uFormat("Locations outside \"%s\" with highest previous posterior kept for likelihood computation.", kRGBDLikelihoodRadius().c_str()));
 
     // Graph optimization
 #ifdef RTABMAP_GTSAM
@@ -363,7 +372,7 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(GTSAM, Optimizer,       int, 1,          "0=Levenberg 1=GaussNewton 2=Dogleg");
 
     // Odometry
-    RTABMAP_PARAM(Odom, Strategy,               int, 0,       "0=Frame-to-Map (F2M) 1=Frame-to-Frame (F2F) 2=Fovis 3=viso2 4=DVO-SLAM 5=ORB_SLAM2");
+    RTABMAP_PARAM(Odom, Strategy,               int, 0,       "0=Frame-to-Map (F2M) 1=Frame-to-Frame (F2F) 2=Fovis 3=viso2 4=DVO-SLAM 5=ORB_SLAM2 6=Dense RGB-D (built-in)");
     RTABMAP_PARAM(Odom, ResetCountdown,         int, 0,       "Automatically reset odometry after X consecutive images on which odometry cannot be computed (value=0 disables auto-reset).");
     RTABMAP_PARAM(Odom, Holonomic,              bool, true,   "If the robot is holonomic (strafing commands can be issued). If not, y value will be estimated from x and yaw values (y=x*tan(yaw)).");
     RTABMAP_PARAM(Odom, FillInfoData,           bool, true,   "Fill info with data (inliers/outliers features).");
@@ -388,8 +397,10 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(OdomF2M, MaxNewFeatures,      int, 0,       "[Visual] Maximum features (sorted by keypoint response) added to local map from a new key-frame. 0 means no limit.");
     RTABMAP_PARAM(OdomF2M, ScanMaxSize,         int, 2000,    "[Geometry] Maximum local scan map size.");
     RTABMAP_PARAM(OdomF2M, ScanSubtractRadius,  float, 0.05,  "[Geometry] Radius used to filter points of a new added scan to local map. This could match the voxel size of the scans.");
+    RTABMAP_PARAM(OdomF2M, FrustumCulling,      bool, false,  uFormat("[Visual] Words of the local map are indexed in a voxel grid and only those inside the camera frustum predicted by the motion guess are matched. When the local map is full, words with the lowest inlier/visible ratio are removed first (instead of the oldest). Only used with %s=0 and %s>0.", kVisCorType().c_str(), kVisCorGuessWinSize().c_str()));
     RTABMAP_PARAM(OdomF2M, BundleAdjustment,          int, 0, "Local bundle adjustment: 0=disabled, 1=g2o, 2=cvsba.");
     RTABMAP_PARAM(OdomF2M, BundleAdjustmentMaxFrames, int, 0, "Maximum frames used for bundle adjustment (0=inf or all current frames in the local map).");
+    RTABMAP_PARAM(OdomF2M, BundleAdjustmentAsync, bool, false, uFormat("Do local bundle adjustment in a background thread each time a key-frame is added (the last %s key-frames are optimized). Refined 3D words are fed back to the local map when ready, so tracking is not blocked by the optimization.", kOdomF2MBundleAdjustmentMaxFrames().c_str()));
 
     // Odometry Mono
     RTABMAP_PARAM(OdomMono, InitMinFlow,        float, 100,  "Minimum optical flow required for the initialization step.");
@@ -449,6 +460,13 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(OdomORBSLAM2, Bf,          double, 0.076, "Fake IR projector baseline (m) used only when stereo is not used.");
     RTABMAP_PARAM(OdomORBSLAM2, ThDepth,     double, 40.0,  "Close/Far threshold. Baseline times.");
 
+    // Odometry Dense
+    RTABMAP_PARAM(OdomDense, PyramidLevels,    int, 4,      "Number of image pyramid levels (coarse-to-fine).");
+    RTABMAP_PARAM(OdomDense, MinLevel,         int, 0,      "Finest pyramid level optimized (0=full resolution). Increasing it trades accuracy for speed.");
+    RTABMAP_PARAM(OdomDense, MaxIterations,    int, 20,     "Maximum Gauss-Newton iterations per pyramid level.");
+    RTABMAP_PARAM(OdomDense, DepthWeight,      float, 1.0,  "Weight of the depth (geometric) error relative to the photometric error. 0 means photometric error only.");
+    RTABMAP_PARAM(OdomDense, MaxDepth,         float, 4.0,  "Maximum depth (m) of the key-frame pixels used. 0 means no limit.");
+
     // Common registration parameters
     RTABMAP_PARAM(Reg, VarianceFromInliersCount, bool, false,   "Set variance as the inverse of the number of inliers. Otherwise, the variance is computed as the average 3D position error of the inliers.");
     RTABMAP_PARAM(Reg, VarianceNormalized,       bool, false,   "Normalize covariance values. Position variances are multiplied by norm of the transform and orientation variances are multiplied by angle of the transform.");
@@ -466,6 +484,7 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(Vis, EpipolarGeometryVar,      float, 0.02,   uFormat("[%s = 2] Epipolar geometry maximum variance to accept the transformation.", kVisEstimationType().c_str()));
     RTABMAP_PARAM(Vis, MinInliers,               int, 20,       "Minimum feature correspondences to compute/accept the transformation.");
     RTABMAP_PARAM(Vis, Iterations,               int, 100,      "Maximum iterations to compute the transform.");
+    RTABMAP_PARAM(Vis, RansacType,               int, 0,        uFormat("[%s = 0 or 1] RANSAC implementation: 0=OpenCV (PnP) or PCL (3D->3D), 1=Built-in (hypotheses evaluated in parallel, number of iterations adapted to the inlier ratio found).", kVisEstimationType().c_str()));
 #ifndef RTABMAP_NONFREE
 #ifdef RTABMAP_OPENCV3
     // OpenCV 3 without xFeatures2D module doesn't have BRIEF
@@ -515,6 +534,7 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(Stereo, OpticalFlow,           bool, true,    "Use optical flow to find stereo correspondences, otherwise a simple block matching approach is used.");
     RTABMAP_PARAM(Stereo, SSD,                   bool, true,    uFormat("[%s=false] Use Sum of Squared Differences (SSD) window, otherwise Sum of Absolute Differences (SAD) window is used.", kStereoOpticalFlow().c_str()));
     RTABMAP_PARAM(Stereo, Eps,                   double, 0.01,  uFormat("[%s=true] Epsilon stop criterion.", kStereoOpticalFlow().c_str()));
+    RTABMAP_PARAM(Stereo, DenseStrategy,         int, 0,        "Dense disparity approach: 0=cv::StereoBM, 1=SGM (semi-global matching with census cost, see StereoSGM parameters).");
 
     RTABMAP_PARAM(StereoBM, BlockSize,           int, 15,       "See cv::StereoBM");
     RTABMAP_PARAM(StereoBM, MinDisparity,        int, 0,        "See cv::StereoBM");
@@ -526,6 +546,16 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(StereoBM, SpeckleWindowSize,   int, 100,      "See cv::StereoBM");
     RTABMAP_PARAM(StereoBM, SpeckleRange,        int, 4,        "See cv::StereoBM");
 
+    RTABMAP_PARAM(StereoSGM, MinDisparity,       int, 0,        "Minimum disparity.");
+    RTABMAP_PARAM(StereoSGM, NumDisparities,     int, 128,      "Number of disparities. A multiple of 16 uses only the vectorized path aggregation.");
+    RTABMAP_PARAM(StereoSGM, P1,                 int, 10,       "Penalty of a disparity change of 1 pixel between neighbors (census cost is between 0 and 62).");
+    RTABMAP_PARAM(StereoSGM, P2,                 int, 120,      "Penalty of larger disparity changes between neighbors, should be > P1.");
+    RTABMAP_PARAM(StereoSGM, Paths,              int, 8,        "Number of aggregation directions: 4 (horizontal and vertical) or 8 (with diagonals).");
+    RTABMAP_PARAM(StereoSGM, UniquenessRatio,    int, 5,        "Margin in percent by which the best cost should win the second best (non-adjacent) disparity.");
+    RTABMAP_PARAM(StereoSGM, Disp12MaxDiff,      int, 1,        "Maximum difference (pixels) of the left-right consistency check. A negative value disables the check.");
+    RTABMAP_PARAM(StereoSGM, SpeckleWindowSize,  int, 100,      "Maximum size of disparity regions considered as noise (0 disables speckle filtering).");
+    RTABMAP_PARAM(StereoSGM, SpeckleRange,       int, 2,        "Maximum disparity variation (pixels) within a connected region.");
+
     // Occupancy Grid
     RTABMAP_PARAM(Grid, FromDepth,               bool,   true,    "Create occupancy grid from depth image(s), otherwise it is created from laser scan.");
     RTABMAP_PARAM(Grid, DepthDecimation,         int,    4,       uFormat("[%s=true] Decimation of the depth image before creating cloud. Negative decimation is done from RGB size instead of depth size (if depth is smaller than RGB, it may be interpolated depending of the decimation value).", kGridDepthDecimation().c_str()));
@@ -557,6 +587,7 @@ class RTABMAP_EXP Parameters
     RTABMAP_PARAM(Grid, NoiseFilteringMinNeighbors, int,     5,      "Noise filtering minimum neighbors.");
     RTABMAP_PARAM(Grid, Scan2dUnknownSpaceFilled,   bool,    false,  "Unknown space filled. Only used with 2D laser scans.");
     RTABMAP_PARAM(Grid, Scan2dMaxFilledRange,       float,   4.0,    "Unknown space filled maximum range. If 0, the laser scan maximum range is used.");
+    RTABMAP_PARAM(Grid, LocalMapEncoding,           int,    0,       "Encoding of the local occupancy grids saved in the nodes, in the database and in the global map cache: 0=float points, 1=int16 cells relative to the node, 2=int16 cells run-length encoded along x. Cells are several times smaller than points and are reprojected faster in the global map.");
     RTABMAP_PARAM(Grid, ProjRayTracing,             bool,   true,    uFormat("[%s=false] 2D ray tracing is done for each projected obstacle, filling unknown space between the sensor and obstacles.", kGrid3D().c_str()));
 
     RTABMAP_PARAM(GridGlobal, FullUpdate,           bool,   true,    "When the graph is changed, the whole map will be reconstructed instead of moving individually each cells of the map. Also, data added to cache won't be released after updating the map. This process is longer but more robust to drift that would erase some parts of the map when it should not.");
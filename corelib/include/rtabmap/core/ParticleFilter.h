@@ -30,6 +30,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rtabmap/utilite/UMath.h>
 #include <rtabmap/utilite/ULogger.h>
+#include <algorithm>
+#include <vector>
 
 
 namespace rtabmap {
@@ -37,138 +39,172 @@ namespace rtabmap {
 // taken from http://www.developpez.net/forums/d544518/c-cpp/c/equivalent-randn-matlab-c/
 #define TWOPI (6.2831853071795864769252867665590057683943387987502) /* 2 * pi */
 
-/*
-   RAND is a macro which returns a pseudo-random numbers from a uniform
-   distribution on the interval [0 1]
-*/
-#define RAND (rand())/((double) RAND_MAX)
-
-/*
-   RANDN is a macro which returns a pseudo-random numbers from a normal
-   distribution with mean zero and standard deviation one. This macro uses Box
-   Muller's algorithm
-*/
-#define RANDN (sqrt(-2.0*log(RAND))*cos(TWOPI*RAND))
-
-std::vector<double> cumSum(const std::vector<double> & v)
+/**
+ * Joint particle filter of the 6 DoF (x,y,z,roll,pitch,yaw). Particles are
+ * stored as structure of arrays. Weights use the likelihood
+ * exp(-lambda*|particle-value|), combined over the dimensions.
+ * Particles are resampled with systematic resampling. The prediction (noise)
+ * step can be done in parallel for large particle sets.
+ */
+class ParticleFilter6DoF
 {
-	std::vector<double> cum(v.size());
-	double sum = 0;
-	for(unsigned int i=0; i<v.size(); ++i)
+public:
+	ParticleFilter6DoF(unsigned int nParticles = 200,
+				   double noiseT = 0.1,
+				   double lambdaT = 10.0,
+				   double noiseR = 0.1,
+				   double lambdaR = 10.0,
+				   bool parallelPredict = true) :
+		size_((int)nParticles),
+		parallelPredict_(parallelPredict),
+		seed_(0)
 	{
-		cum[i] = v[i] + sum;
-		sum += v[i];
+		UASSERT(nParticles > 0);
+		for(int d=0; d<6; ++d)
+		{
+			noise_[d] = d<3?noiseT:noiseR;
+			lambda_[d] = d<3?lambdaT:lambdaR;
+			particles_[d].resize(size_, 0.0);
+			resampled_[d].resize(size_, 0.0);
+		}
+		weights_.resize(size_);
 	}
-	return cum;
-}
 
-std::vector<double> resample(const std::vector<double> & p, // particles
-							 const std::vector<double> & w, // weights
-							 bool normalizeWeights = false)
-{
-	std::vector<double> np; //new particles
-	if(p.size() != w.size() || p.size() == 0)
+	void init(const double values[6])
 	{
-		UERROR("particles (%d) and weights (%d) are not the same size", p.size(), w.size());
-		return np;
+		for(int d=0; d<6; ++d)
+		{
+			std::fill(particles_[d].begin(), particles_[d].end(), values[d]);
+		}
 	}
 
-	std::vector<double> cs;
-	if(normalizeWeights)
+	// values are replaced by their estimates, disabled dimensions are not filtered.
+	void filter(double values[6], const bool enabled[6] = 0)
 	{
-		double wSum = uSum(w);
-		std::vector<double> wNorm(w.size());
-		for(unsigned int i=0; i<w.size(); ++i)
+		predict();
+
+		// log of the weights, vectorized over particles
+		double * w = &weights_[0];
+		std::fill(weights_.begin(), weights_.end(), 0.0);
+		for(int d=0; d<6; ++d)
 		{
-			wNorm[i] = w[i]/wSum;
+			if(enabled == 0 || enabled[d])
+			{
+				const double * p = &particles_[d][0];
+				const double value = values[d];
+				const double lambda = lambda_[d];
+				for(int i=0; i<size_; ++i)
+				{
+					w[i] -= lambda * fabs(p[i] - value);
+				}
+			}
+		}
+		double maxLogWeight = w[0];
+		for(int i=1; i<size_; ++i)
+		{
+			maxLogWeight = w[i] > maxLogWeight?w[i]:maxLogWeight;
+		}
+		double sumWeights = 0.0;
+		for(int i=0; i<size_; ++i)
+		{
+			w[i] = exp(w[i] - maxLogWeight); // relative to the best particle, cannot underflow for all particles
+			sumWeights += w[i];
 		}
-		cs = cumSum(wNorm); // cumulative sum
-	}
-	else
-	{
-		cs = cumSum(w); // cumulative sum
-	}
-	for(unsigned int j=0; j<cs.size(); ++j)
-	{
-		cs[j]/=cs.back();
-	}
 
-	np.resize(p.size());
-	for(unsigned int i=0; i<np.size(); ++i)
-	{
-		unsigned int index = 0;
-		double randnum = RAND;
-		for(unsigned int j=0; j<cs.size(); ++j)
+		// normalize and compute estimated values
+		for(int i=0; i<size_; ++i)
+		{
+			w[i] /= sumWeights;
+		}
+		for(int d=0; d<6; ++d)
 		{
-			if(randnum < cs[j])
+			if(enabled == 0 || enabled[d])
 			{
-				index = j;
-				break;
+				const double * p = &particles_[d][0];
+				double value = 0.0;
+				for(int i=0; i<size_; ++i)
+				{
+					value += w[i] * p[i];
+				}
+				values[d] = value;
 			}
 		}
-		np[i] = p[index];
-	}
-	return np;
-}
 
+		resample();
+	}
 
-class ParticleFilter
-{
-public:
-	ParticleFilter(unsigned int nParticles = 200,
-				   double noise = 0.1,
-				   double lambda = 10.0,
-				   double initValue = 0.0) :
-		noise_(noise),
-		lambda_(lambda)
+private:
+	// xorshift64*, a generator per block of particles so that the
+	// prediction gives the same result with any number of threads
+	static double uniform(unsigned long long & state)
 	{
-		particles_.resize(nParticles, initValue);
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return double((state * 2685821657736338717ULL) >> 11) * (1.0/9007199254740992.0); // [0,1)
 	}
 
-	void init(double initValue = 0.0f)
+	void predict()
 	{
-		particles_ = std::vector<double>(particles_.size(), initValue);
+		static const int kBlock = 256;
+		const int blocks = (size_ + kBlock - 1) / kBlock;
+		const unsigned long long seed = ++seed_;
+#ifdef _OPENMP
+		#pragma omp parallel for if(parallelPredict_ && blocks > 4)
+#endif
+		for(int b=0; b<blocks; ++b)
+		{
+			unsigned long long state = (seed * 0x9E3779B97F4A7C15ULL) ^ ((unsigned long long)(b+1) * 0xBF58476D1CE4E5B9ULL);
+			const int end = std::min(size_, (b+1)*kBlock);
+			for(int d=0; d<6; ++d)
+			{
+				double * p = &particles_[d][0];
+				for(int i=b*kBlock; i<end; ++i)
+				{
+					// Box-Muller
+					double u1 = 1.0 - uniform(state);
+					double u2 = uniform(state);
+					p[i] += noise_[d] * sqrt(-2.0*log(u1))*cos(TWOPI*u2);
+				}
+			}
+		}
 	}
 
-	double filter(double val)
+	// systematic resampling (weights should be normalized)
+	void resample()
 	{
-		std::vector<double> weights(particles_.size(), 1);
-		double sumWeights = 0;
-		for(unsigned int i=0; i<particles_.size(); ++i)
+		unsigned long long state = (++seed_) * 0x9E3779B97F4A7C15ULL;
+		const double step = 1.0/double(size_);
+		double u = uniform(state) * step;
+		double cumulative = weights_[0];
+		int j = 0;
+		for(int i=0; i<size_; ++i)
 		{
-			// add noise to particle
-			particles_[i] += noise_ * RANDN;
-
-			// compute weight
-			double dist = fabs(particles_[i] - val);
-			//dist = sqrt(dist*dist);
-			double w = exp(-lambda_*dist);
-			if(uIsFinite(w) && w > 0)
+			while(u > cumulative && j < size_-1)
 			{
-				weights[i] = w;
+				cumulative += weights_[++j];
 			}
-			sumWeights += weights[i];
+			for(int d=0; d<6; ++d)
+			{
+				resampled_[d][i] = particles_[d][j];
+			}
+			u += step;
 		}
-
-
-		//normalize and compute estimated value
-		double value =0.0;
-		for(unsigned int i=0; i<weights.size(); ++i)
+		for(int d=0; d<6; ++d)
 		{
-			weights[i] /= sumWeights;
-			value += weights[i] * particles_[i];
+			particles_[d].swap(resampled_[d]);
 		}
-
-		//resample the particles
-		particles_ = resample(particles_, weights, false);
-
-		return value;
 	}
 
 private:
-	std::vector<double> particles_;
-	double noise_;
-	double lambda_;
+	int size_;
+	bool parallelPredict_;
+	unsigned long long seed_;
+	double noise_[6];
+	double lambda_[6];
+	std::vector<double> particles_[6]; // SoA: particles_[dimension][particle]
+	std::vector<double> resampled_[6];
+	std::vector<double> weights_;
 };
 
 }
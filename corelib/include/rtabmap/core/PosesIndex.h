@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CORELIB_INCLUDE_RTABMAP_CORE_POSESINDEX_H_
+#define CORELIB_INCLUDE_RTABMAP_CORE_POSESINDEX_H_
+
+#include "rtabmap/core/RtabmapExp.h" // DLL export/import defines
+#include <rtabmap/core/Transform.h>
+#include <map>
+#include <set>
+
+namespace rtabmap {
+
+/**
+ * Hashed grid of node positions, updated incrementally when nodes are
+ * added, moved or removed. It avoids rebuilding a kd-tree of all the
+ * poses for each radius or nearest neighbor search.
+ */
+class RTABMAP_EXP PosesIndex
+{
+public:
+	PosesIndex(float cellSize = 1.0f);
+
+	// Set the cell size (m) of the grid, the index is rebuilt if the size changed.
+	void setCellSize(float cellSize);
+	float cellSize() const {return cellSize_;}
+
+	void clear();
+	void build(const std::map<int, Transform> & poses);
+	// add the node or move it if already indexed
+	void update(int id, const Transform & pose);
+	void remove(int id);
+
+	bool contains(int id) const {return positions_.find(id) != positions_.end();}
+	unsigned int size() const {return (unsigned int)positions_.size();}
+	bool empty() const {return positions_.empty();}
+
+	/**
+	 * Get nodes in the radius around the pose.
+	 * @param pose the query pose
+	 * @param radius radius to search for (m)
+	 * @param excludedId this node is not returned (e.g., the query node)
+	 * @return the nodes with squared distance to query pose.
+	 */
+	std::map<int, float> radiusSearch(const Transform & pose, float radius, int excludedId = 0) const;
+
+	// return the nearest node, 0 if the index is empty
+	int nearestSearch(const Transform & pose, float * sqrdDistance = 0) const;
+
+private:
+	class CellKey
+	{
+	public:
+		CellKey(int x = 0, int y = 0, int z = 0) : x(x), y(y), z(z) {}
+		bool operator<(const CellKey & k) const
+		{
+			return x<k.x || (x==k.x && (y<k.y || (y==k.y && z<k.z)));
+		}
+		bool operator==(const CellKey & k) const {return x==k.x && y==k.y && z==k.z;}
+		int x;
+		int y;
+		int z;
+	};
+
+	CellKey cellKey(float x, float y, float z) const;
+	void searchCell(const CellKey & key, const cv::Point3f & pt, int & id, float & sqrdDistance) const;
+
+private:
+	float cellSize_;
+	std::map<int, cv::Point3f> positions_;
+	std::map<CellKey, std::set<int> > cells_;
+	CellKey minKey_; // bounds of the occupied cells (only grow until the index is cleared)
+	CellKey maxKey_;
+};
+
+} /* namespace rtabmap */
+
+#endif /* CORELIB_INCLUDE_RTABMAP_CORE_POSESINDEX_H_ */
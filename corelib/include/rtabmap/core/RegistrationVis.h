@@ -32,10 +32,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rtabmap/core/Registration.h>
 #include <rtabmap/core/Signature.h>
+#include <rtabmap/utilite/UMutex.h>
+#include <list>
 
 namespace rtabmap {
 
 class Feature2D;
+class RegistrationVisMatcher;
 
 // Visual registration
 class RTABMAP_EXP RegistrationVis : public Registration
@@ -63,10 +66,16 @@ protected:
 	virtual bool isImageRequiredImpl() const {return true;}
 	virtual int getMinVisualCorrespondencesImpl() const {return _minInliers;}
 
+private:
+	RegistrationVisMatcher * acquireMatcher() const;
+	void releaseMatcher(RegistrationVisMatcher * matcher) const;
+	void clearMatchers();
+
 private:
 	int _minInliers;
 	float _inlierDistance;
 	int _iterations;
+	int _ransacType;
 	int _refineIterations;
 	float _epipolarGeometryVar;
 	int _estimationType;
@@ -85,6 +94,10 @@ private:
 
 	ParametersMap _featureParameters;
 	ParametersMap _bundleParameters;
+
+	// idle matchers, reused between calls (one is used by each concurrent call)
+	mutable std::list<RegistrationVisMatcher *> _matchers;
+	mutable UMutex _matchersMutex;
 };
 
 }
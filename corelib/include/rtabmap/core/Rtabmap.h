@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/Statistics.h"
 #include "rtabmap/core/Link.h"
 #include "rtabmap/core/ProgressState.h"
+#include "rtabmap/core/PosesIndex.h"
 
 #include <opencv2/core/core.hpp>
 #include <list>
@@ -49,6 +50,9 @@ class Memory;
 class BayesFilter;
 class Signature;
 class Optimizer;
+namespace graph {
+class DStarLite;
+}
 
 class RTABMAP_EXP Rtabmap
 {
@@ -208,6 +212,8 @@ private:
 private:
 	// Modifiable parameters
 	bool _publishStats;
+	bool _publishStatsDelta;
+	int _publishStatsKeyframe;
 	bool _publishLastSignatureData;
 	bool _publishPdf;
 	bool _publishLikelihood;
@@ -221,6 +227,7 @@ private:
 	bool _statisticLogsBufferedInRAM;
 	bool _statisticLogged;
 	bool _statisticLoggedHeaders;
+	bool _traceLogged;
 	bool _rgbdSlamMode;
 	float _rgbdLinearUpdate;
 	float _rgbdAngularUpdate;
@@ -237,6 +244,10 @@ private:
 	float _proximityFilteringRadius;
 	bool _proximityRawPosesUsed;
 	float _proximityAngle;
+	float _likelihoodRadius;
+	float _likelihoodFov;
+	int _likelihoodRandomSamples;
+	int _likelihoodPosteriorSamples;
 	std::string _databasePath;
 	bool _optimizeFromGraphEnd;
 	float _optimizationMaxLinearError;
@@ -246,6 +257,7 @@ private:
 	int _pathStuckIterations;
 	float _pathLinearVelocity;
 	float _pathAngularVelocity;
+	bool _pathIncremental;
 
 	std::pair<int, float> _loopClosureHypothesis;
 	std::pair<int, float> _highestHypothesis;
@@ -268,10 +280,15 @@ private:
 	std::list<std::string> _bufferedLogsI;
 
 	Statistics statistics_;
+	int _statsSequence;
+	int _statsLastKeyframe;
+	std::map<int, Transform> _publishedPoses; // local graph state of the receivers in delta mode
+	std::multimap<int, Link> _publishedConstraints;
 
 	std::string _wDir;
 
 	std::map<int, Transform> _optimizedPoses;
+	PosesIndex _optimizedPosesIndex; // spatial index of _optimizedPoses, kept up-to-date with it
 	std::multimap<int, Link> _constraints;
 	Transform _mapCorrection;
 	Transform _mapCorrectionBackup; // used in localization mode when odom is lost
@@ -287,6 +304,7 @@ private:
 	Transform _pathTransformToGoal;
 	int _pathStuckCount;
 	float _pathStuckDistance;
+	graph::DStarLite * _pathPlanner; // incremental planner, kept between plans
 
 };
 
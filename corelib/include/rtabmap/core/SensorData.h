@@ -213,6 +213,8 @@ public:
 	const cv::Mat & userDataCompressed() const {return _userDataCompressed;}
 
 	// detect automatically if raw or compressed. If raw, the data will be compressed.
+	// Raw local maps can be points or cells encoded with util3d::encodeLocalMapCells(),
+	// uncompressData() always returns points.
 	void setOccupancyGrid(
 			const cv::Mat & ground,
 			const cv::Mat & obstacles,
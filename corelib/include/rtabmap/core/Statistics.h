@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <opencv2/imgproc/imgproc.hpp>
 #include <list>
 #include <vector>
+#include <set>
 #include <rtabmap/core/Signature.h>
 #include <rtabmap/core/Link.h>
 
@@ -66,6 +67,7 @@ class RTABMAP_EXP Statistics
 	RTABMAP_STATS(Loop, Optimization_max_error, m);
 	RTABMAP_STATS(Loop, Optimization_error, );
 	RTABMAP_STATS(Loop, Optimization_iterations, );
+	RTABMAP_STATS(Loop, Likelihood_skipped, );
 
 	RTABMAP_STATS(Proximity, Time_detections,);
 	RTABMAP_STATS(Proximity, Space_last_detection_id,);
@@ -170,6 +172,9 @@ public:
 	void setLocalPath(const std::vector<int> & localPath) {_localPath=localPath;}
 	void setCurrentGoalId(int goal) {_currentGoalId=goal;}
 	void setReducedIds(const std::map<int, int> & reducedIds) {_reducedIds = reducedIds;}
+	void setGraphSequence(int sequence, bool keyframe) {_graphSequence = sequence; _graphKeyframe = keyframe;}
+	void setRemovedPoses(const std::set<int> & removedPoses) {_removedPoses = removedPoses;}
+	void setRemovedConstraints(const std::multimap<int, Link> & removedConstraints) {_removedConstraints = removedConstraints;}
 
 	// getters
 	bool extended() const {return _extended;}
@@ -191,6 +196,25 @@ public:
 	const std::vector<int> & localPath() const {return _localPath;}
 	int currentGoalId() const {return _currentGoalId;}
 	const std::map<int, int> & reducedIds() const {return _reducedIds;}
+	// 0 -> poses(), constraints() and getSignatures() contain the full local graph,
+	// >0 -> they contain only what changed since the previous sequence (see Rtabmap/PublishStatsDelta)
+	int graphSequence() const {return _graphSequence;}
+	bool graphKeyframe() const {return _graphKeyframe;}
+	const std::set<int> & removedPoses() const {return _removedPoses;}
+	const std::multimap<int, Link> & removedConstraints() const {return _removedConstraints;}
+
+	/**
+	 * Update a graph maintained by the receiver with the poses/constraints of these statistics.
+	 * Non-delta statistics and keyframes replace the graph, deltas are applied over it.
+	 * Node infos (no sensor data) are kept for the nodes in the graph.
+	 * @param sequence last sequence applied, updated on success
+	 * @return false if a delta is missing (graph is left unchanged until the next keyframe)
+	 */
+	bool updateGraph(
+			std::map<int, Transform> & poses,
+			std::multimap<int, Link> & constraints,
+			std::map<int, Signature> & nodeInfos,
+			int & sequence) const;
 
 	const std::map<std::string, float> & data() const {return _data;}
 
@@ -219,6 +243,11 @@ private:
 
 	std::map<int, int> _reducedIds;
 
+	int _graphSequence;
+	bool _graphKeyframe;
+	std::set<int> _removedPoses;
+	std::multimap<int, Link> _removedConstraints;
+
 	// Format for statistics (Plottable statistics must go in that map) :
 	// {"Group/Name/Unit", value}
 	// Example : {"Timing/Total time/ms", 500.0f}
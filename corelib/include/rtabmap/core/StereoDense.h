@@ -36,6 +36,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace rtabmap {
 
 class RTABMAP_EXP StereoDense {
+public:
+	enum Type {
+		kTypeBM = 0,
+		kTypeSGM = 1
+	};
+	static StereoDense * create(const ParametersMap & parameters);
+	static StereoDense * create(Type type, const ParametersMap & parameters = ParametersMap());
+
 public:
 	virtual ~StereoDense() {}
 
@@ -71,6 +79,36 @@ private:
 	int speckleRange_;      //4
 };
 
+/**
+ * Semi-global matching (H. Hirschmuller, 2008) with a 9x7 census transform
+ * as matching cost. Each aggregation direction is a pass over independent
+ * scanlines done in parallel, the disparities of a pixel being updated with
+ * SIMD instructions (AVX2, SSE2 or NEON when available). Disparities are
+ * selected with a uniqueness test, refined to sub-pixel and validated with
+ * a left-right consistency check on the same aggregated costs.
+ */
+class RTABMAP_EXP StereoSGM : public StereoDense {
+public:
+	StereoSGM(const ParametersMap & parameters = ParametersMap());
+	virtual ~StereoSGM() {}
+
+	virtual void parseParameters(const ParametersMap & parameters);
+	virtual cv::Mat computeDisparity(
+			const cv::Mat & leftImage,
+			const cv::Mat & rightImage) const;
+
+private:
+	int minDisparity_;      //0
+	int numDisparities_;    //128
+	int p1_;                //10
+	int p2_;                //120
+	int paths_;             //8
+	int uniquenessRatio_;   //5
+	int disp12MaxDiff_;     //1
+	int speckleWindowSize_; //100
+	int speckleRange_;      //2
+};
+
 } /* namespace rtabmap */
 
 #endif /* STEREODENSE_H_ */
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CORELIB_SRC_TSDFVOLUME_H_
+#define CORELIB_SRC_TSDFVOLUME_H_
+
+#include "rtabmap/core/RtabmapExp.h" // DLL export/import defines
+
+#include <rtabmap/core/Transform.h>
+#include <rtabmap/core/CameraModel.h>
+#include <rtabmap/core/SensorData.h>
+#include <pcl/PolygonMesh.h>
+#include <opencv2/core/core.hpp>
+#include <map>
+#include <vector>
+
+namespace rtabmap {
+
+class TSDFBlockHash;
+
+/**
+ * Truncated signed distance function (TSDF) volume stored in blocks of
+ * 8x8x8 voxels allocated only around observed surfaces (voxel hashing).
+ * Depth images are integrated with the voxels of a frame updated in
+ * parallel. Integrated frames are kept so that nodes can be de-integrated
+ * and re-integrated when their poses are optimized. The surface is
+ * extracted with marching cubes.
+ */
+class RTABMAP_EXP TSDFVolume
+{
+public:
+	/**
+	 * @param voxelSize size of a voxel (m)
+	 * @param truncationDistance distance behind and in front of the surface
+	 *        in which the voxels are updated (m), should be at least 2 voxels
+	 * @param maxDepth depth values over this distance are ignored (m), 0 means inf
+	 * @param keepFrames keep integrated depth images for deintegrate()/update()
+	 */
+	TSDFVolume(float voxelSize = 0.01f, float truncationDistance = 0.04f, float maxDepth = 4.0f, bool keepFrames = true);
+	virtual ~TSDFVolume();
+
+	void clear();
+	float voxelSize() const {return voxelSize_;}
+	float truncationDistance() const {return truncationDistance_;}
+	int blocks() const;
+	unsigned long memoryUsage() const; // bytes
+	const std::map<int, Transform> & addedNodes() const {return addedNodes_;}
+
+	/**
+	 * Integrate the depth image of a node (with color if the image is set).
+	 * @param nodeId id of the node, if already integrated, it is first deintegrated
+	 * @param depth CV_16UC1 (mm) or CV_32FC1 (m)
+	 * @param rgb CV_8UC3 or CV_8UC1, can be empty or larger than depth (same ratio)
+	 * @param model calibration of the depth image, with its local transform
+	 * @param pose pose of the node (base frame)
+	 */
+	bool integrate(
+			int nodeId,
+			const cv::Mat & depth,
+			const cv::Mat & rgb,
+			const CameraModel & model,
+			const Transform & pose);
+	/**
+	 * Same as above with raw (uncompressed) data of a node, multiple RGB-D cameras are supported.
+	 */
+	bool integrate(int nodeId, const SensorData & data, const Transform & pose);
+
+	// Remove the contribution of a node, return false if the node has not been integrated or frames are not kept
+	bool deintegrate(int nodeId);
+
+	/**
+	 * Re-integrate nodes whose poses changed more than the thresholds (0 means
+	 * any change) and deintegrate nodes not in poses. Returns the number of
+	 * re-integrated nodes. Frames should be kept.
+	 */
+	int update(const std::map<int, Transform> & poses, float linearThr = 0.0f, float angularThr = 0.0f);
+
+	/**
+	 * Marching cubes of the zero level set, done in parallel on blocks. Vertices
+	 * (pcl::PointXYZRGBNormal) are shared between adjacent triangles.
+	 * @param minWeight cubes with a voxel having a weight <= minWeight are ignored
+	 */
+	pcl::PolygonMesh::Ptr extractMesh(float minWeight = 0.0f) const;
+
+private:
+	class Frame
+	{
+	public:
+		cv::Mat depth;
+		cv::Mat rgb;
+		CameraModel model;
+	};
+	void integrateFrames(const std::vector<Frame> & frames, const Transform & pose, float weight);
+
+private:
+	float voxelSize_;
+	float truncationDistance_;
+	float maxDepth_;
+	bool keepFrames_;
+	TSDFBlockHash * blocks_;
+	std::map<int, Transform> addedNodes_;
+	std::map<int, std::vector<Frame> > frames_;
+};
+
+} /* namespace rtabmap */
+
+#endif /* CORELIB_SRC_TSDFVOLUME_H_ */
@@ -56,24 +56,24 @@ public:
 	// x,y, theta
 	Transform(float x, float y, float theta);
 
-	float r11() const {return data()[0];}
-	float r12() const {return data()[1];}
-	float r13() const {return data()[2];}
-	float r21() const {return data()[4];}
-	float r22() const {return data()[5];}
-	float r23() const {return data()[6];}
-	float r31() const {return data()[8];}
-	float r32() const {return data()[9];}
-	float r33() const {return data()[10];}
-
-	float o14() const {return data()[3];}
-	float o24() const {return data()[7];}
-	float o34() const {return data()[11];}
-
-	float & operator[](int index) {return data()[index];}
-	const float & operator[](int index) const {return data()[index];}
-	float & operator()(int row, int col) {return data()[row*4 + col];}
-	const float & operator()(int row, int col) const {return data()[row*4 + col];}
+	float r11() const {return data_[0];}
+	float r12() const {return data_[1];}
+	float r13() const {return data_[2];}
+	float r21() const {return data_[4];}
+	float r22() const {return data_[5];}
+	float r23() const {return data_[6];}
+	float r31() const {return data_[8];}
+	float r32() const {return data_[9];}
+	float r33() const {return data_[10];}
+
+	float o14() const {return data_[3];}
+	float o24() const {return data_[7];}
+	float o34() const {return data_[11];}
+
+	float & operator[](int index) {return data_[index];}
+	const float & operator[](int index) const {return data_[index];}
+	float & operator()(int row, int col) {return data_[row*4 + col];}
+	const float & operator()(int row, int col) const {return data_[row*4 + col];}
 
 	bool isNull() const;
 	bool isIdentity() const;
@@ -81,17 +81,18 @@ public:
 	void setNull();
 	void setIdentity();
 
-	const cv::Mat & dataMatrix() const {return data_;}
-	const float * data() const {return (const float *)data_.data;}
-	float * data() {return (float *)data_.data;}
+	// 3x4 CV_32FC1 header on the data of this transform (not a copy, valid while this transform exists)
+	cv::Mat dataMatrix() const {return cv::Mat(3, 4, CV_32FC1, (void*)data_);}
+	const float * data() const {return data_;}
+	float * data() {return data_;}
 	int size() const {return 12;}
 
-	float & x() {return data()[3];}
-	float & y() {return data()[7];}
-	float & z() {return data()[11];}
-	const float & x() const {return data()[3];}
-	const float & y() const {return data()[7];}
-	const float & z() const {return data()[11];}
+	float & x() {return data_[3];}
+	float & y() {return data_[7];}
+	float & z() {return data_[11];}
+	const float & x() const {return data_[3];}
+	const float & y() const {return data_[7];}
+	const float & z() const {return data_[11];}
 
 	float theta() const;
 
@@ -147,7 +148,7 @@ public:
 	static bool canParseString(const std::string & string);
 
 private:
-	cv::Mat data_;
+	float data_[12]; // row-major 3x4, stored inline (no allocation on copy)
 };
 
 RTABMAP_EXP std::ostream& operator<<(std::ostream& os, const Transform& s);
@@ -86,7 +86,9 @@ namespace clams
 		bin_depth_(0),
 		num_bins_x_(0),
 		num_bins_y_(0),
-		training_samples_(0)
+		training_samples_(0),
+		lut_bins_(0),
+		lut_bin_depth_(0)
     {}
     virtual ~DiscreteDepthDistortionModel();
     DiscreteDepthDistortionModel(int width, int height, int bin_width = 8, int bin_height = 6, double bin_depth = 2.0, int smoothing = 1, double max_depth = 10.0);
@@ -129,6 +131,14 @@ namespace clams
 
     size_t training_samples_;
 
+    //! Flattened copy of the frustums used by undistort(): for each bin (y*num_bins_x_+x),
+    //! lut_bins_ multipliers and if they can be interpolated (enough examples).
+    std::vector<float> lut_multipliers_;
+    std::vector<unsigned char> lut_interpolated_;
+    int lut_bins_;
+    double lut_bin_depth_;
+
+    void updateLookupTable();
     void deleteFrustums();
     DiscreteFrustum& frustum(int y, int x);
     const DiscreteFrustum& frustum(int y, int x) const;
@@ -118,6 +118,28 @@ cv::Mat RTABMAP_EXP convertMap2Image8U(const cv::Mat & map8S);
 
 cv::Mat RTABMAP_EXP erodeMap(const cv::Mat & map);
 
+/**
+ * Encode an occupancy local map (points in the node frame, CV_32FC2 or CV_32FC3)
+ * as cell coordinates relative to the node origin. Points falling in the same cell are merged.
+ * @param points the local map (1 row)
+ * @param cellSize size of the cells (m)
+ * @param runLength consecutive cells along x are merged in runs
+ * @return 1 row matrix of int16 cells: CV_16SC2 (x,y), CV_16SC3 (x,y,length) with runs,
+ *         or CV_16SC4 (x,y,z,length) for 3D local maps (runs of length 1 if runLength is false).
+ *         If a cell cannot be represented on 16 bits, the points are returned unchanged.
+ */
+cv::Mat RTABMAP_EXP encodeLocalMapCells(const cv::Mat & points, float cellSize, bool runLength = true);
+
+/**
+ * Decode cells created by encodeLocalMapCells() to points at the center of the cells,
+ * optionally transformed. Along runs, the points are transformed incrementally.
+ * @param cells encoded local map, float points are only transformed
+ * @param cellSize size of the cells used to encode the local map
+ * @param transform transform applied to the points (e.g., the pose of the node)
+ * @return CV_32FC2 or CV_32FC3 points
+ */
+cv::Mat RTABMAP_EXP decodeLocalMapCells(const cv::Mat & cells, float cellSize, const Transform & transform = Transform());
+
 template<typename PointT>
 typename pcl::PointCloud<PointT>::Ptr projectCloudOnXYPlane(
 		const typename pcl::PointCloud<PointT> & cloud);
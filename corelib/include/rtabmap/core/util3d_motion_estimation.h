@@ -52,7 +52,8 @@ Transform RTABMAP_EXP estimateMotion3DTo2D(
 			const std::map<int, cv::Point3f> & words3B = std::map<int, cv::Point3f>(),
 			cv::Mat * covariance = 0, // mean reproj error if words3B is not set
 			std::vector<int> * matchesOut = 0,
-			std::vector<int> * inliersOut = 0);
+			std::vector<int> * inliersOut = 0,
+			int ransacType = 0); // 0=OpenCV/PCL, 1=built-in parallel RANSAC
 
 Transform RTABMAP_EXP estimateMotion3DTo3D(
 			const std::map<int, cv::Point3f> & words3A,
@@ -63,7 +64,8 @@ Transform RTABMAP_EXP estimateMotion3DTo3D(
 			int refineIterations = 5,
 			cv::Mat * covariance = 0,
 			std::vector<int> * matchesOut = 0,
-			std::vector<int> * inliersOut = 0);
+			std::vector<int> * inliersOut = 0,
+			int ransacType = 0); // 0=OpenCV/PCL, 1=built-in parallel RANSAC
 
 void RTABMAP_EXP solvePnPRansac(
 		const std::vector<cv::Point3f> & objectPoints,
@@ -79,7 +81,8 @@ void RTABMAP_EXP solvePnPRansac(
 		std::vector<int> & inliers,
 		int flags,
 		int refineIterations = 1,
-		float refineSigma = 3.0f);
+		float refineSigma = 3.0f,
+		int ransacType = 0); // 0=OpenCV, 1=built-in parallel RANSAC
 
 } // namespace util3d
 } // namespace rtabmap
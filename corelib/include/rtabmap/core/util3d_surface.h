@@ -161,6 +161,28 @@ pcl::TextureMesh::Ptr RTABMAP_EXP createTextureMesh(
 		const ProgressState * state = 0,
 		std::vector<std::map<int, pcl::PointXY> > * vertexToPixels = 0);
 
+/**
+ * Same as createTextureMesh() but for large meshes. Polygons are partitioned in cubic chunks
+ * of size "chunkSize" (the chunk containing the polygon's centroid). Chunks are textured in parallel
+ * (OpenMP) and each chunk is textured only by the cameras whose frustum overlaps it. Depth images
+ * can be compressed: they are uncompressed only while a chunk using them is textured.
+ * Chunk vertices are duplicated at the borders. Like createTextureMesh(), the last
+ * material of the returned mesh is the "occluded" one.
+ */
+pcl::TextureMesh::Ptr RTABMAP_EXP createTextureMeshChunked(
+		const pcl::PolygonMesh::Ptr & mesh,
+		const std::map<int, Transform> & poses,
+		const std::map<int, std::vector<CameraModel> > & cameraModels,
+		const std::map<int, cv::Mat> & cameraDepths, // raw or compressed
+		float chunkSize,
+		float maxDistance = 0.0f, // max camera distance to polygon to apply texture
+		float maxDepthError = 0.0f, // maximum depth error between reprojected mesh and depth image to texture a face (-1=disabled, 0=edge length is used)
+		float maxAngle = 0.0f, // maximum angle between camera and face (0=disabled)
+		int minClusterSize = 50, // minimum size of polygons clusters textured
+		const std::vector<float> & roiRatios = std::vector<float>(), // [left, right, top, bottom] region of interest (in ratios) of the image projected.
+		const ProgressState * state = 0,
+		std::vector<std::map<int, pcl::PointXY> > * vertexToPixels = 0);
+
 /**
  * Remove not textured polygon clusters. If minClusterSize<0, only the largest cluster is kept.
  */
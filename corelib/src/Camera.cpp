@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UFile.h>
 #include <rtabmap/utilite/UDirectory.h>
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 
 #include <opencv2/imgproc/imgproc.hpp>
 
@@ -61,6 +62,7 @@ Camera::~Camera()
 
 SensorData Camera::takeImage(CameraInfo * info)
 {
+	UTRACE("Camera::takeImage");
 	bool warnFrameRateTooHigh = false;
 	float actualFrameRate = 0;
 	if(_imageRate>0)
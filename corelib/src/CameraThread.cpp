@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/clams/discrete_depth_distortion_model.h"
 
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 #include <rtabmap/utilite/ULogger.h>
 
 #include <pcl/io/io.h>
@@ -58,7 +59,7 @@ CameraThread::CameraThread(Camera * camera, const ParametersMap & parameters) :
 		_scanMinDepth(0.0f),
 		_scanVoxelSize(0.0f),
 		_scanNormalsK(0),
-		_stereoDense(new StereoBM(parameters)),
+		_stereoDense(StereoDense::create(parameters)),
 		_distortionModel(0),
 		_bilateralFiltering(false),
 		_bilateralSigmaS(10),
@@ -174,6 +175,7 @@ void CameraThread::mainLoopKill()
 
 void CameraThread::postUpdate(SensorData * dataPtr, CameraInfo * info) const
 {
+	UTRACE("CameraThread::postUpdate");
 	UASSERT(dataPtr!=0);
 	SensorData & data = *dataPtr;
 	if(_colorOnly && !data.depthRaw().empty())
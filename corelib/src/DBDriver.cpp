@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/utilite/UMath.h"
 #include "rtabmap/utilite/ULogger.h"
 #include "rtabmap/utilite/UTimer.h"
+#include "rtabmap/utilite/UTrace.h"
 #include "rtabmap/utilite/UStl.h"
 #include "DBDriverSqlite3.h"
 
@@ -298,6 +299,7 @@ void DBDriver::emptyTrashes(bool async)
 		this->start();
 		return;
 	}
+	UTRACE("DBDriver::emptyTrashes");
 
 	UTimer totalTime;
 	totalTime.start();
@@ -509,6 +511,7 @@ void DBDriver::loadSignatures(const std::list<int> & signIds,
 		std::list<Signature *> & signatures,
 		std::set<int> * loadedFromTrash)
 {
+	UTRACE("DBDriver::loadSignatures");
 	UDEBUG("");
 	// look up in the trash before the database
 	std::list<int> ids = signIds;
@@ -601,6 +604,7 @@ void DBDriver::loadWords(const std::set<int> & wordIds, std::list<VisualWord *>
 
 void DBDriver::loadNodeData(std::list<Signature *> & signatures, bool images, bool scan, bool userData, bool occupancyGrid) const
 {
+	UTRACE("DBDriver::loadNodeData");
 	// Don't look in the trash, we assume that if we want to load
 	// data of a signature, it is not in thrash! Print an error if so.
 	_trashesMutex.lock();
@@ -624,6 +628,7 @@ void DBDriver::getNodeData(
 		SensorData & data,
 		bool images, bool scan, bool userData, bool occupancyGrid) const
 {
+	UTRACE("DBDriver::getNodeData");
 	bool found = false;
 	// look in the trash
 	_trashesMutex.lock();
@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "rtabmap/core/DBReader.h"
 #include "rtabmap/core/DBDriver.h"
+#include "rtabmap/core/Signature.h"
 #include "DBDriverSqlite3.h"
 
 #include <rtabmap/utilite/ULogger.h>
@@ -34,6 +35,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UStl.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UEventsManager.h>
+#include <rtabmap/utilite/UThread.h>
+#include <rtabmap/utilite/UMutex.h>
+#include <rtabmap/utilite/USemaphore.h>
 
 #include "rtabmap/core/CameraEvent.h"
 #include "rtabmap/core/RtabmapEvent.h"
@@ -41,8 +45,212 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/util3d.h"
 #include "rtabmap/core/Compression.h"
 
+#include <deque>
+
 namespace rtabmap {
 
+// A node read from the database with its data uncompressed
+class DBReaderFrame
+{
+public:
+	DBReaderFrame(int id = 0) :
+		id(id),
+		mapId(0),
+		weight(0),
+		stamp(0.0)
+	{}
+	int id;
+	SensorData data;
+	Transform pose;
+	int mapId;
+	int weight;
+	double stamp;
+	Transform groundTruth;
+	cv::Mat neighborInfMatrix; // information matrix of the link with the previous node, empty if none
+};
+
+// Sensor data of all frames are loaded with a single query, then
+// uncompressed in parallel.
+static void readFrames(
+		const DBDriver * dbDriver,
+		std::vector<DBReaderFrame> & frames,
+		bool odometryIgnored,
+		int cameraIndex)
+{
+	std::list<Signature> tmp;
+	std::list<Signature *> signatures;
+	for(unsigned int i=0; i<frames.size(); ++i)
+	{
+		tmp.push_back(Signature(frames[i].id));
+		signatures.push_back(&tmp.back());
+	}
+	dbDriver->loadNodeData(signatures);
+
+	std::list<Signature>::iterator iter=tmp.begin();
+	for(unsigned int i=0; i<frames.size(); ++i, ++iter)
+	{
+		DBReaderFrame & frame = frames[i];
+		frame.data = iter->sensorData();
+
+		std::string label;
+		std::vector<float> velocity;
+		dbDriver->getNodeInfo(frame.id, frame.pose, frame.mapId, frame.weight, label, frame.stamp, frame.groundTruth, velocity);
+
+		if(!odometryIgnored)
+		{
+			std::map<int, Link> links;
+			dbDriver->loadLinks(frame.id, links, Link::kNeighbor);
+			if(links.size() && links.begin()->first < frame.id)
+			{
+				// assume the first is the backward neighbor
+				frame.neighborInfMatrix = links.begin()->second.infMatrix();
+			}
+		}
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if(frames.size() > 1)
+#endif
+	for(int i=0; i<(int)frames.size(); ++i)
+	{
+		SensorData & data = frames[i].data;
+		data.uncompressData();
+		if(data.cameraModels().size() > 1 &&
+			cameraIndex >= 0)
+		{
+			if(cameraIndex < (int)data.cameraModels().size())
+			{
+				// select one camera
+				int subImageWidth = data.imageRaw().cols/data.cameraModels().size();
+				UASSERT(!data.imageRaw().empty() &&
+						data.imageRaw().cols % data.cameraModels().size() == 0 &&
+						cameraIndex*subImageWidth < data.imageRaw().cols);
+				data.setImageRaw(
+						cv::Mat(data.imageRaw(),
+						cv::Rect(cameraIndex*subImageWidth, 0, subImageWidth, data.imageRaw().rows)).clone());
+
+				if(!data.depthOrRightRaw().empty())
+				{
+					UASSERT(data.depthOrRightRaw().cols % data.cameraModels().size() == 0 &&
+							subImageWidth == data.depthOrRightRaw().cols/(int)data.cameraModels().size() &&
+							cameraIndex*subImageWidth < data.depthOrRightRaw().cols);
+					data.setDepthOrRightRaw(
+							cv::Mat(data.depthOrRightRaw(),
+							cv::Rect(cameraIndex*subImageWidth, 0, subImageWidth, data.depthOrRightRaw().rows)).clone());
+				}
+				CameraModel model = data.cameraModels().at(cameraIndex);
+				data.setCameraModel(model);
+			}
+			else
+			{
+				UWARN("DBReader: Camera index %d doesn't exist! Camera models = %d.", cameraIndex, (int)data.cameraModels().size());
+			}
+		}
+	}
+}
+
+// Reads the next nodes by windows of "size" frames, keeping at most
+// two windows in the queue.
+class DBReaderReadAhead : public UThread
+{
+public:
+	DBReaderReadAhead(
+			const DBDriver * dbDriver,
+			const std::vector<int> & ids,
+			int size,
+			bool odometryIgnored,
+			int cameraIndex) :
+		dbDriver_(dbDriver),
+		ids_(ids),
+		size_(size),
+		next_(0),
+		odometryIgnored_(odometryIgnored),
+		cameraIndex_(cameraIndex),
+		freeSlots_(size*2),
+		done_(false)
+	{
+		UASSERT(size_ > 0);
+	}
+	virtual ~DBReaderReadAhead()
+	{
+		this->join(true);
+	}
+
+	// blocking, return false if there are no more frames
+	bool take(DBReaderFrame & frame)
+	{
+		framesReady_.acquire();
+		UScopeMutex lock(mutex_);
+		if(frames_.empty())
+		{
+			// done, wake up next call too
+			framesReady_.release();
+			return false;
+		}
+		frame = frames_.front();
+		frames_.pop_front();
+		freeSlots_.release();
+		return true;
+	}
+
+protected:
+	virtual void mainLoop()
+	{
+		int n = std::min(size_, (int)ids_.size() - next_);
+		if(n <= 0)
+		{
+			mutex_.lock();
+			done_ = true;
+			mutex_.unlock();
+			framesReady_.release();
+			this->kill();
+			return;
+		}
+
+		freeSlots_.acquire(n);
+		if(this->isKilled())
+		{
+			return;
+		}
+
+		std::vector<DBReaderFrame> frames(n);
+		for(int i=0; i<n; ++i)
+		{
+			frames[i].id = ids_[next_+i];
+		}
+		readFrames(dbDriver_, frames, odometryIgnored_, cameraIndex_);
+		next_ += n;
+
+		mutex_.lock();
+		frames_.insert(frames_.end(), frames.begin(), frames.end());
+		mutex_.unlock();
+		framesReady_.release(n);
+	}
+
+	virtual void mainLoopKill()
+	{
+		// unblock the reading thread
+		freeSlots_.release(size_*2);
+		if(!done_)
+		{
+			framesReady_.release();
+		}
+	}
+
+private:
+	const DBDriver * dbDriver_;
+	std::vector<int> ids_;
+	int size_;
+	int next_;
+	bool odometryIgnored_;
+	int cameraIndex_;
+	USemaphore freeSlots_;
+	USemaphore framesReady_;
+	UMutex mutex_;
+	std::deque<DBReaderFrame> frames_;
+	bool done_;
+};
+
 DBReader::DBReader(const std::string & databasePath,
 				   float frameRate,
 				   bool odometryIgnored,
@@ -57,7 +265,9 @@ DBReader::DBReader(const std::string & databasePath,
 	_goalsIgnored(goalsIgnored),
 	_startIndex(startIndex),
 	_cameraIndex(cameraIndex),
+	_readAheadSize(0),
 	_dbDriver(0),
+	_readAhead(0),
 	_currentId(_ids.end()),
 	_previousMapId(-1),
 	_previousStamp(0),
@@ -80,7 +290,9 @@ DBReader::DBReader(const std::list<std::string> & databasePaths,
 	_goalsIgnored(goalsIgnored),
 	_startIndex(startIndex),
 	_cameraIndex(cameraIndex),
+	_readAheadSize(0),
 	_dbDriver(0),
+	_readAhead(0),
 	_currentId(_ids.end()),
 	_previousMapId(-1),
 	_previousStamp(0),
@@ -91,6 +303,7 @@ DBReader::DBReader(const std::list<std::string> & databasePaths,
 
 DBReader::~DBReader()
 {
+	delete _readAhead;
 	if(_dbDriver)
 	{
 		_dbDriver->closeConnection();
@@ -102,6 +315,11 @@ bool DBReader::init(
 		const std::string & calibrationFolder,
 		const std::string & cameraName)
 {
+	if(_readAhead)
+	{
+		delete _readAhead;
+		_readAhead = 0;
+	}
 	if(_dbDriver)
 	{
 		_dbDriver->closeConnection();
@@ -196,6 +414,17 @@ bool DBReader::init(
 		_calibrated = true; // database is empty, make sure calibration warning is not shown.
 	}
 
+	if(_readAheadSize > 0 && _currentId != _ids.end())
+	{
+		_readAhead = new DBReaderReadAhead(
+				_dbDriver,
+				std::vector<int>(_currentId, _ids.end()),
+				_readAheadSize,
+				_odometryIgnored,
+				_cameraIndex);
+		_readAhead->start();
+	}
+
 	_timer.start();
 
 	return true;
@@ -312,27 +541,38 @@ SensorData DBReader::getNextData(CameraInfo * info)
 	{
 		if(_currentId != _ids.end())
 		{
-			int mapId;
-			_dbDriver->getNodeData(*_currentId, data);
+			DBReaderFrame frame(*_currentId);
+			if(_readAhead)
+			{
+				if(!_readAhead->take(frame))
+				{
+					UERROR("Read-ahead thread stopped before the end of the database!");
+					return data;
+				}
+				UASSERT_MSG(frame.id == *_currentId, uFormat("%d vs %d", frame.id, *_currentId).c_str());
+			}
+			else
+			{
+				std::vector<DBReaderFrame> frames(1, frame);
+				readFrames(_dbDriver, frames, _odometryIgnored, _cameraIndex);
+				frame = frames[0];
+			}
+			data = frame.data;
 
 			// info
-			Transform pose;
-			int weight;
-			std::string label;
-			double stamp;
-			Transform groundTruth;
-			std::vector<float> velocity;
-			_dbDriver->getNodeInfo(*_currentId, pose, mapId, weight, label, stamp, groundTruth, velocity);
+			Transform pose = frame.pose;
+			int mapId = frame.mapId;
+			int weight = frame.weight;
+			double stamp = frame.stamp;
+			Transform groundTruth = frame.groundTruth;
 
 			cv::Mat infMatrix = cv::Mat::eye(6,6,CV_64FC1);
 			if(!_odometryIgnored)
 			{
-				std::map<int, Link> links;
-				_dbDriver->loadLinks(*_currentId, links, Link::kNeighbor);
-				if(links.size() && links.begin()->first < *_currentId)
+				if(!frame.neighborInfMatrix.empty())
 				{
-					// assume the first is the backward neighbor, take its variance
-					infMatrix = links.begin()->second.infMatrix();
+					// take the variance of the backward neighbor
+					infMatrix = frame.neighborInfMatrix;
 					_previousInfMatrix = infMatrix;
 				}
 				else if(_previousMapId != mapId)
@@ -361,7 +601,7 @@ SensorData DBReader::getNextData(CameraInfo * info)
 			++_currentId;
 			if(data.imageCompressed().empty() && weight>=0)
 			{
-				UWARN("No image loaded from the database for id=%d!", *_currentId);
+				UWARN("No image loaded from the database for id=%d!", seq);
 			}
 
 			// Frame rate
@@ -400,38 +640,6 @@ SensorData DBReader::getNextData(CameraInfo * info)
 				_previousMapID = mapId;
 			}
 
-			data.uncompressData();
-			if(data.cameraModels().size() > 1 &&
-				_cameraIndex >= 0)
-			{
-				if(_cameraIndex < (int)data.cameraModels().size())
-				{
-					// select one camera
-					int subImageWidth = data.imageRaw().cols/data.cameraModels().size();
-					UASSERT(!data.imageRaw().empty() &&
-							data.imageRaw().cols % data.cameraModels().size() == 0 &&
-							_cameraIndex*subImageWidth < data.imageRaw().cols);
-					data.setImageRaw(
-							cv::Mat(data.imageRaw(),
-							cv::Rect(_cameraIndex*subImageWidth, 0, subImageWidth, data.imageRaw().rows)).clone());
-
-					if(!data.depthOrRightRaw().empty())
-					{
-						UASSERT(data.depthOrRightRaw().cols % data.cameraModels().size() == 0 &&
-								subImageWidth == data.depthOrRightRaw().cols/(int)data.cameraModels().size() &&
-								_cameraIndex*subImageWidth < data.depthOrRightRaw().cols);
-						data.setDepthOrRightRaw(
-								cv::Mat(data.depthOrRightRaw(),
-								cv::Rect(_cameraIndex*subImageWidth, 0, subImageWidth, data.depthOrRightRaw().rows)).clone());
-					}
-					CameraModel model = data.cameraModels().at(_cameraIndex);
-					data.setCameraModel(model);
-				}
-				else
-				{
-					UWARN("DBReader: Camera index %d doesn't exist! Camera models = %d.", _cameraIndex, (int)data.cameraModels().size());
-				}
-			}
 			data.setId(seq);
 			data.setStamp(stamp);
 			data.setGroundTruth(groundTruth);
@@ -35,6 +35,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <pcl/common/common.h>
 #include <pcl/common/transforms.h>
 #include <pcl/correspondence.h>
+#include <Eigen/Sparse>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace rtabmap {
 
@@ -117,6 +122,19 @@ bool testAABBAABB(const AABB &a, const AABB &b)
     return true;
 };
 
+// Mean intensities of the correspondences between two overlapping clouds
+struct GainOverlap
+{
+	GainOverlap() : from(0), to(0), n(0), I1(0), I2(0), IR1(0), IR2(0), IG1(0), IG2(0), IB1(0), IB2(0) {}
+	int from;
+	int to;
+	int n;
+	double I1, I2;
+	double IR1, IR2;
+	double IG1, IG2;
+	double IB1, IB2;
+};
+
 /**
  * @see https://github.com/opencv/opencv/blob/master/modules/stitching/src/exposure_compensate.cpp
  */
@@ -138,34 +156,44 @@ void feedImpl(
 	UASSERT(indices.size() == 0 || clouds.size() == indices.size());
 
 	const int num_images = static_cast<int>(clouds.size());
-	cv::Mat_<int> N(num_images, num_images); N.setTo(0);
-	cv::Mat_<double> I(num_images, num_images); I.setTo(0);
-
-	cv::Mat_<double> IR(num_images, num_images); IR.setTo(0);
-	cv::Mat_<double> IG(num_images, num_images); IG.setTo(0);
-	cv::Mat_<double> IB(num_images, num_images); IB.setTo(0);
 
 	// make id to index map
 	idToIndex.clear();
 	std::vector<int> indexToId(clouds.size());
+	std::vector<typename pcl::PointCloud<PointT>::Ptr> indexToCloud(clouds.size());
+	std::vector<pcl::IndicesPtr> indexToIndices(clouds.size());
 	int oi=0;
-	std::map<int, std::pair<pcl::PointXYZ, pcl::PointXYZ> > boundingBoxes;
 	for(typename std::map<int, typename pcl::PointCloud<PointT>::Ptr>::const_iterator iter=clouds.begin(); iter!=clouds.end(); ++iter)
 	{
 		idToIndex.insert(std::make_pair(iter->first, oi));
 		indexToId[oi] = iter->first;
+		indexToCloud[oi] = iter->second;
 		UASSERT(indices.empty() || uContains(indices, iter->first));
+		if(!indices.empty() && indices.at(iter->first)->size())
+		{
+			indexToIndices[oi] = indices.at(iter->first);
+		}
+		++oi;
+	}
+
+	std::vector<int> sizes(num_images); // N(i,i)
+	std::vector<AABB> boundingBoxes(num_images);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int i=0; i<num_images; ++i)
+	{
 		Eigen::Vector4f minPt(0,0,0,0);
 		Eigen::Vector4f maxPt(0,0,0,0);
-		if(indices.empty() || indices.at(iter->first)->empty())
+		if(indexToIndices[i].get() == 0)
 		{
-			N(oi,oi) = iter->second->size();
-			pcl::getMinMax3D(*iter->second, minPt, maxPt);
+			sizes[i] = indexToCloud[i]->size();
+			pcl::getMinMax3D(*indexToCloud[i], minPt, maxPt);
 		}
 		else
 		{
-			N(oi,oi) = indices.at(iter->first)->size();
-			pcl::getMinMax3D(*iter->second, *indices.at(iter->first), minPt, maxPt);
+			sizes[i] = indexToIndices[i]->size();
+			pcl::getMinMax3D(*indexToCloud[i], *indexToIndices[i], minPt, maxPt);
 		}
 		minPt[0] -= maxCorrespondenceDistance;
 		minPt[1] -= maxCorrespondenceDistance;
@@ -173,184 +201,205 @@ void feedImpl(
 		maxPt[0] += maxCorrespondenceDistance;
 		maxPt[1] += maxCorrespondenceDistance;
 		maxPt[2] += maxCorrespondenceDistance;
-		boundingBoxes.insert(std::make_pair(iter->first, std::make_pair(pcl::PointXYZ(minPt[0], minPt[1], minPt[2]), pcl::PointXYZ(maxPt[0], maxPt[1], maxPt[2]))));
-		++oi;
+		boundingBoxes[i] = AABB(Eigen::Vector3f((maxPt[0] + minPt[0])/2.0f, (maxPt[1] + minPt[1])/2.0f, (maxPt[2] + minPt[2])/2.0f),
+				Eigen::Vector3f((maxPt[0] - minPt[0])/2.0f, (maxPt[1] - minPt[1])/2.0f, (maxPt[2] - minPt[2])/2.0f));
 	}
 
-	typename pcl::search::KdTree<PointT> kdtree;
-	int lastKdTreeId = 0;
+	// Links to compare, only the last link is kept between two clouds
+	std::map<std::pair<int, int>, const Link *> pairs;
 	for(std::multimap<int, Link>::const_iterator iter=links.begin(); iter!=links.end(); ++iter)
 	{
-		if(uContains(idToIndex, iter->second.from()) && uContains(idToIndex, iter->second.to()))
+		std::map<int, int>::const_iterator from = idToIndex.find(iter->second.from());
+		std::map<int, int>::const_iterator to = idToIndex.find(iter->second.to());
+		if(from != idToIndex.end() && to != idToIndex.end() && from->second != to->second)
+		{
+			uInsert(pairs, std::make_pair(std::make_pair(std::min(from->second, to->second), std::max(from->second, to->second)), &iter->second));
+		}
+	}
+
+	// Group the links by "from" cloud, so that its kd-tree is built only once
+	std::map<int, std::vector<const Link *> > groupsMap;
+	for(std::map<std::pair<int, int>, const Link *>::iterator iter=pairs.begin(); iter!=pairs.end(); ++iter)
+	{
+		groupsMap[idToIndex.at(iter->second->from())].push_back(iter->second);
+	}
+	std::vector<std::vector<const Link *> > groups = uValues(groupsMap);
+	std::vector<std::vector<GainOverlap> > overlaps(groups.size());
+
+	UDEBUG("Computing overlaps of %d links (%d clouds)...", (int)pairs.size(), (int)groups.size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int g=0; g<(int)groups.size(); ++g)
+	{
+		typename pcl::search::KdTree<PointT> kdtree;
+		bool kdtreeBuilt = false;
+		std::vector<int> k_indices;
+		std::vector<float> k_sqr_distances;
+		std::vector<unsigned char> addedFrom;
+		std::vector<int> correspondencesFrom;
+		std::vector<int> correspondencesTo;
+		for(unsigned int l=0; l<groups[g].size(); ++l)
 		{
-			const typename pcl::PointCloud<PointT>::Ptr & cloudFrom = clouds.at(iter->second.from());
-			const typename pcl::PointCloud<PointT>::Ptr & cloudTo = clouds.at(iter->second.to());
-			if(cloudFrom->size() && cloudTo->size())
+			const Link & link = *groups[g][l];
+			int i = idToIndex.at(link.from());
+			int j = idToIndex.at(link.to());
+			const typename pcl::PointCloud<PointT>::Ptr & cloudFrom = indexToCloud[i];
+			const typename pcl::PointCloud<PointT>::Ptr & cloudTo = indexToCloud[j];
+			if(cloudFrom->empty() || cloudTo->empty())
+			{
+				continue;
+			}
+
+			//Are bounding boxes intersect?
+			AABB bbTo = boundingBoxes[j];
+			Eigen::Affine3f t = Transform::getIdentity().toEigen3f();
+			if(!link.transform().isIdentity() && !link.transform().isNull())
 			{
-				//Are bounding boxes intersect?
-				std::pair<pcl::PointXYZ, pcl::PointXYZ> bbMinMaxFrom = boundingBoxes.at(iter->second.from());
-				std::pair<pcl::PointXYZ, pcl::PointXYZ> bbMinMaxTo = boundingBoxes.at(iter->second.to());
-				Eigen::Affine3f t = Transform::getIdentity().toEigen3f();
-				if(!iter->second.transform().isIdentity() && !iter->second.transform().isNull())
+				t = link.transform().toEigen3f();
+				bbTo.c = t * bbTo.c;
+				bbTo.r = t.linear().cwiseAbs() * bbTo.r;
+			}
+			if(!testAABBAABB(boundingBoxes[i], bbTo))
+			{
+				continue;
+			}
+
+			if(!kdtreeBuilt)
+			{
+				if(indexToIndices[i].get())
+				{
+					kdtree.setInputCloud(cloudFrom, indexToIndices[i]);
+				}
+				else
 				{
-					t = iter->second.transform().toEigen3f();
-					bbMinMaxTo.first = pcl::transformPoint(bbMinMaxTo.first, t);
-					bbMinMaxTo.second = pcl::transformPoint(bbMinMaxTo.second, t);
+					kdtree.setInputCloud(cloudFrom);
 				}
-				AABB bbFrom(Eigen::Vector3f((bbMinMaxFrom.second.x + bbMinMaxFrom.first.x)/2.0f, (bbMinMaxFrom.second.y + bbMinMaxFrom.first.y)/2.0f, (bbMinMaxFrom.second.z + bbMinMaxFrom.first.z)/2.0f),
-						 Eigen::Vector3f((bbMinMaxFrom.second.x - bbMinMaxFrom.first.x)/2.0f, (bbMinMaxFrom.second.y - bbMinMaxFrom.first.y)/2.0f, (bbMinMaxFrom.second.z - bbMinMaxFrom.first.z)/2.0f));
-				AABB bbTo(Eigen::Vector3f((bbMinMaxTo.second.x + bbMinMaxTo.first.x)/2.0f, (bbMinMaxTo.second.y + bbMinMaxTo.first.y)/2.0f, (bbMinMaxTo.second.z + bbMinMaxTo.first.z)/2.0f),
-						 Eigen::Vector3f((bbMinMaxTo.second.x - bbMinMaxTo.first.x)/2.0f, (bbMinMaxTo.second.y - bbMinMaxTo.first.y)/2.0f, (bbMinMaxTo.second.z - bbMinMaxTo.first.z)/2.0f));
-				//UDEBUG("%d = %f,%f,%f %f,%f,%f", iter->second.from(), bbMinMaxFrom.first[0], bbMinMaxFrom.first[1], bbMinMaxFrom.first[2], bbMinMaxFrom.second[0], bbMinMaxFrom.second[1], bbMinMaxFrom.second[2]);
-				//UDEBUG("%d = %f,%f,%f %f,%f,%f", iter->second.to(), bbMinMaxTo.first[0], bbMinMaxTo.first[1], bbMinMaxTo.first[2], bbMinMaxTo.second[0], bbMinMaxTo.second[1], bbMinMaxTo.second[2]);
-				if(testAABBAABB(bbFrom, bbTo))
+				addedFrom.resize(cloudFrom->size(), 0);
+				kdtreeBuilt = true;
+			}
+
+			const int sizeTo = indexToIndices[j].get()?(int)indexToIndices[j]->size():(int)cloudTo->size();
+			correspondencesFrom.clear();
+			correspondencesTo.clear();
+			for(int k=0; k<sizeTo; ++k)
+			{
+				int index = indexToIndices[j].get()?indexToIndices[j]->at(k):k;
+				if(kdtree.radiusSearch(pcl::transformPoint(cloudTo->at(index), t), maxCorrespondenceDistance, k_indices, k_sqr_distances, 1) &&
+				   !addedFrom[k_indices[0]])
 				{
-					if(lastKdTreeId <= 0 || lastKdTreeId!=iter->second.from())
-					{
-						//reconstruct kdtree
-						if(indices.size() && indices.at(iter->second.from())->size())
-						{
-							kdtree.setInputCloud(cloudFrom, indices.at(iter->second.from()));
-						}
-						else
-						{
-							kdtree.setInputCloud(cloudFrom);
-						}
-					}
-
-					pcl::Correspondences correspondences;
-					pcl::IndicesPtr indicesTo(new std::vector<int>);
-					std::set<int> addedFrom;
-					if(indices.size() && indices.at(iter->second.to())->size())
-					{
-						const pcl::IndicesPtr & indicesTo = indices.at(iter->second.to());
-						correspondences.resize(indicesTo->size());
-						int oi=0;
-						for(unsigned int i=0; i<indicesTo->size(); ++i)
-						{
-							std::vector<int> k_indices;
-							std::vector<float> k_sqr_distances;
-							if(kdtree.radiusSearch(pcl::transformPoint(cloudTo->at(indicesTo->at(i)), t), maxCorrespondenceDistance, k_indices, k_sqr_distances, 1))
-							{
-								if(addedFrom.find(k_indices[0]) == addedFrom.end())
-								{
-									correspondences[oi].index_match = k_indices[0];
-									correspondences[oi].index_query = indicesTo->at(i);
-									correspondences[oi].distance = k_sqr_distances[0];
-									addedFrom.insert(k_indices[0]);
-									++oi;
-								}
-							}
-						}
-						correspondences.resize(oi);
-					}
-					else
-					{
-						correspondences.resize(cloudTo->size());
-						int oi=0;
-						for(unsigned int i=0; i<cloudTo->size(); ++i)
-						{
-							std::vector<int> k_indices;
-							std::vector<float> k_sqr_distances;
-							if(kdtree.radiusSearch(pcl::transformPoint(cloudTo->at(i), t), maxCorrespondenceDistance, k_indices, k_sqr_distances, 1))
-							{
-								if(addedFrom.find(k_indices[0]) == addedFrom.end())
-								{
-									correspondences[oi].index_match = k_indices[0];
-									correspondences[oi].index_query = i;
-									correspondences[oi].distance = k_sqr_distances[0];
-									addedFrom.insert(k_indices[0]);
-									++oi;
-								}
-							}
-						}
-						correspondences.resize(oi);
-					}
-
-					UDEBUG("%d->%d: correspondences = %d", iter->second.from(), iter->second.to(), (int)correspondences.size());
-					if(correspondences.size() && (minOverlap <= 0.0 ||
-							(double(correspondences.size()) / double(clouds.at(iter->second.from())->size()) >= minOverlap &&
-							 double(correspondences.size()) / double(clouds.at(iter->second.to())->size()) >= minOverlap)))
-					{
-						int i = idToIndex.at(iter->second.from());
-						int j = idToIndex.at(iter->second.to());
-
-						double Isum1 = 0, Isum2 = 0;
-						double IRsum1 = 0, IRsum2 = 0;
-						double IGsum1 = 0, IGsum2 = 0;
-						double IBsum1 = 0, IBsum2 = 0;
-						for (unsigned int c = 0; c < correspondences.size(); ++c)
-						{
-							const PointT & pt1 = cloudFrom->at(correspondences.at(c).index_match);
-							const PointT & pt2 = cloudTo->at(correspondences.at(c).index_query);
-
-							Isum1 += std::sqrt(static_cast<double>(sqr(pt1.r) + sqr(pt1.g) + sqr(pt1.b)));
-							Isum2 += std::sqrt(static_cast<double>(sqr(pt2.r) + sqr(pt2.g) + sqr(pt2.b)));
-
-							IRsum1 += static_cast<double>(pt1.r);
-							IRsum2 += static_cast<double>(pt2.r);
-							IGsum1 += static_cast<double>(pt1.g);
-							IGsum2 += static_cast<double>(pt2.g);
-							IBsum1 += static_cast<double>(pt1.b);
-							IBsum2 += static_cast<double>(pt2.b);
-						}
-						N(i, j) = N(j, i) = correspondences.size();
-						I(i, j) = Isum1 / N(i, j);
-						I(j, i) = Isum2 / N(i, j);
-
-						IR(i, j) = IRsum1 / N(i, j);
-						IR(j, i) = IRsum2 / N(i, j);
-						IG(i, j) = IGsum1 / N(i, j);
-						IG(j, i) = IGsum2 / N(i, j);
-						IB(i, j) = IBsum1 / N(i, j);
-						IB(j, i) = IBsum2 / N(i, j);
-					}
+					correspondencesFrom.push_back(k_indices[0]);
+					correspondencesTo.push_back(index);
+					addedFrom[k_indices[0]] = 1;
 				}
 			}
+			for(unsigned int c=0; c<correspondencesFrom.size(); ++c)
+			{
+				addedFrom[correspondencesFrom[c]] = 0;
+			}
+
+			UDEBUG("%d->%d: correspondences = %d", link.from(), link.to(), (int)correspondencesFrom.size());
+			if(correspondencesFrom.size() && (minOverlap <= 0.0 ||
+					(double(correspondencesFrom.size()) / double(cloudFrom->size()) >= minOverlap &&
+					 double(correspondencesFrom.size()) / double(cloudTo->size()) >= minOverlap)))
+			{
+				GainOverlap overlap;
+				overlap.from = i;
+				overlap.to = j;
+				overlap.n = correspondencesFrom.size();
+				for (unsigned int c = 0; c < correspondencesFrom.size(); ++c)
+				{
+					const PointT & pt1 = cloudFrom->at(correspondencesFrom[c]);
+					const PointT & pt2 = cloudTo->at(correspondencesTo[c]);
+
+					overlap.I1 += std::sqrt(static_cast<double>(sqr(pt1.r) + sqr(pt1.g) + sqr(pt1.b)));
+					overlap.I2 += std::sqrt(static_cast<double>(sqr(pt2.r) + sqr(pt2.g) + sqr(pt2.b)));
+
+					overlap.IR1 += static_cast<double>(pt1.r);
+					overlap.IR2 += static_cast<double>(pt2.r);
+					overlap.IG1 += static_cast<double>(pt1.g);
+					overlap.IG2 += static_cast<double>(pt2.g);
+					overlap.IB1 += static_cast<double>(pt1.b);
+					overlap.IB2 += static_cast<double>(pt2.b);
+				}
+				overlap.I1 /= overlap.n;
+				overlap.I2 /= overlap.n;
+				overlap.IR1 /= overlap.n;
+				overlap.IR2 /= overlap.n;
+				overlap.IG1 /= overlap.n;
+				overlap.IG2 /= overlap.n;
+				overlap.IB1 /= overlap.n;
+				overlap.IB2 /= overlap.n;
+				overlaps[g].push_back(overlap);
+			}
 		}
 	}
 
-	cv::Mat_<double> A(num_images, num_images); A.setTo(0);
-	cv::Mat_<double> b(num_images, 1); b.setTo(0);
-	cv::Mat_<double> AR(num_images, num_images); AR.setTo(0);
-	cv::Mat_<double> AG(num_images, num_images); AG.setTo(0);
-	cv::Mat_<double> AB(num_images, num_images); AB.setTo(0);
+	// Sparse normal equations: only overlapping clouds are linked
+	std::vector<double> b(num_images, 0.0);
+	std::vector<std::vector<Eigen::Triplet<double> > > triplets(4);
 	for (int i = 0; i < num_images; ++i)
 	{
-		for (int j = 0; j < num_images; ++j)
+		b[i] += beta * sizes[i];
+		for(int c=0; c<4; ++c)
 		{
-			b(i, 0) += beta * N(i, j);
-			A(i, i) += beta * N(i, j);
-			AR(i, i) += beta * N(i, j);
-			AG(i, i) += beta * N(i, j);
-			AB(i, i) += beta * N(i, j);
-			if (j == i) continue;
-			A(i, i) += 2 * alpha * I(i, j) * I(i, j) * N(i, j);
-			A(i, j) -= 2 * alpha * I(i, j) * I(j, i) * N(i, j);
-
-			AR(i, i) += 2 * alpha * IR(i, j) * IR(i, j) * N(i, j);
-			AR(i, j) -= 2 * alpha * IR(i, j) * IR(j, i) * N(i, j);
-
-			AG(i, i) += 2 * alpha * IG(i, j) * IG(i, j) * N(i, j);
-			AG(i, j) -= 2 * alpha * IG(i, j) * IG(j, i) * N(i, j);
-
-			AB(i, i) += 2 * alpha * IB(i, j) * IB(i, j) * N(i, j);
-			AB(i, j) -= 2 * alpha * IB(i, j) * IB(j, i) * N(i, j);
+			triplets[c].push_back(Eigen::Triplet<double>(i, i, beta * sizes[i]));
+		}
+	}
+	for(unsigned int g=0; g<overlaps.size(); ++g)
+	{
+		for(unsigned int o=0; o<overlaps[g].size(); ++o)
+		{
+			const GainOverlap & overlap = overlaps[g][o];
+			int i = overlap.from;
+			int j = overlap.to;
+			double n = overlap.n;
+			double I[4][2] = {
+					{overlap.I1, overlap.I2},
+					{overlap.IR1, overlap.IR2},
+					{overlap.IG1, overlap.IG2},
+					{overlap.IB1, overlap.IB2}};
+			b[i] += beta * n;
+			b[j] += beta * n;
+			for(int c=0; c<4; ++c)
+			{
+				// I(i,j)=I[c][0], I(j,i)=I[c][1]
+				triplets[c].push_back(Eigen::Triplet<double>(i, i, beta * n + 2 * alpha * I[c][0] * I[c][0] * n));
+				triplets[c].push_back(Eigen::Triplet<double>(j, j, beta * n + 2 * alpha * I[c][1] * I[c][1] * n));
+				triplets[c].push_back(Eigen::Triplet<double>(i, j, -2 * alpha * I[c][0] * I[c][1] * n));
+				triplets[c].push_back(Eigen::Triplet<double>(j, i, -2 * alpha * I[c][1] * I[c][0] * n));
+			}
 		}
 	}
 
-	cv::Mat_<double> gainsGray, gainsR, gainsG, gainsB;
-	cv::solve(A, b, gainsGray);
-
-	cv::solve(AR, b, gainsR);
-	cv::solve(AG, b, gainsG);
-	cv::solve(AB, b, gainsB);
-
-	gains = cv::Mat_<double>(gainsGray.rows, 4);
-	gainsGray.copyTo(gains.col(0));
-	gainsR.copyTo(gains.col(1));
-	gainsG.copyTo(gains.col(2));
-	gainsB.copyTo(gains.col(3));
+	gains = cv::Mat_<double>(num_images, 4);
+	Eigen::Map<Eigen::VectorXd> bEigen(b.data(), num_images);
+	Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > solver;
+	for(int c=0; c<4; ++c)
+	{
+		Eigen::SparseMatrix<double> A(num_images, num_images);
+		A.setFromTriplets(triplets[c].begin(), triplets[c].end()); // duplicates are summed
+		if(c == 0)
+		{
+			solver.analyzePattern(A); // same pattern for all channels
+		}
+		solver.factorize(A);
+		Eigen::VectorXd x;
+		if(solver.info() == Eigen::Success)
+		{
+			x = solver.solve(bEigen);
+		}
+		else
+		{
+			UWARN("Gain compensation: LDLT factorization failed (channel %d), using LU...", c);
+			Eigen::SparseLU<Eigen::SparseMatrix<double> > lu(A);
+			x = lu.solve(bEigen);
+		}
+		for(int i=0; i<num_images; ++i)
+		{
+			gains(i, c) = x[i];
+		}
+	}
 
 	if(ULogger::kInfo)
 	{
@@ -472,6 +521,25 @@ void GainCompensator::apply(
 	}
 }
 
+void GainCompensator::apply(
+		std::map<int, std::pair<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr, pcl::IndicesPtr> > & clouds,
+		bool rgb) const
+{
+	std::vector<std::map<int, std::pair<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr, pcl::IndicesPtr> >::iterator> iters;
+	for(std::map<int, std::pair<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr, pcl::IndicesPtr> >::iterator iter=clouds.begin(); iter!=clouds.end(); ++iter)
+	{
+		UASSERT_MSG(uContains(idToIndex_, iter->first), uFormat("id=%d idToIndex_.size()=%d", iter->first, (int)idToIndex_.size()).c_str());
+		iters.push_back(iter);
+	}
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int i=0; i<(int)iters.size(); ++i)
+	{
+		applyImpl<pcl::PointXYZRGBNormal>(idToIndex_.at(iters[i]->first), iters[i]->second.first, iters[i]->second.second, gains_, rgb);
+	}
+}
+
 double GainCompensator::getGain(int id, double * r, double * g, double * b) const
 {
 	UASSERT_MSG(uContains(idToIndex_, id), uFormat("id=%d idToIndex_.size()=%d", id, (int)idToIndex_.size()).c_str());
@@ -40,6 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <pcl/common/common.h>
 #include <set>
 #include <queue>
+#include <limits>
 #include <fstream>
 
 #include <rtabmap/core/OptimizerTORO.h>
@@ -1373,7 +1374,8 @@ std::list<std::pair<int, Transform> > computePath(
 		bool lookInDatabase,
 		bool updateNewCosts,
 		float linearVelocity,  // m/sec
-		float angularVelocity) // rad/sec
+		float angularVelocity, // rad/sec
+		const std::map<int, Transform> * poses)
 {
 	UASSERT(memory!=0);
 	UASSERT(fromId>=0);
@@ -1388,15 +1390,37 @@ std::list<std::pair<int, Transform> > computePath(
 			angularVelocity);
 
 	std::multimap<int, Link> allLinks;
-	if(lookInDatabase)
+	if(lookInDatabase || poses)
 	{
-		// Faster to load all links in one query
+		// Links of nodes in LTM are kept in RAM by Memory, no database query here
 		UTimer t;
 		allLinks = memory->getAllLinks(lookInDatabase);
 		UINFO("getting all %d links time = %f s", (int)allLinks.size(), t.ticks());
 	}
 
-	//dijkstra
+	// A* heuristic: euclidean distance to the end node (converted in time if a linear velocity is set).
+	// Link costs are computed from the same poses, the heuristic is admissible only if all nodes have a pose.
+	const Transform * endPose = 0;
+	float heuristicScale = 0.0f;
+	if(poses && uContains(*poses, toId) && (linearVelocity > 0.0f || angularVelocity <= 0.0f))
+	{
+		bool allPosed = true;
+		for(std::multimap<int, Link>::const_iterator iter=allLinks.begin(); allPosed && iter!=allLinks.end(); ++iter)
+		{
+			allPosed = uContains(*poses, iter->second.from()) && uContains(*poses, iter->second.to());
+		}
+		if(allPosed)
+		{
+			endPose = &poses->at(toId);
+			heuristicScale = linearVelocity > 0.0f?1.0f/linearVelocity:1.0f;
+		}
+		else
+		{
+			UDEBUG("Some nodes don't have a pose, A* heuristic is not used.");
+		}
+	}
+
+	//dijkstra (A* if poses are set)
 	int startNode = fromId;
 	int endNode = toId;
 	std::map<int, Node> nodes;
@@ -1454,22 +1478,40 @@ std::list<std::pair<int, Transform> > computePath(
 				links.insert(std::make_pair(iter->second.to(), iter->second));
 			}
 		}
+		const Transform * currentOptimizedPose = 0;
+		if(poses)
+		{
+			std::map<int, Transform>::const_iterator poseIter = poses->find(currentNode->id());
+			if(poseIter != poses->end())
+			{
+				currentOptimizedPose = &poseIter->second;
+			}
+		}
 		for(std::map<int, Link>::const_iterator iter = links.begin(); iter!=links.end(); ++iter)
 		{
 			if(iter->second.from() != iter->second.to())
 			{
 				Transform nextPose = currentNode->pose()*iter->second.transform();
+				float length = iter->second.transform().getNorm();
+				if(currentOptimizedPose)
+				{
+					std::map<int, Transform>::const_iterator poseIter = poses->find(iter->second.to());
+					if(poseIter != poses->end())
+					{
+						length = currentOptimizedPose->getDistance(poseIter->second);
+					}
+				}
 				float cost = 0.0f;
 				if(linearVelocity <= 0.0f && angularVelocity <= 0.0f)
 				{
 					// use distance only
-					cost = iter->second.transform().getNorm();
+					cost = length;
 				}
 				else // use time
 				{
 					if(linearVelocity > 0.0f)
 					{
-						cost += iter->second.transform().getNorm()/linearVelocity;
+						cost += length/linearVelocity;
 					}
 					if(angularVelocity > 0.0f)
 					{
@@ -1486,6 +1528,14 @@ std::list<std::pair<int, Transform> > computePath(
 					Node n(iter->second.to(), currentNode->id(), nextPose);
 
 					n.setCostSoFar(currentNode->costSoFar() + cost);
+					if(endPose)
+					{
+						std::map<int, Transform>::const_iterator poseIter = poses->find(n.id());
+						if(poseIter != poses->end())
+						{
+							n.setDistToEnd(poseIter->second.getDistance(*endPose)*heuristicScale);
+						}
+					}
 					nodes.insert(std::make_pair(iter->second.to(), n));
 					if(updateNewCosts)
 					{
@@ -1578,6 +1628,369 @@ std::list<std::pair<int, Transform> > computePath(
 	return path;
 }
 
+DStarLite::State::State() :
+		g(std::numeric_limits<float>::infinity()),
+		rhs(std::numeric_limits<float>::infinity()),
+		key(0.0f, 0.0f),
+		queued(false)
+{
+}
+
+DStarLite::DStarLite() :
+		goal_(0),
+		start_(0),
+		km_(0.0f),
+		linearVelocity_(0.0f),
+		nodesWithoutPose_(0),
+		heuristicUsed_(false),
+		keysChanged_(false)
+{
+}
+
+void DStarLite::init(
+		int goal,
+		const std::multimap<int, Link> & links,
+		const std::map<int, Transform> & poses,
+		float linearVelocity)
+{
+	clear();
+	goal_ = goal;
+	poses_ = poses;
+	linearVelocity_ = linearVelocity;
+	for(std::multimap<int, Link>::const_iterator iter=links.begin(); iter!=links.end(); ++iter)
+	{
+		addLink(iter->second);
+	}
+	changed_.clear(); // first search
+}
+
+void DStarLite::clear()
+{
+	goal_ = 0;
+	start_ = 0;
+	km_ = 0.0f;
+	poses_.clear();
+	edges_.clear();
+	nodesWithoutPose_ = 0;
+	heuristicUsed_ = false;
+	keysChanged_ = false;
+	changed_.clear();
+	states_.clear();
+	queue_.clear();
+}
+
+void DStarLite::addLink(const Link & link)
+{
+	if(goal_ > 0 && link.from() != link.to() && link.isValid())
+	{
+		setEdge(link.from(), link.to(), link.transform());
+		setEdge(link.to(), link.from(), link.transform().inverse());
+		changed_.insert(link.from());
+		changed_.insert(link.to());
+	}
+}
+
+void DStarLite::removeLink(int from, int to)
+{
+	if(goal_ > 0 && from != to)
+	{
+		eraseEdge(from, to);
+		eraseEdge(to, from);
+		changed_.insert(from);
+		changed_.insert(to);
+	}
+}
+
+void DStarLite::updatePoses(const std::map<int, Transform> & poses)
+{
+	if(goal_ == 0)
+	{
+		return;
+	}
+	std::set<int> moved;
+	nodesWithoutPose_ = 0;
+	for(std::map<int, std::map<int, Edge> >::iterator iter=edges_.begin(); iter!=edges_.end(); ++iter)
+	{
+		std::map<int, Transform>::const_iterator newPose = poses.find(iter->first);
+		std::map<int, Transform>::const_iterator oldPose = poses_.find(iter->first);
+		if(newPose == poses.end())
+		{
+			++nodesWithoutPose_;
+		}
+		if((newPose == poses.end()) != (oldPose == poses_.end()) ||
+		   (newPose != poses.end() && !(newPose->second == oldPose->second)))
+		{
+			moved.insert(iter->first);
+		}
+	}
+	poses_ = poses;
+
+	for(std::set<int>::iterator iter=moved.begin(); iter!=moved.end(); ++iter)
+	{
+		std::map<int, Edge> & edges = edges_.at(*iter);
+		for(std::map<int, Edge>::iterator jter=edges.begin(); jter!=edges.end(); ++jter)
+		{
+			jter->second.cost = cost(*iter, jter->first, jter->second.length);
+			edges_.at(jter->first).at(*iter).cost = jter->second.cost;
+			changed_.insert(jter->first);
+		}
+		changed_.insert(*iter);
+	}
+	keysChanged_ = keysChanged_ || moved.size() > 0;
+	UDEBUG("%d nodes moved, %d nodes without pose", (int)moved.size(), nodesWithoutPose_);
+}
+
+float DStarLite::heuristic(int a, int b) const
+{
+	if(!heuristicUsed_)
+	{
+		return 0.0f;
+	}
+	std::map<int, Transform>::const_iterator iterA = poses_.find(a);
+	std::map<int, Transform>::const_iterator iterB = poses_.find(b);
+	if(iterA == poses_.end() || iterB == poses_.end())
+	{
+		return 0.0f;
+	}
+	float d = iterA->second.getDistance(iterB->second);
+	return linearVelocity_ > 0.0f?d/linearVelocity_:d;
+}
+
+float DStarLite::cost(int from, int to, float length) const
+{
+	std::map<int, Transform>::const_iterator iterA = poses_.find(from);
+	std::map<int, Transform>::const_iterator iterB = poses_.find(to);
+	float d = iterA != poses_.end() && iterB != poses_.end()?iterA->second.getDistance(iterB->second):length;
+	return linearVelocity_ > 0.0f?d/linearVelocity_:d;
+}
+
+void DStarLite::setEdge(int from, int to, const Transform & transform)
+{
+	std::map<int, std::map<int, Edge> >::iterator iter = edges_.find(from);
+	if(iter == edges_.end())
+	{
+		iter = edges_.insert(std::make_pair(from, std::map<int, Edge>())).first;
+		if(poses_.find(from) == poses_.end())
+		{
+			++nodesWithoutPose_;
+		}
+	}
+	Edge & edge = iter->second[to];
+	edge.transform = transform;
+	edge.length = transform.getNorm();
+	edge.cost = cost(from, to, edge.length);
+}
+
+void DStarLite::eraseEdge(int from, int to)
+{
+	std::map<int, std::map<int, Edge> >::iterator iter = edges_.find(from);
+	if(iter != edges_.end())
+	{
+		iter->second.erase(to);
+		if(iter->second.empty())
+		{
+			edges_.erase(iter);
+			if(poses_.find(from) == poses_.end())
+			{
+				--nodesWithoutPose_;
+			}
+		}
+	}
+}
+
+DStarLite::State & DStarLite::state(int id)
+{
+	return states_.insert(std::make_pair(id, State())).first->second;
+}
+
+DStarLite::Key DStarLite::computeKey(int id, const State & s) const
+{
+	float m = std::min(s.g, s.rhs);
+	return Key(m + heuristic(start_, id) + km_, m);
+}
+
+void DStarLite::updateKeys()
+{
+	// The heuristic changed: recompute all keys for the current start, the
+	// key modifier is not needed anymore.
+	km_ = 0.0f;
+	std::set<std::pair<Key, int> > queue;
+	for(std::set<std::pair<Key, int> >::iterator iter=queue_.begin(); iter!=queue_.end(); ++iter)
+	{
+		State & s = states_.at(iter->second);
+		s.key = computeKey(iter->second, s);
+		queue.insert(std::make_pair(s.key, iter->second));
+	}
+	queue_.swap(queue);
+	keysChanged_ = false;
+}
+
+void DStarLite::updateVertex(int id)
+{
+	State & s = state(id);
+	if(id != goal_)
+	{
+		s.rhs = std::numeric_limits<float>::infinity();
+		std::map<int, std::map<int, Edge> >::iterator iter = edges_.find(id);
+		if(iter != edges_.end())
+		{
+			for(std::map<int, Edge>::iterator jter=iter->second.begin(); jter!=iter->second.end(); ++jter)
+			{
+				std::map<int, State>::iterator kter = states_.find(jter->first);
+				if(kter != states_.end() && jter->second.cost + kter->second.g < s.rhs)
+				{
+					s.rhs = jter->second.cost + kter->second.g;
+				}
+			}
+		}
+	}
+	if(s.queued)
+	{
+		queue_.erase(std::make_pair(s.key, id));
+		s.queued = false;
+	}
+	if(s.g != s.rhs)
+	{
+		s.key = computeKey(id, s);
+		s.queued = true;
+		queue_.insert(std::make_pair(s.key, id));
+	}
+}
+
+void DStarLite::computeShortestPath()
+{
+	while(!queue_.empty())
+	{
+		State & start = state(start_);
+		if(!(queue_.begin()->first < computeKey(start_, start)) && start.rhs == start.g)
+		{
+			break;
+		}
+
+		Key oldKey = queue_.begin()->first;
+		int id = queue_.begin()->second;
+		State & s = states_.at(id);
+		Key newKey = computeKey(id, s);
+		queue_.erase(queue_.begin());
+		s.queued = false;
+		if(oldKey < newKey)
+		{
+			s.key = newKey;
+			s.queued = true;
+			queue_.insert(std::make_pair(s.key, id));
+			continue;
+		}
+
+		if(s.g > s.rhs)
+		{
+			s.g = s.rhs;
+		}
+		else
+		{
+			s.g = std::numeric_limits<float>::infinity();
+			updateVertex(id);
+		}
+		// links are undirected: predecessors are the neighbors
+		std::map<int, std::map<int, Edge> >::iterator iter = edges_.find(id);
+		if(iter != edges_.end())
+		{
+			for(std::map<int, Edge>::iterator jter=iter->second.begin(); jter!=iter->second.end(); ++jter)
+			{
+				updateVertex(jter->first);
+			}
+		}
+	}
+}
+
+std::list<std::pair<int, Transform> > DStarLite::computePath(int start)
+{
+	UASSERT(goal_ > 0);
+	UASSERT(start > 0);
+	std::list<std::pair<int, Transform> > path;
+
+	if(start_ == 0)
+	{
+		// first search
+		start_ = start;
+		heuristicUsed_ = nodesWithoutPose_ == 0;
+		State & goal = state(goal_);
+		goal.rhs = 0.0f;
+		goal.key = computeKey(goal_, goal);
+		goal.queued = true;
+		queue_.insert(std::make_pair(goal.key, goal_));
+	}
+	else
+	{
+		if(start != start_)
+		{
+			km_ += heuristic(start_, start);
+			start_ = start;
+		}
+		if(heuristicUsed_ != (nodesWithoutPose_ == 0))
+		{
+			heuristicUsed_ = nodesWithoutPose_ == 0;
+			keysChanged_ = true;
+		}
+		if(keysChanged_)
+		{
+			updateKeys();
+		}
+	}
+
+	// only nodes with changed links need to be updated
+	for(std::set<int>::iterator iter=changed_.begin(); iter!=changed_.end(); ++iter)
+	{
+		updateVertex(*iter);
+	}
+	UDEBUG("start=%d goal=%d, %d nodes with changed links, heuristic=%s",
+			start_, goal_, (int)changed_.size(), heuristicUsed_?"true":"false");
+	changed_.clear();
+
+	computeShortestPath();
+
+	// follow the best successors from the start
+	if(state(start_).g == std::numeric_limits<float>::infinity())
+	{
+		return path;
+	}
+	int current = start_;
+	path.push_back(std::make_pair(current, Transform::getIdentity()));
+	while(current != goal_ && path.size() <= edges_.size())
+	{
+		int next = 0;
+		const Transform * transform = 0;
+		float best = std::numeric_limits<float>::infinity();
+		std::map<int, std::map<int, Edge> >::iterator iter = edges_.find(current);
+		if(iter != edges_.end())
+		{
+			for(std::map<int, Edge>::iterator jter=iter->second.begin(); jter!=iter->second.end(); ++jter)
+			{
+				std::map<int, State>::iterator kter = states_.find(jter->first);
+				if(kter != states_.end() && jter->second.cost + kter->second.g < best)
+				{
+					best = jter->second.cost + kter->second.g;
+					next = jter->first;
+					transform = &jter->second.transform;
+				}
+			}
+		}
+		if(next == 0)
+		{
+			UWARN("Path broken after node %d (start=%d goal=%d)", current, start_, goal_);
+			path.clear();
+			return path;
+		}
+		current = next;
+		path.push_back(std::make_pair(current, path.back().second * *transform));
+	}
+	if(current != goal_)
+	{
+		UWARN("Goal %d not reached from %d (loop in the path?)", goal_, start_);
+		path.clear();
+	}
+	return path;
+}
+
 int findNearestNode(
 		const std::map<int, rtabmap::Transform> & nodes,
 		const rtabmap::Transform & targetPose)
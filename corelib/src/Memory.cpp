@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UEventsManager.h>
 #include <rtabmap/utilite/ULogger.h>
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UProcessInfo.h>
 #include <rtabmap/utilite/UMath.h>
@@ -50,6 +51,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/util3d_registration.h"
 #include "rtabmap/core/util3d_surface.h"
 #include "rtabmap/core/util3d_transforms.h"
+#include "rtabmap/core/util3d_mapping.h"
 #include "rtabmap/core/util3d_motion_estimation.h"
 #include "rtabmap/core/util3d.h"
 #include "rtabmap/core/util2d.h"
@@ -67,6 +69,201 @@ const int Memory::kIdStart = 0;
 const int Memory::kIdVirtual = -1;
 const int Memory::kIdInvalid = 0;
 
+/**
+ * Compact adjacency of the links of the nodes in the long-term memory (nodes
+ * not in WM/STM), kept in RAM so that graph traversals and path planning don't
+ * have to query the database. Links of a node are stored contiguously
+ * (CSR-like arrays: neighbor id, type, 3x4 transform and the diagonal of the
+ * information matrix). A node whose links don't fit anymore in its slot is
+ * moved at the end of the arrays; the holes are compacted when they become
+ * larger than the used part.
+ */
+class LinkTopology
+{
+public:
+	LinkTopology() : unused_(0) {}
+
+	void clear()
+	{
+		nodes_.clear();
+		to_.clear();
+		type_.clear();
+		transform_.clear();
+		information_.clear();
+		unused_ = 0;
+	}
+
+	bool contains(int id) const {return nodes_.find(id) != nodes_.end();}
+	int size() const {return (int)nodes_.size();}
+
+	// replace all links of node "id"
+	void set(int id, const std::map<int, Link> & links)
+	{
+		remove(id);
+		Slot & slot = nodes_.insert(std::make_pair(id, Slot())).first->second;
+		allocate(slot, (int)links.size());
+		for(std::map<int, Link>::const_iterator iter=links.begin(); iter!=links.end(); ++iter)
+		{
+			write(slot.offset + slot.count++, iter->second);
+		}
+	}
+
+	void remove(int id)
+	{
+		std::map<int, Slot>::iterator iter = nodes_.find(id);
+		if(iter != nodes_.end())
+		{
+			unused_ += iter->second.capacity;
+			nodes_.erase(iter);
+			compact();
+		}
+	}
+
+	// add or replace the link from link.from() to link.to()
+	void update(const Link & link)
+	{
+		Slot & slot = nodes_.insert(std::make_pair(link.from(), Slot())).first->second;
+		for(int i=slot.offset; i<slot.offset+slot.count; ++i)
+		{
+			if(to_[i] == link.to())
+			{
+				write(i, link);
+				return;
+			}
+		}
+		if(slot.count == slot.capacity)
+		{
+			allocate(slot, slot.capacity>0?slot.capacity*2:4);
+		}
+		write(slot.offset + slot.count++, link);
+		compact();
+	}
+
+	// append neighbor ids and link types of node "id", return false if the node is not here
+	bool getNeighbors(int id, std::vector<std::pair<int, Link::Type> > & neighbors) const
+	{
+		std::map<int, Slot>::const_iterator iter = nodes_.find(id);
+		if(iter == nodes_.end())
+		{
+			return false;
+		}
+		for(int i=iter->second.offset; i<iter->second.offset+iter->second.count; ++i)
+		{
+			neighbors.push_back(std::make_pair(to_[i], (Link::Type)type_[i]));
+		}
+		return true;
+	}
+
+	void getAll(std::multimap<int, Link> & links, bool ignoreNullLinks) const
+	{
+		for(std::map<int, Slot>::const_iterator iter=nodes_.begin(); iter!=nodes_.end(); ++iter)
+		{
+			for(int i=iter->second.offset; i<iter->second.offset+iter->second.count; ++i)
+			{
+				Link link = read(iter->first, i);
+				if(!ignoreNullLinks || link.isValid())
+				{
+					links.insert(std::make_pair(iter->first, link));
+				}
+			}
+		}
+	}
+
+private:
+	struct Slot
+	{
+		Slot() : offset(0), count(0), capacity(0) {}
+		int offset;
+		int count;
+		int capacity;
+	};
+
+	// move the links of the slot at the end of the arrays with a larger capacity
+	void allocate(Slot & slot, int capacity)
+	{
+		int offset = (int)to_.size();
+		to_.resize(offset + capacity, 0);
+		type_.resize(offset + capacity, (unsigned char)Link::kUndef);
+		transform_.resize((offset + capacity)*12, 0.0f);
+		information_.resize((offset + capacity)*6, 0.0f);
+		for(int i=0; i<slot.count; ++i)
+		{
+			to_[offset+i] = to_[slot.offset+i];
+			type_[offset+i] = type_[slot.offset+i];
+			memcpy(&transform_[(offset+i)*12], &transform_[(slot.offset+i)*12], 12*sizeof(float));
+			memcpy(&information_[(offset+i)*6], &information_[(slot.offset+i)*6], 6*sizeof(float));
+		}
+		unused_ += slot.capacity; // the old slot becomes a hole
+		slot.offset = offset;
+		slot.capacity = capacity;
+	}
+
+	void write(int i, const Link & link)
+	{
+		to_[i] = link.to();
+		type_[i] = (unsigned char)link.type();
+		memcpy(&transform_[i*12], link.transform().data(), 12*sizeof(float));
+		for(int j=0; j<6; ++j)
+		{
+			information_[i*6+j] = (float)link.infMatrix().at<double>(j,j);
+		}
+	}
+
+	Link read(int from, int i) const
+	{
+		cv::Mat information = cv::Mat::zeros(6,6,CV_64FC1);
+		for(int j=0; j<6; ++j)
+		{
+			information.at<double>(j,j) = information_[i*6+j];
+		}
+		const float * t = &transform_[i*12];
+		return Link(from, to_[i], (Link::Type)type_[i],
+				Transform(t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7], t[8], t[9], t[10], t[11]),
+				information);
+	}
+
+	void compact()
+	{
+		if(unused_ < 1024 || unused_ < (int)to_.size()/2)
+		{
+			return;
+		}
+		std::vector<int> to;
+		std::vector<unsigned char> type;
+		std::vector<float> transform;
+		std::vector<float> information;
+		int size = (int)to_.size() - unused_;
+		to.reserve(size);
+		type.reserve(size);
+		transform.reserve(size*12);
+		information.reserve(size*6);
+		for(std::map<int, Slot>::iterator iter=nodes_.begin(); iter!=nodes_.end(); ++iter)
+		{
+			Slot & slot = iter->second;
+			int offset = (int)to.size();
+			to.insert(to.end(), to_.begin()+slot.offset, to_.begin()+slot.offset+slot.count);
+			type.insert(type.end(), type_.begin()+slot.offset, type_.begin()+slot.offset+slot.count);
+			transform.insert(transform.end(), transform_.begin()+slot.offset*12, transform_.begin()+(slot.offset+slot.count)*12);
+			information.insert(information.end(), information_.begin()+slot.offset*6, information_.begin()+(slot.offset+slot.count)*6);
+			slot.offset = offset;
+			slot.capacity = slot.count;
+		}
+		to_.swap(to);
+		type_.swap(type);
+		transform_.swap(transform);
+		information_.swap(information);
+		unused_ = 0;
+	}
+
+private:
+	std::map<int, Slot> nodes_;
+	std::vector<int> to_;
+	std::vector<unsigned char> type_;
+	std::vector<float> transform_;   // 12 values per link
+	std::vector<float> information_; // 6 values per link (diagonal of the information matrix)
+	int unused_; // holes left in the arrays by moved or removed nodes
+};
+
 Memory::Memory(const ParametersMap & parameters) :
 	_dbDriver(0),
 	_similarityThreshold(Parameters::defaultMemRehearsalSimilarity()),
@@ -90,6 +287,7 @@ Memory::Memory(const ParametersMap & parameters) :
 	_laserScanDownsampleStepSize(Parameters::defaultMemLaserScanDownsampleStepSize()),
 	_laserScanNormalK(Parameters::defaultMemLaserScanNormalK()),
 	_reextractLoopClosureFeatures(Parameters::defaultRGBDLoopClosureReextractFeatures()),
+	_loopClosureParallelized(Parameters::defaultRGBDLoopClosureParallelized()),
 	_rehearsalMaxDistance(Parameters::defaultRGBDLinearUpdate()),
 	_rehearsalMaxAngle(Parameters::defaultRGBDAngularUpdate()),
 	_rehearsalWeightIgnoredWhileMoving(Parameters::defaultMemRehearsalWeightIgnoredWhileMoving()),
@@ -106,13 +304,15 @@ Memory::Memory(const ParametersMap & parameters) :
 
 	_badSignRatio(Parameters::defaultKpBadSignRatio()),
 	_tfIdfLikelihoodUsed(Parameters::defaultKpTfIdfLikelihoodUsed()),
-	_parallelized(Parameters::defaultKpParallelized())
+	_parallelized(Parameters::defaultKpParallelized()),
+	_pathPlanner(0)
 {
 	_feature2D = Feature2D::create(parameters);
 	_vwd = new VWDictionary(parameters);
 	_registrationPipeline = Registration::create(parameters);
 	_registrationIcp = new RegistrationIcp(parameters);
 	_occupancy = new OccupancyGrid(parameters);
+	_ltmLinks = new LinkTopology();
 	this->parseParameters(parameters);
 }
 
@@ -314,6 +514,24 @@ void Memory::loadDataFromDb(bool postInitClosingEvents)
 			UWARN("_vwd->getUnusedWordsSize() must be empty... size=%d", _vwd->getUnusedWordsSize());
 		}
 		UDEBUG("Total word references added = %d", _vwd->getTotalActiveReferences());
+
+		// Keep in RAM the links of all nodes not loaded in WM
+		if(postInitClosingEvents) UEventsManager::post(new RtabmapEventInit(std::string("Loading links of nodes in LTM...")));
+		std::multimap<int, Link> links;
+		_dbDriver->getAllLinks(links, false);
+		std::map<int, std::map<int, Link> > ltmLinks;
+		for(std::multimap<int, Link>::iterator iter=links.begin(); iter!=links.end(); ++iter)
+		{
+			if(_signatures.find(iter->first) == _signatures.end())
+			{
+				ltmLinks[iter->first].insert(std::make_pair(iter->second.to(), iter->second));
+			}
+		}
+		for(std::map<int, std::map<int, Link> >::iterator iter=ltmLinks.begin(); iter!=ltmLinks.end(); ++iter)
+		{
+			_ltmLinks->set(iter->first, iter->second);
+		}
+		if(postInitClosingEvents) UEventsManager::post(new RtabmapEventInit(uFormat("Loading links of nodes in LTM, done! (%d nodes)", _ltmLinks->size())));
 	}
 	else
 	{
@@ -412,6 +630,7 @@ Memory::~Memory()
 	{
 		delete _occupancy;
 	}
+	delete _ltmLinks;
 }
 
 void Memory::parseParameters(const ParametersMap & parameters)
@@ -441,6 +660,7 @@ void Memory::parseParameters(const ParametersMap & parameters)
 	Parameters::parse(parameters, Parameters::kMemLaserScanDownsampleStepSize(), _laserScanDownsampleStepSize);
 	Parameters::parse(parameters, Parameters::kMemLaserScanNormalK(), _laserScanNormalK);
 	Parameters::parse(parameters, Parameters::kRGBDLoopClosureReextractFeatures(), _reextractLoopClosureFeatures);
+	Parameters::parse(parameters, Parameters::kRGBDLoopClosureParallelized(), _loopClosureParallelized);
 	Parameters::parse(parameters, Parameters::kRGBDLinearUpdate(), _rehearsalMaxDistance);
 	Parameters::parse(parameters, Parameters::kRGBDAngularUpdate(), _rehearsalMaxAngle);
 	Parameters::parse(parameters, Parameters::kMemRehearsalWeightIgnoredWhileMoving(), _rehearsalWeightIgnoredWhileMoving);
@@ -592,6 +812,7 @@ bool Memory::update(
 		const std::vector<float> & velocity,
 		Statistics * stats)
 {
+	UTRACE("Memory::update");
 	UDEBUG("");
 	UTimer timer;
 	UTimer totalTimer;
@@ -722,6 +943,10 @@ void Memory::addSignatureToStm(Signature * signature, const cv::Mat & covariance
 					motionEstimate = _signatures.at(*_stMem.rbegin())->getPose().inverse() * signature->getPose();
 					_signatures.at(*_stMem.rbegin())->addLink(Link(*_stMem.rbegin(), signature->id(), Link::kNeighbor, motionEstimate, infMatrix));
 					signature->addLink(Link(signature->id(), *_stMem.rbegin(), Link::kNeighbor, motionEstimate.inverse(), infMatrix));
+					if(_pathPlanner)
+					{
+						_pathPlanner->addLink(Link(*_stMem.rbegin(), signature->id(), Link::kNeighbor, motionEstimate));
+					}
 				}
 				else
 				{
@@ -778,6 +1003,7 @@ void Memory::addSignatureToWmFromLTM(Signature * signature)
 	if(signature)
 	{
 		UDEBUG("Inserting node %d in WM...", signature->id());
+		_ltmLinks->remove(signature->id());
 		_workingMem.insert(std::make_pair(signature->id(), UTimer::now()));
 		_signatures.insert(std::pair<int, Signature*>(signature->id(), signature));
 		++_signaturesAdded;
@@ -836,6 +1062,10 @@ void Memory::moveSignatureToWMFromSTM(int id, int * reducedTo)
 					Signature * sTo = this->_getSignature(iter->first);
 					UASSERT(sTo!=0);
 					sTo->removeLink(s->id());
+					if(_pathPlanner)
+					{
+						_pathPlanner->removeLink(s->id(), sTo->id());
+					}
 					if(iter->second.type() != Link::kNeighbor &&
 					   iter->second.type() != Link::kNeighborMerged &&
 					   iter->second.type() != Link::kUndef)
@@ -853,6 +1083,10 @@ void Memory::moveSignatureToWMFromSTM(int id, int * reducedTo)
 								UASSERT(sB!=0);
 								UASSERT(!sB->hasLink(l.to()));
 								sB->addLink(l.inverse());
+								if(_pathPlanner)
+								{
+									_pathPlanner->addLink(l);
+								}
 							}
 						}
 					}
@@ -866,6 +1100,10 @@ void Memory::moveSignatureToWMFromSTM(int id, int * reducedTo)
 					   iter->second.type() == Link::kNeighborMerged)
 					{
 						s->removeLink(iter->first);
+						if(_pathPlanner)
+						{
+							_pathPlanner->removeLink(s->id(), iter->first);
+						}
 						if(iter->second.type() == Link::kNeighbor)
 						{
 							if(_lastGlobalLoopClosureId == s->id())
@@ -1013,7 +1251,8 @@ std::multimap<int, Link> Memory::getAllLinks(bool lookInDatabase, bool ignoreNul
 
 	if(lookInDatabase && _dbDriver)
 	{
-		_dbDriver->getAllLinks(links, ignoreNullLinks);
+		// links of nodes in LTM are already in RAM
+		_ltmLinks->getAll(links, ignoreNullLinks);
 	}
 
 	for(std::map<int, Signature*>::const_iterator iter=_signatures.begin(); iter!=_signatures.end(); ++iter)
@@ -1078,8 +1317,7 @@ std::map<int, int> Memory::getNeighborsId(
 				//UDEBUG("Added %d with margin %d", *jter, m);
 				// Look up in STM/WM if all ids are here, if not... load them from the database
 				const Signature * s = this->getSignature(*jter);
-				std::map<int, Link> tmpLinks;
-				const std::map<int, Link> * links = &tmpLinks;
+				std::vector<std::pair<int, Link::Type> > links;
 				if(s)
 				{
 					if(!ignoreIntermediateNodes || s->getWeight() != -1)
@@ -1091,15 +1329,20 @@ std::map<int, int> Memory::getNeighborsId(
 						ignoredIds.insert(*jter);
 					}
 
-					links = &s->getLinks();
+					links.reserve(s->getLinks().size());
+					for(std::map<int, Link>::const_iterator iter=s->getLinks().begin(); iter!=s->getLinks().end(); ++iter)
+					{
+						links.push_back(std::make_pair(iter->first, iter->second.type()));
+					}
 				}
 				else if(maxCheckedInDatabase == -1 || (maxCheckedInDatabase > 0 && _dbDriver && nbLoadedFromDb < maxCheckedInDatabase))
 				{
 					++nbLoadedFromDb;
 					ids.insert(std::pair<int, int>(*jter, m));
 
+					// links of nodes in LTM are kept in RAM, no need to query the database
 					UTimer timer;
-					_dbDriver->loadLinks(*jter, tmpLinks);
+					_ltmLinks->getNeighbors(*jter, links);
 					if(dbAccessTime)
 					{
 						*dbAccessTime += timer.getElapsedTime();
@@ -1107,13 +1350,13 @@ std::map<int, int> Memory::getNeighborsId(
 				}
 
 				// links
-				for(std::map<int, Link>::const_iterator iter=links->begin(); iter!=links->end(); ++iter)
+				for(std::vector<std::pair<int, Link::Type> >::const_iterator iter=links.begin(); iter!=links.end(); ++iter)
 				{
 					if( !uContains(ids, iter->first) && ignoredIds.find(iter->first) == ignoredIds.end())
 					{
-						UASSERT(iter->second.type() != Link::kUndef);
-						if(iter->second.type() == Link::kNeighbor ||
-					       iter->second.type() == Link::kNeighborMerged)
+						UASSERT(iter->second != Link::kUndef);
+						if(iter->second == Link::kNeighbor ||
+					       iter->second == Link::kNeighborMerged)
 						{
 							if(ignoreIntermediateNodes && s->getWeight()==-1)
 							{
@@ -1389,6 +1632,7 @@ void Memory::clear()
 	_idMapCount = kIdStart;
 	_memoryChanged = false;
 	_linksChanged = false;
+	_ltmLinks->clear();
 
 	if(_dbDriver)
 	{
@@ -1414,6 +1658,7 @@ void Memory::clear()
  */
 std::map<int, float> Memory::computeLikelihood(const Signature * signature, const std::list<int> & ids)
 {
+	UTRACE("Memory::computeLikelihood");
 	if(!_tfIdfLikelihoodUsed)
 	{
 		UTimer timer;
@@ -1910,6 +2155,10 @@ void Memory::moveToTrash(Signature * s, bool keepLinkedToGraph, std::list<int> *
 					}
 
 					sTo->removeLink(s->id());
+					if(_pathPlanner)
+					{
+						_pathPlanner->removeLink(s->id(), iter->first);
+					}
 				}
 
 			}
@@ -1978,6 +2227,7 @@ void Memory::moveToTrash(Signature * s, bool keepLinkedToGraph, std::list<int> *
 			s->id()>0 &&
 			(_incrementalMemory || s->isSaved()))
 		{
+			_ltmLinks->set(s->id(), s->getLinks());
 			_dbDriver->asyncSave(s);
 		}
 		else
@@ -2125,6 +2375,10 @@ void Memory::removeLink(int oldId, int newId)
 
 			oldS->removeLink(newS->id());
 			newS->removeLink(oldS->id());
+			if(_pathPlanner)
+			{
+				_pathPlanner->removeLink(oldS->id(), newS->id());
+			}
 
 			if(type!=Link::kVirtualClosure)
 			{
@@ -2322,6 +2576,49 @@ Transform Memory::computeTransform(
 	return transform;
 }
 
+// compute transforms of independent pairs first -> second, in parallel if RGBD/LoopClosureParallelized is true
+std::vector<Transform> Memory::computeTransforms(
+		const std::vector<std::pair<const Signature *, const Signature *> > & pairs,
+		std::vector<RegistrationInfo> * infos) const
+{
+	std::vector<Transform> transforms(pairs.size());
+	std::vector<RegistrationInfo> infosTmp(pairs.size());
+	std::vector<bool> valid(pairs.size(), false);
+	for(unsigned int i=0; i<pairs.size(); ++i)
+	{
+		if(pairs[i].first && pairs[i].second)
+		{
+			valid[i] = true;
+		}
+		else
+		{
+			infosTmp[i].rejectedMsg = "Did not find nodes";
+			UWARN(infosTmp[i].rejectedMsg.c_str());
+		}
+	}
+
+	// Work on copies: data loaded or uncompressed by computeTransform() are
+	// not written in signatures shared by other pairs.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if(_loopClosureParallelized && pairs.size() > 1)
+#endif
+	for(int i=0; i<(int)pairs.size(); ++i)
+	{
+		if(valid[i])
+		{
+			Signature fromS = *pairs[i].first;
+			Signature toS = *pairs[i].second;
+			transforms[i] = computeTransform(fromS, toS, Transform(), &infosTmp[i]);
+		}
+	}
+
+	if(infos)
+	{
+		*infos = infosTmp;
+	}
+	return transforms;
+}
+
 // compute transform fromId -> toId
 Transform Memory::computeIcpTransform(
 		int fromId,
@@ -2531,11 +2828,13 @@ bool Memory::addLink(const Link & link, bool addInDatabase)
 		UDEBUG("Add link between %d and %d (db)", link.from(), link.to());
 		fromS->addLink(link);
 		_dbDriver->addLink(link.inverse());
+		_ltmLinks->update(link.inverse());
 	}
 	else if(toS)
 	{
 		UDEBUG("Add link between %d (db) and %d", link.from(), link.to());
 		_dbDriver->addLink(link);
+		_ltmLinks->update(link);
 		toS->addLink(link.inverse());
 	}
 	else
@@ -2543,6 +2842,12 @@ bool Memory::addLink(const Link & link, bool addInDatabase)
 		UDEBUG("Add link between %d (db) and %d (db)", link.from(), link.to());
 		_dbDriver->addLink(link);
 		_dbDriver->addLink(link.inverse());
+		_ltmLinks->update(link);
+		_ltmLinks->update(link.inverse());
+	}
+	if(_pathPlanner)
+	{
+		_pathPlanner->addLink(link);
 	}
 	return true;
 }
@@ -2563,6 +2868,10 @@ void Memory::updateLink(const Link & link, bool updateInDatabase)
 
 			fromS->addLink(link);
 			toS->addLink(link.inverse());
+			if(_pathPlanner)
+			{
+				_pathPlanner->addLink(link);
+			}
 
 			if(oldType!=Link::kVirtualClosure || link.type()!=Link::kVirtualClosure)
 			{
@@ -2591,6 +2900,11 @@ void Memory::updateLink(const Link & link, bool updateInDatabase)
 		fromS->removeLink(link.to());
 		fromS->addLink(link);
 		_dbDriver->updateLink(link.inverse());
+		_ltmLinks->update(link.inverse());
+		if(_pathPlanner)
+		{
+			_pathPlanner->addLink(link);
+		}
 	}
 	else if(toS)
 	{
@@ -2598,12 +2912,23 @@ void Memory::updateLink(const Link & link, bool updateInDatabase)
 		toS->removeLink(link.from());
 		toS->addLink(link.inverse());
 		_dbDriver->updateLink(link);
+		_ltmLinks->update(link);
+		if(_pathPlanner)
+		{
+			_pathPlanner->addLink(link);
+		}
 	}
 	else
 	{
 		UDEBUG("Update link between %d (db) and %d (db)", link.from(), link.to());
 		_dbDriver->updateLink(link);
 		_dbDriver->updateLink(link.inverse());
+		_ltmLinks->update(link);
+		_ltmLinks->update(link.inverse());
+		if(_pathPlanner)
+		{
+			_pathPlanner->addLink(link);
+		}
 	}
 }
 
@@ -2612,6 +2937,16 @@ void Memory::removeAllVirtualLinks()
 	UDEBUG("");
 	for(std::map<int, Signature*>::iterator iter=_signatures.begin(); iter!=_signatures.end(); ++iter)
 	{
+		if(_pathPlanner)
+		{
+			for(std::map<int, Link>::const_iterator jter=iter->second->getLinks().begin(); jter!=iter->second->getLinks().end(); ++jter)
+			{
+				if(jter->second.type() == Link::kVirtualClosure)
+				{
+					_pathPlanner->removeLink(iter->first, jter->first);
+				}
+			}
+		}
 		iter->second->removeVirtualLinks();
 	}
 }
@@ -2636,6 +2971,10 @@ void Memory::removeVirtualLinks(int signatureId)
 				{
 					UERROR("Link %d of %d not in WM/STM?!?", iter->first, s->id());
 				}
+				if(_pathPlanner)
+				{
+					_pathPlanner->removeLink(s->id(), iter->first);
+				}
 			}
 		}
 		s->removeVirtualLinks();
@@ -2885,6 +3224,10 @@ bool Memory::rehearsalMerge(int oldId, int newId)
 			Link newToOldLink = newS->getLinks().at(oldS->id());
 			oldS->removeLink(newId);
 			newS->removeLink(oldId);
+			if(_pathPlanner)
+			{
+				_pathPlanner->removeLink(oldId, newId);
+			}
 
 			if(_idUpdatedToNewOneRehearsal)
 			{
@@ -2906,6 +3249,11 @@ bool Memory::rehearsalMerge(int oldId, int newId)
 							s->addLink(mergedLink.inverse());
 
 							newS->addLink(mergedLink);
+							if(_pathPlanner)
+							{
+								_pathPlanner->removeLink(oldS->id(), s->id());
+								_pathPlanner->addLink(mergedLink);
+							}
 						}
 						else
 						{
@@ -3893,6 +4241,19 @@ Signature * Memory::createSignature(const SensorData & data, const Transform & p
 		_occupancy->createLocalMap(*s, ground, obstacles, viewPoint);
 		cellSize = _occupancy->getCellSize();
 
+		if(_occupancy->getLocalMapEncoding() > 0)
+		{
+			// saved as cells relative to the node (see Grid/LocalMapEncoding)
+			if(ground.type() == CV_32FC2 || ground.type() == CV_32FC3)
+			{
+				ground = util3d::encodeLocalMapCells(ground, cellSize, _occupancy->getLocalMapEncoding() == 2);
+			}
+			if(obstacles.type() == CV_32FC2 || obstacles.type() == CV_32FC3)
+			{
+				obstacles = util3d::encodeLocalMapCells(obstacles, cellSize, _occupancy->getLocalMapEncoding() == 2);
+			}
+		}
+
 		t = timer.ticks();
 		if(stats) stats->addStatistic(Statistics::kTimingMemOccupancy_grid(), t*1000.0f);
 		UDEBUG("time grid map = %fs", t);
@@ -4065,6 +4426,7 @@ void Memory::enableWordsRef(const std::list<int> & signatureIds)
 
 std::set<int> Memory::reactivateSignatures(const std::list<int> & ids, unsigned int maxLoaded, double & timeDbAccess)
 {
+	UTRACE("Memory::reactivateSignatures");
 	// get the signatures, if not in the working memory, they
 	// will be loaded from the database in an more efficient way
 	// than how it is done in the Memory
@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rtabmap/core/OccupancyGrid.h>
 #include <rtabmap/core/util3d.h>
+#include <rtabmap/core/util3d_mapping.h>
 #include <rtabmap/utilite/ULogger.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UStl.h>
@@ -69,6 +70,7 @@ OccupancyGrid::OccupancyGrid(const ParametersMap & parameters) :
 	minMapSize_(Parameters::defaultGridGlobalMinSize()),
 	erode_(Parameters::defaultGridGlobalEroded()),
 	footprintRadius_(Parameters::defaultGridGlobalFootprintRadius()),
+	localMapEncoding_(Parameters::defaultGridLocalMapEncoding()),
 	xMin_(0.0f),
 	yMin_(0.0f)
 {
@@ -139,6 +141,7 @@ void OccupancyGrid::parseParameters(const ParametersMap & parameters)
 	Parameters::parse(parameters, Parameters::kGridGlobalMinSize(), minMapSize_);
 	Parameters::parse(parameters, Parameters::kGridGlobalEroded(), erode_);
 	Parameters::parse(parameters, Parameters::kGridGlobalFootprintRadius(), footprintRadius_);
+	Parameters::parse(parameters, Parameters::kGridLocalMapEncoding(), localMapEncoding_);
 
 	UASSERT(minMapSize_ >= 0.0f);
 
@@ -415,7 +418,17 @@ void OccupancyGrid::addToCache(
 		const cv::Mat & obstacles)
 {
 	UDEBUG("nodeId=%d", nodeId);
-	uInsert(cache_, std::make_pair(nodeId, std::make_pair(ground, obstacles)));
+	if(localMapEncoding_ > 0)
+	{
+		// keep cells instead of points in the cache
+		cv::Mat groundCells = ground.type() == CV_32FC2 || ground.type() == CV_32FC3?util3d::encodeLocalMapCells(ground, cellSize_, localMapEncoding_ == 2):ground;
+		cv::Mat obstacleCells = obstacles.type() == CV_32FC2 || obstacles.type() == CV_32FC3?util3d::encodeLocalMapCells(obstacles, cellSize_, localMapEncoding_ == 2):obstacles;
+		uInsert(cache_, std::make_pair(nodeId, std::make_pair(groundCells, obstacleCells)));
+	}
+	else
+	{
+		uInsert(cache_, std::make_pair(nodeId, std::make_pair(ground, obstacles)));
+	}
 }
 
 void OccupancyGrid::update(const std::map<int, Transform> & posesIn)
@@ -645,22 +658,35 @@ void OccupancyGrid::update(const std::map<int, Transform> & posesIn)
 					{
 						UFATAL("Occupancy local maps should be 1 row and X cols! (rows=%d cols=%d)", pair.first.rows, pair.first.cols);
 					}
-					cv::Mat ground(1, pair.first.cols, CV_32FC2);
+					bool encoded = pair.first.depth() == CV_16S;
+					cv::Mat ground;
+					if(encoded)
+					{
+						// cells are directly reprojected at the node pose
+						ground = util3d::decodeLocalMapCells(pair.first, cellSize_, iter->second);
+					}
+					else
+					{
+						ground = cv::Mat(1, pair.first.cols, CV_32FC2);
+					}
 					for(int i=0; i<ground.cols; ++i)
 					{
-						const float * vi = pair.first.ptr<float>(0,i);
 						float * vo = ground.ptr<float>(0,i);
-						cv::Point3f vt;
-						if(pair.first.channels() > 2)
-						{
-							vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], vi[2]), iter->second);
-						}
-						else
+						if(!encoded)
 						{
-							vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], 0), iter->second);
+							const float * vi = pair.first.ptr<float>(0,i);
+							cv::Point3f vt;
+							if(pair.first.channels() > 2)
+							{
+								vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], vi[2]), iter->second);
+							}
+							else
+							{
+								vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], 0), iter->second);
+							}
+							vo[0] = vt.x;
+							vo[1] = vt.y;
 						}
-						vo[0] = vt.x;
-						vo[1] = vt.y;
 						if(minX > vo[0])
 							minX = vo[0];
 						else if(maxX < vo[0])
@@ -681,22 +707,35 @@ void OccupancyGrid::update(const std::map<int, Transform> & posesIn)
 					{
 						UFATAL("Occupancy local maps should be 1 row and X cols! (rows=%d cols=%d)", pair.second.rows, pair.second.cols);
 					}
-					cv::Mat obstacles(1, pair.second.cols, CV_32FC2);
+					bool encoded = pair.second.depth() == CV_16S;
+					cv::Mat obstacles;
+					if(encoded)
+					{
+						// cells are directly reprojected at the node pose
+						obstacles = util3d::decodeLocalMapCells(pair.second, cellSize_, iter->second);
+					}
+					else
+					{
+						obstacles = cv::Mat(1, pair.second.cols, CV_32FC2);
+					}
 					for(int i=0; i<obstacles.cols; ++i)
 					{
-						const float * vi = pair.second.ptr<float>(0,i);
 						float * vo = obstacles.ptr<float>(0,i);
-						cv::Point3f vt;
-						if(pair.second.channels() > 2)
+						if(!encoded)
 						{
-							vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], vi[2]), iter->second);
-						}
-						else
-						{
-							vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], 0), iter->second);
+							const float * vi = pair.second.ptr<float>(0,i);
+							cv::Point3f vt;
+							if(pair.second.channels() > 2)
+							{
+								vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], vi[2]), iter->second);
+							}
+							else
+							{
+								vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], 0), iter->second);
+							}
+							vo[0] = vt.x;
+							vo[1] = vt.y;
 						}
-						vo[0] = vt.x;
-						vo[1] = vt.y;
 						if(minX > vo[0])
 							minX = vo[0];
 						else if(maxX < vo[0])
@@ -31,14 +31,23 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/core/util3d_transforms.h>
 #include <rtabmap/core/util3d_filtering.h>
 #include <rtabmap/core/util3d_mapping.h>
+#include <rtabmap/utilite/UTimer.h>
 #include <pcl/common/transforms.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace rtabmap {
 
-OctoMap::OctoMap(float voxelSize, float occupancyThr, bool fullUpdate) :
+OctoMap::OctoMap(float voxelSize, float occupancyThr, bool fullUpdate, float updateMovedNodesThr) :
 		octree_(new octomap::ColorOcTree(voxelSize)),
 		hasColor_(false),
-		fullUpdate_(fullUpdate)
+		fullUpdate_(fullUpdate),
+		updateMovedNodesThr_(updateMovedNodesThr),
+		lastNodesAdded_(0),
+		lastNodesMoved_(0),
+		lastRayCastingTime_(0.0)
 {
 	octree_->setOccupancyThres(occupancyThr);
 	UASSERT(voxelSize>0.0f);
@@ -58,7 +67,7 @@ void OctoMap::clear()
 	cacheClouds_.clear();
 	cacheViewPoints_.clear();
 	addedNodes_.clear();
-	keyRay_ = octomap::KeyRay();
+	contributions_.clear();
 	hasColor_ = false;
 }
 
@@ -83,9 +92,123 @@ void OctoMap::addToCache(int nodeId,
 	uInsert(cacheViewPoints_, std::make_pair(nodeId, viewPoint));
 }
 
+// Cells touched by the cloud of one node, computed without modifying the octree
+class OcTreeNodeUpdate
+{
+public:
+	OcTreeNodeUpdate() : id(0), radius(0.0f) {}
+	int id;
+	Transform pose;
+	std::vector<std::pair<octomap::OcTreeKey, pcl::PointXYZRGB> > ground;
+	std::vector<std::pair<octomap::OcTreeKey, pcl::PointXYZRGB> > obstacles;
+	std::vector<octomap::OcTreeKey> free; // free cells not seen occupied in this cloud
+	float radius; // farthest point from the node (m)
+};
+
+static pcl::PointXYZRGB getCachedPoint(const cv::Mat * scan, const pcl::PointCloud<pcl::PointXYZRGB> * cloud, unsigned int i)
+{
+	return scan?util3d::laserScanToPointRGB(*scan, i):cloud->at(i);
+}
+
+// Original version from A. Hornung:
+// https://github.com/OctoMap/octomap_mapping/blob/jade-devel/octomap_server/src/OctomapServer.cpp#L356
+//
+static void computeNodeUpdate(
+		const octomap::ColorOcTree & octree,
+		const cv::Mat * groundScan,
+		const cv::Mat * obstaclesScan,
+		const pcl::PointCloud<pcl::PointXYZRGB> * groundCloud,
+		const pcl::PointCloud<pcl::PointXYZRGB> * obstaclesCloud,
+		const cv::Point3f & viewPoint,
+		OcTreeNodeUpdate & update)
+{
+	octomap::point3d sensorOrigin(update.pose.x(), update.pose.y(), update.pose.z());
+	sensorOrigin += octomap::point3d(viewPoint.x, viewPoint.y, viewPoint.z);
+
+	octomap::OcTreeKey tmpKey;
+	if (!octree.coordToKeyChecked(sensorOrigin, tmpKey))
+	{
+		UERROR("Could not generate Key for origin ", sensorOrigin.x(), sensorOrigin.y(), sensorOrigin.z());
+	}
+
+	// instead of direct scan insertion, compute update to filter ground:
+	octomap::KeyRay keyRay;
+	octomap::KeySet free_cells, occupied_cells, ground_cells;
+	Eigen::Affine3f t = update.pose.toEigen3f();
+
+	// insert ground points only as free:
+	unsigned int maxGroundPts = groundScan?groundScan->cols:groundCloud->size();
+	UDEBUG("%d: compute free cells (from %d ground points)", update.id, (int)maxGroundPts);
+	update.ground.reserve(maxGroundPts);
+	for (unsigned int i=0; i<maxGroundPts; ++i)
+	{
+		pcl::PointXYZRGB pt = getCachedPoint(groundScan, groundCloud, i);
+		update.radius = std::max(update.radius, pt.getVector3fMap().norm());
+		pt = pcl::transformPoint(pt, t);
+
+		octomap::point3d point(pt.x, pt.y, pt.z);
+
+		// only clear space (ground points)
+		if (octree.computeRayKeys(sensorOrigin, point, keyRay))
+		{
+			free_cells.insert(keyRay.begin(), keyRay.end());
+		}
+		// occupied endpoint
+		octomap::OcTreeKey key;
+		if (octree.coordToKeyChecked(point, key))
+		{
+			ground_cells.insert(key);
+			update.ground.push_back(std::make_pair(key, pt));
+		}
+	}
+	UDEBUG("%d: free cells = %d", update.id, (int)free_cells.size());
+
+	// all other points: free on ray, occupied on endpoint:
+	unsigned int maxObstaclePts = obstaclesScan?obstaclesScan->cols:obstaclesCloud->size();
+	UDEBUG("%d: compute occupied cells (from %d obstacle points)", update.id, (int)maxObstaclePts);
+	update.obstacles.reserve(maxObstaclePts);
+	for (unsigned int i=0; i<maxObstaclePts; ++i)
+	{
+		pcl::PointXYZRGB pt = getCachedPoint(obstaclesScan, obstaclesCloud, i);
+		update.radius = std::max(update.radius, pt.getVector3fMap().norm());
+		pt = pcl::transformPoint(pt, t);
+
+		octomap::point3d point(pt.x, pt.y, pt.z);
+
+		// free cells
+		if (octree.computeRayKeys(sensorOrigin, point, keyRay))
+		{
+			free_cells.insert(keyRay.begin(), keyRay.end());
+		}
+		// occupied endpoint
+		octomap::OcTreeKey key;
+		if (octree.coordToKeyChecked(point, key))
+		{
+			occupied_cells.insert(key);
+			update.obstacles.push_back(std::make_pair(key, pt));
+		}
+	}
+	UDEBUG("%d: occupied cells=%d free cells=%d", update.id, (int)occupied_cells.size(), (int)free_cells.size());
+
+	// mark free cells only if not seen occupied in this cloud
+	update.free.reserve(free_cells.size());
+	for(octomap::KeySet::iterator it = free_cells.begin(), end=free_cells.end(); it!= end; ++it)
+	{
+		if (occupied_cells.find(*it) == occupied_cells.end() &&
+			ground_cells.find(*it) == ground_cells.end())
+		{
+			update.free.push_back(*it);
+		}
+	}
+}
+
 void OctoMap::update(const std::map<int, Transform> & poses)
 {
 	UDEBUG("Update (poses=%d addedNodes_=%d)", (int)poses.size(), (int)addedNodes_.size());
+	UTimer timer;
+	lastNodesAdded_ = 0;
+	lastNodesMoved_ = 0;
+	lastRayCastingTime_ = 0.0;
 
 	// First, check of the graph has changed. If so, re-create the octree by moving all occupied nodes.
 	bool graphOptimized = false; // If a loop closure happened (e.g., poses are modified)
@@ -110,10 +233,79 @@ void OctoMap::update(const std::map<int, Transform> & poses)
 		}
 		else
 		{
-			UDEBUG("Updated pose for node %d is not found, some points may not be copied. Use negative ids to just update cell values without adding new ones.", jter->first);
+			UDEBUG("Updated pose for node %d is not found, some points may not be copied. Use negative ids to just update cell values without adding new ones.", iter->first);
+		}
+	}
+
+	std::set<int> movedNodes; // nodes to remove then re-insert (incremental update)
+	if(!graphChanged && updateMovedNodesThr_ > 0.0f && (graphOptimized || transforms.size() < addedNodes_.size()))
+	{
+		// Only nodes that moved more than the threshold since they were
+		// inserted (or that are not in the graph anymore) are relocated.
+		std::set<int> removedNodes;
+		for(std::map<int, Transform>::iterator iter=addedNodes_.begin(); iter!=addedNodes_.end(); ++iter)
+		{
+			std::map<int, OcTreeNodeCells>::iterator cter = contributions_.find(iter->first);
+			std::map<int, Transform>::const_iterator jter = poses.find(iter->first);
+			if(jter == poses.end())
+			{
+				removedNodes.insert(iter->first);
+			}
+			else if(cter != contributions_.end())
+			{
+				// maximum displacement of the points of the node
+				Transform t = iter->second.inverse() * jter->second;
+				float angle = Eigen::AngleAxisf(t.toEigen3f().linear()).angle();
+				float displacement = iter->second.getDistance(jter->second) + fabs(angle)*cter->second.radius_;
+				if(displacement > updateMovedNodesThr_)
+				{
+					movedNodes.insert(iter->first);
+				}
+			}
+		}
+		UINFO("Graph optimized! %d nodes moved more than %f m (%d nodes removed)",
+				(int)movedNodes.size(), updateMovedNodesThr_, (int)removedNodes.size());
+
+		// remove the contribution of the nodes
+		std::set<int> nodesToRemove = movedNodes;
+		nodesToRemove.insert(removedNodes.begin(), removedNodes.end());
+		for(std::set<int>::iterator iter=nodesToRemove.begin(); iter!=nodesToRemove.end(); ++iter)
+		{
+			std::map<int, OcTreeNodeCells>::iterator cter = contributions_.find(*iter);
+			if(cter != contributions_.end())
+			{
+				for(unsigned int i=0; i<cter->second.hits_.size(); ++i)
+				{
+					octree_->updateNode(cter->second.hits_[i], -octree_->getProbHitLog());
+				}
+				for(unsigned int i=0; i<cter->second.misses_.size(); ++i)
+				{
+					octree_->updateNode(cter->second.misses_[i], -octree_->getProbMissLog());
+				}
+				contributions_.erase(cter);
+			}
+			if(removedNodes.find(*iter) != removedNodes.end())
+			{
+				addedNodes_.erase(*iter);
+			}
+		}
+		if(nodesToRemove.size())
+		{
+			for(std::map<octomap::ColorOcTreeNode*, OcTreeNodeInfo>::iterator iter=occupiedCells_.begin(); iter!=occupiedCells_.end();)
+			{
+				if(nodesToRemove.find(iter->second.nodeRefId_) != nodesToRemove.end())
+				{
+					occupiedCells_.erase(iter++);
+				}
+				else
+				{
+					++iter;
+				}
+			}
 		}
+		lastNodesMoved_ = (int)movedNodes.size();
 	}
-	if(graphOptimized || graphChanged)
+	else if(graphOptimized || graphChanged)
 	{
 		if(graphChanged)
 		{
@@ -129,8 +321,8 @@ void OctoMap::update(const std::map<int, Transform> & poses)
 			// clear all but keep cache
 			octree_->clear();
 			occupiedCells_.clear();
+			contributions_.clear();
 			addedNodes_.clear();
-			keyRay_ = octomap::KeyRay();
 			hasColor_ = false;
 		}
 		else
@@ -187,10 +379,12 @@ void OctoMap::update(const std::map<int, Transform> & poses)
 		}
 	}
 
-	// Original version from A. Hornung:
-	// https://github.com/OctoMap/octomap_mapping/blob/jade-devel/octomap_server/src/OctomapServer.cpp#L356
-	//
+	// moved nodes are re-inserted first, then new nodes
 	std::list<std::pair<int, Transform> > orderedPoses;
+	for(std::set<int>::iterator iter=movedNodes.begin(); iter!=movedNodes.end(); ++iter)
+	{
+		orderedPoses.push_back(*poses.find(*iter));
+	}
 	int lastId = addedNodes_.size()?addedNodes_.rbegin()->first:0;
 	UDEBUG("Last id = %d", lastId);
 	if(lastId >= 0)
@@ -213,7 +407,11 @@ void OctoMap::update(const std::map<int, Transform> & poses)
 		}
 	}
 
-	UDEBUG("orderedPoses = %d", (int)orderedPoses.size());
+	// keep only nodes in cache
+	std::vector<OcTreeNodeUpdate> updates;
+	std::vector<const cv::Mat *> groundScans, obstaclesScans;
+	std::vector<const pcl::PointCloud<pcl::PointXYZRGB> *> groundClouds, obstaclesClouds;
+	std::vector<cv::Point3f> viewPoints;
 	for(std::list<std::pair<int, Transform> >::const_iterator iter=orderedPoses.begin(); iter!=orderedPoses.end(); ++iter)
 	{
 		std::map<int, std::pair<pcl::PointCloud<pcl::PointXYZRGB>::Ptr, pcl::PointCloud<pcl::PointXYZRGB>::Ptr> >::iterator cloudIter;
@@ -224,102 +422,67 @@ void OctoMap::update(const std::map<int, Transform> & poses)
 		viewPointIter = cacheViewPoints_.find(iter->first);
 		if(occupancyIter != cache_.end() || cloudIter != cacheClouds_.end())
 		{
-			UDEBUG("Adding %d to octomap (resolution=%f)", iter->first, octree_->getResolution());
-
 			UASSERT(viewPointIter != cacheViewPoints_.end());
-			octomap::point3d sensorOrigin(iter->second.x(), iter->second.y(), iter->second.z());
-			sensorOrigin += octomap::point3d(viewPointIter->second.x, viewPointIter->second.y, viewPointIter->second.z);
+			updates.push_back(OcTreeNodeUpdate());
+			updates.back().id = iter->first;
+			updates.back().pose = iter->second;
+			groundScans.push_back(occupancyIter != cache_.end()?&occupancyIter->second.first:0);
+			obstaclesScans.push_back(occupancyIter != cache_.end()?&occupancyIter->second.second:0);
+			groundClouds.push_back(occupancyIter == cache_.end()?cloudIter->second.first.get():0);
+			obstaclesClouds.push_back(occupancyIter == cache_.end()?cloudIter->second.second.get():0);
+			viewPoints.push_back(viewPointIter->second);
+		}
+		else
+		{
+			UDEBUG("Did not find %d in cache", iter->first);
+		}
+	}
+	UDEBUG("orderedPoses = %d (in cache=%d)", (int)orderedPoses.size(), (int)updates.size());
+
+	// Ray casting of a batch of nodes is done in parallel (the octree is
+	// only read), then the cells are updated in the octree in the same
+	// order than if the nodes were inserted one after the other.
+	const int batchSize = 32;
+	for(int b=0; b<(int)updates.size(); b+=batchSize)
+	{
+		int end = std::min((int)updates.size(), b+batchSize);
+		UTimer rayTimer;
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for(int i=b; i<end; ++i)
+		{
+			computeNodeUpdate(*octree_, groundScans[i], obstaclesScans[i], groundClouds[i], obstaclesClouds[i], viewPoints[i], updates[i]);
+		}
+		lastRayCastingTime_ += rayTimer.ticks();
 
-			octomap::OcTreeKey tmpKey;
-			if (!octree_->coordToKeyChecked(sensorOrigin, tmpKey)
-					|| !octree_->coordToKeyChecked(sensorOrigin, tmpKey))
+		for(int i=b; i<end; ++i)
+		{
+			OcTreeNodeUpdate & update = updates[i];
+			UDEBUG("Adding %d to octomap (resolution=%f)", update.id, octree_->getResolution());
+			OcTreeNodeCells * cells = 0;
+			if(updateMovedNodesThr_ > 0.0f && update.id > 0)
 			{
-				UERROR("Could not generate Key for origin ", sensorOrigin.x(), sensorOrigin.y(), sensorOrigin.z());
+				cells = &contributions_[update.id];
+				*cells = OcTreeNodeCells();
+				cells->radius_ = update.radius;
+				cells->hits_.reserve(update.obstacles.size());
+				cells->misses_.reserve(update.ground.size() + update.free.size());
 			}
 
-			// instead of direct scan insertion, compute update to filter ground:
-			octomap::KeySet free_cells, occupied_cells, ground_cells;
-			// insert ground points only as free:
-			unsigned int maxGroundPts = occupancyIter != cache_.end()?occupancyIter->second.first.cols:cloudIter->second.first->size();
-			UDEBUG("%d: compute free cells (from %d ground points)", iter->first, (int)maxGroundPts);
-			Eigen::Affine3f t = iter->second.toEigen3f();
-			for (unsigned int i=0; i<maxGroundPts; ++i)
+			for(int j=0; j<2; ++j)
 			{
-				pcl::PointXYZRGB pt;
-				if(occupancyIter != cache_.end())
+				bool isObstacle = j==1;
+				const std::vector<std::pair<octomap::OcTreeKey, pcl::PointXYZRGB> > & endPoints = isObstacle?update.obstacles:update.ground;
+				for(unsigned int k=0; k<endPoints.size(); ++k)
 				{
-					pt = util3d::laserScanToPointRGB(occupancyIter->second.first, i);
-					pt = pcl::transformPoint(pt, t);
-				}
-				else
-				{
-					pt = pcl::transformPoint(cloudIter->second.first->at(i), t);
-				}
-
-				octomap::point3d point(pt.x, pt.y, pt.z);
-
-				// only clear space (ground points)
-				if (octree_->computeRayKeys(sensorOrigin, point, keyRay_))
-				{
-					free_cells.insert(keyRay_.begin(), keyRay_.end());
-				}
-				// occupied endpoint
-				octomap::OcTreeKey key;
-				if (octree_->coordToKeyChecked(point, key))
-				{
-					ground_cells.insert(key);
-
-					octomap::ColorOcTreeNode * n = octree_->updateNode(key, false);
-					if(n)
+					const octomap::OcTreeKey & key = endPoints[k].first;
+					const pcl::PointXYZRGB & pt = endPoints[k].second;
+					octomap::ColorOcTreeNode * n = octree_->updateNode(key, isObstacle);
+					if(cells)
 					{
-						if(!hasColor_ && (pt.r !=0 || pt.g != 0 || pt.b != 0))
-						{
-							hasColor_ = true;
-						}
-						octree_->averageNodeColor(key, pt.r, pt.g, pt.b);
-						if(iter->first > 0)
-						{
-							uInsert(occupiedCells_, std::make_pair(n, OcTreeNodeInfo(iter->first, key, false)));
-						}
-						else
-						{
-							occupiedCells_.insert(std::make_pair(n, OcTreeNodeInfo(iter->first, key, false)));
-						}
+						(isObstacle?cells->hits_:cells->misses_).push_back(key);
 					}
-				}
-			}
-			UDEBUG("%d: free cells = %d", iter->first, (int)free_cells.size());
-
-			// all other points: free on ray, occupied on endpoint:
-			unsigned int maxObstaclePts = occupancyIter != cache_.end()?occupancyIter->second.second.cols:cloudIter->second.second->size();
-			UDEBUG("%d: compute occupied cells (from %d obstacle points)", iter->first, (int)maxObstaclePts);
-			for (unsigned int i=0; i<maxObstaclePts; ++i)
-			{
-				pcl::PointXYZRGB pt;
-				if(occupancyIter != cache_.end())
-				{
-					pt = util3d::laserScanToPointRGB(occupancyIter->second.second, i);
-					pt = pcl::transformPoint(pt, t);
-				}
-				else
-				{
-					pt = pcl::transformPoint(cloudIter->second.second->at(i), t);
-				}
-
-				octomap::point3d point(pt.x, pt.y, pt.z);
-
-				// free cells
-				if (octree_->computeRayKeys(sensorOrigin, point, keyRay_))
-				{
-					free_cells.insert(keyRay_.begin(), keyRay_.end());
-				}
-				// occupied endpoint
-				octomap::OcTreeKey key;
-				if (octree_->coordToKeyChecked(point, key))
-				{
-					occupied_cells.insert(key);
-
-					octomap::ColorOcTreeNode * n = octree_->updateNode(key, true);
 					if(n)
 					{
 						if(!hasColor_ && (pt.r !=0 || pt.g != 0 || pt.b != 0))
@@ -327,35 +490,32 @@ void OctoMap::update(const std::map<int, Transform> & poses)
 							hasColor_ = true;
 						}
 						octree_->averageNodeColor(key, pt.r, pt.g, pt.b);
-						if(iter->first > 0)
+						if(update.id > 0)
 						{
-							uInsert(occupiedCells_, std::make_pair(n, OcTreeNodeInfo(iter->first, key, true)));
+							uInsert(occupiedCells_, std::make_pair(n, OcTreeNodeInfo(update.id, key, isObstacle)));
 						}
 						else
 						{
-							occupiedCells_.insert(std::make_pair(n, OcTreeNodeInfo(iter->first, key, true)));
+							occupiedCells_.insert(std::make_pair(n, OcTreeNodeInfo(update.id, key, isObstacle)));
 						}
 					}
 				}
 			}
-			UDEBUG("%d: occupied cells=%d free cells=%d", iter->first, (int)occupied_cells.size(), (int)free_cells.size());
 
-
-			// mark free cells only if not seen occupied in this cloud
-			for(octomap::KeySet::iterator it = free_cells.begin(), end=free_cells.end(); it!= end; ++it)
+			for(unsigned int k=0; k<update.free.size(); ++k)
 			{
-				if (occupied_cells.find(*it) == occupied_cells.end() &&
-					ground_cells.find(*it) == ground_cells.end())
+				octomap::ColorOcTreeNode * n = octree_->updateNode(update.free[k], false);
+				if(cells)
 				{
-					octomap::ColorOcTreeNode * n = octree_->updateNode(*it, false);
-					if(n)
+					cells->misses_.push_back(update.free[k]);
+				}
+				if(n)
+				{
+					std::map<octomap::ColorOcTreeNode*, OcTreeNodeInfo>::iterator gter;
+					gter = occupiedCells_.find(n);
+					if(gter != occupiedCells_.end() && gter->second.isObstacle_)
 					{
-						std::map<octomap::ColorOcTreeNode*, OcTreeNodeInfo>::iterator gter;
-						gter = occupiedCells_.find(n);
-						if(gter != occupiedCells_.end() && gter->second.isObstacle_)
-						{
-							occupiedCells_.erase(gter);
-						}
+						occupiedCells_.erase(gter);
 					}
 				}
 			}
@@ -364,23 +524,29 @@ void OctoMap::update(const std::map<int, Transform> & poses)
 			//octree_->prune();
 
 			// ignore negative ids as they are temporary clouds
-			if(iter->first > 0)
+			if(update.id > 0)
 			{
-				addedNodes_.insert(*iter);
+				uInsert(addedNodes_, std::make_pair(update.id, update.pose));
+				if(movedNodes.find(update.id) == movedNodes.end())
+				{
+					++lastNodesAdded_;
+				}
 			}
-			UDEBUG("%d: end", iter->first);
-		}
-		else
-		{
-			UDEBUG("Did not find %d in cache", iter->first);
+			UDEBUG("%d: end", update.id);
+
+			// release memory of the batch
+			update = OcTreeNodeUpdate();
 		}
 	}
-	if(!fullUpdate_)
+
+	if(!fullUpdate_ && updateMovedNodesThr_ <= 0.0f)
 	{
 		cache_.clear();
 		cacheClouds_.clear();
 		cacheViewPoints_.clear();
 	}
+	UDEBUG("Update done: added=%d moved=%d ray casting=%fs total=%fs",
+			lastNodesAdded_, lastNodesMoved_, lastRayCastingTime_, timer.ticks());
 }
 
 void HSVtoRGB( float *r, float *g, float *b, float h, float s, float v )
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/OdometryFovis.h"
 #include "rtabmap/core/OdometryViso2.h"
 #include "rtabmap/core/OdometryDVO.h"
+#include "rtabmap/core/OdometryDense.h"
 #include "rtabmap/core/OdometryORBSLAM2.h"
 #include "rtabmap/core/OdometryInfo.h"
 #include "rtabmap/core/util3d.h"
@@ -38,6 +39,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/util3d_filtering.h"
 #include "rtabmap/utilite/ULogger.h"
 #include "rtabmap/utilite/UTimer.h"
+#include "rtabmap/utilite/UTrace.h"
 #include "rtabmap/utilite/UConversion.h"
 #include "rtabmap/core/ParticleFilter.h"
 #include "rtabmap/core/util2d.h"
@@ -60,6 +62,9 @@ Odometry * Odometry::create(Odometry::Type & type, const ParametersMap & paramet
 	Odometry * odometry = 0;
 	switch(type)
 	{
+	case Odometry::kTypeDense:
+		odometry = new OdometryDense(parameters);
+		break;
 	case Odometry::kTypeORBSLAM2:
 		odometry = new OdometryORBSLAM2(parameters);
 		break;
@@ -102,7 +107,8 @@ Odometry::Odometry(const rtabmap::ParametersMap & parameters) :
 		_pose(Transform::getIdentity()),
 		_resetCurrentCount(0),
 		previousStamp_(0),
-		distanceTravelled_(0)
+		distanceTravelled_(0),
+		particleFilter_(0)
 {
 	Parameters::parse(parameters, Parameters::kOdomResetCountdown(), _resetCountdown);
 
@@ -131,19 +137,8 @@ Odometry::Odometry(const rtabmap::ParametersMap & parameters) :
 
 	if(_filteringStrategy == 2)
 	{
-		// Initialize the Particle filters
-		particleFilters_.resize(6);
-		for(unsigned int i = 0; i<particleFilters_.size(); ++i)
-		{
-			if(i<3)
-			{
-				particleFilters_[i] = new ParticleFilter(_particleSize, _particleNoiseT, _particleLambdaT);
-			}
-			else
-			{
-				particleFilters_[i] = new ParticleFilter(_particleSize, _particleNoiseR, _particleLambdaR);
-			}
-		}
+		// Initialize the Particle filter (joint over the 6 DoF)
+		particleFilter_ = new ParticleFilter6DoF(_particleSize, _particleNoiseT, _particleLambdaT, _particleNoiseR, _particleLambdaR);
 	}
 	else if(_filteringStrategy == 1)
 	{
@@ -153,11 +148,8 @@ Odometry::Odometry(const rtabmap::ParametersMap & parameters) :
 
 Odometry::~Odometry()
 {
-	for(unsigned int i=0; i<particleFilters_.size(); ++i)
-	{
-		delete particleFilters_[i];
-	}
-	particleFilters_.clear();
+	delete particleFilter_;
+	particleFilter_ = 0;
 }
 
 void Odometry::reset(const Transform & initialPose)
@@ -168,7 +160,7 @@ void Odometry::reset(const Transform & initialPose)
 	_resetCurrentCount = 0;
 	previousStamp_ = 0;
 	distanceTravelled_ = 0;
-	if(_force3DoF || particleFilters_.size())
+	if(_force3DoF || particleFilter_)
 	{
 		float x,y,z, roll,pitch,yaw;
 		initialPose.getTranslationAndEulerAngles(x, y, z, roll, pitch, yaw);
@@ -190,15 +182,10 @@ void Odometry::reset(const Transform & initialPose)
 			_pose = initialPose;
 		}
 
-		if(particleFilters_.size())
+		if(particleFilter_)
 		{
-			UASSERT(particleFilters_.size() == 6);
-			particleFilters_[0]->init(x);
-			particleFilters_[1]->init(y);
-			particleFilters_[2]->init(z);
-			particleFilters_[3]->init(roll);
-			particleFilters_[4]->init(pitch);
-			particleFilters_[5]->init(yaw);
+			double values[6] = {x, y, z, roll, pitch, yaw};
+			particleFilter_->init(values);
 		}
 
 		if(_filteringStrategy == 1)
@@ -219,6 +206,7 @@ Transform Odometry::process(SensorData & data, OdometryInfo * info)
 
 Transform Odometry::process(SensorData & data, const Transform & guessIn, OdometryInfo * info)
 {
+	UTRACE("Odometry::process");
 	UASSERT_MSG(data.id() >= 0, uFormat("Input data should have ID greater or equal than 0 (id=%d)!", data.id()).c_str());
 
 	// Ground alignment
@@ -424,7 +412,7 @@ Transform Odometry::process(SensorData & data, const Transform & guessIn, Odomet
 			vyaw /= dt;
 		}
 
-		if(_force3DoF || !_holonomic || particleFilters_.size() || _filteringStrategy==1)
+		if(_force3DoF || !_holonomic || particleFilter_ || _filteringStrategy==1)
 		{
 			if(_filteringStrategy == 1)
 			{
@@ -446,24 +434,25 @@ Transform Odometry::process(SensorData & data, const Transform & guessIn, Odomet
 					updateKalmanFilter(vx,vy,vz,vroll,vpitch,vyaw);
 				}
 			}
-			else if(particleFilters_.size())
+			else if(particleFilter_)
 			{
 				// Particle filtering
-				UASSERT(particleFilters_.size()==6);
+				double values[6] = {vx, vy, vz, vroll, vpitch, vyaw};
 				if(previousVelocityTransform_.isNull())
 				{
-					particleFilters_[0]->init(vx);
-					particleFilters_[1]->init(vy);
-					particleFilters_[2]->init(vz);
-					particleFilters_[3]->init(vroll);
-					particleFilters_[4]->init(vpitch);
-					particleFilters_[5]->init(vyaw);
+					particleFilter_->init(values);
 				}
 				else
 				{
-					vx = particleFilters_[0]->filter(vx);
-					vy = particleFilters_[1]->filter(vy);
-					vyaw = particleFilters_[5]->filter(vyaw);
+					// z, roll and pitch are not filtered in 3DoF
+					const bool enabled[6] = {true, true, !_force3DoF, !_force3DoF, !_force3DoF, true};
+					particleFilter_->filter(values, enabled);
+					vx = values[0];
+					vy = values[1];
+					vz = values[2];
+					vroll = values[3];
+					vpitch = values[4];
+					vyaw = values[5];
 
 					if(!_holonomic)
 					{
@@ -478,13 +467,6 @@ Transform Odometry::process(SensorData & data, const Transform & guessIn, Odomet
 							vyaw = (atan(vx/vy)*2.0f-CV_PI)*-1;
 						}
 					}
-
-					if(!_force3DoF)
-					{
-						vz = particleFilters_[2]->filter(vz);
-						vroll = particleFilters_[3]->filter(vroll);
-						vpitch = particleFilters_[4]->filter(vpitch);
-					}
 				}
 
 				if(info)
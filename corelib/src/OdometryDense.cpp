@@ -0,0 +1,677 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rtabmap/core/OdometryDense.h"
+#include "rtabmap/core/OdometryInfo.h"
+#include "rtabmap/utilite/ULogger.h"
+#include "rtabmap/utilite/UTimer.h"
+#include "rtabmap/utilite/UMath.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <Eigen/Cholesky>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace rtabmap {
+
+/**
+ * One level of the image pyramid of a frame. Images are used when the
+ * frame is tracked, the points (structure of arrays, camera frame) are
+ * used when the frame is the key-frame.
+ */
+struct DenseLevel
+{
+	DenseLevel() : fx(0), fy(0), cx(0), cy(0) {}
+	float fx, fy, cx, cy;
+	cv::Mat intensity;  // CV_32FC1
+	cv::Mat gradX;      // CV_32FC1
+	cv::Mat gradY;      // CV_32FC1
+	cv::Mat depth;      // CV_32FC1, NaN when invalid
+	cv::Mat depthGradX; // CV_32FC1, NaN when invalid
+	cv::Mat depthGradY; // CV_32FC1, NaN when invalid
+
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> i;
+};
+
+class DenseFrame
+{
+public:
+	DenseFrame(const cv::Mat & intensity, const cv::Mat & depth, const CameraModel & model, int levels)
+	{
+		UASSERT(intensity.type() == CV_32FC1 && depth.type() == CV_32FC1 && intensity.size() == depth.size());
+		UASSERT(levels >= 1);
+		levels_.resize(levels);
+		levels_[0].fx = model.fx();
+		levels_[0].fy = model.fy();
+		levels_[0].cx = model.cx();
+		levels_[0].cy = model.cy();
+		levels_[0].intensity = intensity;
+		levels_[0].depth = depth;
+		for(int l=1; l<levels; ++l)
+		{
+			const DenseLevel & previous = levels_[l-1];
+			DenseLevel & level = levels_[l];
+			level.fx = previous.fx*0.5f;
+			level.fy = previous.fy*0.5f;
+			level.cx = (previous.cx+0.5f)*0.5f-0.5f;
+			level.cy = (previous.cy+0.5f)*0.5f-0.5f;
+			downsample(previous.intensity, previous.depth, level.intensity, level.depth);
+		}
+		for(int l=0; l<levels; ++l)
+		{
+			gradients(levels_[l].intensity, levels_[l].gradX, levels_[l].gradY);
+			gradients(levels_[l].depth, levels_[l].depthGradX, levels_[l].depthGradY);
+		}
+	}
+
+	int levels() const {return (int)levels_.size();}
+	const DenseLevel & level(int l) const {return levels_[l];}
+
+	// Back-project the pixels with valid depth, to use this frame as key-frame.
+	void extractPoints(float maxDepth)
+	{
+		for(unsigned int l=0; l<levels_.size(); ++l)
+		{
+			DenseLevel & level = levels_[l];
+			level.x.clear();
+			level.y.clear();
+			level.z.clear();
+			level.i.clear();
+			const int n = level.depth.rows*level.depth.cols;
+			level.x.reserve(n);
+			level.y.reserve(n);
+			level.z.reserve(n);
+			level.i.reserve(n);
+			for(int v=0; v<level.depth.rows; ++v)
+			{
+				const float * d = level.depth.ptr<float>(v);
+				const float * in = level.intensity.ptr<float>(v);
+				for(int u=0; u<level.depth.cols; ++u)
+				{
+					if(uIsFinite(d[u]) && d[u] > 0.0f && (maxDepth <= 0.0f || d[u] <= maxDepth))
+					{
+						level.x.push_back((float(u)-level.cx)*d[u]/level.fx);
+						level.y.push_back((float(v)-level.cy)*d[u]/level.fy);
+						level.z.push_back(d[u]);
+						level.i.push_back(in[u]);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	// 2x2 average, invalid depth values are ignored
+	static void downsample(const cv::Mat & intensity, const cv::Mat & depth, cv::Mat & intensityOut, cv::Mat & depthOut)
+	{
+		intensityOut = cv::Mat(intensity.rows/2, intensity.cols/2, CV_32FC1);
+		depthOut = cv::Mat(depth.rows/2, depth.cols/2, CV_32FC1);
+#ifdef _OPENMP
+		#pragma omp parallel for
+#endif
+		for(int v=0; v<intensityOut.rows; ++v)
+		{
+			const float * i0 = intensity.ptr<float>(v*2);
+			const float * i1 = intensity.ptr<float>(v*2+1);
+			const float * d0 = depth.ptr<float>(v*2);
+			const float * d1 = depth.ptr<float>(v*2+1);
+			float * io = intensityOut.ptr<float>(v);
+			float * dout = depthOut.ptr<float>(v);
+			for(int u=0; u<intensityOut.cols; ++u)
+			{
+				io[u] = 0.25f*(i0[u*2] + i0[u*2+1] + i1[u*2] + i1[u*2+1]);
+				float sum = 0.0f;
+				int count = 0;
+				const float values[4] = {d0[u*2], d0[u*2+1], d1[u*2], d1[u*2+1]};
+				for(int k=0; k<4; ++k)
+				{
+					if(uIsFinite(values[k]) && values[k] > 0.0f)
+					{
+						sum += values[k];
+						++count;
+					}
+				}
+				dout[u] = count?sum/float(count):std::numeric_limits<float>::quiet_NaN();
+			}
+		}
+	}
+
+	// central differences, NaN values are propagated
+	static void gradients(const cv::Mat & image, cv::Mat & gradX, cv::Mat & gradY)
+	{
+		gradX = cv::Mat::zeros(image.size(), CV_32FC1);
+		gradY = cv::Mat::zeros(image.size(), CV_32FC1);
+#ifdef _OPENMP
+		#pragma omp parallel for
+#endif
+		for(int v=1; v<image.rows-1; ++v)
+		{
+			const float * previous = image.ptr<float>(v-1);
+			const float * row = image.ptr<float>(v);
+			const float * next = image.ptr<float>(v+1);
+			float * gx = gradX.ptr<float>(v);
+			float * gy = gradY.ptr<float>(v);
+			for(int u=1; u<image.cols-1; ++u)
+			{
+				gx[u] = 0.5f*(row[u+1] - row[u-1]);
+				gy[u] = 0.5f*(next[u] - previous[u]);
+			}
+		}
+	}
+
+private:
+	std::vector<DenseLevel> levels_;
+};
+
+// residuals and Jacobians of one level (structure of arrays)
+struct DenseResiduals
+{
+	void resize(int n)
+	{
+		validI.resize(n);
+		validZ.resize(n);
+		rI.resize(n);
+		rZ.resize(n);
+		for(int k=0; k<6; ++k)
+		{
+			JI[k].resize(n);
+			JZ[k].resize(n);
+		}
+	}
+	std::vector<unsigned char> validI;
+	std::vector<unsigned char> validZ;
+	std::vector<float> rI;
+	std::vector<float> rZ;
+	std::vector<float> JI[6];
+	std::vector<float> JZ[6];
+};
+
+static inline float bilinear(const cv::Mat & image, int u0, int v0, float a, float b)
+{
+	const float * r0 = image.ptr<float>(v0) + u0;
+	const float * r1 = image.ptr<float>(v0+1) + u0;
+	return (1.0f-b)*((1.0f-a)*r0[0] + a*r0[1]) + b*((1.0f-a)*r1[0] + a*r1[1]);
+}
+
+// Warp the key-frame points in the current frame with T (key-frame -> current camera).
+static void computeResiduals(
+		const DenseLevel & reference,
+		const DenseLevel & current,
+		const Eigen::Affine3f & T,
+		bool useDepth,
+		DenseResiduals & res)
+{
+	const int n = (int)reference.x.size();
+	res.resize(n);
+	const Eigen::Matrix3f R = T.linear();
+	const Eigen::Vector3f t = T.translation();
+	const float fx = current.fx, fy = current.fy, cx = current.cx, cy = current.cy;
+	const float maxU = float(current.intensity.cols-1);
+	const float maxV = float(current.intensity.rows-1);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for(int k=0; k<n; ++k)
+	{
+		res.validI[k] = 0;
+		res.validZ[k] = 0;
+
+		const float X = R(0,0)*reference.x[k] + R(0,1)*reference.y[k] + R(0,2)*reference.z[k] + t[0];
+		const float Y = R(1,0)*reference.x[k] + R(1,1)*reference.y[k] + R(1,2)*reference.z[k] + t[1];
+		const float Z = R(2,0)*reference.x[k] + R(2,1)*reference.y[k] + R(2,2)*reference.z[k] + t[2];
+		if(Z <= 0.0f)
+		{
+			continue;
+		}
+		const float iz = 1.0f/Z;
+		const float u = fx*X*iz + cx;
+		const float v = fy*Y*iz + cy;
+		if(!(u >= 0.0f && v >= 0.0f && u < maxU && v < maxV))
+		{
+			continue;
+		}
+		const int u0 = (int)u;
+		const int v0 = (int)v;
+		const float a = u - float(u0);
+		const float b = v - float(v0);
+
+		// derivatives of the projection (u,v) according to the motion (tx,ty,tz,rx,ry,rz)
+		const float xz = X*iz;
+		const float yz = Y*iz;
+		const float Ju[6] = {fx*iz, 0.0f, -fx*xz*iz, -fx*xz*yz, fx*(1.0f+xz*xz), -fx*yz};
+		const float Jv[6] = {0.0f, fy*iz, -fy*yz*iz, -fy*(1.0f+yz*yz), fy*xz*yz, fy*xz};
+
+		const float gx = bilinear(current.gradX, u0, v0, a, b);
+		const float gy = bilinear(current.gradY, u0, v0, a, b);
+		res.rI[k] = bilinear(current.intensity, u0, v0, a, b) - reference.i[k];
+		for(int j=0; j<6; ++j)
+		{
+			res.JI[j][k] = gx*Ju[j] + gy*Jv[j];
+		}
+		res.validI[k] = 1;
+
+		if(useDepth)
+		{
+			const float d = bilinear(current.depth, u0, v0, a, b);
+			const float dx = bilinear(current.depthGradX, u0, v0, a, b);
+			const float dy = bilinear(current.depthGradY, u0, v0, a, b);
+			if(uIsFinite(d) && uIsFinite(dx) && uIsFinite(dy))
+			{
+				// derivative of the transformed point depth
+				const float Jz[6] = {0.0f, 0.0f, 1.0f, Y, -X, 0.0f};
+				res.rZ[k] = d - Z;
+				for(int j=0; j<6; ++j)
+				{
+					res.JZ[j][k] = dx*Ju[j] + dy*Jv[j] - Jz[j];
+				}
+				res.validZ[k] = 1;
+			}
+		}
+	}
+}
+
+// Scale of the t-distribution (5 degrees of freedom) fitting the residuals
+static float tDistributionScale(const std::vector<float> & residuals, const std::vector<unsigned char> & valid)
+{
+	static const float nu = 5.0f;
+	double sum = 0.0;
+	int count = 0;
+	for(unsigned int k=0; k<residuals.size(); ++k)
+	{
+		if(valid[k])
+		{
+			sum += residuals[k]*residuals[k];
+			++count;
+		}
+	}
+	if(count == 0 || sum == 0.0)
+	{
+		return 0.0f;
+	}
+	float variance = float(sum/double(count));
+	for(int iteration=0; iteration<5; ++iteration)
+	{
+		sum = 0.0;
+		for(unsigned int k=0; k<residuals.size(); ++k)
+		{
+			if(valid[k])
+			{
+				const float r2 = residuals[k]*residuals[k];
+				sum += r2*(nu+1.0f)/(nu + r2/variance);
+			}
+		}
+		float newVariance = float(sum/double(count));
+		bool converged = fabs(newVariance-variance) < 1e-3f*variance;
+		variance = newVariance;
+		if(converged || variance <= 0.0f)
+		{
+			break;
+		}
+	}
+	return variance;
+}
+
+// Accumulate the weighted normal equations: 21 elements of H (upper), 6 of b, error and count.
+static void accumulate(
+		const std::vector<unsigned char> & valid,
+		const std::vector<float> & residuals,
+		const std::vector<float> * J,
+		float variance,
+		float scale,
+		Eigen::Matrix<double, 6, 6> & H,
+		Eigen::Matrix<double, 6, 1> & g,
+		double & error,
+		int & count)
+{
+	if(variance <= 0.0f)
+	{
+		return;
+	}
+	static const float nu = 5.0f;
+	static const int kBlocks = 64; // fixed number of blocks: the sum doesn't depend on the number of threads
+	static const int kSize = 21+6+2;
+	const int n = (int)residuals.size();
+	std::vector<double> partial(kBlocks*kSize, 0.0);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for(int block=0; block<kBlocks; ++block)
+	{
+		double * sums = &partial[block*kSize];
+		const int end = int((long long)n*(block+1)/kBlocks);
+		for(int k=int((long long)n*block/kBlocks); k<end; ++k)
+		{
+			if(valid[k])
+			{
+				const float r = residuals[k];
+				const float r2 = r*r;
+				const float w = scale*(nu+1.0f)/(nu + r2/variance)/variance;
+				const float Jk[6] = {J[0][k], J[1][k], J[2][k], J[3][k], J[4][k], J[5][k]};
+				int index = 0;
+				for(int i=0; i<6; ++i)
+				{
+					const float wJi = w*Jk[i];
+					for(int j=i; j<6; ++j)
+					{
+						sums[index++] += wJi*Jk[j];
+					}
+					sums[21+i] += wJi*r;
+				}
+				sums[27] += w*r2;
+				sums[28] += 1.0;
+			}
+		}
+	}
+	for(int block=0; block<kBlocks; ++block)
+	{
+		const double * sums = &partial[block*kSize];
+		int index = 0;
+		for(int i=0; i<6; ++i)
+		{
+			for(int j=i; j<6; ++j)
+			{
+				H(i,j) += sums[index++];
+			}
+			g[i] += sums[21+i];
+		}
+		error += sums[27];
+		count += (int)sums[28];
+	}
+}
+
+OdometryDense::OdometryDense(const ParametersMap & parameters) :
+	Odometry(parameters),
+	pyramidLevels_(Parameters::defaultOdomDensePyramidLevels()),
+	minLevel_(Parameters::defaultOdomDenseMinLevel()),
+	maxIterations_(Parameters::defaultOdomDenseMaxIterations()),
+	depthWeight_(Parameters::defaultOdomDenseDepthWeight()),
+	maxDepth_(Parameters::defaultOdomDenseMaxDepth()),
+	keyFrameThr_(Parameters::defaultOdomKeyFrameThr()),
+	reference_(0),
+	lost_(false),
+	motionFromKeyFrame_(Transform::getIdentity())
+{
+	Parameters::parse(parameters, Parameters::kOdomDensePyramidLevels(), pyramidLevels_);
+	Parameters::parse(parameters, Parameters::kOdomDenseMinLevel(), minLevel_);
+	Parameters::parse(parameters, Parameters::kOdomDenseMaxIterations(), maxIterations_);
+	Parameters::parse(parameters, Parameters::kOdomDenseDepthWeight(), depthWeight_);
+	Parameters::parse(parameters, Parameters::kOdomDenseMaxDepth(), maxDepth_);
+	Parameters::parse(parameters, Parameters::kOdomKeyFrameThr(), keyFrameThr_);
+	UASSERT(pyramidLevels_ >= 1);
+	UASSERT(minLevel_ >= 0 && minLevel_ < pyramidLevels_);
+	UASSERT(maxIterations_ > 0);
+	UASSERT(depthWeight_ >= 0.0f);
+	UASSERT(keyFrameThr_ >= 0.0f && keyFrameThr_<=1.0f);
+}
+
+OdometryDense::~OdometryDense()
+{
+	delete reference_;
+}
+
+void OdometryDense::reset(const Transform & initialPose)
+{
+	Odometry::reset(initialPose);
+	delete reference_;
+	reference_ = 0;
+	lost_ = false;
+	motionFromKeyFrame_.setIdentity();
+}
+
+// return not null transform if odometry is correctly computed
+Transform OdometryDense::computeTransform(
+		SensorData & data,
+		const Transform & guess,
+		OdometryInfo * info)
+{
+	Transform t;
+	UTimer timer;
+
+	if(data.imageRaw().empty() ||
+		data.depthRaw().empty() ||
+		(data.depthRaw().type() != CV_16UC1 && data.depthRaw().type() != CV_32FC1) ||
+		data.imageRaw().rows != data.depthRaw().rows ||
+		data.imageRaw().cols != data.depthRaw().cols)
+	{
+		UERROR("Not supported input! RGB and depth images of the same size are required.");
+		return t;
+	}
+
+	if(!(data.cameraModels().size() == 1 && data.cameraModels()[0].isValidForProjection()))
+	{
+		UERROR("Invalid camera model! Only single RGB-D camera supported by dense odometry. Try another odometry approach.");
+		return t;
+	}
+	const CameraModel & model = data.cameraModels()[0];
+
+	cv::Mat grey;
+	if(data.imageRaw().type() == CV_8UC3)
+	{
+		cv::cvtColor(data.imageRaw(), grey, CV_BGR2GRAY);
+	}
+	else
+	{
+		grey = data.imageRaw();
+	}
+	cv::Mat intensity;
+	grey.convertTo(intensity, CV_32F);
+
+	// zeros are invalid depth values
+	cv::Mat depth;
+	if(data.depthRaw().type() == CV_16UC1)
+	{
+		data.depthRaw().convertTo(depth, CV_32F, 0.001);
+	}
+	else
+	{
+		depth = data.depthRaw().clone();
+	}
+	for(int v=0; v<depth.rows; ++v)
+	{
+		float * d = depth.ptr<float>(v);
+		for(int u=0; u<depth.cols; ++u)
+		{
+			if(!(d[u] > 0.0f))
+			{
+				d[u] = std::numeric_limits<float>::quiet_NaN();
+			}
+		}
+	}
+
+	// the coarsest level should have enough pixels
+	int levels = pyramidLevels_;
+	while(levels > minLevel_+1 && ((depth.cols >> (levels-1)) < 20 || (depth.rows >> (levels-1)) < 15))
+	{
+		--levels;
+	}
+	DenseFrame * current = new DenseFrame(intensity, depth, model, levels);
+
+	cv::Mat covariance = cv::Mat::eye(6,6,CV_64FC1) * 9999.0;
+	int features = 0;
+	int inliers = 0;
+	bool keyFrameAdded = false;
+	if(reference_ == 0)
+	{
+		current->extractPoints(maxDepth_);
+		reference_ = current;
+		keyFrameAdded = true;
+		if(!lost_)
+		{
+			t.setIdentity();
+		}
+	}
+	else
+	{
+		const Transform & localTransform = model.localTransform();
+		Transform guessCamera = Transform::getIdentity();
+		if(!guess.isNull())
+		{
+			guessCamera = localTransform.inverse() * guess * localTransform;
+		}
+		// key-frame -> current camera
+		Eigen::Affine3f T = (motionFromKeyFrame_*guessCamera).inverse().toEigen3f();
+
+		const int coarsest = std::min(reference_->levels(), current->levels())-1;
+		Eigen::Matrix<double, 6, 6> H = Eigen::Matrix<double, 6, 6>::Zero();
+		bool success = false;
+		DenseResiduals residuals;
+		for(int l=coarsest; l>=minLevel_; --l)
+		{
+			const DenseLevel & ref = reference_->level(l);
+			const DenseLevel & cur = current->level(l);
+			double previousError = std::numeric_limits<double>::max();
+			Eigen::Affine3f previousT = T;
+			success = false;
+			for(int iteration=0; iteration<maxIterations_; ++iteration)
+			{
+				computeResiduals(ref, cur, T, depthWeight_>0.0f, residuals);
+
+				Eigen::Matrix<double, 6, 6> Hl = Eigen::Matrix<double, 6, 6>::Zero();
+				Eigen::Matrix<double, 6, 1> g = Eigen::Matrix<double, 6, 1>::Zero();
+				double error = 0.0;
+				int count = 0;
+				int countZ = 0;
+				accumulate(residuals.validI, residuals.rI, residuals.JI, tDistributionScale(residuals.rI, residuals.validI), 1.0f, Hl, g, error, count);
+				if(depthWeight_>0.0f)
+				{
+					accumulate(residuals.validZ, residuals.rZ, residuals.JZ, tDistributionScale(residuals.rZ, residuals.validZ), depthWeight_, Hl, g, error, countZ);
+				}
+				if(count < 6*10)
+				{
+					UDEBUG("level=%d iteration=%d: not enough valid pixels (%d)", l, iteration, count);
+					break;
+				}
+				error /= double(count+countZ);
+				if(error > previousError)
+				{
+					// diverging, keep the previous estimate
+					T = previousT;
+					break;
+				}
+				previousError = error;
+				previousT = T;
+				H = Hl.selfadjointView<Eigen::Upper>();
+				inliers = count;
+				features = (int)ref.x.size();
+				success = true;
+
+				Eigen::Matrix<double, 6, 1> xi = -H.ldlt().solve(g);
+				if(!uIsFinite(xi[0]))
+				{
+					success = false;
+					break;
+				}
+
+				Eigen::Vector3f w((float)xi[3], (float)xi[4], (float)xi[5]);
+				Eigen::Affine3f increment = Eigen::Affine3f::Identity();
+				if(w.norm() > 0.0f)
+				{
+					increment.linear() = Eigen::AngleAxisf(w.norm(), w.normalized()).toRotationMatrix();
+				}
+				increment.translation() = Eigen::Vector3f((float)xi[0], (float)xi[1], (float)xi[2]);
+				T = increment * T;
+
+				if(xi.norm() < 1e-6)
+				{
+					break;
+				}
+			}
+			UDEBUG("level=%d error=%f inliers=%d/%d", l, previousError, inliers, (int)ref.x.size());
+		}
+
+		if(success)
+		{
+			lost_ = false;
+			Transform poseFromKeyFrame = Transform::fromEigen3f(T).inverse();
+			t = motionFromKeyFrame_.inverse() * poseFromKeyFrame;
+
+			// information matrix in camera frame -> covariance in base frame
+			Eigen::Matrix<double, 6, 6> cov = H.inverse();
+			Eigen::Matrix<double, 6, 6> B = Eigen::Matrix<double, 6, 6>::Zero();
+			B.block<3,3>(0,0) = localTransform.toEigen3d().linear();
+			B.block<3,3>(3,3) = B.block<3,3>(0,0);
+			cov = B*cov*B.transpose();
+			for(int i=0; i<6; ++i)
+			{
+				for(int j=0; j<6; ++j)
+				{
+					covariance.at<double>(i,j) = cov(i,j);
+				}
+			}
+
+			if(keyFrameThr_ == 0.0f || float(inliers) <= keyFrameThr_*float(features))
+			{
+				current->extractPoints(maxDepth_);
+				delete reference_;
+				reference_ = current;
+				current = 0;
+				motionFromKeyFrame_.setIdentity();
+				keyFrameAdded = true;
+			}
+			else
+			{
+				motionFromKeyFrame_ = poseFromKeyFrame;
+			}
+		}
+		else
+		{
+			lost_ = true;
+			delete reference_;
+			reference_ = 0; // this will make restart from the next frame
+			motionFromKeyFrame_.setIdentity();
+			UWARN("Dense odometry failed to estimate motion, tracking will be reinitialized on next frame.");
+		}
+		delete current;
+
+		if(!t.isNull() && !t.isIdentity() && !localTransform.isIdentity() && !localTransform.isNull())
+		{
+			// from camera frame to base frame
+			t = localTransform * t * localTransform.inverse();
+		}
+	}
+
+	if(info)
+	{
+		info->type = (int)kTypeDense;
+		info->covariance = covariance;
+		info->features = features;
+		info->inliers = inliers;
+		info->keyFrameAdded = keyFrameAdded;
+	}
+
+	UINFO("Odom update time = %fs inliers=%d/%d key-frame=%s", timer.elapsed(), inliers, features, keyFrameAdded?"true":"false");
+
+	return t;
+}
+
+} // namespace rtabmap
@@ -44,6 +44,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/utilite/UTimer.h"
 #include "rtabmap/utilite/UMath.h"
 #include "rtabmap/utilite/UConversion.h"
+#include "rtabmap/utilite/UThread.h"
+#include "rtabmap/utilite/UMutex.h"
+#include "rtabmap/utilite/USemaphore.h"
 #include <opencv2/calib3d/calib3d.hpp>
 #include <rtabmap/core/OdometryF2M.h>
 #include <pcl/common/io.h>
@@ -56,6 +59,349 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace rtabmap {
 
+/**
+ * Local bundle adjustment done asynchronously: the tracking thread posts
+ * a job each time a key-frame is added, only the latest one is kept if the
+ * optimizer is busy. Results are versioned so that the tracking thread can
+ * ignore the ones computed before a reset.
+ */
+class LocalBundleThread : public UThread
+{
+public:
+	struct Job
+	{
+		Job() : version(0), rootId(0), time(0.0f), outliers(0) {}
+		int version;
+		int rootId;
+		std::map<int, Transform> poses;
+		std::multimap<int, Link> links;
+		std::map<int, CameraModel> models;
+		std::map<int, cv::Point3f> points3D;
+		std::map<int, std::map<int, cv::Point3f> > wordReferences;
+		// results
+		float time;
+		int outliers;
+	};
+
+public:
+	LocalBundleThread(Optimizer * sba) :
+		sba_(sba),
+		hasJob_(false),
+		hasResult_(false)
+	{
+		UASSERT(sba_ != 0);
+	}
+	virtual ~LocalBundleThread()
+	{
+		this->join(true);
+	}
+
+	void post(const Job & job)
+	{
+		jobMutex_.lock();
+		bool wasWaiting = !hasJob_;
+		job_ = job; // replace the pending job, if any
+		hasJob_ = true;
+		jobMutex_.unlock();
+		if(wasWaiting)
+		{
+			jobAdded_.release();
+		}
+	}
+
+	bool takeResult(Job & result)
+	{
+		UScopeMutex lock(resultMutex_);
+		if(hasResult_)
+		{
+			result = result_;
+			result_ = Job();
+			hasResult_ = false;
+			return true;
+		}
+		return false;
+	}
+
+private:
+	virtual void mainLoopKill()
+	{
+		jobAdded_.release();
+	}
+
+	virtual void mainLoop()
+	{
+		jobAdded_.acquire();
+		if(this->isKilled())
+		{
+			return;
+		}
+
+		Job job;
+		jobMutex_.lock();
+		if(hasJob_)
+		{
+			job = job_;
+			job_ = Job();
+			hasJob_ = false;
+		}
+		jobMutex_.unlock();
+
+		if(job.version == 0 || job.poses.size() < 2)
+		{
+			return;
+		}
+
+		UTimer timer;
+		std::set<int> outliers;
+		std::map<int, Transform> poses = sba_->optimizeBA(job.rootId, job.poses, job.links, job.models, job.points3D, job.wordReferences, &outliers);
+		job.time = timer.ticks();
+		job.outliers = (int)outliers.size();
+		UDEBUG("Local bundle adjustment (async) version=%d poses=%d words=%d outliers=%d time=%fs",
+				job.version, (int)job.poses.size(), (int)job.points3D.size(), job.outliers, job.time);
+		if(poses.size() != job.poses.size())
+		{
+			UWARN("Local bundle adjustment failed (version %d)! Local map is not refined.", job.version);
+			return;
+		}
+		job.poses = poses;
+		for(std::set<int>::iterator iter=outliers.begin(); iter!=outliers.end(); ++iter)
+		{
+			job.points3D.erase(*iter);
+		}
+		job.wordReferences.clear();
+
+		UScopeMutex lock(resultMutex_);
+		if(!hasResult_ || result_.version < job.version)
+		{
+			result_ = job;
+			hasResult_ = true;
+		}
+	}
+
+private:
+	Optimizer * sba_;
+	UMutex jobMutex_;
+	USemaphore jobAdded_;
+	Job job_;
+	bool hasJob_;
+	UMutex resultMutex_;
+	Job result_;
+	bool hasResult_;
+};
+
+/**
+ * Spatial index of the local map words. Positions are stored as structure of
+ * arrays sorted by voxel, so that the words in the predicted camera frustum
+ * are found by testing the voxels first. Visibility statistics (times the word
+ * was in the frustum and times it was an inlier) are kept for each word.
+ */
+class LocalMapIndex
+{
+public:
+	LocalMapIndex(float cellSize = 1.0f) :
+		cellSize_(cellSize)
+	{
+		UASSERT(cellSize_ > 0.0f);
+	}
+
+	void clear()
+	{
+		ids_.clear();
+		x_.clear();
+		y_.clear();
+		z_.clear();
+		visible_.clear();
+		found_.clear();
+		cells_.clear();
+		lookup_.clear();
+	}
+
+	int id(int index) const {return ids_[index];}
+
+	// Re-index the words, statistics of the words already indexed are kept.
+	void update(const std::multimap<int, cv::Point3f> & words3)
+	{
+		std::vector<std::pair<int, int> > oldLookup;
+		std::vector<int> oldVisible;
+		std::vector<int> oldFound;
+		oldLookup.swap(lookup_);
+		oldVisible.swap(visible_);
+		oldFound.swap(found_);
+
+		std::vector<int> tmpIds;
+		std::vector<cv::Point3f> tmpPoints;
+		std::vector<std::pair<unsigned long long, int> > order; // <voxel, index>
+		tmpIds.reserve(words3.size());
+		tmpPoints.reserve(words3.size());
+		order.reserve(words3.size());
+		for(std::multimap<int, cv::Point3f>::const_iterator iter=words3.begin(); iter!=words3.end(); ++iter)
+		{
+			if(util3d::isFinite(iter->second))
+			{
+				order.push_back(std::make_pair(key(iter->second), (int)tmpIds.size()));
+				tmpIds.push_back(iter->first);
+				tmpPoints.push_back(iter->second);
+			}
+		}
+		std::sort(order.begin(), order.end());
+
+		const int n = (int)order.size();
+		ids_.resize(n);
+		x_.resize(n);
+		y_.resize(n);
+		z_.resize(n);
+		visible_.resize(n);
+		found_.resize(n);
+		lookup_.resize(n);
+		cells_.clear();
+		for(int i=0; i<n; ++i)
+		{
+			const int id = tmpIds[order[i].second];
+			const cv::Point3f & pt = tmpPoints[order[i].second];
+			if(i == 0 || order[i].first != order[i-1].first)
+			{
+				Cell cell;
+				cell.x = (std::floor(pt.x/cellSize_)+0.5f)*cellSize_;
+				cell.y = (std::floor(pt.y/cellSize_)+0.5f)*cellSize_;
+				cell.z = (std::floor(pt.z/cellSize_)+0.5f)*cellSize_;
+				cell.start = i;
+				cells_.push_back(cell);
+			}
+			cells_.back().end = i+1;
+
+			ids_[i] = id;
+			x_[i] = pt.x;
+			y_[i] = pt.y;
+			z_[i] = pt.z;
+			std::vector<std::pair<int, int> >::iterator iterOld = std::lower_bound(oldLookup.begin(), oldLookup.end(), std::make_pair(id, 0));
+			if(iterOld != oldLookup.end() && iterOld->first == id)
+			{
+				visible_[i] = oldVisible[iterOld->second];
+				found_[i] = oldFound[iterOld->second];
+			}
+			else
+			{
+				visible_[i] = 0;
+				found_[i] = 0;
+			}
+			lookup_[i] = std::make_pair(id, i);
+		}
+		std::sort(lookup_.begin(), lookup_.end());
+	}
+
+	// Indices of the words projected in the image of the camera (pose in optical frame).
+	void cull(const Transform & cameraPose, float fx, float fy, float cx, float cy, int width, int height, std::vector<int> & indices) const
+	{
+		indices.clear();
+		Transform t = cameraPose.inverse();
+		const float r11 = t.r11(), r12 = t.r12(), r13 = t.r13(), tx = t.x();
+		const float r21 = t.r21(), r22 = t.r22(), r23 = t.r23(), ty = t.y();
+		const float r31 = t.r31(), r32 = t.r32(), r33 = t.r33(), tz = t.z();
+		const float maxU = float(width-1);
+		const float maxV = float(height-1);
+
+		// side planes of the frustum, all passing through the camera center
+		const float radius = cellSize_*0.8660254f; // half of the voxel diagonal
+		const float nLeft = std::sqrt(fx*fx + cx*cx);
+		const float nRight = std::sqrt(fx*fx + (maxU-cx)*(maxU-cx));
+		const float nTop = std::sqrt(fy*fy + cy*cy);
+		const float nBottom = std::sqrt(fy*fy + (maxV-cy)*(maxV-cy));
+
+		for(unsigned int c=0; c<cells_.size(); ++c)
+		{
+			const Cell & cell = cells_[c];
+			const float X = r11*cell.x + r12*cell.y + r13*cell.z + tx;
+			const float Y = r21*cell.x + r22*cell.y + r23*cell.z + ty;
+			const float Z = r31*cell.x + r32*cell.y + r33*cell.z + tz;
+			if(Z < -radius ||
+			   fx*X + cx*Z < -radius*nLeft ||
+			   (maxU-cx)*Z - fx*X < -radius*nRight ||
+			   fy*Y + cy*Z < -radius*nTop ||
+			   (maxV-cy)*Z - fy*Y < -radius*nBottom)
+			{
+				continue;
+			}
+
+			for(int i=cell.start; i<cell.end; ++i)
+			{
+				const float px = r11*x_[i] + r12*y_[i] + r13*z_[i] + tx;
+				const float py = r21*x_[i] + r22*y_[i] + r23*z_[i] + ty;
+				const float pz = r31*x_[i] + r32*y_[i] + r33*z_[i] + tz;
+				if(pz > 0.0f)
+				{
+					const float u = fx*px/pz + cx;
+					const float v = fy*py/pz + cy;
+					if(u >= 0.0f && u <= maxU && v >= 0.0f && v <= maxV)
+					{
+						indices.push_back(i);
+					}
+				}
+			}
+		}
+	}
+
+	void updateVisibility(const std::vector<int> & visibleIndices, const std::vector<int> & inliersIDs)
+	{
+		for(unsigned int i=0; i<visibleIndices.size(); ++i)
+		{
+			++visible_[visibleIndices[i]];
+		}
+		for(unsigned int i=0; i<inliersIDs.size(); ++i)
+		{
+			std::vector<std::pair<int, int> >::iterator iter = std::lower_bound(lookup_.begin(), lookup_.end(), std::make_pair(inliersIDs[i], 0));
+			if(iter != lookup_.end() && iter->first == inliersIDs[i])
+			{
+				++found_[iter->second];
+			}
+		}
+	}
+
+	// Word IDs sorted from the least to the most useful (inlier/visible ratio, then oldest first).
+	void removalOrder(std::vector<int> & ids) const
+	{
+		std::vector<std::pair<float, int> > scores(ids_.size());
+		for(unsigned int i=0; i<ids_.size(); ++i)
+		{
+			// new words that were never visible get 0.5
+			scores[i] = std::make_pair(float(found_[i]+1)/float(visible_[i]+2), ids_[i]);
+		}
+		std::sort(scores.begin(), scores.end());
+		ids.resize(scores.size());
+		for(unsigned int i=0; i<scores.size(); ++i)
+		{
+			ids[i] = scores[i].second;
+		}
+	}
+
+private:
+	unsigned long long key(const cv::Point3f & pt) const
+	{
+		const unsigned long long mask = 0x1FFFFF; // 21 bits per axis
+		const long long ix = (long long)std::floor(pt.x/cellSize_);
+		const long long iy = (long long)std::floor(pt.y/cellSize_);
+		const long long iz = (long long)std::floor(pt.z/cellSize_);
+		return (((unsigned long long)ix & mask) << 42) | (((unsigned long long)iy & mask) << 21) | ((unsigned long long)iz & mask);
+	}
+
+private:
+	struct Cell
+	{
+		float x, y, z; // center
+		int start;
+		int end;
+	};
+
+	float cellSize_;
+	std::vector<int> ids_;
+	std::vector<float> x_;
+	std::vector<float> y_;
+	std::vector<float> z_;
+	std::vector<int> visible_;
+	std::vector<int> found_;
+	std::vector<Cell> cells_;
+	std::vector<std::pair<int, int> > lookup_; // <id, index> sorted by id
+};
+
 OdometryF2M::OdometryF2M(const ParametersMap & parameters) :
 	Odometry(parameters),
 	maximumMapSize_(Parameters::defaultOdomF2MMaxSize()),
@@ -65,12 +411,18 @@ OdometryF2M::OdometryF2M(const ParametersMap & parameters) :
 	scanKeyFrameThr_(Parameters::defaultOdomScanKeyFrameThr()),
 	scanMaximumMapSize_(Parameters::defaultOdomF2MScanMaxSize()),
 	scanSubtractRadius_(Parameters::defaultOdomF2MScanSubtractRadius()),
+	frustumCulling_(Parameters::defaultOdomF2MFrustumCulling()),
 	bundleAdjustment_(Parameters::defaultOdomF2MBundleAdjustment()),
 	bundleMaxFrames_(Parameters::defaultOdomF2MBundleAdjustmentMaxFrames()),
+	bundleAsync_(Parameters::defaultOdomF2MBundleAdjustmentAsync()),
 	map_(new Signature(-1)),
 	lastFrame_(new Signature(1)),
+	mapIndex_(0),
 	bundleSeq_(0),
-	sba_(0)
+	sba_(0),
+	bundleThread_(0),
+	bundleVersion_(0),
+	bundleResetVersion_(0)
 {
 	UDEBUG("");
 	Parameters::parse(parameters, Parameters::kOdomF2MMaxSize(), maximumMapSize_);
@@ -80,8 +432,10 @@ OdometryF2M::OdometryF2M(const ParametersMap & parameters) :
 	Parameters::parse(parameters, Parameters::kOdomScanKeyFrameThr(), scanKeyFrameThr_);
 	Parameters::parse(parameters, Parameters::kOdomF2MScanMaxSize(), scanMaximumMapSize_);
 	Parameters::parse(parameters, Parameters::kOdomF2MScanSubtractRadius(), scanSubtractRadius_);
+	Parameters::parse(parameters, Parameters::kOdomF2MFrustumCulling(), frustumCulling_);
 	Parameters::parse(parameters, Parameters::kOdomF2MBundleAdjustment(), bundleAdjustment_);
 	Parameters::parse(parameters, Parameters::kOdomF2MBundleAdjustmentMaxFrames(), bundleMaxFrames_);
+	Parameters::parse(parameters, Parameters::kOdomF2MBundleAdjustmentAsync(), bundleAsync_);
 	UASSERT(bundleMaxFrames_ >= 0);
 	ParametersMap bundleParameters = parameters;
 	if(bundleAdjustment_ > 0)
@@ -92,6 +446,11 @@ OdometryF2M::OdometryF2M(const ParametersMap & parameters) :
 			// disable bundle in RegistrationVis as we do it already here
 			uInsert(bundleParameters, ParametersPair(Parameters::kVisBundleAdjustment(), "0"));
 			sba_ = Optimizer::create(bundleAdjustment_==2?Optimizer::kTypeCVSBA:Optimizer::kTypeG2O, bundleParameters);
+			if(bundleAsync_)
+			{
+				bundleThread_ = new LocalBundleThread(sba_);
+				bundleThread_->start();
+			}
 		}
 		else
 		{
@@ -107,18 +466,40 @@ OdometryF2M::OdometryF2M(const ParametersMap & parameters) :
 	UASSERT(maxNewFeatures_ >= 0);
 
 	regPipeline_ = Registration::create(bundleParameters);
+
+	if(frustumCulling_)
+	{
+		int corType = Parameters::defaultVisCorType();
+		int guessWinSize = Parameters::defaultVisCorGuessWinSize();
+		Parameters::parse(parameters, Parameters::kVisCorType(), corType);
+		Parameters::parse(parameters, Parameters::kVisCorGuessWinSize(), guessWinSize);
+		if(regPipeline_->isImageRequired() && !regPipeline_->isScanRequired() && corType == 0 && guessWinSize > 0)
+		{
+			mapIndex_ = new LocalMapIndex();
+		}
+		else
+		{
+			UWARN("%s is only used with visual registration (%s=0 and %s>0), it is disabled.",
+					Parameters::kOdomF2MFrustumCulling().c_str(),
+					Parameters::kVisCorType().c_str(),
+					Parameters::kVisCorGuessWinSize().c_str());
+			frustumCulling_ = false;
+		}
+	}
 }
 
 OdometryF2M::~OdometryF2M()
 {
 	delete map_;
 	delete lastFrame_;
+	delete mapIndex_;
 	scansBuffer_.clear();
 	bundleWordReferences_.clear();
 	bundlePoses_.clear();
 	bundleLinks_.clear();
 	bundleModels_.clear();
 	bundlePoseReferences_.clear();
+	delete bundleThread_; // joined before deleting the optimizer it uses
 	if(sba_)
 	{
 		delete sba_;
@@ -133,6 +514,10 @@ void OdometryF2M::reset(const Transform & initialPose)
 	Odometry::reset(initialPose);
 	*lastFrame_ = Signature(1);
 	*map_ = Signature(-1);
+	if(mapIndex_)
+	{
+		mapIndex_->clear();
+	}
 	scansBuffer_.clear();
 	bundleWordReferences_.clear();
 	bundlePoses_.clear();
@@ -140,6 +525,8 @@ void OdometryF2M::reset(const Transform & initialPose)
 	bundleModels_.clear();
 	bundlePoseReferences_.clear();
 	bundleSeq_ = 0;
+	// results of jobs posted before the reset are ignored
+	bundleResetVersion_ = bundleVersion_;
 }
 
 // return not null transform if odometry is correctly computed
@@ -176,13 +563,69 @@ Transform OdometryF2M::computeTransform(
 	int totalBundleOutliers = 0;
 	float bundleTime = 0.0f;
 
+	if(bundleThread_)
+	{
+		LocalBundleThread::Job result;
+		if(bundleThread_->takeResult(result) && result.version > bundleResetVersion_)
+		{
+			// feed back refined 3D words that are still in the local map
+			std::multimap<int, cv::Point3f> mapPoints = map_->getWords3();
+			int updated = 0;
+			for(std::map<int, cv::Point3f>::iterator iter=result.points3D.begin(); iter!=result.points3D.end(); ++iter)
+			{
+				std::multimap<int, cv::Point3f>::iterator iterPt = mapPoints.find(iter->first);
+				if(iterPt != mapPoints.end() && util3d::isFinite(iter->second))
+				{
+					iterPt->second = iter->second;
+					++updated;
+				}
+			}
+			if(updated)
+			{
+				map_->setWords3(mapPoints);
+				if(mapIndex_)
+				{
+					mapIndex_->update(map_->getWords3());
+				}
+			}
+
+			// refined key-frames
+			for(std::map<int, Transform>::iterator iter=result.poses.begin(); iter!=result.poses.end(); ++iter)
+			{
+				std::map<int, Transform>::iterator iterPose = bundlePoses_.find(iter->first);
+				if(iterPose != bundlePoses_.end() && !iter->second.isNull())
+				{
+					iterPose->second = iter->second;
+				}
+			}
+			for(std::multimap<int, Link>::iterator iter=bundleLinks_.begin(); iter!=bundleLinks_.end(); ++iter)
+			{
+				if(result.poses.find(iter->second.from()) != result.poses.end() &&
+				   result.poses.find(iter->second.to()) != result.poses.end())
+				{
+					iter->second.setTransform(bundlePoses_.at(iter->second.from()).inverse()*bundlePoses_.at(iter->second.to()));
+				}
+			}
+			bundleTime = result.time;
+			totalBundleOutliers = result.outliers;
+			UDEBUG("Local bundle adjustment result %d applied (words updated=%d)", result.version, updated);
+		}
+	}
+
 	// Generate keypoints from the new data
 	if(lastFrame_->sensorData().isValid())
 	{
 		if((map_->getWords3().size() || !map_->sensorData().laserScanRaw().empty()) &&
 			lastFrame_->sensorData().isValid())
 		{
-			Signature tmpMap = *map_;
+			// with frustum culling, only words of the local map visible from the predicted pose are matched
+			Signature tmpMap;
+			std::vector<int> visibleIndices;
+			bool culled = mapIndex_ && !guess.isNull() && cullLocalMap(this->getPose()*guess, tmpMap, visibleIndices);
+			if(!culled)
+			{
+				tmpMap = *map_;
+			}
 			Transform transform = regPipeline_->computeTransformationMod(
 					tmpMap,
 					*lastFrame_,
@@ -192,6 +635,7 @@ Transform OdometryF2M::computeTransform(
 			if(transform.isNull() && !guess.isNull() && regPipeline_->isImageRequired())
 			{
 				tmpMap = *map_;
+				culled = false;
 				// reset matches, but keep already extracted features in lastFrame_->sensorData()
 				lastFrame_->setWords(std::multimap<int, cv::KeyPoint>());
 				lastFrame_->setWords3(std::multimap<int, cv::Point3f>());
@@ -220,6 +664,11 @@ Transform OdometryF2M::computeTransform(
 			std::map<int, StereoCameraModel> bundleStereoModels;
 			if(!transform.isNull())
 			{
+				if(culled)
+				{
+					mapIndex_->updateVisibility(visibleIndices, regInfo.inliersIDs);
+				}
+
 				// local bundle adjustment
 				if(bundleAdjustment_>0 && sba_ &&
 				   regPipeline_->isImageRequired() &&
@@ -230,9 +679,10 @@ Transform OdometryF2M::computeTransform(
 
 					// make sure the IDs of words in the map are not modified (Optical Flow Registration issue)
 					UASSERT(map_->getWords().size() && tmpMap.getWords().size());
-					if(map_->getWords().size() != tmpMap.getWords().size() ||
-					   map_->getWords().begin()->first != tmpMap.getWords().begin()->first ||
-					   map_->getWords().rbegin()->first != tmpMap.getWords().rbegin()->first)
+					if(!culled && // the culled map has only a subset of the words
+					   (map_->getWords().size() != tmpMap.getWords().size() ||
+					    map_->getWords().begin()->first != tmpMap.getWords().begin()->first ||
+					    map_->getWords().rbegin()->first != tmpMap.getWords().rbegin()->first))
 					{
 						UERROR("Bundle Adjustment cannot be used with a registration approach recomputing features from the \"from\" signature (e.g., Optical Flow).");
 						bundleAdjustment_ = 0;
@@ -253,56 +703,59 @@ Transform OdometryF2M::computeTransform(
 						bundleLinks.insert(std::make_pair(bundlePoses_.rbegin()->first, Link(bundlePoses_.rbegin()->first, lastFrame_->id(), Link::kNeighbor, bundlePoses_.rbegin()->second.inverse()*transform, regInfo.covariance.inv())));
 						bundlePoses.insert(std::make_pair(lastFrame_->id(), transform));
 
-						UDEBUG("Fill matches (%d)", (int)regInfo.inliersIDs.size());
 						std::map<int, std::map<int, cv::Point3f> > wordReferences;
-						for(unsigned int i=0; i<regInfo.inliersIDs.size(); ++i)
+						if(bundleThread_ == 0)
 						{
-							int wordId =regInfo.inliersIDs[i];
+							UDEBUG("Fill matches (%d)", (int)regInfo.inliersIDs.size());
+							for(unsigned int i=0; i<regInfo.inliersIDs.size(); ++i)
+							{
+								int wordId =regInfo.inliersIDs[i];
 
-							// 3D point
-							std::multimap<int, cv::Point3f>::const_iterator iter3D = tmpMap.getWords3().find(wordId);
-							UASSERT(iter3D!=tmpMap.getWords3().end());
-							points3DMap.insert(*iter3D);
+								// 3D point
+								std::multimap<int, cv::Point3f>::const_iterator iter3D = tmpMap.getWords3().find(wordId);
+								UASSERT(iter3D!=tmpMap.getWords3().end());
+								points3DMap.insert(*iter3D);
 
-							std::multimap<int, cv::KeyPoint>::const_iterator iter2D = lastFrame_->getWords().find(wordId);
+								std::multimap<int, cv::KeyPoint>::const_iterator iter2D = lastFrame_->getWords().find(wordId);
 
-							// all other references
-							std::map<int, std::map<int, cv::Point3f> >::iterator refIter = bundleWordReferences_.find(wordId);
-							UASSERT_MSG(refIter != bundleWordReferences_.end(), uFormat("wordId=%d", wordId).c_str());
+								// all other references
+								std::map<int, std::map<int, cv::Point3f> >::iterator refIter = bundleWordReferences_.find(wordId);
+								UASSERT_MSG(refIter != bundleWordReferences_.end(), uFormat("wordId=%d", wordId).c_str());
 
-							std::map<int, cv::Point3f> references;
-							int step = bundleMaxFrames_>0?(refIter->second.size() / bundleMaxFrames_):1;
-							if(step == 0)
-							{
-								step = 1;
-							}
-							int oi=0;
-							for(std::map<int, cv::Point3f>::iterator jter=refIter->second.begin(); jter!=refIter->second.end(); ++jter)
-							{
-								if(oi++ % step == 0 && bundlePoses.find(jter->first)!=bundlePoses.end())
+								std::map<int, cv::Point3f> references;
+								int step = bundleMaxFrames_>0?(refIter->second.size() / bundleMaxFrames_):1;
+								if(step == 0)
 								{
-									references.insert(*jter);
-									++totalBundleWordReferencesUsed;
+									step = 1;
+								}
+								int oi=0;
+								for(std::map<int, cv::Point3f>::iterator jter=refIter->second.begin(); jter!=refIter->second.end(); ++jter)
+								{
+									if(oi++ % step == 0 && bundlePoses.find(jter->first)!=bundlePoses.end())
+									{
+										references.insert(*jter);
+										++totalBundleWordReferencesUsed;
+									}
+								}
+								//make sure the last reference is here
+								if(refIter->second.size() > 1)
+								{
+									references.insert(*refIter->second.rbegin());
 								}
-							}
-							//make sure the last reference is here
-							if(refIter->second.size() > 1)
-							{
-								references.insert(*refIter->second.rbegin());
-							}
 
-							if(iter2D!=lastFrame_->getWords().end())
-							{
-								UASSERT(lastFrame_->getWords3().find(wordId) != lastFrame_->getWords3().end());
-								references.insert(std::make_pair(lastFrame_->id(), cv::Point3f(iter2D->second.pt.x, iter2D->second.pt.y, lastFrame_->getWords3().find(wordId)->second.x)));
-							}
-							wordReferences.insert(std::make_pair(wordId, references));
+								if(iter2D!=lastFrame_->getWords().end())
+								{
+									UASSERT(lastFrame_->getWords3().find(wordId) != lastFrame_->getWords3().end());
+									references.insert(std::make_pair(lastFrame_->id(), cv::Point3f(iter2D->second.pt.x, iter2D->second.pt.y, lastFrame_->getWords3().find(wordId)->second.x)));
+								}
+								wordReferences.insert(std::make_pair(wordId, references));
 
-							//UDEBUG("%d (%f,%f,%f)", iter3D->first, iter3D->second.x, iter3D->second.y, iter3D->second.z);
-							//for(std::map<int, cv::Point2f>::iterator iter=inserted.first->second.begin(); iter!=inserted.first->second.end(); ++iter)
-							//{
-							//	UDEBUG("%d (%f,%f)", iter->first, iter->second.x, iter->second.y);
-							//}
+								//UDEBUG("%d (%f,%f,%f)", iter3D->first, iter3D->second.x, iter3D->second.y, iter3D->second.z);
+								//for(std::map<int, cv::Point2f>::iterator iter=inserted.first->second.begin(); iter!=inserted.first->second.end(); ++iter)
+								//{
+								//	UDEBUG("%d (%f,%f)", iter->first, iter->second.x, iter->second.y);
+								//}
+							}
 						}
 
 						CameraModel model;
@@ -327,47 +780,55 @@ Transform OdometryF2M::computeTransform(
 						}
 						bundleModels.insert(std::make_pair(lastFrame_->id(), model));
 
-						UDEBUG("sba...start");
-						// set root negative to fix all other poses
-						std::set<int> sbaOutliers;
-						UTimer bundleTimer;
-						bundlePoses = sba_->optimizeBA(-lastFrame_->id(), bundlePoses, bundleLinks, bundleModels, points3DMap, wordReferences, &sbaOutliers);
-						bundleTime = bundleTimer.ticks();
-						UDEBUG("sba...end");
-						totalBundleOutliers = (int)sbaOutliers.size();
-
-						UDEBUG("bundleTime=%fs (poses=%d wordRef=%d outliers=%d)", bundleTime, (int)bundlePoses.size(), (int)bundleWordReferences_.size(), (int)sbaOutliers.size());
-
-						UDEBUG("Local Bundle Adjustment Before: %s", transform.prettyPrint().c_str());
-						if(bundlePoses.size() == bundlePoses_.size()+1)
+						if(bundleThread_)
 						{
-							if(!bundlePoses.rbegin()->second.isNull())
+							// optimized in background when a key-frame is added, see postLocalBundleAdjustment()
+							UDEBUG("Local Bundle Adjustment done asynchronously");
+						}
+						else
+						{
+							UDEBUG("sba...start");
+							// set root negative to fix all other poses
+							std::set<int> sbaOutliers;
+							UTimer bundleTimer;
+							bundlePoses = sba_->optimizeBA(-lastFrame_->id(), bundlePoses, bundleLinks, bundleModels, points3DMap, wordReferences, &sbaOutliers);
+							bundleTime = bundleTimer.ticks();
+							UDEBUG("sba...end");
+							totalBundleOutliers = (int)sbaOutliers.size();
+
+							UDEBUG("bundleTime=%fs (poses=%d wordRef=%d outliers=%d)", bundleTime, (int)bundlePoses.size(), (int)bundleWordReferences_.size(), (int)sbaOutliers.size());
+
+							UDEBUG("Local Bundle Adjustment Before: %s", transform.prettyPrint().c_str());
+							if(bundlePoses.size() == bundlePoses_.size()+1)
 							{
-								transform = bundlePoses.rbegin()->second;
-								bundleLinks.find(bundlePoses_.rbegin()->first)->second.setTransform(bundlePoses_.rbegin()->second.inverse()*transform);
-
-								if(sbaOutliers.size())
+								if(!bundlePoses.rbegin()->second.isNull())
 								{
-									std::vector<int> newInliers(regInfo.inliersIDs.size());
-									int oi=0;
-									for(unsigned int i=0; i<regInfo.inliersIDs.size(); ++i)
+									transform = bundlePoses.rbegin()->second;
+									bundleLinks.find(bundlePoses_.rbegin()->first)->second.setTransform(bundlePoses_.rbegin()->second.inverse()*transform);
+
+									if(sbaOutliers.size())
 									{
-										if(sbaOutliers.find(regInfo.inliersIDs[i]) == sbaOutliers.end())
+										std::vector<int> newInliers(regInfo.inliersIDs.size());
+										int oi=0;
+										for(unsigned int i=0; i<regInfo.inliersIDs.size(); ++i)
 										{
-											newInliers[oi++] = regInfo.inliersIDs[i];
+											if(sbaOutliers.find(regInfo.inliersIDs[i]) == sbaOutliers.end())
+											{
+												newInliers[oi++] = regInfo.inliersIDs[i];
+											}
 										}
+										newInliers.resize(oi);
+										UDEBUG("BA outliers ratio %f", float(sbaOutliers.size())/float(regInfo.inliersIDs.size()));
+										regInfo.inliers = (int)newInliers.size();
+										regInfo.inliersIDs = newInliers;
 									}
-									newInliers.resize(oi);
-									UDEBUG("BA outliers ratio %f", float(sbaOutliers.size())/float(regInfo.inliersIDs.size()));
-									regInfo.inliers = (int)newInliers.size();
-									regInfo.inliersIDs = newInliers;
 								}
+								UDEBUG("Local Bundle Adjustment After : %s", transform.prettyPrint().c_str());
+							}
+							else
+							{
+								UWARN("Local bundle adjustment failed! transform is not refined.");
 							}
-							UDEBUG("Local Bundle Adjustment After : %s", transform.prettyPrint().c_str());
-						}
-						else
-						{
-							UWARN("Local bundle adjustment failed! transform is not refined.");
 						}
 					}
 				}
@@ -393,9 +854,9 @@ Transform OdometryF2M::computeTransform(
 
 				// fields to update
 				cv::Mat mapScan = tmpMap.sensorData().laserScanRaw();
-				std::multimap<int, cv::KeyPoint> mapWords = tmpMap.getWords();
-				std::multimap<int, cv::Point3f> mapPoints = tmpMap.getWords3();
-				std::multimap<int, cv::Mat> mapDescriptors = tmpMap.getWordsDescriptors();
+				std::multimap<int, cv::KeyPoint> mapWords;
+				std::multimap<int, cv::Point3f> mapPoints;
+				std::multimap<int, cv::Mat> mapDescriptors;
 
 				bool addVisualKeyFrame = regPipeline_->isImageRequired() &&
 						 (keyFrameThr_ == 0.0f ||
@@ -407,9 +868,15 @@ Transform OdometryF2M::computeTransform(
 				addKeyFrame = false;//bundleLinks.rbegin()->second.transform().getNorm() > 5.0f*0.075f;
 				addKeyFrame = addKeyFrame || addVisualKeyFrame || addGeometricKeyFrame;
 
-				UDEBUG("keyframeThr=%f visKeyFrameThr_=%d matches=%d inliers=%d features=%d mp=%d", keyFrameThr_, visKeyFrameThr_, regInfo.matches, regInfo.inliers, (int)lastFrame_->sensorData().keypoints().size(), (int)mapPoints.size());
+				UDEBUG("keyframeThr=%f visKeyFrameThr_=%d matches=%d inliers=%d features=%d mp=%d", keyFrameThr_, visKeyFrameThr_, regInfo.matches, regInfo.inliers, (int)lastFrame_->sensorData().keypoints().size(), (int)(culled?map_:&tmpMap)->getWords3().size());
 				if(addKeyFrame)
 				{
+					// copy the local map only when it is updated (when culled, tmpMap has only the visible words)
+					const Signature & fullMap = culled?*map_:tmpMap;
+					mapWords = fullMap.getWords();
+					mapPoints = fullMap.getWords3();
+					mapDescriptors = fullMap.getWordsDescriptors();
+
 					//Visual
 					int added = 0;
 					int removed = 0;
@@ -527,38 +994,70 @@ Transform OdometryF2M::computeTransform(
 					// remove words in map if max size is reached
 					if((int)mapPoints.size() > maximumMapSize_)
 					{
-						// remove oldest first, keep matched features with their aliases
+						// remove oldest first (or least visible with frustum culling), keep matched features with their aliases
 						std::set<int> matches(regInfo.matchesIDs.begin(), regInfo.matchesIDs.end());
-						std::multimap<int, cv::Mat>::iterator iterMapDescriptors = mapDescriptors.begin();
-						std::multimap<int, cv::KeyPoint>::iterator iterMapWords = mapWords.begin();
-						for(std::multimap<int, cv::Point3f>::iterator iter = mapPoints.begin();
-							iter!=mapPoints.end() && (int)mapPoints.size() > maximumMapSize_ && mapPoints.size() >= newIds.size();)
+						if(mapIndex_)
 						{
-							if(matches.find(iter->first) == matches.end())
+							// remove the words with the lowest inlier/visible ratio first
+							std::vector<int> removalOrder;
+							mapIndex_->removalOrder(removalOrder);
+							for(unsigned int i=0; i<removalOrder.size() && (int)mapPoints.size() > maximumMapSize_ && mapPoints.size() >= newIds.size(); ++i)
 							{
-								std::map<int, std::map<int, cv::Point3f> >::iterator iterRef = bundleWordReferences_.find(iter->first);
-								if(iterRef != bundleWordReferences_.end())
+								int wordId = removalOrder[i];
+								if(matches.find(wordId) == matches.end() && mapPoints.find(wordId) != mapPoints.end())
 								{
-									for(std::map<int, cv::Point3f>::iterator iterFrame = iterRef->second.begin(); iterFrame != iterRef->second.end(); ++iterFrame)
+									std::map<int, std::map<int, cv::Point3f> >::iterator iterRef = bundleWordReferences_.find(wordId);
+									if(iterRef != bundleWordReferences_.end())
 									{
-										if(bundlePoseReferences_.find(iterFrame->first) != bundlePoseReferences_.end())
+										for(std::map<int, cv::Point3f>::iterator iterFrame = iterRef->second.begin(); iterFrame != iterRef->second.end(); ++iterFrame)
 										{
-											bundlePoseReferences_.at(iterFrame->first) -= 1;
+											if(bundlePoseReferences_.find(iterFrame->first) != bundlePoseReferences_.end())
+											{
+												bundlePoseReferences_.at(iterFrame->first) -= 1;
+											}
 										}
+										bundleWordReferences_.erase(iterRef);
 									}
-									bundleWordReferences_.erase(iterRef);
-								}
 
-								mapPoints.erase(iter++);
-								mapDescriptors.erase(iterMapDescriptors++);
-								mapWords.erase(iterMapWords++);
-								++removed;
+									removed += (int)mapPoints.erase(wordId);
+									mapDescriptors.erase(wordId);
+									mapWords.erase(wordId);
+								}
 							}
-							else
+						}
+						else
+						{
+							std::multimap<int, cv::Mat>::iterator iterMapDescriptors = mapDescriptors.begin();
+							std::multimap<int, cv::KeyPoint>::iterator iterMapWords = mapWords.begin();
+							for(std::multimap<int, cv::Point3f>::iterator iter = mapPoints.begin();
+								iter!=mapPoints.end() && (int)mapPoints.size() > maximumMapSize_ && mapPoints.size() >= newIds.size();)
 							{
-								++iter;
-								++iterMapDescriptors;
-								++iterMapWords;
+								if(matches.find(iter->first) == matches.end())
+								{
+									std::map<int, std::map<int, cv::Point3f> >::iterator iterRef = bundleWordReferences_.find(iter->first);
+									if(iterRef != bundleWordReferences_.end())
+									{
+										for(std::map<int, cv::Point3f>::iterator iterFrame = iterRef->second.begin(); iterFrame != iterRef->second.end(); ++iterFrame)
+										{
+											if(bundlePoseReferences_.find(iterFrame->first) != bundlePoseReferences_.end())
+											{
+												bundlePoseReferences_.at(iterFrame->first) -= 1;
+											}
+										}
+										bundleWordReferences_.erase(iterRef);
+									}
+
+									mapPoints.erase(iter++);
+									mapDescriptors.erase(iterMapDescriptors++);
+									mapWords.erase(iterMapWords++);
+									++removed;
+								}
+								else
+								{
+									++iter;
+									++iterMapDescriptors;
+									++iterMapWords;
+								}
 							}
 						}
 
@@ -700,23 +1199,36 @@ Transform OdometryF2M::computeTransform(
 
 				if(modified)
 				{
-					*map_ = tmpMap;
+					if(!culled)
+					{
+						*map_ = tmpMap;
+					}
 
 					map_->sensorData().setLaserScanRaw(mapScan, LaserScanInfo(0, 0));
 					map_->setWords(mapWords);
 					map_->setWords3(mapPoints);
 				 	map_->setWordsDescriptors(mapDescriptors);
+					if(mapIndex_)
+					{
+						mapIndex_->update(map_->getWords3());
+					}
+				}
+
+				if(addKeyFrame && bundleThread_ && bundleAdjustment_>0)
+				{
+					postLocalBundleAdjustment();
 				}
 			}
 
 			if(info)
 			{
 				// use tmpMap instead of map_ to make sure that correspondences with the new frame matches
-				info->localMapSize = (int)tmpMap.getWords3().size();
+				// (when culled, tmpMap has only the visible words, words in map_ have the same IDs)
+				info->localMapSize = (int)(culled?map_:&tmpMap)->getWords3().size();
 				info->localScanMapSize = tmpMap.sensorData().laserScanRaw().cols;
 				if(this->isInfoDataFilled())
 				{
-					info->localMap = uMultimapToMap(tmpMap.getWords3());
+					info->localMap = uMultimapToMap((culled?map_:&tmpMap)->getWords3());
 					info->localScanMap = tmpMap.sensorData().laserScanRaw();
 				}
 			}
@@ -817,6 +1329,10 @@ Transform OdometryF2M::computeTransform(
 					map_->setWords(words);
 					map_->setWords3(transformedPoints);
 					map_->setWordsDescriptors(descriptors);
+					if(mapIndex_)
+					{
+						mapIndex_->update(map_->getWords3());
+					}
 					addKeyFrame = true;
 				}
 				else
@@ -905,4 +1421,133 @@ Transform OdometryF2M::computeTransform(
 	return output;
 }
 
+bool OdometryF2M::cullLocalMap(const Transform & pose, Signature & visibleMap, std::vector<int> & visibleIndices) const
+{
+	UASSERT(mapIndex_ != 0);
+	CameraModel model;
+	if(lastFrame_->sensorData().cameraModels().size() == 1 && lastFrame_->sensorData().cameraModels()[0].isValidForProjection())
+	{
+		model = lastFrame_->sensorData().cameraModels()[0];
+	}
+	else if(lastFrame_->sensorData().cameraModels().empty() && lastFrame_->sensorData().stereoCameraModel().isValidForProjection())
+	{
+		model = lastFrame_->sensorData().stereoCameraModel().left();
+	}
+	else
+	{
+		return false;
+	}
+	// same image size as RegistrationVis uses for the projection
+	cv::Size imageSize = lastFrame_->sensorData().imageRaw().size();
+	if(imageSize.width == 0 || imageSize.height == 0)
+	{
+		imageSize = model.imageSize();
+	}
+	if(imageSize.width == 0 || imageSize.height == 0)
+	{
+		return false;
+	}
+
+	mapIndex_->cull(pose*model.localTransform(), model.fx(), model.fy(), model.cx(), model.cy(), imageSize.width, imageSize.height, visibleIndices);
+
+	std::vector<int> ids(visibleIndices.size());
+	for(unsigned int i=0; i<visibleIndices.size(); ++i)
+	{
+		ids[i] = mapIndex_->id(visibleIndices[i]);
+	}
+	std::sort(ids.begin(), ids.end());
+
+	std::multimap<int, cv::KeyPoint> words;
+	std::multimap<int, cv::Point3f> words3;
+	std::multimap<int, cv::Mat> descriptors;
+	for(unsigned int i=0; i<ids.size(); ++i)
+	{
+		if(i>0 && ids[i] == ids[i-1])
+		{
+			continue;
+		}
+		std::pair<std::multimap<int, cv::KeyPoint>::const_iterator, std::multimap<int, cv::KeyPoint>::const_iterator> kpts = map_->getWords().equal_range(ids[i]);
+		std::pair<std::multimap<int, cv::Point3f>::const_iterator, std::multimap<int, cv::Point3f>::const_iterator> pts = map_->getWords3().equal_range(ids[i]);
+		std::pair<std::multimap<int, cv::Mat>::const_iterator, std::multimap<int, cv::Mat>::const_iterator> descs = map_->getWordsDescriptors().equal_range(ids[i]);
+		for(; kpts.first!=kpts.second && pts.first!=pts.second && descs.first!=descs.second; ++kpts.first, ++pts.first, ++descs.first)
+		{
+			words.insert(words.end(), *kpts.first);
+			words3.insert(words3.end(), *pts.first);
+			descriptors.insert(descriptors.end(), *descs.first);
+		}
+	}
+	UDEBUG("Frustum culling: %d/%d words visible", (int)words3.size(), (int)map_->getWords3().size());
+
+	visibleMap = Signature(map_->id());
+	visibleMap.setWords(words);
+	visibleMap.setWords3(words3);
+	visibleMap.setWordsDescriptors(descriptors);
+	return true;
+}
+
+void OdometryF2M::postLocalBundleAdjustment()
+{
+	UASSERT(bundleThread_ != 0);
+
+	LocalBundleThread::Job job;
+
+	// window of the last key-frames, the oldest one is fixed
+	std::map<int, Transform>::iterator iterFirst = bundlePoses_.begin();
+	if(bundleMaxFrames_ > 0 && (int)bundlePoses_.size() > bundleMaxFrames_)
+	{
+		std::advance(iterFirst, bundlePoses_.size() - bundleMaxFrames_);
+	}
+	job.poses.insert(iterFirst, bundlePoses_.end());
+	if(job.poses.size() < 2)
+	{
+		return;
+	}
+	job.rootId = job.poses.begin()->first;
+
+	for(std::map<int, Transform>::iterator iter=job.poses.begin(); iter!=job.poses.end(); ++iter)
+	{
+		std::map<int, CameraModel>::iterator iterModel = bundleModels_.find(iter->first);
+		UASSERT(iterModel != bundleModels_.end());
+		job.models.insert(*iterModel);
+	}
+	for(std::multimap<int, Link>::iterator iter=bundleLinks_.begin(); iter!=bundleLinks_.end(); ++iter)
+	{
+		if(job.poses.find(iter->second.from()) != job.poses.end() &&
+		   job.poses.find(iter->second.to()) != job.poses.end())
+		{
+			job.links.insert(*iter);
+		}
+	}
+
+	// words of the local map seen at least twice in the window
+	const std::multimap<int, cv::Point3f> & words3 = map_->getWords3();
+	for(std::map<int, std::map<int, cv::Point3f> >::iterator iter=bundleWordReferences_.begin(); iter!=bundleWordReferences_.end(); ++iter)
+	{
+		std::multimap<int, cv::Point3f>::const_iterator iterPt = words3.find(iter->first);
+		if(iterPt != words3.end())
+		{
+			std::map<int, cv::Point3f> references;
+			for(std::map<int, cv::Point3f>::iterator jter=iter->second.begin(); jter!=iter->second.end(); ++jter)
+			{
+				if(job.poses.find(jter->first) != job.poses.end())
+				{
+					references.insert(*jter);
+				}
+			}
+			if(references.size() >= 2)
+			{
+				job.wordReferences.insert(std::make_pair(iter->first, references));
+				job.points3D.insert(*iterPt);
+			}
+		}
+	}
+
+	if(job.wordReferences.size())
+	{
+		job.version = ++bundleVersion_;
+		UDEBUG("Post local bundle adjustment %d (poses=%d words=%d)", job.version, (int)job.poses.size(), (int)job.points3D.size());
+		bundleThread_->post(job);
+	}
+}
+
 } // namespace rtabmap
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UMath.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 #include <set>
 
 #include <rtabmap/core/OptimizerCVSBA.h>
@@ -62,6 +63,7 @@ std::map<int, Transform> OptimizerCVSBA::optimizeBA(
 		const std::map<int, std::map<int, cv::Point3f> > & wordReferences, // <ID words, IDs frames + keypoint/Disparity>)
 		std::set<int> * outliers)
 {
+	UTRACE("OptimizerCVSBA::optimizeBA");
 #ifdef RTABMAP_CVSBA
 	// run sba optimization
 	cvsba::Sba sba;
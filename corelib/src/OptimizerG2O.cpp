@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UMath.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 #include <set>
 
 #include <rtabmap/core/OptimizerG2O.h>
@@ -148,6 +149,7 @@ std::map<int, Transform> OptimizerG2O::optimize(
 		double * finalError,
 		int * iterationsDone)
 {
+	UTRACE("OptimizerG2O::optimize");
 	std::map<int, Transform> optimizedPoses;
 #ifdef RTABMAP_G2O
 	UDEBUG("Optimizing graph...");
@@ -627,6 +629,7 @@ std::map<int, Transform> OptimizerG2O::optimizeBA(
 		const std::map<int, std::map<int, cv::Point3f> > & wordReferences,
 		std::set<int> * outliers)
 {
+	UTRACE("OptimizerG2O::optimizeBA");
 	std::map<int, Transform> optimizedPoses;
 #ifdef RTABMAP_G2O
 	UDEBUG("Optimizing graph...");
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UMath.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 #include <set>
 
 #include <rtabmap/core/OptimizerGTSAM.h>
@@ -83,6 +84,7 @@ std::map<int, Transform> OptimizerGTSAM::optimize(
 		double * finalError,
 		int * iterationsDone)
 {
+	UTRACE("OptimizerGTSAM::optimize");
 	std::map<int, Transform> optimizedPoses;
 #ifdef RTABMAP_GTSAM
 
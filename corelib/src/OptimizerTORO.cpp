@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UMath.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 #include <set>
 
 #include <rtabmap/core/OptimizerTORO.h>
@@ -59,6 +60,7 @@ std::map<int, Transform> OptimizerTORO::optimize(
 		double * finalError,
 		int * iterationsDone)
 {
+	UTRACE("OptimizerTORO::optimize");
 	std::map<int, Transform> optimizedPoses;
 #ifdef RTABMAP_TORO
 	UDEBUG("Optimizing graph (pose=%d constraints=%d)...", (int)poses.size(), (int)edgeConstraints.size());
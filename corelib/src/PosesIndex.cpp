@@ -0,0 +1,300 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rtabmap/core/PosesIndex.h"
+#include <rtabmap/utilite/ULogger.h>
+#include <rtabmap/utilite/UMath.h>
+#include <rtabmap/utilite/UConversion.h>
+#include <cmath>
+
+namespace rtabmap {
+
+PosesIndex::PosesIndex(float cellSize) :
+		cellSize_(cellSize)
+{
+	UASSERT(cellSize_ > 0.0f);
+}
+
+void PosesIndex::setCellSize(float cellSize)
+{
+	UASSERT(cellSize > 0.0f);
+	if(cellSize != cellSize_)
+	{
+		cellSize_ = cellSize;
+		if(!positions_.empty())
+		{
+			std::map<int, cv::Point3f> positions = positions_;
+			cells_.clear();
+			positions_.clear();
+			for(std::map<int, cv::Point3f>::iterator iter=positions.begin(); iter!=positions.end(); ++iter)
+			{
+				update(iter->first, Transform(iter->second.x, iter->second.y, iter->second.z, 0, 0, 0));
+			}
+		}
+	}
+}
+
+void PosesIndex::clear()
+{
+	positions_.clear();
+	cells_.clear();
+	minKey_ = maxKey_ = CellKey();
+}
+
+void PosesIndex::build(const std::map<int, Transform> & poses)
+{
+	clear();
+	for(std::map<int, Transform>::const_iterator iter=poses.begin(); iter!=poses.end(); ++iter)
+	{
+		update(iter->first, iter->second);
+	}
+}
+
+void PosesIndex::update(int id, const Transform & pose)
+{
+	UASSERT_MSG(!pose.isNull(), uFormat("id=%d", id).c_str());
+	cv::Point3f pt(pose.x(), pose.y(), pose.z());
+	UASSERT_MSG(uIsFinite(pt.x) && uIsFinite(pt.y) && uIsFinite(pt.z), uFormat("Invalid pose (%d) %s", id, pose.prettyPrint().c_str()).c_str());
+	CellKey key = cellKey(pt.x, pt.y, pt.z);
+
+	std::map<int, cv::Point3f>::iterator iter = positions_.find(id);
+	if(iter != positions_.end())
+	{
+		CellKey oldKey = cellKey(iter->second.x, iter->second.y, iter->second.z);
+		iter->second = pt;
+		if(oldKey == key)
+		{
+			return;
+		}
+		std::map<CellKey, std::set<int> >::iterator jter = cells_.find(oldKey);
+		UASSERT(jter != cells_.end());
+		jter->second.erase(id);
+		if(jter->second.empty())
+		{
+			cells_.erase(jter);
+		}
+	}
+	else
+	{
+		if(positions_.empty())
+		{
+			minKey_ = maxKey_ = key;
+		}
+		positions_.insert(std::make_pair(id, pt));
+	}
+	cells_[key].insert(id);
+
+	minKey_.x = std::min(minKey_.x, key.x);
+	minKey_.y = std::min(minKey_.y, key.y);
+	minKey_.z = std::min(minKey_.z, key.z);
+	maxKey_.x = std::max(maxKey_.x, key.x);
+	maxKey_.y = std::max(maxKey_.y, key.y);
+	maxKey_.z = std::max(maxKey_.z, key.z);
+}
+
+void PosesIndex::remove(int id)
+{
+	std::map<int, cv::Point3f>::iterator iter = positions_.find(id);
+	if(iter != positions_.end())
+	{
+		std::map<CellKey, std::set<int> >::iterator jter = cells_.find(cellKey(iter->second.x, iter->second.y, iter->second.z));
+		UASSERT(jter != cells_.end());
+		jter->second.erase(id);
+		if(jter->second.empty())
+		{
+			cells_.erase(jter);
+		}
+		positions_.erase(iter);
+	}
+}
+
+std::map<int, float> PosesIndex::radiusSearch(const Transform & pose, float radius, int excludedId) const
+{
+	std::map<int, float> foundNodes;
+	if(positions_.empty() || radius <= 0.0f || pose.isNull())
+	{
+		return foundNodes;
+	}
+
+	cv::Point3f pt(pose.x(), pose.y(), pose.z());
+	float sqrdRadius = radius*radius;
+	CellKey from = cellKey(pt.x-radius, pt.y-radius, pt.z-radius);
+	CellKey to = cellKey(pt.x+radius, pt.y+radius, pt.z+radius);
+	from.x = std::max(from.x, minKey_.x);
+	from.y = std::max(from.y, minKey_.y);
+	from.z = std::max(from.z, minKey_.z);
+	to.x = std::min(to.x, maxKey_.x);
+	to.y = std::min(to.y, maxKey_.y);
+	to.z = std::min(to.z, maxKey_.z);
+
+	if(from.x > to.x || from.y > to.y || from.z > to.z)
+	{
+		return foundNodes;
+	}
+
+	double cellsToCheck = double(to.x-from.x+1)*double(to.y-from.y+1)*double(to.z-from.z+1);
+	if(cellsToCheck < (double)cells_.size())
+	{
+		for(int x=from.x; x<=to.x; ++x)
+		{
+			for(int y=from.y; y<=to.y; ++y)
+			{
+				for(int z=from.z; z<=to.z; ++z)
+				{
+					std::map<CellKey, std::set<int> >::const_iterator iter = cells_.find(CellKey(x,y,z));
+					if(iter != cells_.end())
+					{
+						for(std::set<int>::const_iterator jter=iter->second.begin(); jter!=iter->second.end(); ++jter)
+						{
+							const cv::Point3f & p = positions_.at(*jter);
+							float sqrdDist = (p.x-pt.x)*(p.x-pt.x) + (p.y-pt.y)*(p.y-pt.y) + (p.z-pt.z)*(p.z-pt.z);
+							if(sqrdDist <= sqrdRadius && *jter != excludedId)
+							{
+								foundNodes.insert(std::make_pair(*jter, sqrdDist));
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		// sparse grid, faster to check all occupied cells
+		for(std::map<CellKey, std::set<int> >::const_iterator iter=cells_.begin(); iter!=cells_.end(); ++iter)
+		{
+			const CellKey & k = iter->first;
+			if(k.x >= from.x && k.x <= to.x &&
+			   k.y >= from.y && k.y <= to.y &&
+			   k.z >= from.z && k.z <= to.z)
+			{
+				for(std::set<int>::const_iterator jter=iter->second.begin(); jter!=iter->second.end(); ++jter)
+				{
+					const cv::Point3f & p = positions_.at(*jter);
+					float sqrdDist = (p.x-pt.x)*(p.x-pt.x) + (p.y-pt.y)*(p.y-pt.y) + (p.z-pt.z)*(p.z-pt.z);
+					if(sqrdDist <= sqrdRadius && *jter != excludedId)
+					{
+						foundNodes.insert(std::make_pair(*jter, sqrdDist));
+					}
+				}
+			}
+		}
+	}
+	return foundNodes;
+}
+
+int PosesIndex::nearestSearch(const Transform & pose, float * sqrdDistance) const
+{
+	int id = 0;
+	float bestSqrdDist = -1.0f;
+	if(positions_.empty() || pose.isNull())
+	{
+		return id;
+	}
+
+	cv::Point3f pt(pose.x(), pose.y(), pose.z());
+	CellKey c = cellKey(pt.x, pt.y, pt.z);
+	int maxRing = std::max(
+			std::max(std::max(std::abs(c.x-minKey_.x), std::abs(c.x-maxKey_.x)),
+					 std::max(std::abs(c.y-minKey_.y), std::abs(c.y-maxKey_.y))),
+			std::max(std::abs(c.z-minKey_.z), std::abs(c.z-maxKey_.z)));
+
+	// Look in rings of cells around the query until the nearest node found
+	// cannot be farther than nodes in the next ring. If too many empty
+	// cells would be visited, all nodes are checked instead.
+	unsigned int cellsVisited = 0;
+	bool exhaustive = false;
+	for(int r=0; r<=maxRing && !exhaustive; ++r)
+	{
+		for(int x=std::max(c.x-r, minKey_.x); x<=std::min(c.x+r, maxKey_.x) && !exhaustive; ++x)
+		{
+			for(int y=std::max(c.y-r, minKey_.y); y<=std::min(c.y+r, maxKey_.y) && !exhaustive; ++y)
+			{
+				for(int z=std::max(c.z-r, minKey_.z); z<=std::min(c.z+r, maxKey_.z); ++z)
+				{
+					if(std::abs(x-c.x) != r && std::abs(y-c.y) != r && std::abs(z-c.z) != r)
+					{
+						// inside the ring, already checked
+						continue;
+					}
+					searchCell(CellKey(x,y,z), pt, id, bestSqrdDist);
+					if(++cellsVisited > positions_.size())
+					{
+						exhaustive = true;
+						break;
+					}
+				}
+			}
+		}
+		if(id > 0 && bestSqrdDist <= (float(r)*cellSize_)*(float(r)*cellSize_))
+		{
+			break;
+		}
+	}
+
+	if(exhaustive)
+	{
+		for(std::map<CellKey, std::set<int> >::const_iterator iter=cells_.begin(); iter!=cells_.end(); ++iter)
+		{
+			searchCell(iter->first, pt, id, bestSqrdDist);
+		}
+	}
+
+	if(sqrdDistance)
+	{
+		*sqrdDistance = bestSqrdDist;
+	}
+	return id;
+}
+
+PosesIndex::CellKey PosesIndex::cellKey(float x, float y, float z) const
+{
+	return CellKey(
+			(int)std::floor(x/cellSize_),
+			(int)std::floor(y/cellSize_),
+			(int)std::floor(z/cellSize_));
+}
+
+void PosesIndex::searchCell(const CellKey & key, const cv::Point3f & pt, int & id, float & sqrdDistance) const
+{
+	std::map<CellKey, std::set<int> >::const_iterator iter = cells_.find(key);
+	if(iter != cells_.end())
+	{
+		for(std::set<int>::const_iterator jter=iter->second.begin(); jter!=iter->second.end(); ++jter)
+		{
+			const cv::Point3f & p = positions_.at(*jter);
+			float sqrdDist = (p.x-pt.x)*(p.x-pt.x) + (p.y-pt.y)*(p.y-pt.y) + (p.z-pt.z)*(p.z-pt.z);
+			if(id == 0 || sqrdDist < sqrdDistance)
+			{
+				id = *jter;
+				sqrdDistance = sqrdDist;
+			}
+		}
+	}
+}
+
+} /* namespace rtabmap */
@@ -43,15 +43,129 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/UTimer.h>
 #include <rtabmap/utilite/UMath.h>
 
-#include <rtflann/flann.hpp>
-
 namespace rtabmap {
 
+/**
+ * Correspondences matching buffers kept between registrations: the dictionary
+ * used for global NNDR matching and, for matching with a guess, a uniform grid
+ * of the projected keypoints and the candidate descriptor distances.
+ */
+class RegistrationVisMatcher
+{
+public:
+	RegistrationVisMatcher(const ParametersMap & featureParameters) :
+		dictionary_(featureParameters),
+		points_(0),
+		radius_(1.0f),
+		cols_(0),
+		rows_(0)
+	{}
+
+	VWDictionary & dictionary() {return dictionary_;}
+
+	// Index points in a grid with cells of radius size, the points should be inside the image
+	void setPoints(const std::vector<cv::Point2f> & points, const cv::Size & imageSize, float radius)
+	{
+		UASSERT(radius > 0.0f);
+		points_ = &points;
+		radius_ = radius;
+		cols_ = int(float(imageSize.width)/radius)+1;
+		rows_ = int(float(imageSize.height)/radius)+1;
+		if((int)grid_.size() < cols_*rows_)
+		{
+			grid_.resize(cols_*rows_);
+		}
+		for(int i=0; i<cols_*rows_; ++i)
+		{
+			grid_[i].clear();
+		}
+		for(unsigned int i=0; i<points.size(); ++i)
+		{
+			int x = int(points[i].x/radius_);
+			int y = int(points[i].y/radius_);
+			UASSERT(x>=0 && x<cols_ && y>=0 && y<rows_);
+			grid_[y*cols_+x].push_back(i);
+		}
+	}
+
+	// Get indices of the points in the radius of pt
+	const std::vector<int> & radiusSearch(const cv::Point2f & pt)
+	{
+		UASSERT(points_ != 0);
+		indices_.clear();
+		int cx = int(std::floor(pt.x/radius_));
+		int cy = int(std::floor(pt.y/radius_));
+		float radiusSqrd = radius_*radius_;
+		for(int y=std::max(cy-1, 0); y<=std::min(cy+1, rows_-1); ++y)
+		{
+			for(int x=std::max(cx-1, 0); x<=std::min(cx+1, cols_-1); ++x)
+			{
+				const std::vector<int> & cell = grid_[y*cols_+x];
+				for(unsigned int i=0; i<cell.size(); ++i)
+				{
+					const cv::Point2f & p = points_->at(cell[i]);
+					if((p.x-pt.x)*(p.x-pt.x) + (p.y-pt.y)*(p.y-pt.y) < radiusSqrd)
+					{
+						indices_.push_back(cell[i]);
+					}
+				}
+			}
+		}
+		return indices_;
+	}
+
+	/**
+	 * Compare the query descriptor with the descriptors of the candidates rows.
+	 * @return the index in candidates of the nearest descriptor if it passes
+	 *         the nearest neighbor distance ratio test, -1 otherwise.
+	 */
+	int nndrMatch(const cv::Mat & query, const cv::Mat & descriptors, const std::vector<int> & candidates, float nndr)
+	{
+		UASSERT(candidates.size() >= 2);
+		int normType = descriptors.type()==CV_8U?cv::NORM_HAMMING:cv::NORM_L2SQR;
+		distances_.resize(candidates.size());
+		for(unsigned int i=0; i<candidates.size(); ++i)
+		{
+			distances_[i] = (float)cv::norm(query, descriptors.row(candidates[i]), normType);
+		}
+		int best = distances_[0] <= distances_[1]?0:1;
+		int second = best==0?1:0;
+		for(unsigned int i=2; i<distances_.size(); ++i)
+		{
+			if(distances_[i] < distances_[best])
+			{
+				second = best;
+				best = i;
+			}
+			else if(distances_[i] < distances_[second])
+			{
+				second = i;
+			}
+		}
+		return distances_[best] < nndr * distances_[second]?best:-1;
+	}
+
+	// buffer for the candidates of a query
+	std::vector<int> & candidates() {return candidates_;}
+
+private:
+	VWDictionary dictionary_;
+	const std::vector<cv::Point2f> * points_;
+	float radius_;
+	int cols_;
+	int rows_;
+	std::vector<std::vector<int> > grid_;
+	std::vector<int> indices_;
+	std::vector<int> candidates_;
+	std::vector<float> distances_;
+};
+
 RegistrationVis::RegistrationVis(const ParametersMap & parameters, Registration * child) :
 		Registration(parameters, child),
 		_minInliers(Parameters::defaultVisMinInliers()),
 		_inlierDistance(Parameters::defaultVisInlierDistance()),
 		_iterations(Parameters::defaultVisIterations()),
+		_ransacType(Parameters::defaultVisRansacType()),
 		_refineIterations(Parameters::defaultVisRefineIterations()),
 		_epipolarGeometryVar(Parameters::defaultVisEpipolarGeometryVar()),
 		_estimationType(Parameters::defaultVisEstimationType()),
@@ -91,6 +205,7 @@ void RegistrationVis::parseParameters(const ParametersMap & parameters)
 	Parameters::parse(parameters, Parameters::kVisMinInliers(), _minInliers);
 	Parameters::parse(parameters, Parameters::kVisInlierDistance(), _inlierDistance);
 	Parameters::parse(parameters, Parameters::kVisIterations(), _iterations);
+	Parameters::parse(parameters, Parameters::kVisRansacType(), _ransacType);
 	Parameters::parse(parameters, Parameters::kVisRefineIterations(), _refineIterations);
 	Parameters::parse(parameters, Parameters::kVisEstimationType(), _estimationType);
 	Parameters::parse(parameters, Parameters::kVisForwardEstOnly(), _forwardEstimateOnly);
@@ -111,6 +226,7 @@ void RegistrationVis::parseParameters(const ParametersMap & parameters)
 	UASSERT_MSG(_minInliers >= 1, uFormat("value=%d", _minInliers).c_str());
 	UASSERT_MSG(_inlierDistance > 0.0f, uFormat("value=%f", _inlierDistance).c_str());
 	UASSERT_MSG(_iterations > 0, uFormat("value=%d", _iterations).c_str());
+	UASSERT_MSG(_ransacType >= 0 && _ransacType <= 1, uFormat("value=%d", _ransacType).c_str());
 
 	// override feature parameters
 	for(ParametersMap::const_iterator iter=parameters.begin(); iter!=parameters.end(); ++iter)
@@ -162,10 +278,43 @@ void RegistrationVis::parseParameters(const ParametersMap & parameters)
 	{
 		uInsert(_featureParameters, ParametersPair(Parameters::kKpSubPixWinSize(), parameters.at(Parameters::kVisSubPixWinSize())));
 	}
+
+	// matchers' dictionary should be recreated with the new parameters
+	clearMatchers();
 }
 
 RegistrationVis::~RegistrationVis()
 {
+	clearMatchers();
+}
+
+RegistrationVisMatcher * RegistrationVis::acquireMatcher() const
+{
+	UScopeMutex lock(_matchersMutex);
+	if(_matchers.size())
+	{
+		RegistrationVisMatcher * matcher = _matchers.back();
+		_matchers.pop_back();
+		return matcher;
+	}
+	return new RegistrationVisMatcher(_featureParameters);
+}
+
+void RegistrationVis::releaseMatcher(RegistrationVisMatcher * matcher) const
+{
+	UASSERT(matcher != 0);
+	UScopeMutex lock(_matchersMutex);
+	_matchers.push_back(matcher);
+}
+
+void RegistrationVis::clearMatchers()
+{
+	UScopeMutex lock(_matchersMutex);
+	for(std::list<RegistrationVisMatcher *>::iterator iter=_matchers.begin(); iter!=_matchers.end(); ++iter)
+	{
+		delete *iter;
+	}
+	_matchers.clear();
 }
 
 Feature2D * RegistrationVis::createFeatureDetector() const
@@ -182,6 +331,7 @@ Transform RegistrationVis::computeTransformationImpl(
 	UDEBUG("%s=%d", Parameters::kVisMinInliers().c_str(), _minInliers);
 	UDEBUG("%s=%f", Parameters::kVisInlierDistance().c_str(), _inlierDistance);
 	UDEBUG("%s=%d", Parameters::kVisIterations().c_str(), _iterations);
+	UDEBUG("%s=%d", Parameters::kVisRansacType().c_str(), _ransacType);
 	UDEBUG("%s=%d", Parameters::kVisEstimationType().c_str(), _estimationType);
 	UDEBUG("%s=%d", Parameters::kVisForwardEstOnly().c_str(), _forwardEstimateOnly);
 	UDEBUG("%s=%f", Parameters::kVisEpipolarGeometryVar().c_str(), _epipolarGeometryVar);
@@ -778,77 +928,51 @@ Transform RegistrationVis::computeTransformationImpl(
 					if(cornersProjected.size())
 					{
 
-						// Create kd-tree for projected keypoints
-						rtflann::Matrix<float> cornersProjectedMat((float*)cornersProjected.data(), cornersProjected.size(), 2);
-						rtflann::Index<rtflann::L2_Simple<float> > index(cornersProjectedMat, rtflann::KDTreeIndexParams());
-						index.buildIndex();
-
-						std::vector< std::vector<size_t> > indices;
-						std::vector<std::vector<float> > dists;
+						// Index projected keypoints in a grid
+						RegistrationVisMatcher * matcher = acquireMatcher();
 						float radius = (float)_guessWinSize; // pixels
-						std::vector<cv::Point2f> pointsTo;
-						cv::KeyPoint::convert(kptsTo, pointsTo);
-						rtflann::Matrix<float> pointsToMat((float*)pointsTo.data(), pointsTo.size(), 2);
-						index.radiusSearch(pointsToMat, indices, dists, radius*radius, rtflann::SearchParams());
+						matcher->setPoints(cornersProjected, imageSize, radius);
 
-						UASSERT(indices.size() == pointsToMat.rows);
 						UASSERT(descriptorsFrom.cols == descriptorsTo.cols);
 						UASSERT(descriptorsFrom.rows == (int)kptsFrom.size());
-						UASSERT((int)pointsToMat.rows == descriptorsTo.rows);
-						UASSERT(pointsToMat.rows == kptsTo.size());
-						UDEBUG("radius search done for guess");
+						UASSERT((int)kptsTo.size() == descriptorsTo.rows);
 
 						// Process results (Nearest Neighbor Distance Ratio)
 						int newToId = orignalWordsFromIds.size()?orignalWordsFromIds.back():descriptorsFrom.rows;
 						std::map<int,int> addedWordsFrom; //<id, index>
 						std::map<int, int> duplicates; //<fromId, toId>
 						int newWords = 0;
-						for(unsigned int i = 0; i < pointsToMat.rows; ++i)
+						for(unsigned int i = 0; i < kptsTo.size(); ++i)
 						{
 							if(kptsTo3D.empty() || util3d::isFinite(kptsTo3D[i]))
 							{
 								int octave = kptsTo[i].octave;
 								int matchedIndex = -1;
-								if(indices[i].size() >= 2)
+								const std::vector<int> & indices = matcher->radiusSearch(kptsTo[i].pt);
+								std::vector<int> & candidates = matcher->candidates();
+								candidates.clear();
+								for(unsigned int j=0; j<indices.size(); ++j)
 								{
-									cv::Mat descriptors;
-									std::vector<int> descriptorsIndices(indices[i].size());
-									int oi=0;
-									for(unsigned int j=0; j<indices[i].size(); ++j)
-									{
-										if(kptsFrom.at(projectedIndexToDescIndex[indices[i].at(j)]).octave==octave)
-										{
-											descriptors.push_back(descriptorsFrom.row(projectedIndexToDescIndex[indices[i].at(j)]));
-											descriptorsIndices[oi++] = indices[i].at(j);
-										}
-									}
-									descriptorsIndices.resize(oi);
-									if(oi >=2)
+									if(kptsFrom.at(projectedIndexToDescIndex[indices[j]]).octave==octave)
 									{
-										std::vector<std::vector<cv::DMatch> > matches;
-										cv::BFMatcher matcher(descriptors.type()==CV_8U?cv::NORM_HAMMING:cv::NORM_L2SQR);
-										matcher.knnMatch(descriptorsTo.row(i), descriptors, matches, 2);
-										UASSERT(matches.size() == 1);
-										UASSERT(matches[0].size() == 2);
-										if(matches[0].at(0).distance < _nndr * matches[0].at(1).distance)
-										{
-											matchedIndex = descriptorsIndices.at(matches[0].at(0).trainIdx);
-										}
+										candidates.push_back(projectedIndexToDescIndex[indices[j]]);
 									}
-									else if(oi == 1)
+								}
+								if(candidates.size() >= 2)
+								{
+									int index = matcher->nndrMatch(descriptorsTo.row(i), descriptorsFrom, candidates, _nndr);
+									if(index >= 0)
 									{
-										matchedIndex = descriptorsIndices[0];
+										matchedIndex = candidates[index];
 									}
 								}
-								else if(indices[i].size() == 1 &&
-									    kptsFrom.at(projectedIndexToDescIndex[indices[i].at(0)]).octave == octave)
+								else if(candidates.size() == 1)
 								{
-									matchedIndex = indices[i].at(0);
+									matchedIndex = candidates[0];
 								}
 
 								if(matchedIndex >= 0)
 								{
-									matchedIndex = projectedIndexToDescIndex[matchedIndex];
 									int id = orignalWordsFromIds.size()?orignalWordsFromIds[matchedIndex]:matchedIndex;
 
 									if(addedWordsFrom.find(matchedIndex) != addedWordsFrom.end())
@@ -891,6 +1015,8 @@ Transform RegistrationVis::computeTransformationImpl(
 							}
 						}
 
+						releaseMatcher(matcher);
+
 						UDEBUG("addedWordsFrom=%d/%d (duplicates=%d, newWords=%d), kptsTo=%d, wordsTo=%d, words3From=%d",
 								(int)addedWordsFrom.size(), (int)cornersProjected.size(), (int)duplicates.size(), newWords,
 								(int)kptsTo.size(), (int)wordsTo.size(), (int)words3From.size());
@@ -959,7 +1085,8 @@ Transform RegistrationVis::computeTransformationImpl(
 
 					UDEBUG("");
 					// match between all descriptors
-					VWDictionary dictionary(_featureParameters);
+					RegistrationVisMatcher * matcher = acquireMatcher();
+					VWDictionary & dictionary = matcher->dictionary();
 					std::list<int> fromWordIds;
 					for (int i = 0; i < descriptorsFrom.rows; ++i)
 					{
@@ -975,6 +1102,7 @@ Transform RegistrationVis::computeTransformationImpl(
 						toWordIds = dictionary.addNewWords(descriptorsTo, 2);
 					}
 					dictionary.clear(false);
+					releaseMatcher(matcher);
 
 					std::multiset<int> fromWordIdsSet(fromWordIds.begin(), fromWordIds.end());
 					std::multiset<int> toWordIdsSet(toWordIds.begin(), toWordIds.end());
@@ -1180,7 +1308,8 @@ Transform RegistrationVis::computeTransformationImpl(
 								uMultimapToMapUnique(signatureB->getWords3()),
 								varianceFromInliersCount()?0:&covariances[dir],
 								&matchesV,
-								&inliersV);
+								&inliersV,
+								_ransacType);
 						inliers[dir] = inliersV;
 						matches[dir] = matchesV;
 						if(transforms[dir].isNull())
@@ -1217,7 +1346,8 @@ Transform RegistrationVis::computeTransformationImpl(
 							_refineIterations,
 							&covariances[dir],
 							&matchesV,
-							&inliersV);
+							&inliersV,
+							_ransacType);
 					inliers[dir] = inliersV;
 					matches[dir] = matchesV;
 					if(transforms[dir].isNull())
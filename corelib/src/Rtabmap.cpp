@@ -43,6 +43,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/utilite/ULogger.h>
 #include <rtabmap/utilite/UFile.h>
 #include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UTrace.h>
 #include <rtabmap/utilite/UConversion.h>
 #include <rtabmap/utilite/UMath.h>
 
@@ -55,8 +56,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <set>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #define LOG_F "LogF.txt"
 #define LOG_I "LogI.txt"
+#define LOG_TRACE "Trace.bin"
 
 #define GRAPH_FILE_NAME "Graph.dot"
 
@@ -76,6 +82,8 @@ namespace rtabmap
 
 Rtabmap::Rtabmap() :
 	_publishStats(Parameters::defaultRtabmapPublishStats()),
+	_publishStatsDelta(Parameters::defaultRtabmapPublishStatsDelta()),
+	_publishStatsKeyframe(Parameters::defaultRtabmapPublishStatsKeyframe()),
 	_publishLastSignatureData(Parameters::defaultRtabmapPublishLastSignature()),
 	_publishPdf(Parameters::defaultRtabmapPublishPdf()),
 	_publishLikelihood(Parameters::defaultRtabmapPublishLikelihood()),
@@ -89,6 +97,7 @@ Rtabmap::Rtabmap() :
 	_statisticLogsBufferedInRAM(Parameters::defaultRtabmapStatisticLogsBufferedInRAM()),
 	_statisticLogged(Parameters::defaultRtabmapStatisticLogged()),
 	_statisticLoggedHeaders(Parameters::defaultRtabmapStatisticLoggedHeaders()),
+	_traceLogged(Parameters::defaultRtabmapTraceLogged()),
 	_rgbdSlamMode(Parameters::defaultRGBDEnabled()),
 	_rgbdLinearUpdate(Parameters::defaultRGBDLinearUpdate()),
 	_rgbdAngularUpdate(Parameters::defaultRGBDAngularUpdate()),
@@ -105,6 +114,10 @@ Rtabmap::Rtabmap() :
 	_proximityFilteringRadius(Parameters::defaultRGBDProximityPathFilteringRadius()),
 	_proximityRawPosesUsed(Parameters::defaultRGBDProximityPathRawPosesUsed()),
 	_proximityAngle(Parameters::defaultRGBDProximityAngle()*M_PI/180.0f),
+	_likelihoodRadius(Parameters::defaultRGBDLikelihoodRadius()),
+	_likelihoodFov(Parameters::defaultRGBDLikelihoodFov()*M_PI/180.0f),
+	_likelihoodRandomSamples(Parameters::defaultRGBDLikelihoodRandomSamples()),
+	_likelihoodPosteriorSamples(Parameters::defaultRGBDLikelihoodPosteriorSamples()),
 	_databasePath(""),
 	_optimizeFromGraphEnd(Parameters::defaultRGBDOptimizeFromGraphEnd()),
 	_optimizationMaxLinearError(Parameters::defaultRGBDOptimizeMaxError()),
@@ -114,6 +127,7 @@ Rtabmap::Rtabmap() :
 	_pathStuckIterations(Parameters::defaultRGBDPlanStuckIterations()),
 	_pathLinearVelocity(Parameters::defaultRGBDPlanLinearVelocity()),
 	_pathAngularVelocity(Parameters::defaultRGBDPlanAngularVelocity()),
+	_pathIncremental(Parameters::defaultRGBDPlanIncremental()),
 	_loopClosureHypothesis(0,0.0f),
 	_highestHypothesis(0,0.0f),
 	_lastProcessTime(0.0),
@@ -128,18 +142,22 @@ Rtabmap::Rtabmap() :
 	_wDir(""),
 	_mapCorrection(Transform::getIdentity()),
 	_lastLocalizationNodeId(0),
+	_statsSequence(0),
+	_statsLastKeyframe(0),
 	_pathStatus(0),
 	_pathCurrentIndex(0),
 	_pathGoalIndex(0),
 	_pathTransformToGoal(Transform::getIdentity()),
 	_pathStuckCount(0),
-	_pathStuckDistance(0.0f)
+	_pathStuckDistance(0.0f),
+	_pathPlanner(0)
 {
 }
 
 Rtabmap::~Rtabmap() {
 	UDEBUG("");
 	this->close();
+	delete _pathPlanner;
 }
 
 void Rtabmap::setupLogFiles(bool overwrite)
@@ -246,6 +264,11 @@ void Rtabmap::setupLogFiles(bool overwrite)
 		}
 		UDEBUG("Log disabled!");
 	}
+
+	if(_traceLogged && !_wDir.empty() && overwrite && UFile::exists(_wDir+"/"+LOG_TRACE))
+	{
+		UFile::erase(_wDir+"/"+LOG_TRACE);
+	}
 }
 
 void Rtabmap::flushStatisticLogs()
@@ -268,6 +291,10 @@ void Rtabmap::flushStatisticLogs()
 		}
 		_bufferedLogsI.clear();
 	}
+	if(_traceLogged && !_wDir.empty())
+	{
+		UTrace::write(_wDir+"/"+LOG_TRACE);
+	}
 }
 
 void Rtabmap::init(const ParametersMap & parameters, const std::string & databasePath)
@@ -331,13 +358,21 @@ void Rtabmap::close(bool databaseSaved, const std::string & ouputDatabasePath)
 	_lastProcessTime = 0.0;
 	_someNodesHaveBeenTransferred = false;
 	_optimizedPoses.clear();
+	_optimizedPosesIndex.clear();
 	_constraints.clear();
 	_mapCorrection.setIdentity();
 	_mapCorrectionBackup.setNull();
 	_lastLocalizationPose.setNull();
 	_lastLocalizationNodeId = 0;
+	_statsLastKeyframe = 0; // next statistics will be a keyframe
+	_publishedPoses.clear();
+	_publishedConstraints.clear();
 	_distanceTravelled = 0.0f;
 	this->clearPath(0);
+	if(_pathPlanner)
+	{
+		_pathPlanner->clear();
+	}
 
 	flushStatisticLogs();
 	if(_foutFloat)
@@ -385,6 +420,10 @@ void Rtabmap::parseParameters(const ParametersMap & parameters)
 	Parameters::parse(parameters, Parameters::kRtabmapStatisticLogsBufferedInRAM(), _statisticLogsBufferedInRAM);
 	Parameters::parse(parameters, Parameters::kRtabmapStatisticLogged(), _statisticLogged);
 	Parameters::parse(parameters, Parameters::kRtabmapStatisticLoggedHeaders(), _statisticLoggedHeaders);
+	if(Parameters::parse(parameters, Parameters::kRtabmapTraceLogged(), _traceLogged))
+	{
+		UTrace::setEnabled(_traceLogged);
+	}
 
 	ULOGGER_DEBUG("");
 	ParametersMap::const_iterator iter;
@@ -394,6 +433,8 @@ void Rtabmap::parseParameters(const ParametersMap & parameters)
 	}
 
 	Parameters::parse(parameters, Parameters::kRtabmapPublishStats(), _publishStats);
+	Parameters::parse(parameters, Parameters::kRtabmapPublishStatsDelta(), _publishStatsDelta);
+	Parameters::parse(parameters, Parameters::kRtabmapPublishStatsKeyframe(), _publishStatsKeyframe);
 	Parameters::parse(parameters, Parameters::kRtabmapPublishLastSignature(), _publishLastSignatureData);
 	Parameters::parse(parameters, Parameters::kRtabmapPublishPdf(), _publishPdf);
 	Parameters::parse(parameters, Parameters::kRtabmapPublishLikelihood(), _publishLikelihood);
@@ -413,6 +454,11 @@ void Rtabmap::parseParameters(const ParametersMap & parameters)
 	Parameters::parse(parameters, Parameters::kRGBDProximityBySpace(), _proximityBySpace);
 	Parameters::parse(parameters, Parameters::kRGBDScanMatchingIdsSavedInLinks(), _scanMatchingIdsSavedInLinks);
 	Parameters::parse(parameters, Parameters::kRGBDLocalRadius(), _localRadius);
+	if(_localRadius > 0.0f)
+	{
+		// most radius searches are done with the local radius
+		_optimizedPosesIndex.setCellSize(_localRadius);
+	}
 	Parameters::parse(parameters, Parameters::kRGBDLocalImmunizationRatio(), _localImmunizationRatio);
 	Parameters::parse(parameters, Parameters::kRGBDProximityMaxGraphDepth(), _proximityMaxGraphDepth);
 	Parameters::parse(parameters, Parameters::kRGBDProximityMaxPaths(), _proximityMaxPaths);
@@ -423,6 +469,13 @@ void Rtabmap::parseParameters(const ParametersMap & parameters)
 	{
 		_proximityAngle *= M_PI/180.0f;
 	}
+	Parameters::parse(parameters, Parameters::kRGBDLikelihoodRadius(), _likelihoodRadius);
+	if(Parameters::parse(parameters, Parameters::kRGBDLikelihoodFov(), _likelihoodFov))
+	{
+		_likelihoodFov *= M_PI/180.0f;
+	}
+	Parameters::parse(parameters, Parameters::kRGBDLikelihoodRandomSamples(), _likelihoodRandomSamples);
+	Parameters::parse(parameters, Parameters::kRGBDLikelihoodPosteriorSamples(), _likelihoodPosteriorSamples);
 	Parameters::parse(parameters, Parameters::kRGBDOptimizeFromGraphEnd(), _optimizeFromGraphEnd);
 	Parameters::parse(parameters, Parameters::kRGBDOptimizeMaxError(), _optimizationMaxLinearError);
 	Parameters::parse(parameters, Parameters::kRtabmapStartNewMapOnLoopClosure(), _startNewMapOnLoopClosure);
@@ -431,6 +484,10 @@ void Rtabmap::parseParameters(const ParametersMap & parameters)
 	Parameters::parse(parameters, Parameters::kRGBDPlanStuckIterations(), _pathStuckIterations);
 	Parameters::parse(parameters, Parameters::kRGBDPlanLinearVelocity(), _pathLinearVelocity);
 	Parameters::parse(parameters, Parameters::kRGBDPlanAngularVelocity(), _pathAngularVelocity);
+	if(Parameters::parse(parameters, Parameters::kRGBDPlanIncremental(), _pathIncremental) && _pathPlanner)
+	{
+		_pathPlanner->clear();
+	}
 
 	UASSERT(_rgbdLinearUpdate >= 0.0f);
 	UASSERT(_rgbdAngularUpdate >= 0.0f);
@@ -649,6 +706,7 @@ int Rtabmap::triggerNewMap()
 		mapId = _memory->incrementMapId(&reducedIds);
 		UINFO("New map triggered, new map = %d", mapId);
 		_optimizedPoses.clear();
+		_optimizedPosesIndex.clear();
 		_constraints.clear();
 		_lastLocalizationNodeId = 0;
 		_mapCorrection.setIdentity();
@@ -787,13 +845,21 @@ void Rtabmap::resetMemory()
 	_lastProcessTime = 0.0;
 	_someNodesHaveBeenTransferred = false;
 	_optimizedPoses.clear();
+	_optimizedPosesIndex.clear();
 	_constraints.clear();
 	_mapCorrection.setIdentity();
 	_mapCorrectionBackup.setNull();
 	_lastLocalizationPose.setNull();
 	_lastLocalizationNodeId = 0;
+	_statsLastKeyframe = 0; // next statistics will be a keyframe
+	_publishedPoses.clear();
+	_publishedConstraints.clear();
 	_distanceTravelled = 0.0f;
 	this->clearPath(0);
+	if(_pathPlanner)
+	{
+		_pathPlanner->clear();
+	}
 
 	if(_memory)
 	{
@@ -801,6 +867,7 @@ void Rtabmap::resetMemory()
 		if(_memory->getLastWorkingSignature())
 		{
 			optimizeCurrentMap(_memory->getLastWorkingSignature()->id(), false, _optimizedPoses, &_constraints);
+			_optimizedPosesIndex.build(_optimizedPoses);
 		}
 		if(_bayesFilter)
 		{
@@ -853,6 +920,7 @@ bool Rtabmap::process(
 		const std::vector<float> & odomVelocity,
 		const std::map<std::string, float> & externalStats)
 {
+	UTRACE("Rtabmap::process");
 	UDEBUG("");
 
 	//============================================================
@@ -1027,6 +1095,7 @@ bool Rtabmap::process(
 		if(rehearsedId > 0)
 		{
 			_optimizedPoses.erase(rehearsedId);
+			_optimizedPosesIndex.remove(rehearsedId);
 		}
 		else if(signature->getWeight() >= 0 && _rgbdLinearUpdate > 0.0f && _rgbdAngularUpdate > 0.0f)
 		{
@@ -1167,6 +1236,7 @@ bool Rtabmap::process(
 		UDEBUG("Added pose %s (odom=%s)", newPose.prettyPrint().c_str(), signature->getPose().prettyPrint().c_str());
 		// Update Poses and Constraints
 		_optimizedPoses.insert(std::make_pair(signature->id(), newPose));
+		_optimizedPosesIndex.update(signature->id(), newPose);
 		_lastLocalizationPose = newPose; // keep in cache the latest corrected pose
 		if(signature->getLinks().size() &&
 		   signature->getLinks().begin()->second.type() == Link::kNeighbor)
@@ -1189,6 +1259,7 @@ bool Rtabmap::process(
 				{
 					tmp = _constraints.rbegin()->second.merge(tmp, tmp.type());
 					_optimizedPoses.erase(s->id());
+					_optimizedPosesIndex.remove(s->id());
 					_constraints.erase(--_constraints.end());
 				}
 			}
@@ -1217,6 +1288,7 @@ bool Rtabmap::process(
 				int erased = (int)_optimizedPoses.erase(iter->first);
 				if(erased)
 				{
+					_optimizedPosesIndex.remove(iter->first);
 					for(std::multimap<int, Link>::iterator jter = _constraints.begin(); jter!=_constraints.end();)
 					{
 						if(jter->second.from() == iter->first || jter->second.to() == iter->first)
@@ -1336,8 +1408,94 @@ bool Rtabmap::process(
 				}
 			}
 
+			int likelihoodSkipped = 0;
+			std::list<int> signaturesSkipped;
+			if(_likelihoodRadius > 0.0f &&
+			   _rgbdSlamMode &&
+			   _graphOptimizer->iterations() > 0 &&
+			   (_memory->isIncremental() || _lastLocalizationNodeId > 0) && // in localization mode, the map is trusted only once localized
+			   uContains(_optimizedPoses, signature->id()))
+			{
+				// Spatial prefilter: compare only with locations around the current pose.
+				// A random sample and the most probable locations from the last
+				// posterior are also kept so that global loop closures can be detected.
+				const Transform & currentPose = _optimizedPoses.at(signature->id());
+				std::map<int, float> nearNodes = _optimizedPosesIndex.radiusSearch(currentPose, _likelihoodRadius, signature->id());
+				Transform currentPoseInv = currentPose.inverse();
+				std::set<int> kept;
+				for(std::map<int, float>::iterator iter=nearNodes.begin(); iter!=nearNodes.end(); ++iter)
+				{
+					if(_likelihoodFov > 0.0f)
+					{
+						const Transform & pose = _optimizedPoses.at(iter->first);
+						Transform t = currentPoseInv * pose;
+						float angleInFront = t.x()!=0.0f||t.y()!=0.0f?fabs(atan2(t.y(), t.x())):0.0f;
+						float roll, pitch, yaw;
+						t.getEulerAngles(roll, pitch, yaw);
+						if(angleInFront > _likelihoodFov/2.0f && fabs(yaw) > _likelihoodFov/2.0f)
+						{
+							continue;
+						}
+					}
+					kept.insert(iter->first);
+				}
+
+				if(_likelihoodPosteriorSamples > 0)
+				{
+					std::multimap<float, int> posteriorSorted;
+					const std::map<int, float> & lastPosterior = _bayesFilter->getPosterior();
+					for(std::map<int, float>::const_iterator iter=lastPosterior.begin(); iter!=lastPosterior.end(); ++iter)
+					{
+						if(iter->first > 0 && kept.find(iter->first) == kept.end())
+						{
+							posteriorSorted.insert(std::make_pair(iter->second, iter->first));
+						}
+					}
+					int i=0;
+					for(std::multimap<float, int>::reverse_iterator iter=posteriorSorted.rbegin(); iter!=posteriorSorted.rend() && i<_likelihoodPosteriorSamples; ++iter, ++i)
+					{
+						kept.insert(iter->second);
+					}
+				}
+
+				std::vector<int> outside;
+				std::list<int> filtered;
+				for(std::list<int>::iterator iter=signaturesToCompare.begin(); iter!=signaturesToCompare.end(); ++iter)
+				{
+					if(*iter <= 0 || kept.find(*iter) != kept.end())
+					{
+						filtered.push_back(*iter); // virtual place is always kept
+					}
+					else
+					{
+						outside.push_back(*iter);
+					}
+				}
+				// Partial Fisher-Yates shuffle to select the random samples
+				int randomSamples = std::min(_likelihoodRandomSamples, (int)outside.size());
+				for(int i=0; i<randomSamples; ++i)
+				{
+					int j = i + rand() % int(outside.size()-i);
+					std::swap(outside[i], outside[j]);
+					filtered.push_back(outside[i]);
+				}
+				signaturesSkipped.insert(signaturesSkipped.end(), outside.begin()+randomSamples, outside.end());
+				likelihoodSkipped = (int)signaturesSkipped.size();
+				UDEBUG("Likelihood spatial filter: compared=%d skipped=%d (near=%d, radius=%fm)",
+						(int)filtered.size(), likelihoodSkipped, (int)nearNodes.size(), _likelihoodRadius);
+				signaturesToCompare = filtered;
+			}
+
 			rawLikelihood = _memory->computeLikelihood(signature, signaturesToCompare);
 
+			// Skipped locations get a null likelihood, like locations not sharing words
+			// with the current signature, to keep their posterior in the Bayes filter
+			for(std::list<int>::iterator iter=signaturesSkipped.begin(); iter!=signaturesSkipped.end(); ++iter)
+			{
+				rawLikelihood.insert(std::make_pair(*iter, 0.0f));
+			}
+			statistics_.addStatistic(Statistics::kLoopLikelihood_skipped(), likelihoodSkipped);
+
 			// Adjust the likelihood (with mean and std dev)
 			likelihood = rawLikelihood;
 			this->adjustLikelihood(likelihood);
@@ -1716,7 +1874,7 @@ bool Rtabmap::process(
 
 		// retrieval based on the nodes close the the nearest pose in WM
 		// immunize closest nodes
-		std::map<int, float> nearNodes = graph::getNodesInRadius(signature->id(), _optimizedPoses, _localRadius);
+		std::map<int, float> nearNodes = _optimizedPosesIndex.radiusSearch(_optimizedPoses.at(signature->id()), _localRadius, signature->id());
 		// sort by distance
 		std::multimap<float, int> nearNodesByDist;
 		for(std::map<int, float>::iterator iter=nearNodes.begin(); iter!=nearNodes.end(); ++iter)
@@ -1903,7 +2061,7 @@ bool Rtabmap::process(
 				}
 				else
 				{
-					nearestIds = graph::getNodesInRadius(signature->id(), _optimizedPoses, _localRadius);
+					nearestIds = _optimizedPosesIndex.radiusSearch(_optimizedPoses.at(signature->id()), _localRadius, signature->id());
 				}
 				UDEBUG("nearestIds=%d/%d", (int)nearestIds.size(), (int)_optimizedPoses.size());
 				std::map<int, Transform> nearestPoses;
@@ -1920,10 +2078,13 @@ bool Rtabmap::process(
 				std::map<int, std::map<int, Transform> > nearestPaths = getPaths(nearestPoses, _optimizedPoses.at(signature->id()), _proximityMaxGraphDepth);
 				UDEBUG("nearestPaths=%d proximityMaxPaths=%d", (int)nearestPaths.size(), _proximityMaxPaths);
 
+				// Select the nearest node of each path (from the most recent path), their
+				// registration is done in parallel, then they are accepted in paths order.
+				std::vector<int> proximityCandidates;
+				std::vector<std::pair<const Signature *, const Signature *> > proximityPairs;
 				for(std::map<int, std::map<int, Transform> >::const_reverse_iterator iter=nearestPaths.rbegin();
 					iter!=nearestPaths.rend() &&
-					(_memory->isIncremental() || lastProximitySpaceClosureId == 0) &&
-					(_proximityMaxPaths <= 0 || localVisualPathsChecked < _proximityMaxPaths);
+					(_proximityMaxPaths <= 0 || (int)proximityCandidates.size() < _proximityMaxPaths);
 					++iter)
 				{
 					std::map<int, Transform> path = iter->second;
@@ -1940,46 +2101,58 @@ bool Rtabmap::process(
 							(_proximityFilteringRadius <= 0.0f ||
 							 _optimizedPoses.at(signature->id()).getDistanceSquared(_optimizedPoses.at(nearestId)) < _proximityFilteringRadius*_proximityFilteringRadius))
 						{
-							++localVisualPathsChecked;
-							RegistrationInfo info;
-							// guess is null to make sure visual correspondences are globally computed
-							Transform transform = _memory->computeTransform(nearestId, signature->id(), Transform(), &info);
-							if(!transform.isNull())
+							proximityCandidates.push_back(nearestId);
+							proximityPairs.push_back(std::make_pair(_memory->getSignature(nearestId), signature));
+						}
+					}
+				}
+
+				// guess is null to make sure visual correspondences are globally computed
+				std::vector<RegistrationInfo> proximityInfos;
+				std::vector<Transform> proximityTransforms = _memory->computeTransforms(proximityPairs, &proximityInfos);
+				for(unsigned int i=0;
+					i<proximityCandidates.size() &&
+					(_memory->isIncremental() || lastProximitySpaceClosureId == 0);
+					++i)
+				{
+					++localVisualPathsChecked;
+					int nearestId = proximityCandidates[i];
+					const RegistrationInfo & info = proximityInfos[i];
+					Transform transform = proximityTransforms[i];
+					if(!transform.isNull())
+					{
+						transform = transform.inverse();
+						if(_proximityFilteringRadius <= 0 || transform.getNormSquared() <= _proximityFilteringRadius*_proximityFilteringRadius)
+						{
+							UINFO("[Visual] Add local loop closure in SPACE (%d->%d) %s",
+									signature->id(),
+									nearestId,
+									transform.prettyPrint().c_str());
+							UASSERT(info.covariance.at<double>(0,0) > 0.0 && info.covariance.at<double>(5,5) > 0.0);
+							_memory->addLink(Link(signature->id(), nearestId, Link::kLocalSpaceClosure, transform, info.covariance.inv()));
+							loopClosureLinksAdded.push_back(std::make_pair(signature->id(), nearestId));
+
+							if(loopClosureVisualInliers == 0)
 							{
-								transform = transform.inverse();
-								if(_proximityFilteringRadius <= 0 || transform.getNormSquared() <= _proximityFilteringRadius*_proximityFilteringRadius)
-								{
-									UINFO("[Visual] Add local loop closure in SPACE (%d->%d) %s",
-											signature->id(),
-											nearestId,
-											transform.prettyPrint().c_str());
-									UASSERT(info.covariance.at<double>(0,0) > 0.0 && info.covariance.at<double>(5,5) > 0.0);
-									_memory->addLink(Link(signature->id(), nearestId, Link::kLocalSpaceClosure, transform, info.covariance.inv()));
-									loopClosureLinksAdded.push_back(std::make_pair(signature->id(), nearestId));
-
-									if(loopClosureVisualInliers == 0)
-									{
-										loopClosureVisualInliers = info.inliers;
-									}
-									if(loopClosureVisualMatches == 0)
-									{
-										loopClosureVisualMatches = info.matches;
-									}
+								loopClosureVisualInliers = info.inliers;
+							}
+							if(loopClosureVisualMatches == 0)
+							{
+								loopClosureVisualMatches = info.matches;
+							}
 
-									if(_loopClosureHypothesis.first == 0)
-									{
-										++proximityDetectionsAddedVisually;
-										lastProximitySpaceClosureId = nearestId;
-									}
-								}
-								else
-								{
-									UWARN("Ignoring local loop closure with %d because resulting "
-										  "transform is to large!? (%fm > %fm)",
-											nearestId, transform.getNorm(), _proximityFilteringRadius);
-								}
+							if(_loopClosureHypothesis.first == 0)
+							{
+								++proximityDetectionsAddedVisually;
+								lastProximitySpaceClosureId = nearestId;
 							}
 						}
+						else
+						{
+							UWARN("Ignoring local loop closure with %d because resulting "
+								  "transform is to large!? (%fm > %fm)",
+									nearestId, transform.getNorm(), _proximityFilteringRadius);
+						}
 					}
 				}
 
@@ -2195,10 +2368,12 @@ bool Rtabmap::process(
 					iter->second = mapCorrectionInv * up * iter->second;
 				}
 				_optimizedPoses.at(signature->id()) = signature->getPose();
+				_optimizedPosesIndex.build(_optimizedPoses);
 			}
 			else
 			{
 				_optimizedPoses.at(signature->id()) = _optimizedPoses.at(localizationLinks.begin()->first) * localizationLinks.begin()->second.transform().inverse();
+				_optimizedPosesIndex.update(signature->id(), _optimizedPoses.at(signature->id()));
 			}
 		}
 		else
@@ -2293,6 +2468,7 @@ bool Rtabmap::process(
 			{
 				UINFO("Updated local map (old size=%d, new size=%d)", (int)_optimizedPoses.size(), (int)poses.size());
 				_optimizedPoses = poses;
+				_optimizedPosesIndex.build(_optimizedPoses);
 				_constraints = constraints;
 			}
 		}
@@ -2564,6 +2740,7 @@ bool Rtabmap::process(
 				{
 					UDEBUG("Removed %d from local map", iter->first);
 					UASSERT(iter->first != _lastLocalizationNodeId);
+					_optimizedPosesIndex.remove(iter->first);
 					_optimizedPoses.erase(iter++);
 				}
 				else
@@ -2586,6 +2763,7 @@ bool Rtabmap::process(
 		else
 		{
 			_optimizedPoses.clear();
+			_optimizedPosesIndex.clear();
 			_constraints.clear();
 		}
 	}
@@ -2647,8 +2825,126 @@ bool Rtabmap::process(
 			poses = _optimizedPoses;
 			constraints = _constraints;
 		}
-		UDEBUG("Get all node infos...");
-		for(std::map<int, Transform>::iterator iter=poses.begin(); iter!=poses.end(); ++iter)
+		localGraphSize = (int)poses.size();
+		int localizedId = 0;
+		if(!lastSignatureLocalizedPose.isNull() &&
+		   poses.insert(std::make_pair(lastSignatureData.id(), lastSignatureLocalizedPose)).second) // in case we are in localization
+		{
+			localizedId = lastSignatureData.id();
+		}
+		statistics_.addStatistic(Statistics::kMemoryLocal_graph_size(), poses.size());
+
+		std::list<int> infoIds; // nodes for which we publish node info
+		if(_publishStatsDelta &&
+		   _statsLastKeyframe > 0 &&
+		   (_publishStatsKeyframe <= 0 || _statsSequence+1 - _statsLastKeyframe < _publishStatsKeyframe))
+		{
+			// Delta: compare with what has been published, updating it at the same time
+			std::map<int, Transform> deltaPoses;
+			std::set<int> removedPoses;
+			std::map<int, Transform>::iterator iter=poses.begin();
+			std::map<int, Transform>::iterator jter=_publishedPoses.begin();
+			while(iter!=poses.end() || jter!=_publishedPoses.end())
+			{
+				if(jter==_publishedPoses.end() || (iter!=poses.end() && iter->first < jter->first))
+				{
+					// added
+					deltaPoses.insert(deltaPoses.end(), *iter);
+					_publishedPoses.insert(jter, *iter);
+					if(iter->first != localizedId)
+					{
+						infoIds.push_back(iter->first);
+					}
+					++iter;
+				}
+				else if(iter==poses.end() || jter->first < iter->first)
+				{
+					// removed
+					removedPoses.insert(removedPoses.end(), jter->first);
+					_publishedPoses.erase(jter++);
+				}
+				else
+				{
+					if(iter->second != jter->second)
+					{
+						// changed
+						deltaPoses.insert(deltaPoses.end(), *iter);
+						jter->second = iter->second;
+					}
+					++iter;
+					++jter;
+				}
+			}
+
+			std::multimap<int, Link> deltaConstraints;
+			std::multimap<int, Link> removedConstraints;
+			for(std::multimap<int, Link>::iterator iter=_publishedConstraints.begin(); iter!=_publishedConstraints.end();)
+			{
+				if(graph::findLink(constraints, iter->second.from(), iter->second.to(), false) == constraints.end())
+				{
+					removedConstraints.insert(*iter);
+					_publishedConstraints.erase(iter++);
+				}
+				else
+				{
+					++iter;
+				}
+			}
+			for(std::multimap<int, Link>::iterator iter=constraints.begin(); iter!=constraints.end(); ++iter)
+			{
+				std::multimap<int, Link>::iterator jter = graph::findLink(_publishedConstraints, iter->second.from(), iter->second.to(), false);
+				if(jter == _publishedConstraints.end())
+				{
+					deltaConstraints.insert(*iter);
+					_publishedConstraints.insert(*iter);
+				}
+				else if(jter->second.type() != iter->second.type() ||
+						jter->second.transform() != iter->second.transform() ||
+						jter->second.transVariance() != iter->second.transVariance() ||
+						jter->second.rotVariance() != iter->second.rotVariance())
+				{
+					deltaConstraints.insert(*iter);
+					jter->second = iter->second;
+				}
+			}
+			UDEBUG("Graph delta %d: poses=%d/%d removed=%d, links=%d/%d removed=%d",
+					_statsSequence+1,
+					(int)deltaPoses.size(), (int)poses.size(), (int)removedPoses.size(),
+					(int)deltaConstraints.size(), (int)constraints.size(), (int)removedConstraints.size());
+
+			poses.swap(deltaPoses);
+			constraints.swap(deltaConstraints);
+			statistics_.setRemovedPoses(removedPoses);
+			statistics_.setRemovedConstraints(removedConstraints);
+			statistics_.setGraphSequence(++_statsSequence, false);
+		}
+		else
+		{
+			if(_publishStatsDelta)
+			{
+				_publishedPoses = poses;
+				_publishedConstraints = constraints;
+				_statsLastKeyframe = ++_statsSequence;
+				statistics_.setGraphSequence(_statsSequence, true);
+			}
+			else if(_statsLastKeyframe > 0)
+			{
+				// delta mode has been disabled
+				_statsLastKeyframe = 0;
+				_publishedPoses.clear();
+				_publishedConstraints.clear();
+			}
+			for(std::map<int, Transform>::iterator iter=poses.begin(); iter!=poses.end(); ++iter)
+			{
+				if(iter->first != localizedId)
+				{
+					infoIds.push_back(iter->first);
+				}
+			}
+		}
+
+		UDEBUG("Get node infos (%d)...", (int)infoIds.size());
+		for(std::list<int>::iterator iter=infoIds.begin(); iter!=infoIds.end(); ++iter)
 		{
 			Transform odomPoseLocal;
 			int weight = -1;
@@ -2657,9 +2953,9 @@ bool Rtabmap::process(
 			double stamp = 0;
 			Transform groundTruth;
 			std::vector<float> velocity;
-			_memory->getNodeInfo(iter->first, odomPoseLocal, mapId, weight, label, stamp, groundTruth, velocity, false);
-			signatures.insert(std::make_pair(iter->first,
-					Signature(iter->first,
+			_memory->getNodeInfo(*iter, odomPoseLocal, mapId, weight, label, stamp, groundTruth, velocity, false);
+			signatures.insert(std::make_pair(*iter,
+					Signature(*iter,
 							mapId,
 							weight,
 							stamp,
@@ -2668,18 +2964,12 @@ bool Rtabmap::process(
 							groundTruth)));
 			if(!velocity.empty())
 			{
-				signatures.at(iter->first).setVelocity(velocity[0], velocity[1], velocity[2], velocity[3], velocity[4], velocity[5]);
+				signatures.at(*iter).setVelocity(velocity[0], velocity[1], velocity[2], velocity[3], velocity[4], velocity[5]);
 			}
 		}
-		localGraphSize = (int)poses.size();
-		if(!lastSignatureLocalizedPose.isNull())
-		{
-			poses.insert(std::make_pair(lastSignatureData.id(), lastSignatureLocalizedPose)); // in case we are in localization
-		}
 		statistics_.setPoses(poses);
 		statistics_.setConstraints(constraints);
 		statistics_.setSignatures(signatures);
-		statistics_.addStatistic(Statistics::kMemoryLocal_graph_size(), poses.size());
 		UDEBUG("");
 	}
 
@@ -2766,6 +3056,10 @@ bool Rtabmap::process(
 		UINFO("Time logging = %f...", timer.ticks());
 		//ULogger::flush();
 	}
+	if(_traceLogged && !_statisticLogsBufferedInRAM && !_wDir.empty())
+	{
+		UTrace::write(_wDir+"/"+LOG_TRACE);
+	}
 	UDEBUG("End process");
 
 	return true;
@@ -2837,6 +3131,7 @@ void Rtabmap::rejectLoopClosure(int oldId, int newId)
 void Rtabmap::setOptimizedPoses(const std::map<int, Transform> & poses)
 {
 	_optimizedPoses = poses;
+	_optimizedPosesIndex.build(_optimizedPoses);
 }
 
 void Rtabmap::dumpData() const
@@ -2885,7 +3180,7 @@ std::map<int, Transform> Rtabmap::getForwardWMPoses(
 		}
 		else
 		{
-			foundIds = graph::getNodesInRadius(fromId, _optimizedPoses, radius);
+			foundIds = _optimizedPosesIndex.radiusSearch(_optimizedPoses.at(fromId), radius, fromId);
 		}
 
 		float radiusSqrd = radius * radius;
@@ -2978,12 +3273,25 @@ std::map<int, std::map<int, Transform> > Rtabmap::getPaths(std::map<int, Transfo
 	std::map<int, std::map<int, Transform> > paths;
 	if(_memory && poses.size() && !target.isNull())
 	{
+		// sort poses by distance to target once, instead of searching
+		// the nearest remaining pose each time a path is removed
+		std::multimap<float, int> posesByDistance;
+		for(std::map<int, Transform>::iterator iter=poses.begin(); iter!=poses.end(); ++iter)
+		{
+			posesByDistance.insert(std::make_pair(iter->second.getDistanceSquared(target), iter->first));
+		}
+		std::multimap<float, int>::iterator nearestIter = posesByDistance.begin();
+
 		// Segment poses connected only by neighbor links
 		while(poses.size())
 		{
 			std::map<int, Transform> path;
 			// select nearest pose and iterate neighbors from there
-			int nearestId = rtabmap::graph::findNearestNode(poses, target);
+			while(poses.find(nearestIter->second) == poses.end())
+			{
+				++nearestIter;
+			}
+			int nearestId = nearestIter->second;
 			std::map<int, int> ids = _memory->getNeighborsId(nearestId, maxGraphDepth, 0, true, true, true);
 
 			for(std::map<int, int>::iterator iter=ids.begin(); iter!=ids.end(); ++iter)
@@ -3481,6 +3789,15 @@ int Rtabmap::detectMoreLoopClosures(float clusterRadius, float clusterAngle, int
 	std::list<Link> loopClosuresAdded;
 	std::multimap<int, int> checkedLoopClosures;
 
+	// number of candidates registered at the same time
+	int batchSize = 1;
+#ifdef _OPENMP
+	if(_memory->isLoopClosureParallelized())
+	{
+		batchSize = omp_get_max_threads()*2;
+	}
+#endif
+
 	std::map<int, Transform> poses;
 	std::multimap<int, Link> links;
 	std::map<int, Signature> signatures;
@@ -3513,156 +3830,187 @@ int Rtabmap::detectMoreLoopClosures(float clusterRadius, float clusterAngle, int
 
 		int i=0;
 		std::set<int> addedLinks;
-		for(std::multimap<int, int>::iterator iter=clusters.begin(); iter!= clusters.end(); ++iter, ++i)
+		std::multimap<int, int>::iterator iter=clusters.begin();
+		while(iter!=clusters.end())
 		{
 			if(processState && processState->isCanceled())
 			{
 				return -1;
-				break;
 			}
 
-			int from = iter->first;
-			int to = iter->second;
-			if(iter->first < iter->second)
+			// Select the next candidates, their registration is done in
+			// parallel, then they are accepted in clusters order.
+			std::vector<std::pair<int, int> > candidates;
+			std::vector<int> candidatesIndex;
+			std::multimap<int, int> candidatesLinks;
+			for(; iter!= clusters.end() && (int)candidates.size() < batchSize; ++iter, ++i)
 			{
-				from = iter->second;
-				to = iter->first;
-			}
+				int from = iter->first;
+				int to = iter->second;
+				if(iter->first < iter->second)
+				{
+					from = iter->second;
+					to = iter->first;
+				}
 
-			if(rtabmap::graph::findLink(checkedLoopClosures, from, to) == checkedLoopClosures.end())
-			{
 				// only add new links and one per cluster per iteration
-				if(addedLinks.find(from) == addedLinks.end() &&
+				if(rtabmap::graph::findLink(checkedLoopClosures, from, to) == checkedLoopClosures.end() &&
+				   rtabmap::graph::findLink(candidatesLinks, from, to) == candidatesLinks.end() &&
+				   addedLinks.find(from) == addedLinks.end() &&
 				   addedLinks.find(to) == addedLinks.end() &&
 				   rtabmap::graph::findLink(links, from, to) == links.end())
 				{
-					checkedLoopClosures.insert(std::make_pair(from, to));
-
 					UASSERT(signatures.find(from) != signatures.end());
 					UASSERT(signatures.find(to) != signatures.end());
+					candidatesLinks.insert(std::make_pair(from, to));
+					candidates.push_back(std::make_pair(from, to));
+					candidatesIndex.push_back(i);
+				}
+			}
 
-					RegistrationInfo info;
-					// use signatures instead of IDs because some signatures may not be in WM
-					Transform t = _memory->computeTransform(signatures.at(from), signatures.at(to), Transform(), &info);
+			// use signatures instead of IDs because some signatures may not be in WM
+			std::vector<std::pair<const Signature *, const Signature *> > pairs(candidates.size());
+			for(unsigned int j=0; j<candidates.size(); ++j)
+			{
+				pairs[j].first = &signatures.at(candidates[j].first);
+				pairs[j].second = &signatures.at(candidates[j].second);
+			}
+			std::vector<RegistrationInfo> infos;
+			std::vector<Transform> transforms = _memory->computeTransforms(pairs, &infos);
+
+			for(unsigned int j=0; j<candidates.size(); ++j)
+			{
+				int from = candidates[j].first;
+				int to = candidates[j].second;
+
+				// a previous candidate of this batch may have added a link to these nodes
+				if(addedLinks.find(from) != addedLinks.end() ||
+				   addedLinks.find(to) != addedLinks.end())
+				{
+					continue;
+				}
+				checkedLoopClosures.insert(std::make_pair(from, to));
 
-					if(!t.isNull())
+				const RegistrationInfo & info = infos[j];
+				Transform t = transforms[j];
+
+				if(!t.isNull())
+				{
+					bool updateConstraints = true;
+					if(_optimizationMaxLinearError > 0.0f)
 					{
-						bool updateConstraints = true;
-						if(_optimizationMaxLinearError > 0.0f)
-						{
-							//optimize the graph to see if the new constraint is globally valid
+						//optimize the graph to see if the new constraint is globally valid
 
-							int fromId = from;
-							int mapId = signatures.at(from).mapId();
-							// use first node of the map containing from
-							for(std::map<int, Signature>::iterator iter=signatures.begin(); iter!=signatures.end(); ++iter)
+						int fromId = from;
+						int mapId = signatures.at(from).mapId();
+						// use first node of the map containing from
+						for(std::map<int, Signature>::iterator iter=signatures.begin(); iter!=signatures.end(); ++iter)
+						{
+							if(iter->second.mapId() == mapId)
 							{
-								if(iter->second.mapId() == mapId)
-								{
-									fromId = iter->first;
-									break;
-								}
+								fromId = iter->first;
+								break;
 							}
-							std::multimap<int, Link> linksIn = links;
-							linksIn.insert(std::make_pair(from, Link(from, to, Link::kUserClosure, t, info.covariance.inv())));
-							const Link * maxLinearLink = 0;
-							const Link * maxAngularLink = 0;
-							float maxLinearError = 0.0f;
-							float maxAngularError = 0.0f;
-							std::map<int, Transform> optimizedPoses;
-							std::multimap<int, Link> links;
-							UASSERT(poses.find(fromId) != poses.end());
-							UASSERT_MSG(poses.find(from) != poses.end(), uFormat("id=%d poses=%d links=%d", from, (int)poses.size(), (int)links.size()).c_str());
-							UASSERT_MSG(poses.find(to) != poses.end(), uFormat("id=%d poses=%d links=%d", to, (int)poses.size(), (int)links.size()).c_str());
-							_graphOptimizer->getConnectedGraph(fromId, poses, linksIn, optimizedPoses, links);
-							UASSERT(optimizedPoses.find(fromId) != optimizedPoses.end());
-							UASSERT_MSG(optimizedPoses.find(from) != optimizedPoses.end(), uFormat("id=%d poses=%d links=%d", from, (int)optimizedPoses.size(), (int)links.size()).c_str());
-							UASSERT_MSG(optimizedPoses.find(to) != optimizedPoses.end(), uFormat("id=%d poses=%d links=%d", to, (int)optimizedPoses.size(), (int)links.size()).c_str());
-							UASSERT(graph::findLink(links, from, to) != links.end());
-							optimizedPoses = _graphOptimizer->optimize(fromId, optimizedPoses, links);
-							std::string msg;
-							if(optimizedPoses.size())
+						}
+						std::multimap<int, Link> linksIn = links;
+						linksIn.insert(std::make_pair(from, Link(from, to, Link::kUserClosure, t, info.covariance.inv())));
+						const Link * maxLinearLink = 0;
+						const Link * maxAngularLink = 0;
+						float maxLinearError = 0.0f;
+						float maxAngularError = 0.0f;
+						std::map<int, Transform> optimizedPoses;
+						std::multimap<int, Link> links;
+						UASSERT(poses.find(fromId) != poses.end());
+						UASSERT_MSG(poses.find(from) != poses.end(), uFormat("id=%d poses=%d links=%d", from, (int)poses.size(), (int)links.size()).c_str());
+						UASSERT_MSG(poses.find(to) != poses.end(), uFormat("id=%d poses=%d links=%d", to, (int)poses.size(), (int)links.size()).c_str());
+						_graphOptimizer->getConnectedGraph(fromId, poses, linksIn, optimizedPoses, links);
+						UASSERT(optimizedPoses.find(fromId) != optimizedPoses.end());
+						UASSERT_MSG(optimizedPoses.find(from) != optimizedPoses.end(), uFormat("id=%d poses=%d links=%d", from, (int)optimizedPoses.size(), (int)links.size()).c_str());
+						UASSERT_MSG(optimizedPoses.find(to) != optimizedPoses.end(), uFormat("id=%d poses=%d links=%d", to, (int)optimizedPoses.size(), (int)links.size()).c_str());
+						UASSERT(graph::findLink(links, from, to) != links.end());
+						optimizedPoses = _graphOptimizer->optimize(fromId, optimizedPoses, links);
+						std::string msg;
+						if(optimizedPoses.size())
+						{
+							for(std::multimap<int, Link>::iterator iter=links.begin(); iter!=links.end(); ++iter)
 							{
-								for(std::multimap<int, Link>::iterator iter=links.begin(); iter!=links.end(); ++iter)
+								// ignore links with high variance
+								if(iter->second.transVariance() <= 1.0 && iter->second.from() != iter->second.to())
 								{
-									// ignore links with high variance
-									if(iter->second.transVariance() <= 1.0 && iter->second.from() != iter->second.to())
+									UASSERT(optimizedPoses.find(iter->second.from())!=optimizedPoses.end());
+									UASSERT(optimizedPoses.find(iter->second.to())!=optimizedPoses.end());
+									Transform t1 = optimizedPoses.at(iter->second.from());
+									Transform t2 = optimizedPoses.at(iter->second.to());
+									UASSERT(!t1.isNull() && !t2.isNull());
+									Transform t = t1.inverse()*t2;
+									float linearError = uMax3(
+											fabs(iter->second.transform().x() - t.x()),
+											fabs(iter->second.transform().y() - t.y()),
+											fabs(iter->second.transform().z() - t.z()));
+									Eigen::Vector3f vA = t1.toEigen3f().rotation()*Eigen::Vector3f(1,0,0);
+									Eigen::Vector3f vB = t2.toEigen3f().rotation()*Eigen::Vector3f(1,0,0);
+									float angularError = pcl::getAngle3D(Eigen::Vector4f(vA[0], vA[1], vA[2], 0), Eigen::Vector4f(vB[0], vB[1], vB[2], 0));
+									if(linearError > maxLinearError)
 									{
-										UASSERT(optimizedPoses.find(iter->second.from())!=optimizedPoses.end());
-										UASSERT(optimizedPoses.find(iter->second.to())!=optimizedPoses.end());
-										Transform t1 = optimizedPoses.at(iter->second.from());
-										Transform t2 = optimizedPoses.at(iter->second.to());
-										UASSERT(!t1.isNull() && !t2.isNull());
-										Transform t = t1.inverse()*t2;
-										float linearError = uMax3(
-												fabs(iter->second.transform().x() - t.x()),
-												fabs(iter->second.transform().y() - t.y()),
-												fabs(iter->second.transform().z() - t.z()));
-										Eigen::Vector3f vA = t1.toEigen3f().rotation()*Eigen::Vector3f(1,0,0);
-										Eigen::Vector3f vB = t2.toEigen3f().rotation()*Eigen::Vector3f(1,0,0);
-										float angularError = pcl::getAngle3D(Eigen::Vector4f(vA[0], vA[1], vA[2], 0), Eigen::Vector4f(vB[0], vB[1], vB[2], 0));
-										if(linearError > maxLinearError)
-										{
-											maxLinearError = linearError;
-											maxLinearLink = &iter->second;
-										}
-										if(angularError > maxAngularError)
-										{
-											maxAngularError = angularError;
-											maxAngularLink = &iter->second;
-										}
+										maxLinearError = linearError;
+										maxLinearLink = &iter->second;
+									}
+									if(angularError > maxAngularError)
+									{
+										maxAngularError = angularError;
+										maxAngularLink = &iter->second;
 									}
-								}
-								if(maxLinearLink)
-								{
-									UINFO("Max optimization linear error = %f m (link %d->%d)", maxLinearError, maxLinearLink->from(), maxLinearLink->to());
-								}
-								if(maxAngularLink)
-								{
-									UINFO("Max optimization angular error = %f deg (link %d->%d)", maxAngularError*180.0f/M_PI, maxAngularLink->from(), maxAngularLink->to());
-								}
-
-								if(maxLinearError > _optimizationMaxLinearError)
-								{
-									msg = uFormat("Rejecting edge %d->%d because "
-											  "graph error is too large after optimization (%f m for edge %d->%d, %f deg for edge %d->%d). "
-											  "\"%s\" is %f m.",
-											  from,
-											  to,
-											  maxLinearError,
-											  maxLinearLink->from(),
-											  maxLinearLink->to(),
-											  maxAngularError*180.0f/M_PI,
-											  maxAngularLink?maxAngularLink->from():0,
-											  maxAngularLink?maxAngularLink->to():0,
-											  Parameters::kRGBDOptimizeMaxError().c_str(),
-											  _optimizationMaxLinearError);
 								}
 							}
-							else
+							if(maxLinearLink)
 							{
-								msg = uFormat("Rejecting edge %d->%d because graph optimization has failed!",
-										  from,
-										  to);
+								UINFO("Max optimization linear error = %f m (link %d->%d)", maxLinearError, maxLinearLink->from(), maxLinearLink->to());
 							}
-							if(!msg.empty())
+							if(maxAngularLink)
 							{
-								UWARN("%s", msg.c_str());
-								updateConstraints = false;
+								UINFO("Max optimization angular error = %f deg (link %d->%d)", maxAngularError*180.0f/M_PI, maxAngularLink->from(), maxAngularLink->to());
 							}
-						}
 
-						if(updateConstraints)
+							if(maxLinearError > _optimizationMaxLinearError)
+							{
+								msg = uFormat("Rejecting edge %d->%d because "
+										  "graph error is too large after optimization (%f m for edge %d->%d, %f deg for edge %d->%d). "
+										  "\"%s\" is %f m.",
+										  from,
+										  to,
+										  maxLinearError,
+										  maxLinearLink->from(),
+										  maxLinearLink->to(),
+										  maxAngularError*180.0f/M_PI,
+										  maxAngularLink?maxAngularLink->from():0,
+										  maxAngularLink?maxAngularLink->to():0,
+										  Parameters::kRGBDOptimizeMaxError().c_str(),
+										  _optimizationMaxLinearError);
+							}
+						}
+						else
+						{
+							msg = uFormat("Rejecting edge %d->%d because graph optimization has failed!",
+									  from,
+									  to);
+						}
+						if(!msg.empty())
 						{
-							UINFO("Added new loop closure between %d and %d.", from, to);
-							addedLinks.insert(from);
-							addedLinks.insert(to);
-							cv::Mat inf = info.covariance.inv();
-							links.insert(std::make_pair(from, Link(from, to, Link::kUserClosure, t, inf)));
-							loopClosuresAdded.push_back(Link(from, to, Link::kUserClosure, t, inf));
-							UINFO("Detected loop closure %d->%d! (%d/%d)", from, to, i+1, (int)clusters.size());
+							UWARN("%s", msg.c_str());
+							updateConstraints = false;
 						}
 					}
+
+					if(updateConstraints)
+					{
+						UINFO("Added new loop closure between %d and %d.", from, to);
+						addedLinks.insert(from);
+						addedLinks.insert(to);
+						cv::Mat inf = info.covariance.inv();
+						links.insert(std::make_pair(from, Link(from, to, Link::kUserClosure, t, inf)));
+						loopClosuresAdded.push_back(Link(from, to, Link::kUserClosure, t, inf));
+						UINFO("Detected loop closure %d->%d! (%d/%d)", from, to, candidatesIndex[j]+1, (int)clusters.size());
+					}
 				}
 			}
 		}
@@ -3811,18 +4159,45 @@ bool Rtabmap::computePath(int targetNode, bool global)
 				UWARN("Last localization pose is null... cannot compute a path");
 				return false;
 			}
-			currentNode = graph::findNearestNode(_optimizedPoses, _lastLocalizationPose);
+			currentNode = _optimizedPosesIndex.nearestSearch(_lastLocalizationPose);
 		}
 		if(currentNode && targetNode)
 		{
-			std::list<std::pair<int, Transform> > path = graph::computePath(
+			std::list<std::pair<int, Transform> > path;
+			if(_pathIncremental && global)
+			{
+				if(_pathPlanner == 0)
+				{
+					_pathPlanner = new graph::DStarLite();
+				}
+				if(_pathPlanner->goal() != targetNode)
+				{
+					// new goal, plan from scratch, then memory feeds the link changes
+					_pathPlanner->init(targetNode, _memory->getAllLinks(true), _optimizedPoses, _pathLinearVelocity);
+					_memory->setPathPlanner(_pathPlanner);
+				}
+				else
+				{
+					// link costs are computed from the optimized poses
+					_pathPlanner->updatePoses(_optimizedPoses);
+				}
+				// link transforms are kept by the planner, no database query here
+				path = _pathPlanner->computePath(currentNode);
+				UINFO("D* Lite time = %fs", timer.ticks());
+			}
+			else
+			{
+				// A* with optimized poses for costs and heuristic
+				path = graph::computePath(
 					currentNode,
 					targetNode,
 					_memory,
 					global,
 					false,
 					_pathLinearVelocity,
-					_pathAngularVelocity);
+					_pathAngularVelocity,
+					&_optimizedPoses);
+			}
 
 			//transform in current referential
 			Transform t = uValue(_optimizedPoses, currentNode, Transform::getIdentity());
@@ -3944,7 +4319,7 @@ bool Rtabmap::computePath(const Transform & targetPose)
 			UWARN("Last localization pose is null... cannot compute a path");
 			return false;
 		}
-		currentNode = graph::findNearestNode(_optimizedPoses, _lastLocalizationPose);
+		currentNode = _optimizedPosesIndex.nearestSearch(_lastLocalizationPose);
 	}
 
 	int nearestId;
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "rtabmap/core/SensorData.h"
 #include "rtabmap/core/Compression.h"
+#include "rtabmap/core/util3d_mapping.h"
 #include "rtabmap/utilite/ULogger.h"
 #include <rtabmap/utilite/UMath.h>
 #include <rtabmap/utilite/UConversion.h>
@@ -544,7 +545,8 @@ void SensorData::setOccupancyGrid(
 
 	if(!ground.empty())
 	{
-		if(ground.type() == CV_32FC2 || ground.type() == CV_32FC3 || ground.type() == CV_32FC(4) || ground.type() == CV_32FC(6))
+		if(ground.type() == CV_32FC2 || ground.type() == CV_32FC3 || ground.type() == CV_32FC(4) || ground.type() == CV_32FC(6) ||
+		   ground.type() == CV_16SC2 || ground.type() == CV_16SC3 || ground.type() == CV_16SC4) // encoded cells
 		{
 			_groundCellsRaw = ground;
 			ctGround.start();
@@ -557,7 +559,8 @@ void SensorData::setOccupancyGrid(
 	}
 	if(!obstacles.empty())
 	{
-		if(obstacles.type() == CV_32FC2 || obstacles.type() == CV_32FC3 || obstacles.type() == CV_32FC(4) || obstacles.type() == CV_32FC(6))
+		if(obstacles.type() == CV_32FC2 || obstacles.type() == CV_32FC3 || obstacles.type() == CV_32FC(4) || obstacles.type() == CV_32FC(6) ||
+		   obstacles.type() == CV_16SC2 || obstacles.type() == CV_16SC3 || obstacles.type() == CV_16SC4) // encoded cells
 		{
 			_obstacleCellsRaw = obstacles;
 			ctObstacles.start();
@@ -811,6 +814,16 @@ void SensorData::uncompressDataConst(
 			*obstacleCellsRaw = ctObstacleCells.getUncompressedData();
 		}
 	}
+
+	// Local maps encoded as cells are returned as points
+	if(groundCellsRaw && !groundCellsRaw->empty() && groundCellsRaw->depth() == CV_16S)
+	{
+		*groundCellsRaw = util3d::decodeLocalMapCells(*groundCellsRaw, _cellSize);
+	}
+	if(obstacleCellsRaw && !obstacleCellsRaw->empty() && obstacleCellsRaw->depth() == CV_16S)
+	{
+		*obstacleCellsRaw = util3d::decodeLocalMapCells(*obstacleCellsRaw, _cellSize);
+	}
 }
 
 void SensorData::setFeatures(const std::vector<cv::KeyPoint> & keypoints, const std::vector<cv::Point3f> & keypoints3D, const cv::Mat & descriptors)
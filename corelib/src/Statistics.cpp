@@ -26,6 +26,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "rtabmap/core/Statistics.h"
+#include "rtabmap/core/Graph.h"
+#include <rtabmap/utilite/ULogger.h>
 #include <rtabmap/utilite/UStl.h>
 #include <rtabmap/utilite/UConversion.h>
 
@@ -77,7 +79,9 @@ Statistics::Statistics() :
 	_loopClosureId(0),
 	_proximiyDetectionId(0),
 	_stamp(0.0f),
-	_currentGoalId(0)
+	_currentGoalId(0),
+	_graphSequence(0),
+	_graphKeyframe(false)
 {
 	_defaultDataInitialized = true;
 }
@@ -92,4 +96,79 @@ void Statistics::addStatistic(const std::string & name, float value)
 	uInsert(_data, std::pair<std::string, float>(name, value));
 }
 
+bool Statistics::updateGraph(
+		std::map<int, Transform> & poses,
+		std::multimap<int, Link> & constraints,
+		std::map<int, Signature> & nodeInfos,
+		int & sequence) const
+{
+	if(_graphSequence > 0 && !_graphKeyframe)
+	{
+		if(sequence == 0 || _graphSequence != sequence+1)
+		{
+			UWARN("Received graph delta %d but last sequence applied is %d, waiting for the next keyframe...", _graphSequence, sequence);
+			return false;
+		}
+		for(std::set<int>::const_iterator iter=_removedPoses.begin(); iter!=_removedPoses.end(); ++iter)
+		{
+			poses.erase(*iter);
+			nodeInfos.erase(*iter);
+		}
+		for(std::multimap<int, Link>::const_iterator iter=_removedConstraints.begin(); iter!=_removedConstraints.end(); ++iter)
+		{
+			std::multimap<int, Link>::iterator jter = graph::findLink(constraints, iter->second.from(), iter->second.to(), false);
+			if(jter != constraints.end())
+			{
+				constraints.erase(jter);
+			}
+		}
+		for(std::map<int, Transform>::const_iterator iter=_poses.begin(); iter!=_poses.end(); ++iter)
+		{
+			uInsert(poses, *iter);
+		}
+		for(std::multimap<int, Link>::const_iterator iter=_constraints.begin(); iter!=_constraints.end(); ++iter)
+		{
+			std::multimap<int, Link>::iterator jter = graph::findLink(constraints, iter->second.from(), iter->second.to(), false);
+			if(jter != constraints.end())
+			{
+				jter->second = iter->second;
+			}
+			else
+			{
+				constraints.insert(*iter);
+			}
+		}
+	}
+	else
+	{
+		poses = _poses;
+		constraints = _constraints;
+		nodeInfos.clear();
+	}
+
+	// keep only node infos, not sensor data
+	for(std::map<int, Signature>::const_iterator iter=_signatures.begin(); iter!=_signatures.end(); ++iter)
+	{
+		if(poses.find(iter->first) != poses.end())
+		{
+			Signature info(iter->first,
+					iter->second.mapId(),
+					iter->second.getWeight(),
+					iter->second.getStamp(),
+					iter->second.getLabel(),
+					iter->second.getPose(),
+					iter->second.getGroundTruthPose());
+			const std::vector<float> & v = iter->second.getVelocity();
+			if(v.size() == 6)
+			{
+				info.setVelocity(v[0], v[1], v[2], v[3], v[4], v[5]);
+			}
+			uInsert(nodeInfos, std::make_pair(iter->first, info));
+		}
+	}
+
+	sequence = _graphSequence;
+	return true;
+}
+
 }
@@ -27,11 +27,48 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rtabmap/core/StereoDense.h>
 #include <rtabmap/utilite/ULogger.h>
+#include <rtabmap/utilite/UMath.h>
 #include <opencv2/calib3d/calib3d.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
+#include <climits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 namespace rtabmap {
 
+StereoDense * StereoDense::create(const ParametersMap & parameters)
+{
+	int stereoTypeInt = Parameters::defaultStereoDenseStrategy();
+	Parameters::parse(parameters, Parameters::kStereoDenseStrategy(), stereoTypeInt);
+	return create((StereoDense::Type)stereoTypeInt, parameters);
+}
+
+StereoDense * StereoDense::create(StereoDense::Type type, const ParametersMap & parameters)
+{
+	StereoDense * stereo = 0;
+	switch(type)
+	{
+	case StereoDense::kTypeSGM:
+		stereo = new StereoSGM(parameters);
+		break;
+	case StereoDense::kTypeBM:
+	default:
+		stereo = new StereoBM(parameters);
+		break;
+	}
+	return stereo;
+}
+
 StereoBM::StereoBM(int blockSize, int numDisparities) :
 		blockSize_(blockSize),
 		minDisparity_(Parameters::defaultStereoBMMinDisparity()),
@@ -119,4 +156,418 @@ cv::Mat StereoBM::computeDisparity(
 	return disparity;
 }
 
+//////////////////////////
+// StereoSGM
+//////////////////////////
+// Census window 9x7: 62 bits compared to the center pixel
+static const int kCensusHalfWidth = 4;
+static const int kCensusHalfHeight = 3;
+static const unsigned char kCensusInvalidCost = 64; // no correspondence in the right image
+// Padding of the path costs on both sides of the disparity range. With
+// P1,P2 < 4096, all path costs stay lower than this value and additions
+// don't overflow, even with signed 16 bits instructions.
+static const unsigned short kSGMSentinel = 0x3FFF;
+
+static inline int hammingDistance(unsigned long long a, unsigned long long b)
+{
+#ifdef __GNUC__
+	return __builtin_popcountll(a ^ b);
+#else
+	unsigned long long n = a ^ b;
+	n = n - ((n >> 1) & 0x5555555555555555ULL);
+	n = (n & 0x3333333333333333ULL) + ((n >> 2) & 0x3333333333333333ULL);
+	n = (n + (n >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return int((n * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+static void censusTransform(const cv::Mat & image, std::vector<unsigned long long> & census)
+{
+	cv::Mat padded;
+	cv::copyMakeBorder(image, padded, kCensusHalfHeight, kCensusHalfHeight, kCensusHalfWidth, kCensusHalfWidth, cv::BORDER_REPLICATE);
+	census.resize(image.total());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int y=0; y<image.rows; ++y)
+	{
+		unsigned long long * out = &census[y*image.cols];
+		for(int x=0; x<image.cols; ++x)
+		{
+			unsigned char center = padded.at<unsigned char>(y+kCensusHalfHeight, x+kCensusHalfWidth);
+			unsigned long long bits = 0;
+			for(int v=0; v<=2*kCensusHalfHeight; ++v)
+			{
+				const unsigned char * row = padded.ptr<unsigned char>(y+v) + x;
+				for(int u=0; u<=2*kCensusHalfWidth; ++u)
+				{
+					if(v != kCensusHalfHeight || u != kCensusHalfWidth)
+					{
+						bits = (bits << 1) | (row[u] < center?1:0);
+					}
+				}
+			}
+			out[x] = bits;
+		}
+	}
+}
+
+/**
+ * One step of a path: Lc(d) = C(d) + min(Lp(d), Lp(d-1)+P1, Lp(d+1)+P1, min(Lp)+P2) - min(Lp).
+ * Lp[-1] and Lp[D] should be set to kSGMSentinel. Lc is added to S.
+ * Returns min(Lc).
+ */
+static inline unsigned short sgmPathStep(
+		const unsigned char * C,
+		const unsigned short * Lp,
+		unsigned short * Lc,
+		unsigned short * S,
+		int D,
+		unsigned short P1,
+		unsigned short P2,
+		unsigned short minPrev)
+{
+	const unsigned short jump = minPrev + P2;
+	unsigned short minCur = kSGMSentinel;
+	int d=0;
+#if defined(__AVX2__)
+	const __m256i vP1 = _mm256_set1_epi16(P1);
+	const __m256i vJump = _mm256_set1_epi16(jump);
+	const __m256i vMinPrev = _mm256_set1_epi16(minPrev);
+	__m256i vMin = _mm256_set1_epi16(kSGMSentinel);
+	for(; d+16<=D; d+=16)
+	{
+		__m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(C+d)));
+		__m256i l = _mm256_min_epu16(_mm256_loadu_si256((const __m256i*)(Lp+d)), vJump);
+		__m256i lm = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(Lp+d-1)), vP1);
+		__m256i lp = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(Lp+d+1)), vP1);
+		l = _mm256_min_epu16(l, _mm256_min_epu16(lm, lp));
+		l = _mm256_sub_epi16(_mm256_add_epi16(c, l), vMinPrev);
+		_mm256_storeu_si256((__m256i*)(Lc+d), l);
+		_mm256_storeu_si256((__m256i*)(S+d), _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(S+d)), l));
+		vMin = _mm256_min_epu16(vMin, l);
+	}
+	if(d)
+	{
+		__m128i m = _mm_min_epu16(_mm256_castsi256_si128(vMin), _mm256_extracti128_si256(vMin, 1));
+		minCur = (unsigned short)(_mm_cvtsi128_si32(_mm_minpos_epu16(m)) & 0xFFFF);
+	}
+#elif defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vP1 = _mm_set1_epi16(P1);
+	const __m128i vJump = _mm_set1_epi16(jump);
+	const __m128i vMinPrev = _mm_set1_epi16(minPrev);
+	__m128i vMin = _mm_set1_epi16(kSGMSentinel);
+	for(; d+8<=D; d+=8)
+	{
+		// values are lower than 0x7FFF, signed min is fine
+		__m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(C+d)), zero);
+		__m128i l = _mm_min_epi16(_mm_loadu_si128((const __m128i*)(Lp+d)), vJump);
+		__m128i lm = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(Lp+d-1)), vP1);
+		__m128i lp = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(Lp+d+1)), vP1);
+		l = _mm_min_epi16(l, _mm_min_epi16(lm, lp));
+		l = _mm_sub_epi16(_mm_add_epi16(c, l), vMinPrev);
+		_mm_storeu_si128((__m128i*)(Lc+d), l);
+		_mm_storeu_si128((__m128i*)(S+d), _mm_add_epi16(_mm_loadu_si128((const __m128i*)(S+d)), l));
+		vMin = _mm_min_epi16(vMin, l);
+	}
+	if(d)
+	{
+		vMin = _mm_min_epi16(vMin, _mm_srli_si128(vMin, 8));
+		vMin = _mm_min_epi16(vMin, _mm_srli_si128(vMin, 4));
+		vMin = _mm_min_epi16(vMin, _mm_srli_si128(vMin, 2));
+		minCur = (unsigned short)(_mm_cvtsi128_si32(vMin) & 0xFFFF);
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const uint16x8_t vP1 = vdupq_n_u16(P1);
+	const uint16x8_t vJump = vdupq_n_u16(jump);
+	const uint16x8_t vMinPrev = vdupq_n_u16(minPrev);
+	uint16x8_t vMin = vdupq_n_u16(kSGMSentinel);
+	for(; d+8<=D; d+=8)
+	{
+		uint16x8_t c = vmovl_u8(vld1_u8(C+d));
+		uint16x8_t l = vminq_u16(vld1q_u16(Lp+d), vJump);
+		uint16x8_t lm = vaddq_u16(vld1q_u16(Lp+d-1), vP1);
+		uint16x8_t lp = vaddq_u16(vld1q_u16(Lp+d+1), vP1);
+		l = vminq_u16(l, vminq_u16(lm, lp));
+		l = vsubq_u16(vaddq_u16(c, l), vMinPrev);
+		vst1q_u16(Lc+d, l);
+		vst1q_u16(S+d, vaddq_u16(vld1q_u16(S+d), l));
+		vMin = vminq_u16(vMin, l);
+	}
+	if(d)
+	{
+		uint16x4_t m = vmin_u16(vget_low_u16(vMin), vget_high_u16(vMin));
+		m = vpmin_u16(m, m);
+		m = vpmin_u16(m, m);
+		minCur = vget_lane_u16(m, 0);
+	}
+#endif
+	for(; d<D; ++d)
+	{
+		unsigned short l = uMin(uMin(Lp[d], jump), (unsigned short)(uMin(Lp[d-1], Lp[d+1]) + P1));
+		l = C[d] + l - minPrev;
+		Lc[d] = l;
+		S[d] += l;
+		if(l < minCur)
+		{
+			minCur = l;
+		}
+	}
+	return minCur;
+}
+
+/**
+ * Aggregate the costs along direction (dx,dy) and add them to sum. Each
+ * scanline of the direction starts on the image border and is independent
+ * of the others, so they are processed in parallel.
+ */
+static void sgmAggregatePath(
+		const unsigned char * cost,
+		unsigned short * sum,
+		int width,
+		int height,
+		int D,
+		int dx,
+		int dy,
+		unsigned short P1,
+		unsigned short P2)
+{
+	std::vector<cv::Point> starts;
+	if(dy != 0)
+	{
+		for(int x=0; x<width; ++x)
+		{
+			starts.push_back(cv::Point(x, dy>0?0:height-1));
+		}
+	}
+	if(dx != 0)
+	{
+		for(int y=0; y<height; ++y)
+		{
+			if(dy == 0 || y != (dy>0?0:height-1))
+			{
+				starts.push_back(cv::Point(dx>0?0:width-1, y));
+			}
+		}
+	}
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int i=0; i<(int)starts.size(); ++i)
+	{
+		std::vector<unsigned short> buffer(2*(D+2), kSGMSentinel);
+		unsigned short * Lp = &buffer[1];
+		unsigned short * Lc = &buffer[D+3];
+
+		int x = starts[i].x;
+		int y = starts[i].y;
+		const unsigned char * C = cost + (y*width+x)*D;
+		unsigned short * S = sum + (y*width+x)*D;
+		unsigned short minPrev = kSGMSentinel;
+		for(int d=0; d<D; ++d)
+		{
+			Lp[d] = C[d];
+			S[d] += C[d];
+			if(Lp[d] < minPrev)
+			{
+				minPrev = Lp[d];
+			}
+		}
+		x+=dx;
+		y+=dy;
+		while(x>=0 && x<width && y>=0 && y<height)
+		{
+			C = cost + (y*width+x)*D;
+			S = sum + (y*width+x)*D;
+			minPrev = sgmPathStep(C, Lp, Lc, S, D, P1, P2, minPrev);
+			std::swap(Lp, Lc);
+			x+=dx;
+			y+=dy;
+		}
+	}
+}
+
+StereoSGM::StereoSGM(const ParametersMap & parameters) :
+		StereoDense(parameters),
+		minDisparity_(Parameters::defaultStereoSGMMinDisparity()),
+		numDisparities_(Parameters::defaultStereoSGMNumDisparities()),
+		p1_(Parameters::defaultStereoSGMP1()),
+		p2_(Parameters::defaultStereoSGMP2()),
+		paths_(Parameters::defaultStereoSGMPaths()),
+		uniquenessRatio_(Parameters::defaultStereoSGMUniquenessRatio()),
+		disp12MaxDiff_(Parameters::defaultStereoSGMDisp12MaxDiff()),
+		speckleWindowSize_(Parameters::defaultStereoSGMSpeckleWindowSize()),
+		speckleRange_(Parameters::defaultStereoSGMSpeckleRange())
+{
+	this->parseParameters(parameters);
+}
+
+void StereoSGM::parseParameters(const ParametersMap & parameters)
+{
+	Parameters::parse(parameters, Parameters::kStereoSGMMinDisparity(), minDisparity_);
+	Parameters::parse(parameters, Parameters::kStereoSGMNumDisparities(), numDisparities_);
+	Parameters::parse(parameters, Parameters::kStereoSGMP1(), p1_);
+	Parameters::parse(parameters, Parameters::kStereoSGMP2(), p2_);
+	Parameters::parse(parameters, Parameters::kStereoSGMPaths(), paths_);
+	Parameters::parse(parameters, Parameters::kStereoSGMUniquenessRatio(), uniquenessRatio_);
+	Parameters::parse(parameters, Parameters::kStereoSGMDisp12MaxDiff(), disp12MaxDiff_);
+	Parameters::parse(parameters, Parameters::kStereoSGMSpeckleWindowSize(), speckleWindowSize_);
+	Parameters::parse(parameters, Parameters::kStereoSGMSpeckleRange(), speckleRange_);
+
+	UASSERT_MSG(numDisparities_ > 0, uFormat("%s=%d", Parameters::kStereoSGMNumDisparities().c_str(), numDisparities_).c_str());
+	UASSERT_MSG(p1_ > 0 && p2_ > p1_, uFormat("%s=%d %s=%d", Parameters::kStereoSGMP1().c_str(), p1_, Parameters::kStereoSGMP2().c_str(), p2_).c_str());
+	if(p2_ > 4000)
+	{
+		// keep the sum of 8 paths in 16 bits
+		UWARN("%s=%d is too high, set to 4000.", Parameters::kStereoSGMP2().c_str(), p2_);
+		p2_ = 4000;
+	}
+	if(paths_ != 4 && paths_ != 8)
+	{
+		UWARN("%s=%d should be 4 or 8, set to 8.", Parameters::kStereoSGMPaths().c_str(), paths_);
+		paths_ = 8;
+	}
+}
+
+cv::Mat StereoSGM::computeDisparity(
+		const cv::Mat & leftImage,
+		const cv::Mat & rightImage) const
+{
+	UASSERT(!leftImage.empty() && !rightImage.empty());
+	UASSERT(leftImage.cols == rightImage.cols && leftImage.rows == rightImage.rows);
+	UASSERT((leftImage.type() == CV_8UC1 || leftImage.type() == CV_8UC3) && rightImage.type() == CV_8UC1);
+
+	cv::Mat leftMono;
+	if(leftImage.channels() == 3)
+	{
+		cv::cvtColor(leftImage, leftMono, CV_BGR2GRAY);
+	}
+	else
+	{
+		leftMono = leftImage;
+	}
+
+	const int width = leftMono.cols;
+	const int height = leftMono.rows;
+	const int D = numDisparities_;
+
+	std::vector<unsigned long long> censusLeft;
+	std::vector<unsigned long long> censusRight;
+	censusTransform(leftMono, censusLeft);
+	censusTransform(rightImage, censusRight);
+
+	// cost volume, disparities are contiguous for each pixel
+	std::vector<unsigned char> cost(width*height*D);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int y=0; y<height; ++y)
+	{
+		for(int x=0; x<width; ++x)
+		{
+			unsigned long long cl = censusLeft[y*width+x];
+			unsigned char * C = &cost[(y*width+x)*D];
+			for(int d=0; d<D; ++d)
+			{
+				int xr = x - minDisparity_ - d;
+				C[d] = xr>=0 && xr<width?(unsigned char)hammingDistance(cl, censusRight[y*width+xr]):kCensusInvalidCost;
+			}
+		}
+	}
+
+	// aggregation, one parallel pass per direction
+	std::vector<unsigned short> sum(width*height*D, 0);
+	static const int directions[8][2] = {{1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {-1,1}, {1,-1}, {-1,-1}};
+	for(int i=0; i<paths_; ++i)
+	{
+		sgmAggregatePath(&cost[0], &sum[0], width, height, D, directions[i][0], directions[i][1], (unsigned short)p1_, (unsigned short)p2_);
+	}
+
+	// winner-takes-all with uniqueness, sub-pixel and left-right checks
+	const short invalid = (minDisparity_-1)*16;
+	cv::Mat disparity(height, width, CV_16SC1);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int y=0; y<height; ++y)
+	{
+		short * out = disparity.ptr<short>(y);
+		std::vector<int> best(width, -1);
+		std::vector<int> rightBest(width, -1);
+		std::vector<int> rightMin(width, INT_MAX);
+		for(int x=0; x<width; ++x)
+		{
+			const unsigned short * S = &sum[(y*width+x)*D];
+			int bestD = 0;
+			int minS = S[0];
+			for(int d=0; d<D; ++d)
+			{
+				if(S[d] < minS)
+				{
+					minS = S[d];
+					bestD = d;
+				}
+				// best disparity of the right pixel matched by this disparity
+				int xr = x - minDisparity_ - d;
+				if(xr >= 0 && xr < width && S[d] < rightMin[xr])
+				{
+					rightMin[xr] = S[d];
+					rightBest[xr] = d;
+				}
+			}
+
+			out[x] = invalid;
+			int xr = x - minDisparity_ - bestD;
+			if(xr < 0 || xr >= width)
+			{
+				continue;
+			}
+			bool unique = true;
+			for(int d=0; d<D && unique; ++d)
+			{
+				if(S[d]*(100-uniquenessRatio_) < minS*100 && std::abs(bestD - d) > 1)
+				{
+					unique = false;
+				}
+			}
+			if(!unique)
+			{
+				continue;
+			}
+			best[x] = bestD;
+			int d16 = (minDisparity_+bestD)*16;
+			if(bestD > 0 && bestD < D-1)
+			{
+				int denom2 = uMax(S[bestD-1] + S[bestD+1] - 2*S[bestD], 1);
+				d16 += ((S[bestD-1] - S[bestD+1])*16 + denom2)/(denom2*2);
+			}
+			out[x] = (short)d16;
+		}
+
+		if(disp12MaxDiff_ >= 0)
+		{
+			for(int x=0; x<width; ++x)
+			{
+				if(best[x] >= 0)
+				{
+					int xr = x - minDisparity_ - best[x];
+					if(rightBest[xr] < 0 || std::abs(rightBest[xr] - best[x]) > disp12MaxDiff_)
+					{
+						out[x] = invalid;
+					}
+				}
+			}
+		}
+	}
+
+	if(speckleWindowSize_ > 0)
+	{
+		cv::filterSpeckles(disparity, invalid, speckleWindowSize_, speckleRange_*16);
+	}
+
+	return disparity;
+}
+
 } /* namespace rtabmap */
@@ -0,0 +1,710 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rtabmap/core/TSDFVolume.h"
+
+#include <rtabmap/utilite/ULogger.h>
+#include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UStl.h>
+#include <pcl/surface/marching_cubes.h>
+#include <pcl/conversions.h>
+#include <algorithm>
+#include <cmath>
+#include <list>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace rtabmap {
+
+static const int kBlockSize = 8; // voxels per side
+static const int kBlockVoxels = kBlockSize*kBlockSize*kBlockSize;
+
+class TSDFVoxel
+{
+public:
+	TSDFVoxel() : tsdf(1.0f), weight(0.0f), r(0.0f), g(0.0f), b(0.0f) {}
+	float tsdf;
+	float weight;
+	float r;
+	float g;
+	float b;
+};
+
+class TSDFBlock
+{
+public:
+	TSDFBlock(int x, int y, int z) : x_(x), y_(y), z_(z) {}
+	int x_;
+	int y_;
+	int z_;
+	TSDFVoxel voxels_[kBlockVoxels]; // x fastest, then y, then z
+};
+
+/**
+ * Hash table of the allocated blocks, indexed by their integer coordinates.
+ * Allocation is not thread-safe, look-ups are.
+ */
+class TSDFBlockHash
+{
+public:
+	TSDFBlockHash() : buckets_(1<<12, -1) {}
+	~TSDFBlockHash() {clear();}
+
+	void clear()
+	{
+		for(unsigned int i=0; i<blocks_.size(); ++i)
+		{
+			delete blocks_[i];
+		}
+		blocks_.clear();
+		next_.clear();
+		buckets_ = std::vector<int>(1<<12, -1);
+	}
+	int size() const {return (int)blocks_.size();}
+	TSDFBlock * block(int index) const {return blocks_[index];}
+
+	int find(int x, int y, int z) const
+	{
+		for(int i=buckets_[hash(x,y,z) & (buckets_.size()-1)]; i>=0; i=next_[i])
+		{
+			const TSDFBlock * b = blocks_[i];
+			if(b->x_ == x && b->y_ == y && b->z_ == z)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	int allocate(int x, int y, int z)
+	{
+		int index = find(x,y,z);
+		if(index < 0)
+		{
+			index = (int)blocks_.size();
+			blocks_.push_back(new TSDFBlock(x,y,z));
+			int & head = buckets_[hash(x,y,z) & (buckets_.size()-1)];
+			next_.push_back(head);
+			head = index;
+			if(blocks_.size() > buckets_.size()*3/4)
+			{
+				rehash(buckets_.size()*2);
+			}
+		}
+		return index;
+	}
+
+private:
+	static unsigned int hash(int x, int y, int z)
+	{
+		return ((unsigned int)x*73856093u) ^ ((unsigned int)y*19349663u) ^ ((unsigned int)z*83492791u);
+	}
+	void rehash(unsigned int size)
+	{
+		buckets_ = std::vector<int>(size, -1);
+		for(unsigned int i=0; i<blocks_.size(); ++i)
+		{
+			int & head = buckets_[hash(blocks_[i]->x_, blocks_[i]->y_, blocks_[i]->z_) & (size-1)];
+			next_[i] = head;
+			head = (int)i;
+		}
+	}
+
+private:
+	std::vector<int> buckets_; // first block of each bucket
+	std::vector<int> next_;    // next block in the same bucket
+	std::vector<TSDFBlock*> blocks_;
+};
+
+static inline float depthValue(const cv::Mat & depth, int v, int u)
+{
+	return depth.type() == CV_16UC1?float(depth.at<unsigned short>(v,u))*0.001f:depth.at<float>(v,u);
+}
+
+TSDFVolume::TSDFVolume(float voxelSize, float truncationDistance, float maxDepth, bool keepFrames) :
+		voxelSize_(voxelSize),
+		truncationDistance_(truncationDistance),
+		maxDepth_(maxDepth),
+		keepFrames_(keepFrames),
+		blocks_(new TSDFBlockHash())
+{
+	UASSERT(voxelSize_ > 0.0f);
+	UASSERT(truncationDistance_ > 0.0f);
+	UASSERT(maxDepth_ >= 0.0f);
+	if(truncationDistance_ < voxelSize_*2.0f)
+	{
+		UWARN("Truncation distance (%f m) should be at least two times the voxel size (%f m).", truncationDistance_, voxelSize_);
+	}
+}
+
+TSDFVolume::~TSDFVolume()
+{
+	delete blocks_;
+}
+
+void TSDFVolume::clear()
+{
+	blocks_->clear();
+	addedNodes_.clear();
+	frames_.clear();
+}
+
+int TSDFVolume::blocks() const
+{
+	return blocks_->size();
+}
+
+unsigned long TSDFVolume::memoryUsage() const
+{
+	unsigned long memory = blocks_->size()*(sizeof(TSDFBlock)+sizeof(TSDFBlock*)+sizeof(int)*2);
+	for(std::map<int, std::vector<Frame> >::const_iterator iter=frames_.begin(); iter!=frames_.end(); ++iter)
+	{
+		for(unsigned int i=0; i<iter->second.size(); ++i)
+		{
+			memory += iter->second[i].depth.total()*iter->second[i].depth.elemSize();
+			memory += iter->second[i].rgb.total()*iter->second[i].rgb.elemSize();
+		}
+	}
+	return memory;
+}
+
+bool TSDFVolume::integrate(
+		int nodeId,
+		const cv::Mat & depth,
+		const cv::Mat & rgb,
+		const CameraModel & model,
+		const Transform & pose)
+{
+	UASSERT(!pose.isNull());
+	UASSERT(depth.type() == CV_16UC1 || depth.type() == CV_32FC1);
+	UASSERT(rgb.empty() || rgb.type() == CV_8UC3 || rgb.type() == CV_8UC1);
+	if(!model.isValidForProjection() || model.localTransform().isNull())
+	{
+		UERROR("Node %d: camera model is not valid for projection.", nodeId);
+		return false;
+	}
+
+	Frame frame;
+	frame.depth = depth;
+	frame.rgb = rgb;
+	frame.model = model;
+	// the calibration is generally for the RGB image, make it match the depth image
+	int calibrationWidth = model.imageWidth()>0?model.imageWidth():rgb.cols;
+	if(calibrationWidth > 0 && calibrationWidth != depth.cols)
+	{
+		frame.model = model.scaled(double(depth.cols)/double(calibrationWidth));
+	}
+
+	std::vector<Frame> frames;
+	frames.push_back(frame);
+
+	if(addedNodes_.find(nodeId) != addedNodes_.end() && !deintegrate(nodeId))
+	{
+		UWARN("Node %d is already integrated and cannot be deintegrated (frames are not kept), it will be integrated twice.", nodeId);
+	}
+	integrateFrames(frames, pose, 1.0f);
+	if(nodeId > 0)
+	{
+		uInsert(addedNodes_, std::make_pair(nodeId, pose));
+		if(keepFrames_)
+		{
+			uInsert(frames_, std::make_pair(nodeId, frames));
+		}
+	}
+	return true;
+}
+
+bool TSDFVolume::integrate(int nodeId, const SensorData & data, const Transform & pose)
+{
+	cv::Mat depth = data.depthRaw();
+	const std::vector<CameraModel> & models = data.cameraModels();
+	if(depth.empty() || models.empty())
+	{
+		UERROR("Node %d: raw depth image and RGB-D camera models are required (stereo is not supported, depth=%dx%d, models=%d).",
+				nodeId, depth.cols, depth.rows, (int)models.size());
+		return false;
+	}
+	UASSERT(depth.cols % models.size() == 0);
+	const cv::Mat & rgb = data.imageRaw();
+	UASSERT(rgb.empty() || rgb.cols % models.size() == 0);
+
+	if(addedNodes_.find(nodeId) != addedNodes_.end() && !deintegrate(nodeId))
+	{
+		UWARN("Node %d is already integrated and cannot be deintegrated (frames are not kept), it will be integrated twice.", nodeId);
+	}
+
+	// multi-cameras are concatenated horizontally
+	std::vector<Frame> frames;
+	int subDepthWidth = depth.cols/models.size();
+	int subRgbWidth = rgb.cols/models.size();
+	for(unsigned int i=0; i<models.size(); ++i)
+	{
+		if(!models[i].isValidForProjection() || models[i].localTransform().isNull())
+		{
+			UERROR("Node %d: camera model %d is not valid for projection.", nodeId, i);
+			continue;
+		}
+		Frame frame;
+		frame.depth = cv::Mat(depth, cv::Rect(subDepthWidth*i, 0, subDepthWidth, depth.rows));
+		if(!rgb.empty())
+		{
+			frame.rgb = cv::Mat(rgb, cv::Rect(subRgbWidth*i, 0, subRgbWidth, rgb.rows));
+		}
+		frame.model = models[i];
+		int calibrationWidth = models[i].imageWidth()>0?models[i].imageWidth():subRgbWidth;
+		if(calibrationWidth > 0 && calibrationWidth != subDepthWidth)
+		{
+			frame.model = models[i].scaled(double(subDepthWidth)/double(calibrationWidth));
+		}
+		frames.push_back(frame);
+	}
+	if(frames.empty())
+	{
+		return false;
+	}
+
+	integrateFrames(frames, pose, 1.0f);
+	if(nodeId > 0)
+	{
+		uInsert(addedNodes_, std::make_pair(nodeId, pose));
+		if(keepFrames_)
+		{
+			uInsert(frames_, std::make_pair(nodeId, frames));
+		}
+	}
+	return true;
+}
+
+bool TSDFVolume::deintegrate(int nodeId)
+{
+	std::map<int, Transform>::iterator iter = addedNodes_.find(nodeId);
+	std::map<int, std::vector<Frame> >::iterator jter = frames_.find(nodeId);
+	if(iter == addedNodes_.end() || jter == frames_.end())
+	{
+		return false;
+	}
+	integrateFrames(jter->second, iter->second, -1.0f);
+	addedNodes_.erase(iter);
+	frames_.erase(jter);
+	return true;
+}
+
+int TSDFVolume::update(const std::map<int, Transform> & poses, float linearThr, float angularThr)
+{
+	UTimer timer;
+	if(!keepFrames_ && addedNodes_.size())
+	{
+		UERROR("Frames should be kept to update the TSDF volume.");
+		return 0;
+	}
+
+	std::list<int> removed;
+	std::list<std::pair<int, Transform> > moved;
+	for(std::map<int, Transform>::iterator iter=addedNodes_.begin(); iter!=addedNodes_.end(); ++iter)
+	{
+		std::map<int, Transform>::const_iterator jter = poses.find(iter->first);
+		if(jter == poses.end())
+		{
+			removed.push_back(iter->first);
+		}
+		else if(!(jter->second == iter->second))
+		{
+			Transform t = iter->second.inverse() * jter->second;
+			float angle = Eigen::AngleAxisf(t.toEigen3f().linear()).angle();
+			if(t.getNorm() > linearThr || fabs(angle) > angularThr)
+			{
+				moved.push_back(*jter);
+			}
+		}
+	}
+
+	for(std::list<int>::iterator iter=removed.begin(); iter!=removed.end(); ++iter)
+	{
+		deintegrate(*iter);
+	}
+	for(std::list<std::pair<int, Transform> >::iterator iter=moved.begin(); iter!=moved.end(); ++iter)
+	{
+		std::vector<Frame> frames = frames_.at(iter->first);
+		deintegrate(iter->first);
+		integrateFrames(frames, iter->second, 1.0f);
+		addedNodes_.insert(*iter);
+		frames_.insert(std::make_pair(iter->first, frames));
+	}
+	UDEBUG("Deintegrated %d nodes, re-integrated %d nodes (%fs)", (int)removed.size(), (int)moved.size(), timer.ticks());
+	return (int)moved.size();
+}
+
+void TSDFVolume::integrateFrames(const std::vector<Frame> & frames, const Transform & pose, float weight)
+{
+	const float blockMetricSize = voxelSize_*float(kBlockSize);
+	for(unsigned int f=0; f<frames.size(); ++f)
+	{
+		const Frame & frame = frames[f];
+		const cv::Mat & depth = frame.depth;
+		Eigen::Affine3f cameraToWorld = (pose * frame.model.localTransform()).toEigen3f();
+		Eigen::Affine3f worldToCamera = cameraToWorld.inverse();
+		float fx = frame.model.fx();
+		float fy = frame.model.fy();
+		float cx = frame.model.cx();
+		float cy = frame.model.cy();
+
+		// Find blocks in the truncation band of the depth values
+		std::vector<std::vector<long long> > rowKeys(depth.rows);
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for(int v=0; v<depth.rows; ++v)
+		{
+			std::vector<long long> & keys = rowKeys[v];
+			for(int u=0; u<depth.cols; ++u)
+			{
+				float d = depthValue(depth, v, u);
+				if(!(d > 0.0f) || (maxDepth_ > 0.0f && d > maxDepth_))
+				{
+					continue;
+				}
+				float step = blockMetricSize/2.0f;
+				for(float s = d-truncationDistance_; ; s+=step)
+				{
+					s = std::min(s, d+truncationDistance_);
+					if(s > 0.0f)
+					{
+						Eigen::Vector3f pt = cameraToWorld * Eigen::Vector3f((float(u)-cx)*s/fx, (float(v)-cy)*s/fy, s);
+						long long bx = (long long)floor(pt[0]/blockMetricSize);
+						long long by = (long long)floor(pt[1]/blockMetricSize);
+						long long bz = (long long)floor(pt[2]/blockMetricSize);
+						// 21 bits per axis
+						long long key = ((bx+(1<<20)) << 42) | ((by+(1<<20)) << 21) | (bz+(1<<20));
+						if(keys.empty() || keys.back() != key)
+						{
+							keys.push_back(key);
+						}
+					}
+					if(s >= d+truncationDistance_)
+					{
+						break;
+					}
+				}
+			}
+		}
+		std::vector<long long> keys;
+		for(unsigned int i=0; i<rowKeys.size(); ++i)
+		{
+			keys.insert(keys.end(), rowKeys[i].begin(), rowKeys[i].end());
+			std::vector<long long>().swap(rowKeys[i]);
+		}
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+		// Allocate blocks (only look-up when deintegrating)
+		std::vector<TSDFBlock*> visibleBlocks;
+		visibleBlocks.reserve(keys.size());
+		for(unsigned int i=0; i<keys.size(); ++i)
+		{
+			int bx = int((keys[i] >> 42) & 0x1FFFFF) - (1<<20);
+			int by = int((keys[i] >> 21) & 0x1FFFFF) - (1<<20);
+			int bz = int(keys[i] & 0x1FFFFF) - (1<<20);
+			int index = weight>0.0f?blocks_->allocate(bx, by, bz):blocks_->find(bx, by, bz);
+			if(index >= 0)
+			{
+				visibleBlocks.push_back(blocks_->block(index));
+			}
+		}
+
+		// Update voxels, each block is updated by only one thread
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for(int i=0; i<(int)visibleBlocks.size(); ++i)
+		{
+			TSDFBlock * block = visibleBlocks[i];
+			for(int k=0; k<kBlockVoxels; ++k)
+			{
+				int vx = k % kBlockSize;
+				int vy = (k / kBlockSize) % kBlockSize;
+				int vz = k / (kBlockSize*kBlockSize);
+				Eigen::Vector3f pt(
+						float(block->x_*kBlockSize + vx)*voxelSize_,
+						float(block->y_*kBlockSize + vy)*voxelSize_,
+						float(block->z_*kBlockSize + vz)*voxelSize_);
+				pt = worldToCamera * pt;
+				if(pt[2] <= 0.0f)
+				{
+					continue;
+				}
+				int u = int(fx*pt[0]/pt[2] + cx + 0.5f);
+				int v = int(fy*pt[1]/pt[2] + cy + 0.5f);
+				if(u < 0 || u >= depth.cols || v < 0 || v >= depth.rows)
+				{
+					continue;
+				}
+				float d = depthValue(depth, v, u);
+				if(!(d > 0.0f) || (maxDepth_ > 0.0f && d > maxDepth_))
+				{
+					continue;
+				}
+				float sdf = d - pt[2];
+				if(sdf < -truncationDistance_)
+				{
+					continue; // occluded
+				}
+				float tsdf = std::min(1.0f, sdf/truncationDistance_);
+
+				float r=255.0f, g=255.0f, b=255.0f;
+				if(!frame.rgb.empty())
+				{
+					int ru = u*frame.rgb.cols/depth.cols;
+					int rv = v*frame.rgb.rows/depth.rows;
+					if(frame.rgb.channels() == 3)
+					{
+						const unsigned char * bgr = frame.rgb.ptr<unsigned char>(rv, ru);
+						b = bgr[0];
+						g = bgr[1];
+						r = bgr[2];
+					}
+					else
+					{
+						r = g = b = frame.rgb.at<unsigned char>(rv, ru);
+					}
+				}
+
+				TSDFVoxel & voxel = block->voxels_[k];
+				float newWeight = voxel.weight + weight;
+				if(newWeight <= 0.0f)
+				{
+					voxel = TSDFVoxel();
+				}
+				else
+				{
+					voxel.tsdf = (voxel.tsdf*voxel.weight + tsdf*weight)/newWeight;
+					voxel.r = (voxel.r*voxel.weight + r*weight)/newWeight;
+					voxel.g = (voxel.g*voxel.weight + g*weight)/newWeight;
+					voxel.b = (voxel.b*voxel.weight + b*weight)/newWeight;
+					voxel.weight = newWeight;
+				}
+			}
+		}
+		UDEBUG("%s frame %d/%d: %d blocks updated (total=%d)", weight>0.0f?"Integrated":"Deintegrated", f+1, (int)frames.size(), (int)visibleBlocks.size(), blocks_->size());
+	}
+}
+
+// Vertex of the mesh on an edge of the grid
+class TSDFMeshVertex
+{
+public:
+	long long key;
+	pcl::PointXYZRGBNormal pt;
+};
+
+pcl::PolygonMesh::Ptr TSDFVolume::extractMesh(float minWeight) const
+{
+	UTimer timer;
+	// Corners of a cube (same order than pcl::MarchingCubes tables)
+	static const int corners[8][3] = {{0,0,0}, {1,0,0}, {1,0,1}, {0,0,1}, {0,1,0}, {1,1,0}, {1,1,1}, {0,1,1}};
+	static const int edges[12][2] = {{0,1}, {1,2}, {2,3}, {3,0}, {4,5}, {5,6}, {6,7}, {7,4}, {0,4}, {1,5}, {2,6}, {3,7}};
+
+	std::vector<std::vector<TSDFMeshVertex> > blockVertices(blocks_->size());
+	std::vector<std::vector<pcl::Vertices> > blockPolygons(blocks_->size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int b=0; b<blocks_->size(); ++b)
+	{
+		const TSDFBlock * block = blocks_->block(b);
+		// the cubes on the positive borders use voxels of the neighbor blocks
+		const TSDFBlock * neighbors[8];
+		for(int n=0; n<8; ++n)
+		{
+			int index = blocks_->find(block->x_+(n&1), block->y_+((n>>1)&1), block->z_+((n>>2)&1));
+			neighbors[n] = index>=0?blocks_->block(index):0;
+		}
+
+		std::vector<TSDFMeshVertex> & vertices = blockVertices[b];
+		std::vector<pcl::Vertices> & polygons = blockPolygons[b];
+		std::map<long long, int> vertexIndices;
+		for(int k=0; k<kBlockVoxels; ++k)
+		{
+			int vx = k % kBlockSize;
+			int vy = (k / kBlockSize) % kBlockSize;
+			int vz = k / (kBlockSize*kBlockSize);
+
+			const TSDFVoxel * cube[8];
+			int cubeIndex = 0;
+			bool valid = true;
+			for(int c=0; c<8 && valid; ++c)
+			{
+				int x = vx + corners[c][0];
+				int y = vy + corners[c][1];
+				int z = vz + corners[c][2];
+				const TSDFBlock * nb = neighbors[(x/kBlockSize) | ((y/kBlockSize)<<1) | ((z/kBlockSize)<<2)];
+				if(nb == 0)
+				{
+					valid = false;
+					break;
+				}
+				cube[c] = &nb->voxels_[(x%kBlockSize) + (y%kBlockSize)*kBlockSize + (z%kBlockSize)*kBlockSize*kBlockSize];
+				if(cube[c]->weight <= minWeight || cube[c]->weight <= 0.0f)
+				{
+					valid = false;
+				}
+				else if(cube[c]->tsdf < 0.0f)
+				{
+					cubeIndex |= 1 << c;
+				}
+			}
+			if(!valid || pcl::edgeTable[cubeIndex] == 0)
+			{
+				continue;
+			}
+
+			// gradient of the cube (pointing outside the surface), to orient the triangles
+			Eigen::Vector3f gradient(0,0,0);
+			for(int c=0; c<8; ++c)
+			{
+				gradient += Eigen::Vector3f(corners[c][0]-0.5f, corners[c][1]-0.5f, corners[c][2]-0.5f)*cube[c]->tsdf;
+			}
+
+			int edgeVertices[12];
+			for(int e=0; e<12; ++e)
+			{
+				if((pcl::edgeTable[cubeIndex] & (1<<e)) == 0)
+				{
+					continue;
+				}
+				int ca = edges[e][0];
+				int cb = edges[e][1];
+				// the edge is identified by its lower corner and its axis
+				int gx = block->x_*kBlockSize + vx + std::min(corners[ca][0], corners[cb][0]);
+				int gy = block->y_*kBlockSize + vy + std::min(corners[ca][1], corners[cb][1]);
+				int gz = block->z_*kBlockSize + vz + std::min(corners[ca][2], corners[cb][2]);
+				int axis = corners[ca][0]!=corners[cb][0]?0:corners[ca][1]!=corners[cb][1]?1:2;
+				// 20 bits per axis
+				long long key = (((long long)(gx+(1<<19))) << 42) | (((long long)(gy+(1<<19))) << 22) | (((long long)(gz+(1<<19))) << 2) | axis;
+
+				std::map<long long, int>::iterator iter = vertexIndices.find(key);
+				if(iter != vertexIndices.end())
+				{
+					edgeVertices[e] = iter->second;
+					continue;
+				}
+
+				const TSDFVoxel & va = *cube[ca];
+				const TSDFVoxel & vb = *cube[cb];
+				float t = va.tsdf / (va.tsdf - vb.tsdf);
+				TSDFMeshVertex vertex;
+				vertex.key = key;
+				vertex.pt.x = (float(block->x_*kBlockSize + vx + corners[ca][0]) + t*float(corners[cb][0]-corners[ca][0]))*voxelSize_;
+				vertex.pt.y = (float(block->y_*kBlockSize + vy + corners[ca][1]) + t*float(corners[cb][1]-corners[ca][1]))*voxelSize_;
+				vertex.pt.z = (float(block->z_*kBlockSize + vz + corners[ca][2]) + t*float(corners[cb][2]-corners[ca][2]))*voxelSize_;
+				vertex.pt.r = (unsigned char)std::min(255.0f, va.r + t*(vb.r-va.r) + 0.5f);
+				vertex.pt.g = (unsigned char)std::min(255.0f, va.g + t*(vb.g-va.g) + 0.5f);
+				vertex.pt.b = (unsigned char)std::min(255.0f, va.b + t*(vb.b-va.b) + 0.5f);
+				vertex.pt.normal_x = vertex.pt.normal_y = vertex.pt.normal_z = 0.0f;
+				edgeVertices[e] = (int)vertices.size();
+				vertexIndices.insert(std::make_pair(key, (int)vertices.size()));
+				vertices.push_back(vertex);
+			}
+
+			for(int i=0; pcl::triTable[cubeIndex][i] != -1; i+=3)
+			{
+				pcl::Vertices polygon;
+				polygon.vertices.resize(3);
+				polygon.vertices[0] = edgeVertices[pcl::triTable[cubeIndex][i]];
+				polygon.vertices[1] = edgeVertices[pcl::triTable[cubeIndex][i+1]];
+				polygon.vertices[2] = edgeVertices[pcl::triTable[cubeIndex][i+2]];
+				Eigen::Vector3f p0 = vertices[polygon.vertices[0]].pt.getVector3fMap();
+				Eigen::Vector3f n = (vertices[polygon.vertices[1]].pt.getVector3fMap() - p0).cross(vertices[polygon.vertices[2]].pt.getVector3fMap() - p0);
+				if(n.dot(gradient) < 0.0f)
+				{
+					std::swap(polygon.vertices[1], polygon.vertices[2]);
+					n = -n;
+				}
+				for(int j=0; j<3; ++j)
+				{
+					pcl::PointXYZRGBNormal & pt = vertices[polygon.vertices[j]].pt;
+					pt.normal_x += n[0];
+					pt.normal_y += n[1];
+					pt.normal_z += n[2];
+				}
+				polygons.push_back(polygon);
+			}
+		}
+	}
+	double extractionTime = timer.ticks();
+
+	// Merge blocks, sharing vertices on block borders
+	pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+	std::vector<pcl::Vertices> polygons;
+	std::map<long long, int> vertexIndices;
+	for(unsigned int b=0; b<blockVertices.size(); ++b)
+	{
+		std::vector<int> indices(blockVertices[b].size());
+		for(unsigned int i=0; i<blockVertices[b].size(); ++i)
+		{
+			const TSDFMeshVertex & vertex = blockVertices[b][i];
+			std::pair<std::map<long long, int>::iterator, bool> inserted = vertexIndices.insert(std::make_pair(vertex.key, (int)cloud.size()));
+			if(inserted.second)
+			{
+				cloud.push_back(vertex.pt);
+			}
+			else
+			{
+				pcl::PointXYZRGBNormal & pt = cloud.at(inserted.first->second);
+				pt.normal_x += vertex.pt.normal_x;
+				pt.normal_y += vertex.pt.normal_y;
+				pt.normal_z += vertex.pt.normal_z;
+			}
+			indices[i] = inserted.first->second;
+		}
+		for(unsigned int i=0; i<blockPolygons[b].size(); ++i)
+		{
+			pcl::Vertices polygon = blockPolygons[b][i];
+			for(unsigned int j=0; j<polygon.vertices.size(); ++j)
+			{
+				polygon.vertices[j] = indices[polygon.vertices[j]];
+			}
+			polygons.push_back(polygon);
+		}
+		std::vector<TSDFMeshVertex>().swap(blockVertices[b]);
+		std::vector<pcl::Vertices>().swap(blockPolygons[b]);
+	}
+	for(unsigned int i=0; i<cloud.size(); ++i)
+	{
+		cloud.at(i).getNormalVector3fMap().normalize();
+	}
+
+	pcl::PolygonMesh::Ptr mesh(new pcl::PolygonMesh);
+	pcl::toPCLPointCloud2(cloud, mesh->cloud);
+	mesh->polygons = polygons;
+	UDEBUG("Mesh extracted: %d vertices, %d polygons from %d blocks (marching cubes=%fs, merge=%fs)",
+			(int)cloud.size(), (int)polygons.size(), blocks_->size(), extractionTime, timer.ticks());
+	return mesh;
+}
+
+} /* namespace rtabmap */
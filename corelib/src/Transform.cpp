@@ -38,8 +38,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace rtabmap {
 
-Transform::Transform() : data_(cv::Mat::zeros(3,4,CV_32FC1))
+Transform::Transform()
 {
+	memset(data_, 0, 12*sizeof(float));
 }
 
 // rotation matrix r## and origin o##
@@ -48,10 +49,9 @@ Transform::Transform(
 		float r21, float r22, float r23, float o24,
 		float r31, float r32, float r33, float o34)
 {
-	data_ = (cv::Mat_<float>(3,4) <<
-			r11, r12, r13, o14,
-			r21, r22, r23, o24,
-			r31, r32, r33, o34);
+	data_[0] = r11; data_[1] = r12; data_[2] = r13; data_[3] = o14;
+	data_[4] = r21; data_[5] = r22; data_[6] = r23; data_[7] = o24;
+	data_[8] = r31; data_[9] = r32; data_[10] = r33; data_[11] = o34;
 }
 
 Transform::Transform(const cv::Mat & transformationMatrix)
@@ -59,7 +59,10 @@ Transform::Transform(const cv::Mat & transformationMatrix)
 	UASSERT(transformationMatrix.cols == 4 &&
 			transformationMatrix.rows == 3 &&
 			transformationMatrix.type() == CV_32FC1);
-	data_ = transformationMatrix;
+	for(int i=0; i<3; ++i)
+	{
+		memcpy(data_+i*4, transformationMatrix.ptr<float>(i), 4*sizeof(float));
+	}
 }
 
 Transform::Transform(float x, float y, float z, float roll, float pitch, float yaw)
@@ -68,8 +71,7 @@ Transform::Transform(float x, float y, float z, float roll, float pitch, float y
 	*this = fromEigen3f(t);
 }
 
-Transform::Transform(float x, float y, float z, float qx, float qy, float qz, float qw) :
-		data_(cv::Mat::zeros(3,4,CV_32FC1))
+Transform::Transform(float x, float y, float z, float qx, float qy, float qz, float qw)
 {
 	Eigen::Matrix3f rotation = Eigen::Quaternionf(qw, qx, qy, qz).toRotationMatrix();
 	data()[0] = rotation(0,0);
@@ -94,8 +96,7 @@ Transform::Transform(float x, float y, float theta)
 
 bool Transform::isNull() const
 {
-	return (data_.empty() ||
-			(data()[0] == 0.0f &&
+	return ((data()[0] == 0.0f &&
 			data()[1] == 0.0f &&
 			data()[2] == 0.0f &&
 			data()[3] == 0.0f &&
@@ -156,7 +157,27 @@ float Transform::theta() const
 
 Transform Transform::inverse() const
 {
-	return fromEigen4f(toEigen4f().inverse());
+	// inverse of the 3x3 part with cofactors, then -A^-1 * t
+	const float * a = data_;
+	const float c00 = a[5]*a[10] - a[6]*a[9];
+	const float c01 = a[6]*a[8] - a[4]*a[10];
+	const float c02 = a[4]*a[9] - a[5]*a[8];
+	const float det = a[0]*c00 + a[1]*c01 + a[2]*c02;
+	if(det == 0.0f)
+	{
+		// singular (e.g., null transform)
+		return fromEigen4f(toEigen4f().inverse());
+	}
+	const float s = 1.0f/det;
+	Transform inv(
+			c00*s, (a[2]*a[9] - a[1]*a[10])*s, (a[1]*a[6] - a[2]*a[5])*s, 0.0f,
+			c01*s, (a[0]*a[10] - a[2]*a[8])*s, (a[2]*a[4] - a[0]*a[6])*s, 0.0f,
+			c02*s, (a[1]*a[8] - a[0]*a[9])*s, (a[0]*a[5] - a[1]*a[4])*s, 0.0f);
+	float * b = inv.data_;
+	b[3]  = -(b[0]*a[3] + b[1]*a[7] + b[2]*a[11]);
+	b[7]  = -(b[4]*a[3] + b[5]*a[7] + b[6]*a[11]);
+	b[11] = -(b[8]*a[3] + b[9]*a[7] + b[10]*a[11]);
+	return inv;
 }
 
 Transform Transform::rotation() const
@@ -183,12 +204,12 @@ Transform Transform::to3DoF() const
 
 cv::Mat Transform::rotationMatrix() const
 {
-	return data_.colRange(0, 3).clone();
+	return dataMatrix().colRange(0, 3).clone();
 }
 
 cv::Mat Transform::translationMatrix() const
 {
-	return data_.col(3).clone();
+	return dataMatrix().col(3).clone();
 }
 
 void Transform::getTranslationAndEulerAngles(float & x, float & y, float & z, float & roll, float & pitch, float & yaw) const
@@ -265,7 +286,22 @@ std::string Transform::prettyPrint() const
 
 Transform Transform::operator*(const Transform & t) const
 {
-	return fromEigen4f(toEigen4f()*t.toEigen4f());
+	// [A a] * [B b] = [A*B A*b+a], row by row (written to be vectorized)
+	Transform out;
+	const float * a = data_;
+	const float * b = t.data_;
+	float * o = out.data_;
+	for(int i=0; i<3; ++i)
+	{
+		const float * ai = a + i*4;
+		float * oi = o + i*4;
+		for(int j=0; j<4; ++j)
+		{
+			oi[j] = ai[0]*b[j] + ai[1]*b[4+j] + ai[2]*b[8+j];
+		}
+		oi[3] += ai[3];
+	}
+	return out;
 }
 
 Transform & Transform::operator*=(const Transform & t)
@@ -276,7 +312,7 @@ Transform & Transform::operator*=(const Transform & t)
 
 bool Transform::operator==(const Transform & t) const
 {
-	return memcmp(data_.data, t.data_.data, data_.total() * sizeof(float)) == 0;
+	return memcmp(data_, t.data_, 12 * sizeof(float)) == 0;
 }
 
 bool Transform::operator!=(const Transform & t) const
@@ -227,6 +227,7 @@ namespace clams
     for(size_t i = 0; i < frustums_.size(); ++i)
       for(size_t j = 0; j < frustums_[i].size(); ++j)
         frustums_[i][j] = new DiscreteFrustum(*other.frustums_[i][j]);
+    updateLookupTable();
 
     return *this;
   }
@@ -240,7 +241,9 @@ namespace clams
     height_(height),
     bin_width_(bin_width),
     bin_height_(bin_height),
-    bin_depth_(bin_depth)
+    bin_depth_(bin_depth),
+    lut_bins_(0),
+    lut_bin_depth_(0)
   {
     UASSERT(width_ % bin_width_ == 0);
     UASSERT(height_ % bin_height_ == 0);
@@ -256,6 +259,56 @@ namespace clams
     }
 
     training_samples_ = 0;
+    updateLookupTable();
+  }
+
+  void DiscreteDepthDistortionModel::updateLookupTable()
+  {
+    lut_bins_ = 0;
+    lut_multipliers_.clear();
+    lut_interpolated_.clear();
+    if(frustums_.empty() || num_bins_x_*bin_width_ != width_ || num_bins_y_*bin_height_ != height_)
+      return;
+
+    // all frustums should have the same bins
+    int bins = frustums_[0][0]->num_bins_;
+    double binDepth = frustums_[0][0]->bin_depth_;
+    for(size_t y = 0; y < frustums_.size(); ++y)
+      for(size_t x = 0; x < frustums_[y].size(); ++x)
+        if(frustums_[y][x]->num_bins_ != bins || frustums_[y][x]->bin_depth_ != binDepth)
+        {
+          UWARN("Frustums don't have all the same bins, undistortion will not use the lookup table.");
+          return;
+        }
+
+    lut_multipliers_.resize(num_bins_y_*num_bins_x_*bins);
+    lut_interpolated_.resize(num_bins_y_*num_bins_x_*bins);
+    for(int y = 0; y < num_bins_y_; ++y)
+      for(int x = 0; x < num_bins_x_; ++x)
+        for(int i = 0; i < bins; ++i)
+        {
+          lut_multipliers_[(y*num_bins_x_ + x)*bins + i] = frustums_[y][x]->multipliers_.coeffRef(i);
+          lut_interpolated_[(y*num_bins_x_ + x)*bins + i] = frustums_[y][x]->counts_.coeffRef(i) < 50?0:1;
+        }
+    lut_bins_ = bins;
+    lut_bin_depth_ = binDepth;
+  }
+
+  // Same computation than DiscreteFrustum::interpolatedUndistort(), on a lookup table row
+  static inline double lutUndistort(double z, const float * multipliers, const unsigned char * interpolated, int bins, double binDepth)
+  {
+    int idx = min(bins - 1, (int)floor(z / binDepth));
+    double start = binDepth * idx;
+    int idx1 = z - start < binDepth / 2?idx:idx + 1;
+    int idx0 = idx1 - 1;
+    if(idx0 < 0 || idx1 >= bins || !interpolated[idx0] || !interpolated[idx1])
+      return z * multipliers[idx];
+
+    double z0 = (idx0 + 1) * binDepth - binDepth * 0.5;
+    double coeff1 = (z - z0) / binDepth;
+    double coeff0 = 1.0 - coeff1;
+    double mult = coeff0 * multipliers[idx0] + coeff1 * multipliers[idx1];
+    return z * mult;
   }
 
   void DiscreteDepthDistortionModel::deleteFrustums()
@@ -278,7 +331,36 @@ namespace clams
     UASSERT(width_ == depth.cols);
     UASSERT(height_ ==depth.rows);
     UASSERT(depth.type() == CV_16UC1 || depth.type() == CV_32FC1);
-    if(depth.type() == CV_32FC1)
+    if(lut_bins_ > 0)
+    {
+      // rows in parallel, each bin uses a contiguous segment of the lookup table
+      const bool isFloat = depth.type() == CV_32FC1;
+		#pragma omp parallel for
+		for(int v = 0; v < height_; ++v) {
+		  const int rowOffset = (v / bin_height_) * num_bins_x_;
+		  for(int x = 0; x < num_bins_x_; ++x) {
+			const float * multipliers = &lut_multipliers_[(rowOffset + x) * lut_bins_];
+			const unsigned char * interpolated = &lut_interpolated_[(rowOffset + x) * lut_bins_];
+			if(isFloat) {
+			  float * z = depth.ptr<float>(v) + x * bin_width_;
+			  for(int u = 0; u < bin_width_; ++u) {
+				if(uIsNan(z[u]) || z[u] == 0.0f)
+				  continue;
+				z[u] = lutUndistort(z[u], multipliers, interpolated, lut_bins_, lut_bin_depth_);
+			  }
+			}
+			else {
+			  unsigned short * z = depth.ptr<unsigned short>(v) + x * bin_width_;
+			  for(int u = 0; u < bin_width_; ++u) {
+				if(z[u] == 0)
+				  continue;
+				z[u] = lutUndistort(z[u] * 0.001, multipliers, interpolated, lut_bins_, lut_bin_depth_)*1000;
+			  }
+			}
+		  }
+		}
+    }
+    else if(depth.type() == CV_32FC1)
     {
 		#pragma omp parallel for
 		for(int v = 0; v < height_; ++v) {
@@ -310,7 +392,17 @@ namespace clams
 
   void DiscreteDepthDistortionModel::addExample(int v, int u, double ground_truth, double measurement)
   {
-    frustum(v, u).addExample(ground_truth, measurement);
+    DiscreteFrustum & f = frustum(v, u);
+    f.addExample(ground_truth, measurement);
+    if(lut_bins_ > 0)
+    {
+      int offset = ((v / bin_height_)*num_bins_x_ + u / bin_width_)*lut_bins_;
+      for(int i = 0; i < lut_bins_; ++i)
+      {
+        lut_multipliers_[offset + i] = f.multipliers_.coeffRef(i);
+        lut_interpolated_[offset + i] = f.counts_.coeffRef(i) < 50?0:1;
+      }
+    }
   }
 
   size_t DiscreteDepthDistortionModel::accumulate(const cv::Mat& ground_truth,
@@ -344,6 +436,12 @@ namespace clams
 
     training_samples_ += num_training_examples;
 
+    if(num_training_examples)
+    {
+      UScopeMutex sm(mutex_);
+      updateLookupTable();
+    }
+
     return num_training_examples;
   }
 
@@ -452,6 +550,7 @@ namespace clams
           frustums_[y][x]->deserialize(in, ascii);
         }
       }
+      updateLookupTable();
       UDEBUG("");
     }
 
@@ -40,6 +40,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <pcl/common/centroid.h>
 #include <pcl/common/io.h>
 
+#include <algorithm>
+#include <climits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace rtabmap
 {
 
@@ -136,6 +143,50 @@ void occupancy2DFromLaserScan(
 	obstacles = scanHit.clone();
 }
 
+// Transform a local occupancy map (1 row, 2 or 3 channels) in 2D map frame (CV_32FC2)
+static cv::Mat transformLocalMap2D(const cv::Mat & localMap, const Transform & pose)
+{
+	cv::Mat output;
+	if(localMap.cols)
+	{
+		output = cv::Mat(1, localMap.cols, CV_32FC2);
+		for(int i=0; i<output.cols; ++i)
+		{
+			const float * vi = localMap.ptr<float>(0,i);
+			float * vo = output.ptr<float>(0,i);
+			cv::Point3f vt;
+			if(localMap.channels() > 2)
+			{
+				vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], vi[2]), pose);
+			}
+			else
+			{
+				vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], 0), pose);
+			}
+			vo[0] = vt.x;
+			vo[1] = vt.y;
+		}
+	}
+	return output;
+}
+
+static void updateMinMax2D(const cv::Mat & points, float & minX, float & minY, float & maxX, float & maxY)
+{
+	for(int i=0; i<points.cols; ++i)
+	{
+		const float * vo = points.ptr<float>(0,i);
+		if(minX > vo[0])
+			minX = vo[0];
+		else if(maxX < vo[0])
+			maxX = vo[0];
+
+		if(minY > vo[1])
+			minY = vo[1];
+		else if(maxY < vo[1])
+			maxY = vo[1];
+	}
+}
+
 /**
  * Create 2d Occupancy grid (CV_8S) from 2d occupancy
  * -1 = unknown
@@ -180,8 +231,39 @@ cv::Mat create2DMapFromOccupancyLocalMaps(
 		}
 	}
 
+	// transform the local maps in parallel
+	std::vector<const std::pair<cv::Mat, cv::Mat> *> localMaps;
+	std::vector<const Transform *> localMapPoses;
+	for(std::list<std::pair<int, Transform> >::const_iterator iter = poses.begin(); iter!=poses.end(); ++iter)
+	{
+		std::map<int, std::pair<cv::Mat, cv::Mat> >::const_iterator jter = occupancy.find(iter->first);
+		if(jter != occupancy.end())
+		{
+			if((jter->second.first.rows > 1 && jter->second.first.cols == 1) ||
+			   (jter->second.second.rows > 1 && jter->second.second.cols == 1))
+			{
+				UFATAL("Occupancy local maps should be 1 row and X cols! (rows=%d cols=%d, rows=%d cols=%d)",
+						jter->second.first.rows, jter->second.first.cols, jter->second.second.rows, jter->second.second.cols);
+			}
+			UASSERT(!iter->second.isNull());
+			localMaps.push_back(&jter->second);
+			localMapPoses.push_back(&iter->second);
+		}
+	}
+	std::vector<cv::Mat> transformedGrounds(localMaps.size());
+	std::vector<cv::Mat> transformedObstacles(localMaps.size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(localMaps.size() > 1)
+#endif
+	for(int i=0; i<(int)localMaps.size(); ++i)
+	{
+		transformedGrounds[i] = transformLocalMap2D(localMaps[i]->first, *localMapPoses[i]);
+		transformedObstacles[i] = transformLocalMap2D(localMaps[i]->second, *localMapPoses[i]);
+	}
+
 	float minX=-minMapSize/2.0, minY=-minMapSize/2.0, maxX=minMapSize/2.0, maxY=minMapSize/2.0;
 	bool undefinedSize = minMapSize == 0.0f;
+	int k=0;
 	for(std::list<std::pair<int, Transform> >::const_iterator iter = poses.begin(); iter!=poses.end(); ++iter)
 	{
 		UASSERT(!iter->second.isNull());
@@ -207,81 +289,21 @@ cv::Mat create2DMapFromOccupancyLocalMaps(
 				maxY = y;
 		}
 
-		if(uContains(occupancy, iter->first))
+		std::map<int, std::pair<cv::Mat, cv::Mat> >::const_iterator jter = occupancy.find(iter->first);
+		if(jter != occupancy.end())
 		{
-			const std::pair<cv::Mat, cv::Mat> & pair = occupancy.at(iter->first);
-
-			//ground
-			if(pair.first.cols)
+			UASSERT(k < (int)localMaps.size() && localMaps[k] == &jter->second);
+			updateMinMax2D(transformedGrounds[k], minX, minY, maxX, maxY);
+			updateMinMax2D(transformedObstacles[k], minX, minY, maxX, maxY);
+			if(transformedGrounds[k].cols)
 			{
-				if(pair.first.rows > 1 && pair.first.cols == 1)
-				{
-					UFATAL("Occupancy local maps should be 1 row and X cols! (rows=%d cols=%d)", pair.first.rows, pair.first.cols);
-				}
-				cv::Mat ground(1, pair.first.cols, CV_32FC2);
-				for(int i=0; i<ground.cols; ++i)
-				{
-					const float * vi = pair.first.ptr<float>(0,i);
-					float * vo = ground.ptr<float>(0,i);
-					cv::Point3f vt;
-					if(pair.first.channels() > 2)
-					{
-						vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], vi[2]), iter->second);
-					}
-					else
-					{
-						vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], 0), iter->second);
-					}
-					vo[0] = vt.x;
-					vo[1] = vt.y;
-					if(minX > vo[0])
-						minX = vo[0];
-					else if(maxX < vo[0])
-						maxX = vo[0];
-
-					if(minY > vo[1])
-						minY = vo[1];
-					else if(maxY < vo[1])
-						maxY = vo[1];
-				}
-				emptyLocalMaps.insert(std::make_pair(iter->first, ground));
+				emptyLocalMaps.insert(std::make_pair(iter->first, transformedGrounds[k]));
 			}
-
-			//obstacles
-			if(pair.second.cols)
+			if(transformedObstacles[k].cols)
 			{
-				if(pair.second.rows > 1 && pair.second.cols == 1)
-				{
-					UFATAL("Occupancy local maps should be 1 row and X cols! (rows=%d cols=%d)", pair.second.rows, pair.second.cols);
-				}
-				cv::Mat obstacles(1, pair.second.cols, CV_32FC2);
-				for(int i=0; i<obstacles.cols; ++i)
-				{
-					const float * vi = pair.second.ptr<float>(0,i);
-					float * vo = obstacles.ptr<float>(0,i);
-					cv::Point3f vt;
-					if(pair.second.channels() > 2)
-					{
-						vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], vi[2]), iter->second);
-					}
-					else
-					{
-						vt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], 0), iter->second);
-					}
-					vo[0] = vt.x;
-					vo[1] = vt.y;
-					if(minX > vo[0])
-						minX = vo[0];
-					else if(maxX < vo[0])
-						maxX = vo[0];
-
-					if(minY > vo[1])
-						minY = vo[1];
-					else if(maxY < vo[1])
-						maxY = vo[1];
-				}
-				occupiedLocalMaps.insert(std::make_pair(iter->first, obstacles));
+				occupiedLocalMaps.insert(std::make_pair(iter->first, transformedObstacles[k]));
 			}
+			++k;
 		}
 	}
 	UDEBUG("timer=%fs", timer.ticks());
@@ -536,6 +558,142 @@ cv::Mat create2DMap(const std::map<int, Transform> & poses,
 			scanMaxRange);
 }
 
+// Walk the cells from start to end (excluding end) and call visitor(index)
+// on each cell that should be set as free, index being the offset of the
+// cell in grid.data. The grid is not modified.
+template<typename Visitor>
+static void rayTraceCells(const cv::Point2i & start, const cv::Point2i & end, const cv::Mat & grid, bool stopOnObstacle, Visitor & visitor)
+{
+	UASSERT_MSG(start.x >= 0 && start.x < grid.cols, uFormat("start.x=%d grid.cols=%d", start.x, grid.cols).c_str());
+	UASSERT_MSG(start.y >= 0 && start.y < grid.rows, uFormat("start.y=%d grid.rows=%d", start.y, grid.rows).c_str());
+	UASSERT_MSG(end.x >= 0 && end.x < grid.cols, uFormat("end.x=%d grid.cols=%d", end.x, grid.cols).c_str());
+	UASSERT_MSG(end.y >= 0 && end.y < grid.rows, uFormat("end.x=%d grid.cols=%d", end.y, grid.rows).c_str());
+
+	cv::Point2i ptA, ptB;
+	ptA = start;
+	ptB = end;
+
+	float slope = float(ptB.y - ptA.y)/float(ptB.x - ptA.x);
+
+	bool swapped = false;
+	if(slope<-1.0f || slope>1.0f)
+	{
+		// swap x and y
+		slope = 1.0f/slope;
+
+		int tmp = ptA.x;
+		ptA.x = ptA.y;
+		ptA.y = tmp;
+
+		tmp = ptB.x;
+		ptB.x = ptB.y;
+		ptB.y = tmp;
+
+		swapped = true;
+	}
+
+	float b = ptA.y - slope*ptA.x;
+	for(int x=ptA.x; ptA.x<ptB.x?x<ptB.x:x>ptB.x; ptA.x<ptB.x?++x:--x)
+	{
+		int upperbound = float(x)*slope + b;
+		int lowerbound = upperbound;
+		if(x != ptA.x)
+		{
+			lowerbound = (ptA.x<ptB.x?x+1:x-1)*slope + b;
+		}
+
+		if(lowerbound > upperbound)
+		{
+			int tmp = upperbound;
+			upperbound = lowerbound;
+			lowerbound = tmp;
+		}
+
+		if(!swapped)
+		{
+			UASSERT_MSG(lowerbound >= 0 && lowerbound < grid.rows, uFormat("lowerbound=%f grid.rows=%d x=%d slope=%f b=%f x=%f", lowerbound, grid.rows, x, slope, b, x).c_str());
+			UASSERT_MSG(upperbound >= 0 && upperbound < grid.rows, uFormat("upperbound=%f grid.rows=%d x+1=%d slope=%f b=%f x=%f", upperbound, grid.rows, x+1, slope, b, x).c_str());
+		}
+		else
+		{
+			UASSERT_MSG(lowerbound >= 0 && lowerbound < grid.cols, uFormat("lowerbound=%f grid.cols=%d x=%d slope=%f b=%f x=%f", lowerbound, grid.cols, x, slope, b, x).c_str());
+			UASSERT_MSG(upperbound >= 0 && upperbound < grid.cols, uFormat("upperbound=%f grid.cols=%d x+1=%d slope=%f b=%f x=%f", upperbound, grid.cols, x+1, slope, b, x).c_str());
+		}
+
+		for(int y = lowerbound; y<=(int)upperbound; ++y)
+		{
+			int index;
+			if(swapped)
+			{
+				index = x*grid.step[0] + y;
+			}
+			else
+			{
+				index = y*grid.step[0] + x;
+			}
+			if(grid.data[index] == 100 && stopOnObstacle)
+			{
+				return;
+			}
+			else
+			{
+				visitor(index);
+			}
+		}
+	}
+}
+
+class RayTraceFreeSetter
+{
+public:
+	RayTraceFreeSetter(cv::Mat & grid) : data_((char*)grid.data) {}
+	void operator()(int index) {data_[index] = 0;} // free space
+private:
+	char * data_;
+};
+
+class RayTraceCellsCollector
+{
+public:
+	RayTraceCellsCollector(std::vector<int> & cells) : cells_(cells) {}
+	void operator()(int index) {cells_.push_back(index);}
+private:
+	std::vector<int> & cells_;
+};
+
+// Trace in parallel the rays from start to each end point (same as rayTrace()
+// with stopOnObstacle=true), without modifying the grid: cells[i] are the
+// cells that would be set free by the ray to ends[i]. As rays only set cells
+// free and stop on obstacles, they can be applied afterwards in any order.
+static void rayTraceCellsParallel(
+		const cv::Point2i & start,
+		const std::vector<cv::Point2i> & ends,
+		const cv::Mat & grid,
+		std::vector<std::vector<int> > & cells)
+{
+	cells.resize(ends.size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 32) if(ends.size() > 64)
+#endif
+	for(int i=0; i<(int)ends.size(); ++i)
+	{
+		cells[i].clear();
+		if(ends[i] != start)
+		{
+			RayTraceCellsCollector collector(cells[i]);
+			rayTraceCells(start, ends[i], grid, true, collector);
+		}
+	}
+}
+
+static void setFreeCells(const std::vector<int> & cells, cv::Mat & grid)
+{
+	for(unsigned int i=0; i<cells.size(); ++i)
+	{
+		grid.data[cells[i]] = 0; // free space
+	}
+}
+
 /**
  * Create 2d Occupancy grid (CV_8S)
  * -1 = unknown
@@ -646,32 +804,33 @@ cv::Mat create2DMap(const std::map<int, Transform> & poses,
 				}
 			}
 
-			// ray tracing for hits
+			// ray tracing of hits and no hits, the obstacles of the map don't change until the next scan
+			std::vector<cv::Point2i> ends(iter->second.first.cols + iter->second.second.cols);
 			for(int i=0; i<iter->second.first.cols; ++i)
 			{
 				const float * ptr = iter->second.first.ptr<float>(0, i);
-				cv::Point2i end((ptr[0]-xMin)/cellSize, (ptr[1]-yMin)/cellSize);
-				if(end!=start)
-				{
-					if(localScans.size() > 1 || map.at<char>(end.y, end.x) != 0)
-					{
-						rayTrace(start, end, map, true); // trace free space
-					}
-				}
+				ends[i] = cv::Point2i((ptr[0]-xMin)/cellSize, (ptr[1]-yMin)/cellSize);
 			}
-			// ray tracing for no hits
 			for(int i=0; i<iter->second.second.cols; ++i)
 			{
 				const float * ptr = iter->second.second.ptr<float>(0, i);
-				cv::Point2i end((ptr[0]-xMin)/cellSize, (ptr[1]-yMin)/cellSize);
+				ends[iter->second.first.cols+i] = cv::Point2i((ptr[0]-xMin)/cellSize, (ptr[1]-yMin)/cellSize);
+			}
+			std::vector<std::vector<int> > rays;
+			rayTraceCellsParallel(start, ends, map, rays);
+
+			// apply the rays in the scan order
+			for(int i=0; i<(int)ends.size(); ++i)
+			{
+				const cv::Point2i & end = ends[i];
 				if(end!=start)
 				{
 					if(localScans.size() > 1 || map.at<char>(end.y, end.x) != 0)
 					{
-						rayTrace(start, end, map, true); // trace free space
-						if(map.at<char>(end.y, end.x) == -1)
+						setFreeCells(rays[i], map); // trace free space
+						if(i >= iter->second.first.cols && map.at<char>(end.y, end.x) == -1)
 						{
-							map.at<char>(end.y, end.x) = 0; // empty
+							map.at<char>(end.y, end.x) = 0; // empty (no hit)
 						}
 					}
 				}
@@ -729,6 +888,7 @@ cv::Mat create2DMap(const std::map<int, Transform> & poses,
 						endLastVector = endLastVector / cv::norm(endLastVector);
 						float angle = (endRotatedVector/normEndRotatedVector).dot(endLastVector);
 						angle = angle<-1.0f?-1.0f:angle>1.0f?1.0f:angle;
+						std::vector<cv::Point2i> ends;
 						while(acos(angle) > M_PI_4 || endRotatedVector.cross(endLastVector).at<float>(2) > 0.0f)
 						{
 							cv::Point2i end((endRotated.at<float>(0)-xMin)/cellSize, (endRotated.at<float>(1)-yMin)/cellSize);
@@ -737,7 +897,7 @@ cv::Mat create2DMap(const std::map<int, Transform> & poses,
 							end.x = end.x >= map.cols?map.cols-1:end.x;
 							end.y = end.y < 0?0:end.y;
 							end.y = end.y >= map.rows?map.rows-1:end.y;
-							rayTrace(start, end, map, true); // trace free space
+							ends.push_back(end);
 							// next point
 							endRotated = rotation*(endRotated - origin) + origin;
 							endRotatedVector.at<float>(0) = endRotated.at<float>(0) - origin.at<float>(0);
@@ -751,6 +911,14 @@ cv::Mat create2DMap(const std::map<int, Transform> & poses,
 							//		angle,
 							//		endRotatedVector.cross(endLastVector).at<float>(2));
 						}
+
+						// trace free space
+						std::vector<std::vector<int> > rays;
+						rayTraceCellsParallel(start, ends, map, rays);
+						for(unsigned int i=0; i<rays.size(); ++i)
+						{
+							setFreeCells(rays[i], map);
+						}
 					}
 				}
 				++j;
@@ -765,83 +933,8 @@ cv::Mat create2DMap(const std::map<int, Transform> & poses,
 
 void rayTrace(const cv::Point2i & start, const cv::Point2i & end, cv::Mat & grid, bool stopOnObstacle)
 {
-	UASSERT_MSG(start.x >= 0 && start.x < grid.cols, uFormat("start.x=%d grid.cols=%d", start.x, grid.cols).c_str());
-	UASSERT_MSG(start.y >= 0 && start.y < grid.rows, uFormat("start.y=%d grid.rows=%d", start.y, grid.rows).c_str());
-	UASSERT_MSG(end.x >= 0 && end.x < grid.cols, uFormat("end.x=%d grid.cols=%d", end.x, grid.cols).c_str());
-	UASSERT_MSG(end.y >= 0 && end.y < grid.rows, uFormat("end.x=%d grid.cols=%d", end.y, grid.rows).c_str());
-
-	cv::Point2i ptA, ptB;
-	ptA = start;
-	ptB = end;
-
-	float slope = float(ptB.y - ptA.y)/float(ptB.x - ptA.x);
-
-	bool swapped = false;
-	if(slope<-1.0f || slope>1.0f)
-	{
-		// swap x and y
-		slope = 1.0f/slope;
-
-		int tmp = ptA.x;
-		ptA.x = ptA.y;
-		ptA.y = tmp;
-
-		tmp = ptB.x;
-		ptB.x = ptB.y;
-		ptB.y = tmp;
-
-		swapped = true;
-	}
-
-	float b = ptA.y - slope*ptA.x;
-	for(int x=ptA.x; ptA.x<ptB.x?x<ptB.x:x>ptB.x; ptA.x<ptB.x?++x:--x)
-	{
-		int upperbound = float(x)*slope + b;
-		int lowerbound = upperbound;
-		if(x != ptA.x)
-		{
-			lowerbound = (ptA.x<ptB.x?x+1:x-1)*slope + b;
-		}
-
-		if(lowerbound > upperbound)
-		{
-			int tmp = upperbound;
-			upperbound = lowerbound;
-			lowerbound = tmp;
-		}
-
-		if(!swapped)
-		{
-			UASSERT_MSG(lowerbound >= 0 && lowerbound < grid.rows, uFormat("lowerbound=%f grid.rows=%d x=%d slope=%f b=%f x=%f", lowerbound, grid.rows, x, slope, b, x).c_str());
-			UASSERT_MSG(upperbound >= 0 && upperbound < grid.rows, uFormat("upperbound=%f grid.rows=%d x+1=%d slope=%f b=%f x=%f", upperbound, grid.rows, x+1, slope, b, x).c_str());
-		}
-		else
-		{
-			UASSERT_MSG(lowerbound >= 0 && lowerbound < grid.cols, uFormat("lowerbound=%f grid.cols=%d x=%d slope=%f b=%f x=%f", lowerbound, grid.cols, x, slope, b, x).c_str());
-			UASSERT_MSG(upperbound >= 0 && upperbound < grid.cols, uFormat("upperbound=%f grid.cols=%d x+1=%d slope=%f b=%f x=%f", upperbound, grid.cols, x+1, slope, b, x).c_str());
-		}
-
-		for(int y = lowerbound; y<=(int)upperbound; ++y)
-		{
-			char * v;
-			if(swapped)
-			{
-				v = &grid.at<char>(x, y);
-			}
-			else
-			{
-				v = &grid.at<char>(y, x);
-			}
-			if(*v == 100 && stopOnObstacle)
-			{
-				return;
-			}
-			else
-			{
-				*v = 0; // free space
-			}
-		}
-	}
+	RayTraceFreeSetter setter(grid);
+	rayTraceCells(start, end, grid, stopOnObstacle, setter);
 }
 
 //convert to gray scaled map
@@ -906,6 +999,170 @@ cv::Mat erodeMap(const cv::Mat & map)
 	return erodedMap;
 }
 
+static bool cellLess(const cv::Vec3s & a, const cv::Vec3s & b)
+{
+	// sorted by z, y then x so that consecutive cells along x are contiguous
+	return a[2]<b[2] || (a[2]==b[2] && (a[1]<b[1] || (a[1]==b[1] && a[0]<b[0])));
+}
+
+cv::Mat encodeLocalMapCells(const cv::Mat & points, float cellSize, bool runLength)
+{
+	UASSERT(cellSize > 0.0f);
+	if(points.empty())
+	{
+		return cv::Mat();
+	}
+	UASSERT_MSG(points.type() == CV_32FC2 || points.type() == CV_32FC3,
+			uFormat("Only 2D or 3D points can be encoded (type=%d)", points.type()).c_str());
+	UASSERT_MSG(points.rows == 1, uFormat("Occupancy local maps should be 1 row and X cols! (rows=%d cols=%d)", points.rows, points.cols).c_str());
+	bool is3D = points.channels() == 3;
+
+	std::vector<cv::Vec3s> cells(points.cols);
+	for(int i=0; i<points.cols; ++i)
+	{
+		const float * p = points.ptr<float>(0, i);
+		float x = floor(p[0]/cellSize+0.5f);
+		float y = floor(p[1]/cellSize+0.5f);
+		float z = is3D?floor(p[2]/cellSize+0.5f):0.0f;
+		if(x < SHRT_MIN || x > SHRT_MAX ||
+		   y < SHRT_MIN || y > SHRT_MAX ||
+		   z < SHRT_MIN || z > SHRT_MAX)
+		{
+			UWARN("Point (%f,%f,%f) is too far from the node origin to be encoded with cell size %f m, the local map is kept uncompressed.",
+					p[0], p[1], is3D?p[2]:0.0f, cellSize);
+			return points;
+		}
+		cells[i] = cv::Vec3s((short)x, (short)y, (short)z);
+	}
+	std::sort(cells.begin(), cells.end(), cellLess);
+	cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+	if(!is3D && !runLength)
+	{
+		cv::Mat output(1, (int)cells.size(), CV_16SC2);
+		for(unsigned int i=0; i<cells.size(); ++i)
+		{
+			short * o = output.ptr<short>(0, i);
+			o[0] = cells[i][0];
+			o[1] = cells[i][1];
+		}
+		return output;
+	}
+
+	int channels = is3D?4:3;
+	cv::Mat output(1, (int)cells.size(), CV_16SC(channels));
+	int oi = 0;
+	short * run = 0;
+	for(unsigned int i=0; i<cells.size(); ++i)
+	{
+		if(run &&
+		   runLength &&
+		   cells[i][1] == run[1] &&
+		   cells[i][2] == cells[i-1][2] &&
+		   cells[i][0] == cells[i-1][0]+1 &&
+		   run[channels-1] < SHRT_MAX)
+		{
+			++run[channels-1];
+		}
+		else
+		{
+			run = output.ptr<short>(0, oi++);
+			run[0] = cells[i][0];
+			run[1] = cells[i][1];
+			if(is3D)
+			{
+				run[2] = cells[i][2];
+			}
+			run[channels-1] = 1;
+		}
+	}
+	UDEBUG("Encoded %d points in %d cells (%d runs)", points.cols, (int)cells.size(), oi);
+	return cv::Mat(output, cv::Range::all(), cv::Range(0, oi)).clone();
+}
+
+cv::Mat decodeLocalMapCells(const cv::Mat & cells, float cellSize, const Transform & transform)
+{
+	if(cells.empty())
+	{
+		return cv::Mat();
+	}
+	UASSERT_MSG(cells.rows == 1, uFormat("Occupancy local maps should be 1 row and X cols! (rows=%d cols=%d)", cells.rows, cells.cols).c_str());
+	bool transformed = !transform.isNull() && !transform.isIdentity();
+
+	if(cells.depth() == CV_32F)
+	{
+		UASSERT(cells.channels() == 2 || cells.channels() == 3);
+		if(!transformed)
+		{
+			return cells;
+		}
+		cv::Mat output(1, cells.cols, cells.type());
+		for(int i=0; i<cells.cols; ++i)
+		{
+			const float * vi = cells.ptr<float>(0, i);
+			float * vo = output.ptr<float>(0, i);
+			cv::Point3f pt = util3d::transformPoint(cv::Point3f(vi[0], vi[1], cells.channels()==3?vi[2]:0.0f), transform);
+			vo[0] = pt.x;
+			vo[1] = pt.y;
+			if(cells.channels() == 3)
+			{
+				vo[2] = pt.z;
+			}
+		}
+		return output;
+	}
+
+	UASSERT_MSG(cells.type() == CV_16SC2 || cells.type() == CV_16SC3 || cells.type() == CV_16SC4,
+			uFormat("Not an encoded local map (type=%d)", cells.type()).c_str());
+	UASSERT(cellSize > 0.0f);
+	int channels = cells.channels();
+	bool is3D = channels == 4;
+
+	int size = cells.cols;
+	if(channels > 2)
+	{
+		size = 0;
+		for(int i=0; i<cells.cols; ++i)
+		{
+			size += cells.ptr<short>(0, i)[channels-1];
+		}
+	}
+
+	// step along x of the node frame
+	Transform t = transformed?transform:Transform::getIdentity();
+	float stepX = t.r11()*cellSize;
+	float stepY = t.r21()*cellSize;
+	float stepZ = t.r31()*cellSize;
+
+	cv::Mat output(1, size, is3D?CV_32FC3:CV_32FC2);
+	int oi = 0;
+	for(int i=0; i<cells.cols; ++i)
+	{
+		const short * c = cells.ptr<short>(0, i);
+		int length = channels>2?c[channels-1]:1;
+		cv::Point3f pt(float(c[0])*cellSize, float(c[1])*cellSize, is3D?float(c[2])*cellSize:0.0f);
+		if(transformed)
+		{
+			pt = util3d::transformPoint(pt, t);
+		}
+		for(int j=0; j<length; ++j)
+		{
+			float * vo = output.ptr<float>(0, oi++);
+			vo[0] = pt.x;
+			vo[1] = pt.y;
+			if(is3D)
+			{
+				vo[2] = pt.z;
+			}
+			pt.x += stepX;
+			pt.y += stepY;
+			pt.z += stepZ;
+		}
+	}
+	UASSERT(oi == size);
+	return output;
+}
+
 }
 
 }
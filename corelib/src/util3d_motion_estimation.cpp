@@ -39,12 +39,536 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "opencv/solvepnp.h"
 #endif
 
+#include <Eigen/Geometry>
+#include <cfloat>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace rtabmap
 {
 
 namespace util3d
 {
 
+// Built-in RANSAC (see Vis/RansacType)
+static const int kRansacBlock = 64;
+
+// Correspondences stored as structure of arrays, so that the scoring loops are vectorized
+struct RansacPoints
+{
+	RansacPoints(int size) : ax(size), ay(size), az(size), bx(size), by(size), bz(size) {}
+	int size() const {return (int)ax.size();}
+	std::vector<float> ax, ay, az; // 3D points
+	std::vector<float> bx, by, bz; // 2D (bz unused) or 3D points
+};
+
+// Number of iterations to get an outlier-free sample with the given confidence (as cv::RANSACUpdateNumIters())
+static int ransacUpdateIterations(double confidence, double outlierRatio, int modelPoints, int maxIterations)
+{
+	double num = std::log(1.0 - confidence);
+	double denom = 1.0 - std::pow(1.0 - outlierRatio, modelPoints);
+	if(denom < DBL_MIN)
+	{
+		return 0;
+	}
+	denom = std::log(denom);
+	return denom >= 0.0 || -num >= maxIterations*(-denom) ? maxIterations : (int)std::ceil(num/denom);
+}
+
+// Minimal sample of a hypothesis, the same hypothesis index always gives the same sample
+static void ransacSample(int hypothesis, int n, int size, int * sample)
+{
+	cv::RNG rng(0xFFFFFFFF + (uint64)hypothesis*2654435761U);
+	for(int i=0; i<size; ++i)
+	{
+		bool duplicated;
+		do
+		{
+			sample[i] = rng.uniform(0, n);
+			duplicated = false;
+			for(int j=0; j<i && !duplicated; ++j)
+			{
+				duplicated = sample[j] == sample[i];
+			}
+		}
+		while(duplicated);
+	}
+}
+
+// Hypotheses evaluated together, in parallel when OpenMP is available
+static int ransacBatchSize()
+{
+#ifdef _OPENMP
+	return omp_get_max_threads()*2;
+#else
+	return 1;
+#endif
+}
+
+// Count inliers of the camera pose m=[R|t] (world to camera) with reprojection
+// error under the threshold. When inliers is null, scoring stops (returning 0) as soon
+// as the model cannot have more than bestInliers inliers.
+static int ransacScorePnP(
+		const RansacPoints & pts,
+		const float * m,
+		float fx, float fy, float cx, float cy,
+		float thresholdSqr,
+		int bestInliers,
+		std::vector<int> * inliers = 0,
+		std::vector<float> * errors = 0)
+{
+	const int n = pts.size();
+	const int maxOutliers = n - bestInliers;
+	int count = 0;
+	unsigned char in[kRansacBlock];
+	float err[kRansacBlock];
+	for(int start=0; start<n; start+=kRansacBlock)
+	{
+		const int size = std::min(kRansacBlock, n-start);
+		const float * ax = &pts.ax[start];
+		const float * ay = &pts.ay[start];
+		const float * az = &pts.az[start];
+		const float * bx = &pts.bx[start];
+		const float * by = &pts.by[start];
+		int blockCount = 0;
+		for(int i=0; i<size; ++i)
+		{
+			float x = m[0]*ax[i] + m[1]*ay[i] + m[2]*az[i] + m[3];
+			float y = m[4]*ax[i] + m[5]*ay[i] + m[6]*az[i] + m[7];
+			float z = m[8]*ax[i] + m[9]*ay[i] + m[10]*az[i] + m[11];
+			float iz = 1.0f/z;
+			float du = fx*x*iz + cx - bx[i];
+			float dv = fy*y*iz + cy - by[i];
+			err[i] = du*du + dv*dv;
+			in[i] = (z > 0.0f) & (err[i] <= thresholdSqr);
+			blockCount += in[i];
+		}
+		if(inliers)
+		{
+			for(int i=0; i<size; ++i)
+			{
+				if(in[i])
+				{
+					inliers->push_back(start+i);
+					if(errors)
+					{
+						errors->push_back(err[i]);
+					}
+				}
+			}
+		}
+		count += blockCount;
+		if(!inliers && (start+size) - count >= maxOutliers)
+		{
+			return 0;
+		}
+	}
+	return count;
+}
+
+// Same as ransacScorePnP() but for a rigid transform m=[R|t] from points b to points a (3D distance)
+static int ransacScoreRigid(
+		const RansacPoints & pts,
+		const float * m,
+		float thresholdSqr,
+		int bestInliers,
+		std::vector<int> * inliers = 0,
+		std::vector<float> * errors = 0)
+{
+	const int n = pts.size();
+	const int maxOutliers = n - bestInliers;
+	int count = 0;
+	unsigned char in[kRansacBlock];
+	float err[kRansacBlock];
+	for(int start=0; start<n; start+=kRansacBlock)
+	{
+		const int size = std::min(kRansacBlock, n-start);
+		const float * ax = &pts.ax[start];
+		const float * ay = &pts.ay[start];
+		const float * az = &pts.az[start];
+		const float * bx = &pts.bx[start];
+		const float * by = &pts.by[start];
+		const float * bz = &pts.bz[start];
+		int blockCount = 0;
+		for(int i=0; i<size; ++i)
+		{
+			float dx = m[0]*bx[i] + m[1]*by[i] + m[2]*bz[i] + m[3] - ax[i];
+			float dy = m[4]*bx[i] + m[5]*by[i] + m[6]*bz[i] + m[7] - ay[i];
+			float dz = m[8]*bx[i] + m[9]*by[i] + m[10]*bz[i] + m[11] - az[i];
+			err[i] = dx*dx + dy*dy + dz*dz;
+			in[i] = err[i] <= thresholdSqr;
+			blockCount += in[i];
+		}
+		if(inliers)
+		{
+			for(int i=0; i<size; ++i)
+			{
+				if(in[i])
+				{
+					inliers->push_back(start+i);
+					if(errors)
+					{
+						errors->push_back(err[i]);
+					}
+				}
+			}
+		}
+		count += blockCount;
+		if(!inliers && (start+size) - count >= maxOutliers)
+		{
+			return 0;
+		}
+	}
+	return count;
+}
+
+// Built-in PnP RANSAC: EPnP (or P3P) hypotheses are scored in parallel, the number
+// of iterations is updated with the best inlier ratio found (confidence=0.99).
+// Reprojection errors are computed on undistorted image points.
+static void ransacPnP(
+		const std::vector<cv::Point3f> & objectPoints,
+		const std::vector<cv::Point2f> & imagePoints,
+		const cv::Mat & cameraMatrix,
+		const cv::Mat & distCoeffs,
+		cv::Mat & rvec,
+		cv::Mat & tvec,
+		int iterationsCount,
+		float reprojectionError,
+		std::vector<int> & inliers,
+		int flags)
+{
+	UASSERT(objectPoints.size() == imagePoints.size());
+	inliers.clear();
+	const int n = (int)objectPoints.size();
+	const int kernel = flags == 2?2:1; // P3P or EPnP
+	const int modelPoints = kernel == 2?4:5;
+	if(n < modelPoints)
+	{
+		return;
+	}
+
+	std::vector<cv::Point2f> idealPoints = imagePoints;
+	if(!distCoeffs.empty() && cv::countNonZero(distCoeffs))
+	{
+		cv::undistortPoints(imagePoints, idealPoints, cameraMatrix, distCoeffs, cv::noArray(), cameraMatrix);
+	}
+	cv::Mat K;
+	cameraMatrix.convertTo(K, CV_64F);
+	const float fx = K.at<double>(0,0);
+	const float fy = K.at<double>(1,1);
+	const float cx = K.at<double>(0,2);
+	const float cy = K.at<double>(1,2);
+	const float thresholdSqr = reprojectionError*reprojectionError;
+
+	RansacPoints pts(n);
+	for(int i=0; i<n; ++i)
+	{
+		pts.ax[i] = objectPoints[i].x;
+		pts.ay[i] = objectPoints[i].y;
+		pts.az[i] = objectPoints[i].z;
+		pts.bx[i] = idealPoints[i].x;
+		pts.by[i] = idealPoints[i].y;
+	}
+
+	const int batchSize = ransacBatchSize();
+	std::vector<float> models(batchSize*12);
+	std::vector<int> scores(batchSize);
+	float bestModel[12];
+	int bestInliers = 0;
+	int maxIterations = iterationsCount;
+	for(int first=0; first<maxIterations; first+=batchSize)
+	{
+		const int count = std::min(batchSize, maxIterations-first);
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic) if(count>1)
+#endif
+		for(int i=0; i<count; ++i)
+		{
+			scores[i] = 0;
+			int sample[5];
+			ransacSample(first+i, n, modelPoints, sample);
+			std::vector<cv::Point3f> sampleObjectPoints(modelPoints);
+			std::vector<cv::Point2f> sampleImagePoints(modelPoints);
+			for(int j=0; j<modelPoints; ++j)
+			{
+				sampleObjectPoints[j] = objectPoints[sample[j]];
+				sampleImagePoints[j] = idealPoints[sample[j]];
+			}
+			cv::Mat r, t;
+			cv::solvePnP(sampleObjectPoints, sampleImagePoints, K, cv::Mat(), r, t, false, kernel);
+			if(r.total() != 3 || t.total() != 3 || !cv::checkRange(r) || !cv::checkRange(t))
+			{
+				continue;
+			}
+			cv::Mat R;
+			cv::Rodrigues(r, R);
+			float * m = &models[i*12];
+			for(int j=0; j<3; ++j)
+			{
+				m[j*4] = R.at<double>(j,0);
+				m[j*4+1] = R.at<double>(j,1);
+				m[j*4+2] = R.at<double>(j,2);
+				m[j*4+3] = t.at<double>(j);
+			}
+			scores[i] = ransacScorePnP(pts, m, fx, fy, cx, cy, thresholdSqr, bestInliers);
+		}
+		for(int i=0; i<count; ++i)
+		{
+			if(scores[i] > bestInliers)
+			{
+				bestInliers = scores[i];
+				memcpy(bestModel, &models[i*12], 12*sizeof(float));
+			}
+		}
+		if(bestInliers >= modelPoints)
+		{
+			maxIterations = std::min(maxIterations, ransacUpdateIterations(0.99, 1.0-double(bestInliers)/double(n), modelPoints, iterationsCount));
+		}
+	}
+	UDEBUG("RANSAC: iterations=%d/%d inliers=%d/%d", maxIterations, iterationsCount, bestInliers, n);
+
+	if(bestInliers >= modelPoints)
+	{
+		ransacScorePnP(pts, bestModel, fx, fy, cx, cy, thresholdSqr, 0, &inliers);
+
+		// final model estimated on all inliers, starting from the best hypothesis
+		std::vector<cv::Point3f> inlierObjectPoints(inliers.size());
+		std::vector<cv::Point2f> inlierImagePoints(inliers.size());
+		for(unsigned int i=0; i<inliers.size(); ++i)
+		{
+			inlierObjectPoints[i] = objectPoints[inliers[i]];
+			inlierImagePoints[i] = idealPoints[inliers[i]];
+		}
+		cv::Mat R = (cv::Mat_<double>(3,3) <<
+				bestModel[0], bestModel[1], bestModel[2],
+				bestModel[4], bestModel[5], bestModel[6],
+				bestModel[8], bestModel[9], bestModel[10]);
+		cv::Mat r, t = (cv::Mat_<double>(3,1) << bestModel[3], bestModel[7], bestModel[11]);
+		cv::Rodrigues(R, r);
+		cv::solvePnP(inlierObjectPoints, inlierImagePoints, K, cv::Mat(), r, t, true, flags == 2?1:flags);
+		r.reshape(1, rvec.rows).convertTo(rvec, rvec.empty()?CV_64F:rvec.type());
+		t.reshape(1, tvec.rows).convertTo(tvec, tvec.empty()?CV_64F:tvec.type());
+	}
+}
+
+// Built-in 3D->3D RANSAC (transform from pointsB to pointsA), hypotheses are scored in
+// parallel. Model refinement is the same as in util3d::transformFromXYZCorrespondences().
+static Transform ransacRigid(
+		const std::vector<cv::Point3f> & pointsA,
+		const std::vector<cv::Point3f> & pointsB,
+		double inlierThreshold,
+		int iterations,
+		int refineIterations,
+		double refineSigma,
+		std::vector<int> & inliers,
+		double * variance)
+{
+	UASSERT(pointsA.size() == pointsB.size());
+	inliers.clear();
+	const int n = (int)pointsA.size();
+	const int modelPoints = 3;
+	if(n < modelPoints)
+	{
+		UDEBUG("Not enough points to compute the transform");
+		return Transform();
+	}
+
+	RansacPoints pts(n);
+	for(int i=0; i<n; ++i)
+	{
+		pts.ax[i] = pointsA[i].x;
+		pts.ay[i] = pointsA[i].y;
+		pts.az[i] = pointsA[i].z;
+		pts.bx[i] = pointsB[i].x;
+		pts.by[i] = pointsB[i].y;
+		pts.bz[i] = pointsB[i].z;
+	}
+	float thresholdSqr = float(inlierThreshold*inlierThreshold);
+
+	const int batchSize = ransacBatchSize();
+	std::vector<float> models(batchSize*12);
+	std::vector<int> scores(batchSize);
+	float bestModel[12];
+	int bestInliers = 0;
+	int maxIterations = iterations;
+	for(int first=0; first<maxIterations; first+=batchSize)
+	{
+		const int count = std::min(batchSize, maxIterations-first);
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic) if(count>1)
+#endif
+		for(int i=0; i<count; ++i)
+		{
+			scores[i] = 0;
+			int sample[3];
+			ransacSample(first+i, n, modelPoints, sample);
+			Eigen::Matrix3f src, dst;
+			for(int j=0; j<modelPoints; ++j)
+			{
+				src.col(j) = Eigen::Vector3f(pointsB[sample[j]].x, pointsB[sample[j]].y, pointsB[sample[j]].z);
+				dst.col(j) = Eigen::Vector3f(pointsA[sample[j]].x, pointsA[sample[j]].y, pointsA[sample[j]].z);
+			}
+			// degenerated sample (colinear points)
+			if((src.col(1)-src.col(0)).cross(src.col(2)-src.col(0)).squaredNorm() < 1e-12f ||
+			   (dst.col(1)-dst.col(0)).cross(dst.col(2)-dst.col(0)).squaredNorm() < 1e-12f)
+			{
+				continue;
+			}
+			Eigen::Matrix4f T = Eigen::umeyama(src, dst, false);
+			float * m = &models[i*12];
+			for(int j=0; j<3; ++j)
+			{
+				for(int k=0; k<4; ++k)
+				{
+					m[j*4+k] = T(j,k);
+				}
+			}
+			scores[i] = ransacScoreRigid(pts, m, thresholdSqr, bestInliers);
+		}
+		for(int i=0; i<count; ++i)
+		{
+			if(scores[i] > bestInliers)
+			{
+				bestInliers = scores[i];
+				memcpy(bestModel, &models[i*12], 12*sizeof(float));
+			}
+		}
+		if(bestInliers >= modelPoints)
+		{
+			maxIterations = std::min(maxIterations, ransacUpdateIterations(0.99, 1.0-double(bestInliers)/double(n), modelPoints, iterations));
+		}
+	}
+	UDEBUG("RANSAC: iterations=%d/%d inliers=%d/%d", maxIterations, iterations, bestInliers, n);
+
+	if(bestInliers < modelPoints)
+	{
+		UDEBUG("RANSAC: Failed to find model");
+		return Transform();
+	}
+
+	std::vector<float> errors;
+	ransacScoreRigid(pts, bestModel, thresholdSqr, 0, &inliers, &errors);
+
+	if(refineIterations>0)
+	{
+		double error_threshold = inlierThreshold;
+		int refine_iterations = 0;
+		bool inlier_changed = false, oscillating = false;
+		std::vector<int> new_inliers, prev_inliers = inliers;
+		std::vector<float> new_errors;
+		std::vector<size_t> inliers_sizes;
+		float newModel[12];
+		memcpy(newModel, bestModel, 12*sizeof(float));
+		do
+		{
+			// Optimize the model coefficients
+			Eigen::Matrix3Xf src(3, prev_inliers.size()), dst(3, prev_inliers.size());
+			for(unsigned int i=0; i<prev_inliers.size(); ++i)
+			{
+				src.col(i) = Eigen::Vector3f(pts.bx[prev_inliers[i]], pts.by[prev_inliers[i]], pts.bz[prev_inliers[i]]);
+				dst.col(i) = Eigen::Vector3f(pts.ax[prev_inliers[i]], pts.ay[prev_inliers[i]], pts.az[prev_inliers[i]]);
+			}
+			Eigen::Matrix4f T = Eigen::umeyama(src, dst, false);
+			for(int j=0; j<3; ++j)
+			{
+				for(int k=0; k<4; ++k)
+				{
+					newModel[j*4+k] = T(j,k);
+				}
+			}
+			inliers_sizes.push_back (prev_inliers.size ());
+
+			// Select the new inliers based on the optimized coefficients and new threshold
+			new_inliers.clear();
+			new_errors.clear();
+			ransacScoreRigid(pts, newModel, float(error_threshold*error_threshold), 0, &new_inliers, &new_errors);
+			UDEBUG("RANSAC refineModel: Number of inliers found (before/after): %d/%d, with an error threshold of %f.",
+					(int)prev_inliers.size (), (int)new_inliers.size (), error_threshold);
+
+			if ((int)new_inliers.size() < modelPoints)
+			{
+				++refine_iterations;
+				if (refine_iterations >= refineIterations)
+				{
+					break;
+				}
+				continue;
+			}
+
+			// Estimate the variance and the new threshold
+			std::vector<float> sortedErrors = new_errors;
+			std::sort(sortedErrors.begin(), sortedErrors.end());
+			double v = 2.1981 * sortedErrors[sortedErrors.size() >> 1];
+			error_threshold = std::min (inlierThreshold, refineSigma * sqrt(v));
+
+			UDEBUG ("RANSAC refineModel: New estimated error threshold: %f (variance=%f) on iteration %d out of %d.",
+				  error_threshold, v, refine_iterations, refineIterations);
+			inlier_changed = false;
+			std::swap (prev_inliers, new_inliers);
+			errors = new_errors;
+			memcpy(bestModel, newModel, 12*sizeof(float));
+
+			// If the number of inliers changed, then we are still optimizing
+			if (new_inliers.size () != prev_inliers.size ())
+			{
+				// Check if the number of inliers is oscillating in between two values
+				if (inliers_sizes.size () >= 4)
+				{
+					if (inliers_sizes[inliers_sizes.size () - 1] == inliers_sizes[inliers_sizes.size () - 3] &&
+					inliers_sizes[inliers_sizes.size () - 2] == inliers_sizes[inliers_sizes.size () - 4])
+					{
+						oscillating = true;
+						break;
+					}
+				}
+				inlier_changed = true;
+				continue;
+			}
+
+			// Check the values of the inlier set
+			for (size_t i = 0; i < prev_inliers.size (); ++i)
+			{
+				// If the value of the inliers changed, then we are still optimizing
+				if (prev_inliers[i] != new_inliers[i])
+				{
+					inlier_changed = true;
+					break;
+				}
+			}
+		}
+		while (inlier_changed && ++refine_iterations < refineIterations);
+
+		if (oscillating)
+		{
+			UDEBUG("RANSAC refineModel: Detected oscillations in the model refinement.");
+		}
+
+		std::swap (inliers, prev_inliers);
+	}
+
+	if((int)inliers.size() < modelPoints)
+	{
+		UDEBUG("RANSAC: Model with inliers < 3");
+		inliers.clear();
+		return Transform();
+	}
+
+	if(variance)
+	{
+		std::sort(errors.begin(), errors.end());
+		*variance = 2.1981 * errors[errors.size() >> 1];
+	}
+
+	Transform transform(
+			bestModel[0], bestModel[1], bestModel[2], bestModel[3],
+			bestModel[4], bestModel[5], bestModel[6], bestModel[7],
+			bestModel[8], bestModel[9], bestModel[10], bestModel[11]);
+	UDEBUG("RANSAC inliers=%d/%d tf=%s", (int)inliers.size(), n, transform.prettyPrint().c_str());
+	return transform;
+}
+
 Transform estimateMotion3DTo2D(
 			const std::map<int, cv::Point3f> & words3A,
 			const std::map<int, cv::KeyPoint> & words2B,
@@ -58,7 +582,8 @@ Transform estimateMotion3DTo2D(
 			const std::map<int, cv::Point3f> & words3B,
 			cv::Mat * covariance,
 			std::vector<int> * matchesOut,
-			std::vector<int> * inliersOut)
+			std::vector<int> * inliersOut,
+			int ransacType)
 {
 	UASSERT(cameraModel.isValidForProjection());
 	UASSERT(!guess.isNull());
@@ -126,7 +651,9 @@ Transform estimateMotion3DTo2D(
 				minInliers, // min inliers
 				inliers,
 				flagsPnP,
-				refineIterations);
+				refineIterations,
+				3.0f,
+				ransacType);
 
 		if((int)inliers.size() >= minInliers)
 		{
@@ -205,7 +732,8 @@ Transform estimateMotion3DTo3D(
 			int refineIterations,
 			cv::Mat * covariance,
 			std::vector<int> * matchesOut,
-			std::vector<int> * inliersOut)
+			std::vector<int> * inliersOut,
+			int ransacType)
 {
 	Transform transform;
 	std::vector<cv::Point3f> inliers1; // previous
@@ -228,7 +756,29 @@ Transform estimateMotion3DTo3D(
 	}
 
 	std::vector<int> inliers;
-	if((int)inliers1.size() >= minInliers)
+	if((int)inliers1.size() >= minInliers && ransacType == 1)
+	{
+		double variance = 1.0;
+		Transform t = ransacRigid(
+				inliers1,
+				inliers2,
+				inliersDistance,
+				iterations,
+				refineIterations,
+				3.0,
+				inliers,
+				covariance?&variance:0);
+
+		if(!t.isNull() && (int)inliers.size() >= minInliers)
+		{
+			transform = t;
+			if(covariance)
+			{
+				*covariance *= variance;
+			}
+		}
+	}
+	else if((int)inliers1.size() >= minInliers)
 	{
 		pcl::PointCloud<pcl::PointXYZ>::Ptr inliers1cloud(new pcl::PointCloud<pcl::PointXYZ>);
 		pcl::PointCloud<pcl::PointXYZ>::Ptr inliers2cloud(new pcl::PointCloud<pcl::PointXYZ>);
@@ -323,29 +873,47 @@ void solvePnPRansac(
         std::vector<int> & inliers,
         int flags,
         int refineIterations,
-        float refineSigma)
+        float refineSigma,
+        int ransacType)
 {
 	if(minInliersCount < 4)
 	{
 		minInliersCount = 4;
 	}
+	if(ransacType == 1)
+	{
+		ransacPnP(
+				objectPoints,
+				imagePoints,
+				cameraMatrix,
+				distCoeffs,
+				rvec,
+				tvec,
+				iterationsCount,
+				reprojectionError,
+				inliers,
+				flags);
+	}
+	else
+	{
 #if CV_MAJOR_VERSION < 3
-	cv3::solvePnPRansac( //use OpenCV3 version of solvePnPRansac in OpenCV2
+		cv3::solvePnPRansac( //use OpenCV3 version of solvePnPRansac in OpenCV2
 #else
-	cv::solvePnPRansac( // use directly version from OpenCV 3
+		cv::solvePnPRansac( // use directly version from OpenCV 3
 #endif
-			objectPoints,
-			imagePoints,
-			cameraMatrix,
-			distCoeffs,
-			rvec,
-			tvec,
-			useExtrinsicGuess,
-			iterationsCount,
-			reprojectionError,
-			0.99, // confidence
-			inliers,
-			flags);
+				objectPoints,
+				imagePoints,
+				cameraMatrix,
+				distCoeffs,
+				rvec,
+				tvec,
+				useExtrinsicGuess,
+				iterationsCount,
+				reprojectionError,
+				0.99, // confidence
+				inliers,
+				flags);
+	}
 
 	float inlierThreshold = reprojectionError;
 	if((int)inliers.size() >= minInliersCount && refineIterations>0)
@@ -43,6 +43,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <pcl/surface/mls.h>
 #include <pcl18/surface/texture_mapping.h>
 #include <pcl/features/integral_image_normal.h>
+#include <pcl/common/io.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifndef DISABLE_VTK
 #include <pcl/surface/vtk_smoothing/vtk_mesh_quadric_decimation.h>
@@ -841,6 +846,257 @@ pcl::TextureMesh::Ptr createTextureMesh(
 	return textureMesh;
 }
 
+namespace {
+struct TextureChunkKey
+{
+	TextureChunkKey(int x, int y, int z) : x(x), y(y), z(z) {}
+	bool operator<(const TextureChunkKey & k) const
+	{
+		if(x != k.x) return x < k.x;
+		if(y != k.y) return y < k.y;
+		return z < k.z;
+	}
+	int x,y,z;
+};
+
+// Conservative test: is the sphere (center, radius) in the frustum of the camera?
+bool isSphereInCameraFrustum(
+		const Eigen::Vector3f & center,
+		float radius,
+		const Transform & cameraPose,
+		const CameraModel & model,
+		float maxDistance)
+{
+	Eigen::Vector3f c = cameraPose.inverse().toEigen3f() * center;
+	if(c[2] < -radius || (maxDistance > 0.0f && c[2] > maxDistance + radius))
+	{
+		return false;
+	}
+	// Old calibrations may not have the image size, assume the principal point is centered
+	const float w = model.imageWidth()>0?model.imageWidth():2.0f*model.cx();
+	const float h = model.imageHeight()>0?model.imageHeight():2.0f*model.cy();
+	if(w <= 0.0f || h <= 0.0f)
+	{
+		// unknown image size, only the distance is checked
+		return true;
+	}
+	Eigen::Vector3f normals[4] = {
+			Eigen::Vector3f(model.fx(), 0, model.cx()),       // left
+			Eigen::Vector3f(-model.fx(), 0, w - model.cx()),  // right
+			Eigen::Vector3f(0, model.fy(), model.cy()),       // top
+			Eigen::Vector3f(0, -model.fy(), h - model.cy())}; // bottom
+	for(int i=0; i<4; ++i)
+	{
+		if(normals[i].normalized().dot(c) < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+}
+
+pcl::TextureMesh::Ptr createTextureMeshChunked(
+		const pcl::PolygonMesh::Ptr & mesh,
+		const std::map<int, Transform> & poses,
+		const std::map<int, std::vector<CameraModel> > & cameraModels,
+		const std::map<int, cv::Mat> & cameraDepths,
+		float chunkSize,
+		float maxDistance,
+		float maxDepthError,
+		float maxAngle,
+		int minClusterSize,
+		const std::vector<float> & roiRatios,
+		const ProgressState * state,
+		std::vector<std::map<int, pcl::PointXY> > * vertexToPixels)
+{
+	UASSERT(mesh->polygons.size());
+	UASSERT(chunkSize > 0.0f);
+	UASSERT_MSG(poses.size() == cameraModels.size(), uFormat("%d vs %d", (int)poses.size(), (int)cameraModels.size()).c_str());
+
+	UTimer timer;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+	pcl::fromPCLPointCloud2(mesh->cloud, *cloud);
+
+	// Partition polygons by their centroid
+	std::map<TextureChunkKey, std::vector<int> > chunkPolygons;
+	for(unsigned int i=0; i<mesh->polygons.size(); ++i)
+	{
+		const pcl::Vertices & v = mesh->polygons[i];
+		UASSERT(v.vertices.size()>0);
+		Eigen::Vector3f centroid(0,0,0);
+		for(unsigned int j=0; j<v.vertices.size(); ++j)
+		{
+			centroid += cloud->at(v.vertices[j]).getVector3fMap();
+		}
+		centroid /= float(v.vertices.size());
+		chunkPolygons[TextureChunkKey(
+				int(std::floor(centroid[0]/chunkSize)),
+				int(std::floor(centroid[1]/chunkSize)),
+				int(std::floor(centroid[2]/chunkSize)))].push_back(i);
+	}
+	std::vector<std::vector<int> *> chunks;
+	chunks.reserve(chunkPolygons.size());
+	for(std::map<TextureChunkKey, std::vector<int> >::iterator iter=chunkPolygons.begin(); iter!=chunkPolygons.end(); ++iter)
+	{
+		chunks.push_back(&iter->second);
+	}
+	UINFO("Texturing %d polygons in %d chunks of %fm (%fs)", (int)mesh->polygons.size(), (int)chunks.size(), chunkSize, timer.ticks());
+
+	std::vector<pcl::TextureMesh::Ptr> chunkMeshes(chunks.size());
+	std::vector<std::vector<std::map<int, pcl::PointXY> > > chunkVertexToPixels(vertexToPixels?chunks.size():0);
+	int batchSize = 1;
+#ifdef _OPENMP
+	batchSize = omp_get_max_threads()*2;
+#endif
+	for(int b=0; b<(int)chunks.size(); b+=batchSize)
+	{
+		int end = std::min(b+batchSize, (int)chunks.size());
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for(int c=b; c<end; ++c)
+		{
+			const std::vector<int> & polygons = *chunks[c];
+
+			// Extract the chunk sub mesh
+			std::map<int, int> vertexMap; // <mesh, chunk>
+			std::vector<int> indices;
+			Eigen::Vector3f minPt, maxPt;
+			pcl::PolygonMesh::Ptr chunkMesh(new pcl::PolygonMesh);
+			chunkMesh->polygons.resize(polygons.size());
+			for(unsigned int i=0; i<polygons.size(); ++i)
+			{
+				chunkMesh->polygons[i] = mesh->polygons[polygons[i]];
+				std::vector<uint32_t> & vertices = chunkMesh->polygons[i].vertices;
+				for(unsigned int j=0; j<vertices.size(); ++j)
+				{
+					std::pair<std::map<int, int>::iterator, bool> inserted = vertexMap.insert(std::make_pair((int)vertices[j], (int)indices.size()));
+					if(inserted.second)
+					{
+						const Eigen::Vector3f pt = cloud->at(vertices[j]).getVector3fMap();
+						if(indices.empty())
+						{
+							minPt = maxPt = pt;
+						}
+						else
+						{
+							minPt = minPt.cwiseMin(pt);
+							maxPt = maxPt.cwiseMax(pt);
+						}
+						indices.push_back(vertices[j]);
+					}
+					vertices[j] = inserted.first->second;
+				}
+			}
+			pcl::copyPointCloud(mesh->cloud, indices, chunkMesh->cloud);
+
+			// Keep only cameras seeing the chunk
+			Eigen::Vector3f center = (minPt + maxPt)/2.0f;
+			float radius = (maxPt - minPt).norm()/2.0f;
+			std::map<int, Transform> chunkPoses;
+			std::map<int, std::vector<CameraModel> > chunkModels;
+			std::map<int, cv::Mat> chunkDepths;
+			std::map<int, std::vector<CameraModel> >::const_iterator modelIter=cameraModels.begin();
+			for(std::map<int, Transform>::const_iterator poseIter=poses.begin(); poseIter!=poses.end(); ++poseIter, ++modelIter)
+			{
+				UASSERT(poseIter->first == modelIter->first);
+				for(unsigned int i=0; i<modelIter->second.size(); ++i)
+				{
+					if(isSphereInCameraFrustum(center, radius, poseIter->second*modelIter->second[i].localTransform(), modelIter->second[i], maxDistance))
+					{
+						chunkPoses.insert(*poseIter);
+						chunkModels.insert(*modelIter);
+						std::map<int, cv::Mat>::const_iterator depthIter = cameraDepths.find(poseIter->first);
+						if(depthIter != cameraDepths.end() && !depthIter->second.empty())
+						{
+							cv::Mat depth = depthIter->second;
+							if(depth.rows == 1 && depth.type() == CV_8UC1)
+							{
+								depth = uncompressImage(depth);
+							}
+							chunkDepths.insert(std::make_pair(poseIter->first, depth));
+						}
+						break;
+					}
+				}
+			}
+
+			chunkMeshes[c] = createTextureMesh(
+					chunkMesh,
+					chunkPoses,
+					chunkModels,
+					chunkDepths,
+					maxDistance,
+					maxDepthError,
+					maxAngle,
+					minClusterSize,
+					roiRatios,
+					0,
+					vertexToPixels?&chunkVertexToPixels[c]:0);
+			UDEBUG("Chunk %d/%d: %d polygons, %d vertices, %d cameras", c+1, (int)chunks.size(), (int)polygons.size(), (int)indices.size(), (int)chunkPoses.size());
+		}
+
+		std::string msg = uFormat("Textured chunks %d/%d", end, (int)chunks.size());
+		UINFO(msg.c_str());
+		if(state && (state->isCanceled() || !state->callback(msg)))
+		{
+			//cancelled!
+			UWARN("Texturing cancelled!");
+			return pcl::TextureMesh::Ptr(new pcl::TextureMesh);
+		}
+	}
+
+	// Assemble chunks (materials with same texture file are merged)
+	std::list<pcl::TextureMesh::Ptr> meshes(chunkMeshes.begin(), chunkMeshes.end());
+	pcl::TextureMesh::Ptr textureMesh = concatenateTextureMeshes(meshes);
+	meshes.clear();
+
+	// Like createTextureMesh(), the occluded material should be the last one
+	for(unsigned int i=0; i<textureMesh->tex_materials.size(); ++i)
+	{
+		if(textureMesh->tex_materials[i].tex_file.compare("occluded") == 0)
+		{
+			std::swap(textureMesh->tex_materials[i], textureMesh->tex_materials.back());
+			std::swap(textureMesh->tex_polygons[i], textureMesh->tex_polygons.back());
+			std::swap(textureMesh->tex_coordinates[i], textureMesh->tex_coordinates.back());
+			break;
+		}
+	}
+	std::map<std::string, int> materialIndices;
+	for(unsigned int i=0; i<textureMesh->tex_materials.size(); ++i)
+	{
+		textureMesh->tex_materials[i].tex_name = uFormat("material_%d", i);
+		materialIndices.insert(std::make_pair(textureMesh->tex_materials[i].tex_file, i));
+	}
+
+	if(vertexToPixels)
+	{
+		// remap chunk vertices and cameras to assembled mesh
+		*vertexToPixels = std::vector<std::map<int, pcl::PointXY> >(textureMesh->cloud.width*textureMesh->cloud.height);
+		int offset = 0;
+		for(unsigned int c=0; c<chunkMeshes.size(); ++c)
+		{
+			const pcl::TextureMesh & chunkMesh = *chunkMeshes[c];
+			for(unsigned int v=0; v<chunkVertexToPixels[c].size(); ++v)
+			{
+				UASSERT(offset+v < vertexToPixels->size());
+				for(std::map<int, pcl::PointXY>::iterator iter=chunkVertexToPixels[c][v].begin(); iter!=chunkVertexToPixels[c][v].end(); ++iter)
+				{
+					UASSERT(iter->first < (int)chunkMesh.tex_materials.size());
+					std::map<std::string, int>::iterator jter = materialIndices.find(chunkMesh.tex_materials[iter->first].tex_file);
+					UASSERT(jter != materialIndices.end());
+					vertexToPixels->at(offset+v).insert(std::make_pair(jter->second, iter->second));
+				}
+			}
+			offset += chunkMesh.cloud.width*chunkMesh.cloud.height;
+		}
+	}
+
+	UINFO("Texturing %d chunks... done! (%d materials, %fs)", (int)chunks.size(), (int)textureMesh->tex_materials.size(), timer.ticks());
+	return textureMesh;
+}
+
 void cleanTextureMesh(
 		pcl::TextureMesh & textureMesh,
 		int minClusterSize)
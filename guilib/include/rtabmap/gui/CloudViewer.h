@@ -59,11 +59,13 @@ namespace pcl {
 }
 
 class QMenu;
+class QTimer;
 class vtkProp;
 
 namespace rtabmap {
 
 class OctoMap;
+class CloudViewerLOD;
 
 class RTABMAPGUI_EXP CloudViewer : public QVTKWidget
 {
@@ -112,6 +114,17 @@ public:
 			const Transform & pose = Transform::getIdentity(),
 			const QColor & color = QColor());
 
+	/**
+	 * Add a cloud to the level of detail layer (see setLODEnabled()). The cloud is not
+	 * added as its own actor but merged with other clouds in spatial chunks. The id can
+	 * be used like other clouds with updateCloudPose(), removeCloud(),
+	 * setCloudVisibility(), getPose() and getAddedClouds().
+	 */
+	bool addCloudLOD(
+			const std::string & id,
+			const pcl::PointCloud<pcl::PointXYZRGB>::Ptr & cloud,
+			const Transform & pose);
+
 	bool addCloudMesh(
 			const std::string & id,
 			const pcl::PointCloud<pcl::PointXYZ>::Ptr & cloud,
@@ -253,6 +266,13 @@ public:
 	void setEdgeVisibility(bool visible);
 	double getRenderingRate() const;
 
+	bool isLODEnabled() const;
+	int getLODPointBudget() const;
+	float getLODChunkSize() const;
+	void setLODEnabled(bool enabled);
+	void setLODPointBudget(int points);
+	void setLODChunkSize(float size);
+
 	void getCameraPosition(
 			float & x, float & y, float & z,
 			float & focalX, float & focalY, float & focalZ,
@@ -284,6 +304,7 @@ public slots:
 	void setCloudOpacity(const std::string & id, double opacity = 1.0);
 	void setCloudPointSize(const std::string & id, int size);
 	virtual void clear();
+	void updateLOD();
 
 signals:
 	void configChanged();
@@ -324,6 +345,9 @@ private:
     QAction * _aSetFlatShading;
     QAction * _aSetEdgeVisibility;
     QAction * _aBackfaceCulling;
+    QAction * _aSetLOD;
+    QAction * _aSetLODPointBudget;
+    QAction * _aSetLODChunkSize;
     QMenu * _menu;
     std::set<std::string> _graphes;
     std::set<std::string> _coordinates;
@@ -347,6 +371,10 @@ private:
     bool _frontfaceCulling;
     double _renderingRate;
     vtkProp * _octomapActor;
+    CloudViewerLOD * _lod;
+    QTimer * _lodTimer;
+    double _lodOpacity;
+    int _lodPointSize;
 };
 
 } /* namespace rtabmap */
@@ -292,6 +292,10 @@ private:
 	std::multimap<int, Link> _currentLinksMap; // <nodeFromId, link>
 	std::map<int, int> _currentMapIds;   // <nodeId, mapId>
 	std::map<int, std::string> _currentLabels; // <nodeId, label>
+	int _statsGraphSequence; // local graph maintained from delta statistics
+	std::map<int, Transform> _statsGraphPoses;
+	std::multimap<int, Link> _statsGraphLinks;
+	std::map<int, Signature> _statsGraphNodeInfos;
 	std::map<int, std::pair<pcl::PointCloud<pcl::PointXYZRGB>::Ptr, pcl::IndicesPtr> > _cachedClouds;
 	long _createdCloudsMemoryUsage;
 	std::set<int> _cachedEmptyClouds;
@@ -175,6 +175,7 @@ public:
 	int getOctomapTreeDepth() const;
 	bool isOctomapFullUpdate() const;
 	double getOctomapOccupancyThr() const;
+	double getOctomapUpdateMovedNodesThr() const;
 	int getOctomapPointSize() const;
 	int getCloudDecimation(int index) const;   // 0=map, 1=odom
 	double getCloudMaxDepth(int index) const;  // 0=map, 1=odom
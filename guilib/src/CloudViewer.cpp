@@ -26,6 +26,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "rtabmap/gui/CloudViewer.h"
+#include "CloudViewerLOD.h"
 
 #include <rtabmap/core/Version.h>
 #include <rtabmap/utilite/ULogger.h>
@@ -44,6 +45,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QColorDialog>
 #include <QtGui/QVector3D>
 #include <QMainWindow>
+#include <QTimer>
 #include <set>
 
 #include <vtkCamera.h>
@@ -209,7 +211,11 @@ CloudViewer::CloudViewer(QWidget *parent) :
 		_currentBgColor(Qt::black),
 		_frontfaceCulling(false),
 		_renderingRate(5.0),
-		_octomapActor(0)
+		_octomapActor(0),
+		_lod(new CloudViewerLOD),
+		_lodTimer(0),
+		_lodOpacity(1.0),
+		_lodPointSize(2)
 {
 	UDEBUG("");
 	this->setMinimumSize(200, 200);
@@ -250,6 +256,13 @@ CloudViewer::CloudViewer(QWidget *parent) :
 	//setup menu/actions
 	createMenu();
 
+	// The level of detail is refreshed outside rendering (chunk actors cannot
+	// be added or removed while painting), update() returns early if the
+	// camera didn't move enough.
+	_lodTimer = new QTimer(this);
+	_lodTimer->setInterval(200);
+	connect(_lodTimer, SIGNAL(timeout()), this, SLOT(updateLOD()));
+
 	setMouseTracking(false);
 }
 
@@ -258,6 +271,7 @@ CloudViewer::~CloudViewer()
 	UDEBUG("");
 	this->clear();
 	delete _visualizer;
+	delete _lod;
 	UDEBUG("");
 }
 
@@ -324,6 +338,11 @@ void CloudViewer::createMenu()
 	_aBackfaceCulling = new QAction("Backface culling", this);
 	_aBackfaceCulling->setCheckable(true);
 	_aBackfaceCulling->setChecked(true);
+	_aSetLOD = new QAction("Level of detail", this);
+	_aSetLOD->setCheckable(true);
+	_aSetLOD->setChecked(false);
+	_aSetLODPointBudget = new QAction("Set point budget...", this);
+	_aSetLODChunkSize = new QAction("Set chunk size...", this);
 
 	QMenu * cameraMenu = new QMenu("Camera", this);
 	cameraMenu->addAction(_aLockCamera);
@@ -352,12 +371,18 @@ void CloudViewer::createMenu()
 	gridMenu->addAction(_aSetGridCellCount);
 	gridMenu->addAction(_aSetGridCellSize);
 
+	QMenu * lodMenu = new QMenu("Level of detail", this);
+	lodMenu->addAction(_aSetLOD);
+	lodMenu->addAction(_aSetLODPointBudget);
+	lodMenu->addAction(_aSetLODChunkSize);
+
 	//menus
 	_menu = new QMenu(this);
 	_menu->addMenu(cameraMenu);
 	_menu->addMenu(trajectoryMenu);
 	_menu->addMenu(frustumMenu);
 	_menu->addMenu(gridMenu);
+	_menu->addMenu(lodMenu);
 	_menu->addAction(_aSetBackgroundColor);
 	_menu->addAction(_aSetRenderingRate);
 	_menu->addAction(_aSetLighting);
@@ -414,6 +439,10 @@ void CloudViewer::saveSettings(QSettings & settings, const QString & group) cons
 
 	settings.setValue("bg_color", this->getDefaultBackgroundColor());
 	settings.setValue("rendering_rate", this->getRenderingRate());
+
+	settings.setValue("lod", this->isLODEnabled());
+	settings.setValue("lod_point_budget", this->getLODPointBudget());
+	settings.setValue("lod_chunk_size", (double)this->getLODChunkSize());
 	if(!group.isEmpty())
 	{
 		settings.endGroup();
@@ -458,6 +487,10 @@ void CloudViewer::loadSettings(QSettings & settings, const QString & group)
 	
 	this->setRenderingRate(settings.value("rendering_rate", this->getRenderingRate()).toDouble());
 
+	this->setLODEnabled(settings.value("lod", this->isLODEnabled()).toBool());
+	this->setLODPointBudget(settings.value("lod_point_budget", this->getLODPointBudget()).toInt());
+	this->setLODChunkSize(settings.value("lod_chunk_size", this->getLODChunkSize()).toFloat());
+
 	if(!group.isEmpty())
 	{
 		settings.endGroup();
@@ -474,6 +507,7 @@ bool CloudViewer::updateCloudPose(
 	{
 		UDEBUG("Updating pose %s to %s", id.c_str(), pose.prettyPrint().c_str());
 		if(_addedClouds.find(id).value() == pose ||
+		   _lod->updatePose(id, pose) ||
 		   _visualizer->updatePointCloudPose(id, pose.toEigen3f()))
 		{
 			_addedClouds.find(id).value() = pose;
@@ -611,6 +645,25 @@ bool CloudViewer::addCloud(
 	return addCloud(id, binaryCloud, pose, false, false, color);
 }
 
+bool CloudViewer::addCloudLOD(
+		const std::string & id,
+		const pcl::PointCloud<pcl::PointXYZRGB>::Ptr & cloud,
+		const Transform & pose)
+{
+	if(!this->isLODEnabled())
+	{
+		UERROR("Level of detail is not enabled, cannot add cloud \"%s\".", id.c_str());
+		return false;
+	}
+	if(_addedClouds.contains(id) && !_lod->contains(id))
+	{
+		this->removeCloud(id);
+	}
+	_lod->addCloud(id, cloud, pose);
+	_addedClouds.insert(id, pose);
+	return true;
+}
+
 bool CloudViewer::addCloudMesh(
 	const std::string & id,
 	const pcl::PointCloud<pcl::PointXYZ>::Ptr & cloud,
@@ -1619,13 +1672,17 @@ void CloudViewer::resetCamera()
 void CloudViewer::removeAllClouds()
 {
 	_addedClouds.clear();
+	_lod->clear();
 	_visualizer->removeAllPointClouds();
+	std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr> chunksToUpdate;
+	std::set<std::string> chunksToRemove;
+	_lod->update(Eigen::Vector3f(0,0,0), chunksToUpdate, chunksToRemove); // flush removed chunks
 }
 
 
 bool CloudViewer::removeCloud(const std::string & id)
 {
-	bool success = _visualizer->removePointCloud(id);
+	bool success = _lod->remove(id) || _visualizer->removePointCloud(id);
 	_addedClouds.remove(id); // remove after visualizer
 	return success;
 }
@@ -1702,6 +1759,96 @@ void CloudViewer::setEdgeVisibility(bool visible)
 	this->update();
 }
 
+bool CloudViewer::isLODEnabled() const
+{
+	return _aSetLOD->isChecked();
+}
+
+int CloudViewer::getLODPointBudget() const
+{
+	return _lod->getPointBudget();
+}
+
+float CloudViewer::getLODChunkSize() const
+{
+	return _lod->getChunkSize();
+}
+
+void CloudViewer::setLODEnabled(bool enabled)
+{
+	if(!enabled && _aSetLOD->isChecked())
+	{
+		_lodTimer->stop();
+		// re-add LOD clouds as normal clouds
+		QMap<std::string, Transform> addedClouds = _addedClouds;
+		for(QMap<std::string, Transform>::iterator iter=addedClouds.begin(); iter!=addedClouds.end(); ++iter)
+		{
+			if(_lod->contains(iter.key()))
+			{
+				pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = _lod->getCloud(iter.key());
+				bool visible = _lod->isVisible(iter.key());
+				this->removeCloud(iter.key());
+				if(cloud.get() && this->addCloud(iter.key(), cloud, iter.value()))
+				{
+					this->setCloudVisibility(iter.key(), visible);
+					this->setCloudOpacity(iter.key(), _lodOpacity);
+					this->setCloudPointSize(iter.key(), _lodPointSize);
+				}
+			}
+		}
+		this->updateLOD(); // flush removed chunks
+	}
+	else if(enabled && !_lodTimer->isActive())
+	{
+		_lodTimer->start();
+	}
+	_aSetLOD->setChecked(enabled);
+}
+
+void CloudViewer::setLODPointBudget(int points)
+{
+	if(points > 0)
+	{
+		_lod->setPointBudget(points);
+		this->update();
+	}
+}
+
+void CloudViewer::setLODChunkSize(float size)
+{
+	if(size > 0.0f)
+	{
+		_lod->setChunkSize(size);
+		this->update();
+	}
+}
+
+void CloudViewer::updateLOD()
+{
+	float x,y,z,focalX,focalY,focalZ,upX,upY,upZ;
+	this->getCameraPosition(x,y,z,focalX,focalY,focalZ,upX,upY,upZ);
+	std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr> chunksToUpdate;
+	std::set<std::string> chunksToRemove;
+	if(_lod->update(Eigen::Vector3f(x,y,z), chunksToUpdate, chunksToRemove))
+	{
+		for(std::set<std::string>::iterator iter=chunksToRemove.begin(); iter!=chunksToRemove.end(); ++iter)
+		{
+			_visualizer->removePointCloud(*iter);
+		}
+		for(std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr>::iterator iter=chunksToUpdate.begin(); iter!=chunksToUpdate.end(); ++iter)
+		{
+			pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> colorHandler(iter->second);
+			if(!_visualizer->updatePointCloud(iter->second, colorHandler, iter->first))
+			{
+				_visualizer->addPointCloud(iter->second, colorHandler, iter->first);
+			}
+			_visualizer->setPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_OPACITY, _lodOpacity, iter->first);
+			_visualizer->setPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_POINT_SIZE, (double)_lodPointSize, iter->first);
+		}
+		this->update();
+	}
+}
+
 void CloudViewer::getCameraPosition(
 		float & x, float & y, float & z,
 		float & focalX, float & focalY, float & focalZ,
@@ -1924,6 +2071,10 @@ void CloudViewer::setBackgroundColor(const QColor & color)
 
 void CloudViewer::setCloudVisibility(const std::string & id, bool isVisible)
 {
+	if(_lod->setVisible(id, isVisible))
+	{
+		return;
+	}
 	pcl::visualization::CloudActorMapPtr cloudActorMap = _visualizer->getCloudActorMap();
 	pcl::visualization::CloudActorMap::iterator iter = cloudActorMap->find(id);
 	if(iter != cloudActorMap->end())
@@ -1938,6 +2089,10 @@ void CloudViewer::setCloudVisibility(const std::string & id, bool isVisible)
 
 bool CloudViewer::getCloudVisibility(const std::string & id)
 {
+	if(_lod->contains(id))
+	{
+		return _lod->isVisible(id);
+	}
 	pcl::visualization::CloudActorMapPtr cloudActorMap = _visualizer->getCloudActorMap();
 	pcl::visualization::CloudActorMap::iterator iter = cloudActorMap->find(id);
 	if(iter != cloudActorMap->end())
@@ -1953,6 +2108,23 @@ bool CloudViewer::getCloudVisibility(const std::string & id)
 
 void CloudViewer::setCloudOpacity(const std::string & id, double opacity)
 {
+	if(_lod->contains(id))
+	{
+		// same opacity for all chunks
+		if(_lodOpacity != opacity)
+		{
+			_lodOpacity = opacity;
+			pcl::visualization::CloudActorMapPtr cloudActorMap = _visualizer->getCloudActorMap();
+			for(pcl::visualization::CloudActorMap::iterator iter=cloudActorMap->begin(); iter!=cloudActorMap->end(); ++iter)
+			{
+				if(CloudViewerLOD::isChunkId(iter->first))
+				{
+					_visualizer->setPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_OPACITY, opacity, iter->first);
+				}
+			}
+		}
+		return;
+	}
 	double lastOpacity;
 	_visualizer->getPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_OPACITY, lastOpacity, id);
 	if(lastOpacity != opacity)
@@ -1963,6 +2135,23 @@ void CloudViewer::setCloudOpacity(const std::string & id, double opacity)
 
 void CloudViewer::setCloudPointSize(const std::string & id, int size)
 {
+	if(_lod->contains(id))
+	{
+		// same point size for all chunks
+		if(_lodPointSize != size)
+		{
+			_lodPointSize = size;
+			pcl::visualization::CloudActorMapPtr cloudActorMap = _visualizer->getCloudActorMap();
+			for(pcl::visualization::CloudActorMap::iterator iter=cloudActorMap->begin(); iter!=cloudActorMap->end(); ++iter)
+			{
+				if(CloudViewerLOD::isChunkId(iter->first))
+				{
+					_visualizer->setPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_POINT_SIZE, (double)size, iter->first);
+				}
+			}
+		}
+		return;
+	}
 	double lastSize;
 	_visualizer->getPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_POINT_SIZE, lastSize, id);
 	if((int)lastSize != size)
@@ -2447,6 +2636,32 @@ void CloudViewer::handleAction(QAction * a)
 	{
 		this->setBackfaceCulling(_aBackfaceCulling->isChecked(), _frontfaceCulling);
 	}
+	else if(a == _aSetLOD)
+	{
+		// action is already toggled, set back previous state to apply the new one
+		bool enabled = _aSetLOD->isChecked();
+		_aSetLOD->setChecked(!enabled);
+		this->setLODEnabled(enabled);
+		this->update();
+	}
+	else if(a == _aSetLODPointBudget)
+	{
+		bool ok;
+		int value = QInputDialog::getInt(this, tr("Set point budget"), tr("Points"), _lod->getPointBudget(), 1000, 100000000, 100000, &ok);
+		if(ok)
+		{
+			this->setLODPointBudget(value);
+		}
+	}
+	else if(a == _aSetLODChunkSize)
+	{
+		bool ok;
+		double value = QInputDialog::getDouble(this, tr("Set chunk size"), tr("Size (m)"), _lod->getChunkSize(), 0.1, 100, 1, &ok);
+		if(ok)
+		{
+			this->setLODChunkSize(value);
+		}
+	}
 }
 
 } /* namespace rtabmap */
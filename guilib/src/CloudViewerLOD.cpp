@@ -0,0 +1,384 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "CloudViewerLOD.h"
+
+#include <rtabmap/core/util3d_transforms.h>
+#include <rtabmap/utilite/ULogger.h>
+#include <rtabmap/utilite/UConversion.h>
+#include <rtabmap/utilite/UStl.h>
+
+namespace rtabmap {
+
+// voxel levels used to sort contributions coarse-to-fine: chunkSize/2^(levels-1) is the finest
+static const int kOrderingLevels = 7;
+
+CloudViewerLOD::CloudViewerLOD(
+		float chunkSize,
+		int pointBudget,
+		float poseUpdateLinear,
+		float poseUpdateAngular) :
+	chunkSize_(chunkSize),
+	pointBudget_(pointBudget),
+	poseUpdateLinear_(poseUpdateLinear),
+	poseUpdateAngular_(poseUpdateAngular),
+	lastCameraPosition_(0,0,0),
+	forceUpdate_(true)
+{
+	UASSERT(chunkSize_ > 0.0f);
+	UASSERT(pointBudget_ > 0);
+}
+
+void CloudViewerLOD::setChunkSize(float chunkSize)
+{
+	UASSERT(chunkSize > 0.0f);
+	if(chunkSize != chunkSize_)
+	{
+		// re-dispatch all nodes in the new chunks
+		for(std::map<std::string, Node>::iterator iter=nodes_.begin(); iter!=nodes_.end(); ++iter)
+		{
+			removeNode(iter->first, iter->second);
+		}
+		chunkSize_ = chunkSize;
+		for(std::map<std::string, Node>::iterator iter=nodes_.begin(); iter!=nodes_.end(); ++iter)
+		{
+			if(iter->second.visible)
+			{
+				insertNode(iter->first, iter->second);
+			}
+		}
+	}
+}
+
+void CloudViewerLOD::setPointBudget(int pointBudget)
+{
+	UASSERT(pointBudget > 0);
+	if(pointBudget != pointBudget_)
+	{
+		pointBudget_ = pointBudget;
+		forceUpdate_ = true;
+	}
+}
+
+void CloudViewerLOD::addCloud(
+		const std::string & id,
+		const pcl::PointCloud<pcl::PointXYZRGB>::Ptr & cloud,
+		const Transform & pose)
+{
+	UASSERT(cloud.get() != 0 && !pose.isNull());
+	std::map<std::string, Node>::iterator iter = nodes_.find(id);
+	if(iter != nodes_.end())
+	{
+		removeNode(iter->first, iter->second);
+	}
+	else
+	{
+		iter = nodes_.insert(std::make_pair(id, Node())).first;
+	}
+	iter->second.cloud = cloud;
+	iter->second.pose = pose;
+	if(iter->second.visible)
+	{
+		insertNode(iter->first, iter->second);
+	}
+}
+
+bool CloudViewerLOD::updatePose(const std::string & id, const Transform & pose)
+{
+	std::map<std::string, Node>::iterator iter = nodes_.find(id);
+	if(iter != nodes_.end())
+	{
+		UASSERT(!pose.isNull());
+		Transform delta = iter->second.pose.inverse() * pose;
+		if(delta.getNorm() > poseUpdateLinear_ ||
+		   Eigen::AngleAxisf(delta.toEigen3f().rotation()).angle() > poseUpdateAngular_)
+		{
+			if(iter->second.visible)
+			{
+				removeNode(iter->first, iter->second);
+				iter->second.pose = pose;
+				insertNode(iter->first, iter->second);
+			}
+			else
+			{
+				iter->second.pose = pose;
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+bool CloudViewerLOD::setVisible(const std::string & id, bool visible)
+{
+	std::map<std::string, Node>::iterator iter = nodes_.find(id);
+	if(iter != nodes_.end())
+	{
+		if(iter->second.visible != visible)
+		{
+			iter->second.visible = visible;
+			if(visible)
+			{
+				insertNode(iter->first, iter->second);
+			}
+			else
+			{
+				removeNode(iter->first, iter->second);
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+bool CloudViewerLOD::isVisible(const std::string & id) const
+{
+	std::map<std::string, Node>::const_iterator iter = nodes_.find(id);
+	return iter != nodes_.end() && iter->second.visible;
+}
+
+pcl::PointCloud<pcl::PointXYZRGB>::Ptr CloudViewerLOD::getCloud(const std::string & id) const
+{
+	std::map<std::string, Node>::const_iterator iter = nodes_.find(id);
+	if(iter != nodes_.end())
+	{
+		return iter->second.cloud;
+	}
+	return pcl::PointCloud<pcl::PointXYZRGB>::Ptr();
+}
+
+bool CloudViewerLOD::remove(const std::string & id)
+{
+	std::map<std::string, Node>::iterator iter = nodes_.find(id);
+	if(iter != nodes_.end())
+	{
+		removeNode(iter->first, iter->second);
+		nodes_.erase(iter);
+		return true;
+	}
+	return false;
+}
+
+void CloudViewerLOD::clear()
+{
+	for(std::map<ChunkKey, Chunk>::iterator iter=chunks_.begin(); iter!=chunks_.end(); ++iter)
+	{
+		removedChunks_.insert(iter->first);
+	}
+	chunks_.clear();
+	nodes_.clear();
+}
+
+bool CloudViewerLOD::update(
+		const Eigen::Vector3f & cameraPosition,
+		std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr> & chunksToUpdate,
+		std::set<std::string> & chunksToRemove)
+{
+	for(std::set<ChunkKey>::iterator iter=removedChunks_.begin(); iter!=removedChunks_.end(); ++iter)
+	{
+		if(chunks_.find(*iter) == chunks_.end())
+		{
+			chunksToRemove.insert(chunkId(*iter));
+		}
+	}
+	removedChunks_.clear();
+
+	bool dirty = forceUpdate_;
+	for(std::map<ChunkKey, Chunk>::iterator iter=chunks_.begin(); !dirty && iter!=chunks_.end(); ++iter)
+	{
+		dirty = iter->second.dirty;
+	}
+	// Levels are recomputed only when the camera moved more than half a chunk
+	if(!dirty && (cameraPosition - lastCameraPosition_).norm() < chunkSize_/2.0f)
+	{
+		return !chunksToRemove.empty();
+	}
+	lastCameraPosition_ = cameraPosition;
+	forceUpdate_ = false;
+
+	// Share the budget between chunks, nearest chunks get a higher density
+	std::vector<std::pair<std::map<ChunkKey, Chunk>::iterator, float> > weights;
+	weights.reserve(chunks_.size());
+	float sumWeights = 0.0f;
+	for(std::map<ChunkKey, Chunk>::iterator iter=chunks_.begin(); iter!=chunks_.end(); ++iter)
+	{
+		Eigen::Vector3f center(
+				(float(iter->first.x)+0.5f)*chunkSize_,
+				(float(iter->first.y)+0.5f)*chunkSize_,
+				(float(iter->first.z)+0.5f)*chunkSize_);
+		float d = std::max((center - cameraPosition).norm(), chunkSize_);
+		float w = float(iter->second.size)/(d*d);
+		weights.push_back(std::make_pair(iter, w));
+		sumWeights += w;
+	}
+
+	int shownPoints = 0;
+	for(unsigned int i=0; i<weights.size(); ++i)
+	{
+		Chunk & chunk = weights[i].first->second;
+		float target = sumWeights>0.0f?float(pointBudget_)*weights[i].second/sumWeights:0.0f;
+		int level = 0;
+		while(level < 30 && float(chunk.size >> level) > target && (chunk.size >> (level+1)) > 0)
+		{
+			++level;
+		}
+		if(chunk.dirty || level != chunk.level)
+		{
+			pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+			cloud->reserve(chunk.size >> level);
+			for(std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr>::iterator jter=chunk.contributions.begin();
+				jter!=chunk.contributions.end();
+				++jter)
+			{
+				int count = std::max((int)jter->second->size() >> level, 1);
+				cloud->insert(cloud->end(), jter->second->begin(), jter->second->begin()+count);
+			}
+			chunksToUpdate.insert(std::make_pair(chunkId(weights[i].first->first), cloud));
+			chunk.level = level;
+			chunk.dirty = false;
+		}
+		shownPoints += chunk.size >> level;
+	}
+	UDEBUG("LOD: chunks=%d updated=%d removed=%d shown points=%d/%d",
+			(int)chunks_.size(), (int)chunksToUpdate.size(), (int)chunksToRemove.size(), shownPoints, pointBudget_);
+	return !chunksToUpdate.empty() || !chunksToRemove.empty();
+}
+
+std::string CloudViewerLOD::chunkId(const ChunkKey & key)
+{
+	return uFormat("lod_chunk_%d_%d_%d", key.x, key.y, key.z);
+}
+
+bool CloudViewerLOD::isChunkId(const std::string & id)
+{
+	return id.compare(0, 10, "lod_chunk_") == 0;
+}
+
+CloudViewerLOD::ChunkKey CloudViewerLOD::keyOf(const pcl::PointXYZRGB & pt) const
+{
+	return ChunkKey(
+			int(std::floor(pt.x/chunkSize_)),
+			int(std::floor(pt.y/chunkSize_)),
+			int(std::floor(pt.z/chunkSize_)));
+}
+
+void CloudViewerLOD::insertNode(const std::string & id, Node & node)
+{
+	UASSERT(node.chunks.empty());
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = util3d::transformPointCloud(node.cloud, node.pose);
+
+	std::map<ChunkKey, std::vector<int> > indices;
+	for(unsigned int i=0; i<cloud->size(); ++i)
+	{
+		const pcl::PointXYZRGB & pt = cloud->at(i);
+		if(pcl::isFinite(pt))
+		{
+			indices[keyOf(pt)].push_back(i);
+		}
+	}
+
+	for(std::map<ChunkKey, std::vector<int> >::iterator iter=indices.begin(); iter!=indices.end(); ++iter)
+	{
+		// Sort points coarse-to-fine: at each level, the first point
+		// falling in a voxel not already occupied is taken.
+		const std::vector<int> & points = iter->second;
+		Eigen::Vector3f origin(iter->first.x*chunkSize_, iter->first.y*chunkSize_, iter->first.z*chunkSize_);
+		std::vector<int> ordered;
+		ordered.reserve(points.size());
+		std::vector<bool> taken(points.size(), false);
+		for(int l=0; l<kOrderingLevels && ordered.size() < points.size(); ++l)
+		{
+			int cells = 1 << l;
+			float cellSize = chunkSize_/float(cells);
+			std::set<int> occupied;
+			std::vector<int> cellIndices(points.size());
+			for(unsigned int i=0; i<points.size(); ++i)
+			{
+				Eigen::Vector3f p = (cloud->at(points[i]).getVector3fMap() - origin)/cellSize;
+				int x = uMax(0, uMin(cells-1, int(p[0])));
+				int y = uMax(0, uMin(cells-1, int(p[1])));
+				int z = uMax(0, uMin(cells-1, int(p[2])));
+				cellIndices[i] = x + (y + z*cells)*cells;
+				if(taken[i])
+				{
+					occupied.insert(cellIndices[i]);
+				}
+			}
+			for(unsigned int i=0; i<points.size(); ++i)
+			{
+				if(!taken[i] && occupied.insert(cellIndices[i]).second)
+				{
+					taken[i] = true;
+					ordered.push_back(i);
+				}
+			}
+		}
+		for(unsigned int i=0; i<points.size(); ++i)
+		{
+			if(!taken[i])
+			{
+				ordered.push_back(i);
+			}
+		}
+
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr contribution(new pcl::PointCloud<pcl::PointXYZRGB>);
+		contribution->resize(ordered.size());
+		for(unsigned int i=0; i<ordered.size(); ++i)
+		{
+			contribution->at(i) = cloud->at(points[ordered[i]]);
+		}
+
+		Chunk & chunk = chunks_[iter->first];
+		chunk.contributions.insert(std::make_pair(id, contribution));
+		chunk.size += (int)contribution->size();
+		chunk.dirty = true;
+		node.chunks.insert(iter->first);
+		removedChunks_.erase(iter->first);
+	}
+}
+
+void CloudViewerLOD::removeNode(const std::string & id, Node & node)
+{
+	for(std::set<ChunkKey>::iterator iter=node.chunks.begin(); iter!=node.chunks.end(); ++iter)
+	{
+		std::map<ChunkKey, Chunk>::iterator jter = chunks_.find(*iter);
+		UASSERT(jter != chunks_.end());
+		std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr>::iterator kter = jter->second.contributions.find(id);
+		UASSERT(kter != jter->second.contributions.end());
+		jter->second.size -= (int)kter->second->size();
+		jter->second.contributions.erase(kter);
+		jter->second.dirty = true;
+		if(jter->second.contributions.empty())
+		{
+			chunks_.erase(jter);
+			removedChunks_.insert(*iter);
+		}
+	}
+	node.chunks.clear();
+}
+
+} /* namespace rtabmap */
@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GUILIB_SRC_CLOUDVIEWERLOD_H_
+#define GUILIB_SRC_CLOUDVIEWERLOD_H_
+
+#include <rtabmap/core/Transform.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <map>
+#include <set>
+#include <string>
+
+namespace rtabmap {
+
+/**
+ * Level of detail of the clouds shown in CloudViewer. Node clouds are merged
+ * in cubic chunks (in map frame) so that only one actor is created per chunk
+ * instead of one per node. Points of each node contribution are sorted
+ * coarse-to-fine like an octree traversal (the first points of a contribution
+ * are evenly spread in the chunk), so a chunk can be shown at a lower resolution
+ * by keeping only its first points. The point budget is shared between chunks
+ * depending on their distance to the camera. Only chunks touched by a node
+ * added, moved or removed (or for which the level changed) are regenerated.
+ */
+class CloudViewerLOD
+{
+public:
+	struct ChunkKey
+	{
+		ChunkKey(int x=0, int y=0, int z=0) : x(x), y(y), z(z) {}
+		bool operator<(const ChunkKey & k) const
+		{
+			if(x != k.x) return x < k.x;
+			if(y != k.y) return y < k.y;
+			return z < k.z;
+		}
+		int x,y,z;
+	};
+
+public:
+	CloudViewerLOD(
+			float chunkSize = 2.0f,
+			int pointBudget = 2000000,
+			float poseUpdateLinear = 0.01f,  // m
+			float poseUpdateAngular = 0.01f); // rad
+	virtual ~CloudViewerLOD() {}
+
+	void setChunkSize(float chunkSize);
+	void setPointBudget(int pointBudget);
+	float getChunkSize() const {return chunkSize_;}
+	int getPointBudget() const {return pointBudget_;}
+
+	void addCloud(
+			const std::string & id,
+			const pcl::PointCloud<pcl::PointXYZRGB>::Ptr & cloud, // in node frame
+			const Transform & pose);
+	/**
+	 * Chunks are regenerated only if the pose changed more than
+	 * the linear/angular thresholds since the cloud was inserted.
+	 */
+	bool updatePose(const std::string & id, const Transform & pose);
+	bool setVisible(const std::string & id, bool visible);
+	bool isVisible(const std::string & id) const;
+	bool remove(const std::string & id);
+	bool contains(const std::string & id) const {return nodes_.find(id) != nodes_.end();}
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr getCloud(const std::string & id) const; // in node frame
+	void clear();
+
+	/**
+	 * Update the level of detail of the chunks for the current camera position.
+	 * @param chunksToUpdate chunks (in map frame) to add or replace in the viewer
+	 * @param chunksToRemove chunks to remove from the viewer
+	 * @return false if nothing changed
+	 */
+	bool update(
+			const Eigen::Vector3f & cameraPosition,
+			std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr> & chunksToUpdate,
+			std::set<std::string> & chunksToRemove);
+
+	static std::string chunkId(const ChunkKey & key);
+	static bool isChunkId(const std::string & id);
+
+private:
+	struct Node
+	{
+		Node() : visible(true) {}
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;
+		Transform pose; // pose used to fill the chunks
+		bool visible;
+		std::set<ChunkKey> chunks;
+	};
+	struct Chunk
+	{
+		Chunk() : size(0), level(-1), dirty(true) {}
+		std::map<std::string, pcl::PointCloud<pcl::PointXYZRGB>::Ptr> contributions; // ordered coarse-to-fine
+		int size;
+		int level; // shown points = size >> level, -1=not shown
+		bool dirty;
+	};
+
+	void insertNode(const std::string & id, Node & node);
+	void removeNode(const std::string & id, Node & node);
+	ChunkKey keyOf(const pcl::PointXYZRGB & pt) const;
+
+private:
+	float chunkSize_;
+	int pointBudget_;
+	float poseUpdateLinear_;
+	float poseUpdateAngular_;
+	std::map<std::string, Node> nodes_;
+	std::map<ChunkKey, Chunk> chunks_;
+	std::set<ChunkKey> removedChunks_;
+	Eigen::Vector3f lastCameraPosition_;
+	bool forceUpdate_;
+};
+
+} /* namespace rtabmap */
+
+#endif /* GUILIB_SRC_CLOUDVIEWERLOD_H_ */
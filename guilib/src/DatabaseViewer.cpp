@@ -184,6 +184,7 @@ DatabaseViewer::DatabaseViewer(const QString & ini, QWidget * parent) :
 	uInsert(parameters, Parameters::getDefaultParameters("Icp"));
 	uInsert(parameters, Parameters::getDefaultParameters("Stereo"));
 	uInsert(parameters, Parameters::getDefaultParameters("StereoBM"));
+	uInsert(parameters, Parameters::getDefaultParameters("StereoSGM"));
 	uInsert(parameters, Parameters::getDefaultParameters("Grid"));
 	parameters.insert(*Parameters::getDefaultParameters().find(Parameters::kRGBDOptimizeMaxError()));
 	parameters.insert(*Parameters::getDefaultParameters().find(Parameters::kRGBDLoopClosureReextractFeatures()));
@@ -898,15 +899,30 @@ void DatabaseViewer::closeEvent(QCloseEvent* event)
 			{
 				// Rejected links
 				UASSERT(generatedLocalMaps_.size() == generatedLocalMapsInfo_.size());
+				int localMapEncoding = Parameters::defaultGridLocalMapEncoding();
+				Parameters::parse(ui_->parameters_toolbox->getParameters(), Parameters::kGridLocalMapEncoding(), localMapEncoding);
 				std::map<int, std::pair<cv::Mat, cv::Mat> >::iterator mapIter = generatedLocalMaps_.begin();
 				std::map<int, std::pair<float, cv::Point3f> >::iterator infoIter = generatedLocalMapsInfo_.begin();
 				for(; mapIter!=generatedLocalMaps_.end(); ++mapIter, ++infoIter)
 				{
 					UASSERT(mapIter->first == infoIter->first);
+					cv::Mat ground = mapIter->second.first;
+					cv::Mat obstacles = mapIter->second.second;
+					if(localMapEncoding > 0)
+					{
+						if(ground.type() == CV_32FC2 || ground.type() == CV_32FC3)
+						{
+							ground = util3d::encodeLocalMapCells(ground, infoIter->second.first, localMapEncoding == 2);
+						}
+						if(obstacles.type() == CV_32FC2 || obstacles.type() == CV_32FC3)
+						{
+							obstacles = util3d::encodeLocalMapCells(obstacles, infoIter->second.first, localMapEncoding == 2);
+						}
+					}
 					dbDriver_->updateOccupancyGrid(
 							mapIter->first,
-							mapIter->second.first,
-							mapIter->second.second,
+							ground,
+							obstacles,
 							infoIter->second.first,
 							infoIter->second.second);
 				}
@@ -43,6 +43,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rtabmap/core/util2d.h"
 #include "rtabmap/core/Graph.h"
 #include "rtabmap/core/GainCompensator.h"
+#include "rtabmap/core/TSDFVolume.h"
 #include "rtabmap/core/clams/discrete_depth_distortion_model.h"
 #include "rtabmap/core/DBDriver.h"
 #include "rtabmap/core/Version.h"
@@ -172,6 +173,7 @@ ExportCloudsDialog::ExportCloudsDialog(QWidget *parent) :
 	connect(_ui->doubleSpinBox_meshingTextureMaxDistance, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
 	connect(_ui->doubleSpinBox_meshingTextureMaxDepthError, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
 	connect(_ui->doubleSpinBox_meshingTextureMaxAngle, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
+	connect(_ui->doubleSpinBox_meshingTextureChunkSize, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
 	connect(_ui->spinBox_mesh_minTextureClusterSize, SIGNAL(valueChanged(int)), this, SIGNAL(configChanged()));
 	connect(_ui->lineEdit_meshingTextureRoiRatios, SIGNAL(textChanged(const QString &)), this, SIGNAL(configChanged()));
 	connect(_ui->checkBox_cameraFilter, SIGNAL(stateChanged(int)), this, SIGNAL(configChanged()));
@@ -197,6 +199,11 @@ ExportCloudsDialog::ExportCloudsDialog(QWidget *parent) :
 	connect(_ui->doubleSpinBox_cputsdf_flattenRadius, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
 	connect(_ui->spinBox_cputsdf_randomSplit, SIGNAL(valueChanged(int)), this, SIGNAL(configChanged()));
 
+	connect(_ui->doubleSpinBox_tsdf_voxelSize, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
+	connect(_ui->doubleSpinBox_tsdf_truncation, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
+	connect(_ui->doubleSpinBox_tsdf_maxDepth, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
+	connect(_ui->doubleSpinBox_tsdf_minWeight, SIGNAL(valueChanged(double)), this, SIGNAL(configChanged()));
+
 	_progressDialog = new ProgressDialog(this);
 	_progressDialog->setVisible(false);
 	_progressDialog->setAutoClose(true, 2);
@@ -314,6 +321,7 @@ void ExportCloudsDialog::saveSettings(QSettings & settings, const QString & grou
 	settings.setValue("mesh_textureMaxDistance", _ui->doubleSpinBox_meshingTextureMaxDistance->value());
 	settings.setValue("mesh_textureMaxDepthError", _ui->doubleSpinBox_meshingTextureMaxDepthError->value());
 	settings.setValue("mesh_textureMaxAngle", _ui->doubleSpinBox_meshingTextureMaxAngle->value());
+	settings.setValue("mesh_textureChunkSize", _ui->doubleSpinBox_meshingTextureChunkSize->value());
 	settings.setValue("mesh_textureMinCluster", _ui->spinBox_mesh_minTextureClusterSize->value());
 	settings.setValue("mesh_textureRoiRatios", _ui->lineEdit_meshingTextureRoiRatios->text());
 	settings.setValue("mesh_textureCameraFiltering", _ui->checkBox_cameraFilter->isChecked());
@@ -348,6 +356,11 @@ void ExportCloudsDialog::saveSettings(QSettings & settings, const QString & grou
 	settings.setValue("cputsdf_flattenRadius", _ui->doubleSpinBox_cputsdf_flattenRadius->value());
 	settings.setValue("cputsdf_randomSplit", _ui->spinBox_cputsdf_randomSplit->value());
 
+	settings.setValue("tsdf_voxelSize", _ui->doubleSpinBox_tsdf_voxelSize->value());
+	settings.setValue("tsdf_truncation", _ui->doubleSpinBox_tsdf_truncation->value());
+	settings.setValue("tsdf_maxDepth", _ui->doubleSpinBox_tsdf_maxDepth->value());
+	settings.setValue("tsdf_minWeight", _ui->doubleSpinBox_tsdf_minWeight->value());
+
 	if(!group.isEmpty())
 	{
 		settings.endGroup();
@@ -427,6 +440,7 @@ void ExportCloudsDialog::loadSettings(QSettings & settings, const QString & grou
 	_ui->doubleSpinBox_meshingTextureMaxDistance->setValue(settings.value("mesh_textureMaxDistance", _ui->doubleSpinBox_meshingTextureMaxDistance->value()).toDouble());
 	_ui->doubleSpinBox_meshingTextureMaxDepthError->setValue(settings.value("mesh_textureMaxDepthError", _ui->doubleSpinBox_meshingTextureMaxDepthError->value()).toDouble());
 	_ui->doubleSpinBox_meshingTextureMaxAngle->setValue(settings.value("mesh_textureMaxAngle", _ui->doubleSpinBox_meshingTextureMaxAngle->value()).toDouble());
+	_ui->doubleSpinBox_meshingTextureChunkSize->setValue(settings.value("mesh_textureChunkSize", _ui->doubleSpinBox_meshingTextureChunkSize->value()).toDouble());
 	_ui->spinBox_mesh_minTextureClusterSize->setValue(settings.value("mesh_textureMinCluster", _ui->spinBox_mesh_minTextureClusterSize->value()).toDouble());
 	_ui->lineEdit_meshingTextureRoiRatios->setText(settings.value("mesh_textureRoiRatios", _ui->lineEdit_meshingTextureRoiRatios->text()).toString());
 	_ui->checkBox_cameraFilter->setChecked(settings.value("mesh_textureCameraFiltering", _ui->checkBox_cameraFilter->isChecked()).toBool());
@@ -463,6 +477,11 @@ void ExportCloudsDialog::loadSettings(QSettings & settings, const QString & grou
 	_ui->doubleSpinBox_cputsdf_flattenRadius->setValue(settings.value("cputsdf_flattenRadius", _ui->doubleSpinBox_cputsdf_flattenRadius->value()).toDouble());
 	_ui->spinBox_cputsdf_randomSplit->setValue(settings.value("cputsdf_randomSplit", _ui->spinBox_cputsdf_randomSplit->value()).toInt());
 
+	_ui->doubleSpinBox_tsdf_voxelSize->setValue(settings.value("tsdf_voxelSize", _ui->doubleSpinBox_tsdf_voxelSize->value()).toDouble());
+	_ui->doubleSpinBox_tsdf_truncation->setValue(settings.value("tsdf_truncation", _ui->doubleSpinBox_tsdf_truncation->value()).toDouble());
+	_ui->doubleSpinBox_tsdf_maxDepth->setValue(settings.value("tsdf_maxDepth", _ui->doubleSpinBox_tsdf_maxDepth->value()).toDouble());
+	_ui->doubleSpinBox_tsdf_minWeight->setValue(settings.value("tsdf_minWeight", _ui->doubleSpinBox_tsdf_minWeight->value()).toDouble());
+
 	updateReconstructionFlavor();
 	updateMLSGrpVisibility();
 
@@ -540,6 +559,7 @@ void ExportCloudsDialog::restoreDefaults()
 	_ui->doubleSpinBox_meshingTextureMaxDistance->setValue(3.0);
 	_ui->doubleSpinBox_meshingTextureMaxDepthError->setValue(0.0);
 	_ui->doubleSpinBox_meshingTextureMaxAngle->setValue(0.0);
+	_ui->doubleSpinBox_meshingTextureChunkSize->setValue(0.0);
 	_ui->spinBox_mesh_minTextureClusterSize->setValue(50);
 	_ui->lineEdit_meshingTextureRoiRatios->setText("0.0 0.0 0.0 0.0");
 	_ui->checkBox_cameraFilter->setChecked(false);
@@ -573,6 +593,11 @@ void ExportCloudsDialog::restoreDefaults()
 	_ui->doubleSpinBox_cputsdf_flattenRadius->setValue(0.005);
 	_ui->spinBox_cputsdf_randomSplit->setValue(1);
 
+	_ui->doubleSpinBox_tsdf_voxelSize->setValue(0.01);
+	_ui->doubleSpinBox_tsdf_truncation->setValue(0.04);
+	_ui->doubleSpinBox_tsdf_maxDepth->setValue(4.0);
+	_ui->doubleSpinBox_tsdf_minWeight->setValue(0);
+
 	updateReconstructionFlavor();
 	updateMLSGrpVisibility();
 
@@ -635,6 +660,7 @@ void ExportCloudsDialog::updateReconstructionFlavor()
 		_ui->comboBox_meshingApproach->setItemData(2, Qt::UserRole - 1);
 #endif
 		_ui->comboBox_meshingApproach->setItemData(3, _ui->comboBox_pipeline->currentIndex() == 0?1 | 32:0,Qt::UserRole - 1);
+		_ui->comboBox_meshingApproach->setItemData(4, _ui->comboBox_pipeline->currentIndex() == 0 && _ui->checkBox_assemble->isChecked()?1 | 32:0,Qt::UserRole - 1);
 
 		if(_ui->comboBox_pipeline->currentIndex() == 0 && _ui->comboBox_meshingApproach->currentIndex()<2)
 		{
@@ -662,6 +688,7 @@ void ExportCloudsDialog::updateReconstructionFlavor()
 		_ui->groupBox_poisson->setVisible(_ui->comboBox_pipeline->currentIndex() == 1 && _ui->comboBox_meshingApproach->currentIndex()==1);
 		_ui->groupBox_cputsdf->setVisible(_ui->comboBox_pipeline->currentIndex() == 0 && _ui->comboBox_meshingApproach->currentIndex()==2);
 		_ui->groupBox_organized->setVisible(_ui->comboBox_pipeline->currentIndex() == 0 && _ui->comboBox_meshingApproach->currentIndex()==3);
+		_ui->groupBox_tsdf->setVisible(_ui->comboBox_pipeline->currentIndex() == 0 && _ui->comboBox_meshingApproach->currentIndex()==4);
 
 #ifndef DISABLE_VTK
 		_ui->doubleSpinBox_meshDecimationFactor->setEnabled(_ui->comboBox_meshingApproach->currentIndex()!=3);
@@ -1229,12 +1256,13 @@ bool ExportCloudsDialog::getExportedClouds(
 				 _ui->checkBox_textureMapping->isChecked()))
 			{
 				_progressDialog->appendText(tr("Applying gain compensation..."));
+				QApplication::processEvents();
+				_compensator->apply(clouds, _ui->checkBox_gainRGB->isChecked());
 				for(std::map<int, std::pair<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr, pcl::IndicesPtr> >::iterator jter=clouds.begin();jter!=clouds.end(); ++jter)
 				{
 					if(jter!=clouds.end())
 					{
-						double gain = _compensator->getGain(jter->first);;
-						_compensator->apply(jter->first, jter->second.first, jter->second.second, _ui->checkBox_gainRGB->isChecked());
+						double gain = _compensator->getGain(jter->first);
 
 						_progressDialog->appendText(tr("Cloud %1 has gain %2").arg(jter->first).arg(gain));
 						_progressDialog->incrementStep();
@@ -1492,6 +1520,11 @@ bool ExportCloudsDialog::getExportedClouds(
 #ifdef RTABMAP_CPUTSDF
 		cpu_tsdf::TSDFVolumeOctree::Ptr tsdf;
 #endif
+		TSDFVolume tsdfVolume(
+				_ui->doubleSpinBox_tsdf_voxelSize->value(),
+				_ui->doubleSpinBox_tsdf_truncation->value(),
+				_ui->doubleSpinBox_tsdf_maxDepth->value(),
+				false); // no re-integration when exporting
 
 		//used for organized texturing below
 		std::map<int, std::vector<int> > organizedIndices;
@@ -1503,7 +1536,7 @@ bool ExportCloudsDialog::getExportedClouds(
 		{
 			if(_ui->comboBox_pipeline->currentIndex() == 0)
 			{
-				if(_ui->comboBox_meshingApproach->currentIndex()==2)
+				if(_ui->comboBox_meshingApproach->currentIndex()==2 || _ui->comboBox_meshingApproach->currentIndex()==4)
 				{
 					_progressDialog->appendText(tr("Creating TSDF volume... "));
 				}
@@ -1542,6 +1575,60 @@ bool ExportCloudsDialog::getExportedClouds(
 								_dbDriver->getCalibration(iter->first, models, stereoModel);
 							}
 
+							if(_ui->comboBox_meshingApproach->currentIndex()==4 && _ui->checkBox_assemble->isChecked())
+							{
+								// depth images are recreated from the organized clouds (already filtered)
+								bool integrated = false;
+								if(models.empty() && stereoModel.isValidForProjection())
+								{
+									models.push_back(stereoModel.left());
+								}
+								bool validModels = models.size() && iter->second->width % models.size() == 0;
+								for(unsigned int m=0; validModels && m<models.size(); ++m)
+								{
+									// image size is required to recover the decimation of the cloud
+									validModels = models[m].isValidForProjection() && models[m].imageHeight()>0 && models[m].imageWidth()>0;
+								}
+								if(validModels)
+								{
+									int subWidth = iter->second->width/models.size();
+									cv::Mat depth = cv::Mat::zeros(iter->second->height, iter->second->width, CV_32FC1);
+									cv::Mat rgb = cv::Mat::zeros(iter->second->height, iter->second->width, CV_8UC3);
+									std::vector<CameraModel> scaledModels(models.size());
+									for(unsigned int m=0; m<models.size(); ++m)
+									{
+										float decimation = float(models[m].imageWidth()) / float(subWidth);
+										scaledModels[m] = models[m].scaled(1.0/decimation);
+										Transform localTransformInv = models[m].localTransform().inverse();
+										for(int v=0; v<(int)iter->second->height; ++v)
+										{
+											for(int u=m*subWidth; u<(int)(m+1)*subWidth; ++u)
+											{
+												const pcl::PointXYZRGBNormal & pt = iter->second->at(u, v);
+												if(pcl::isFinite(pt))
+												{
+													depth.at<float>(v, u) = util3d::transformPoint(pt, localTransformInv).z;
+													unsigned char * bgr = rgb.ptr<unsigned char>(v, u);
+													bgr[0] = pt.b;
+													bgr[1] = pt.g;
+													bgr[2] = pt.r;
+												}
+											}
+										}
+									}
+									integrated = tsdfVolume.integrate(iter->first, SensorData(rgb, depth, scaledModels), poses.at(iter->first));
+								}
+								if(integrated)
+								{
+									_progressDialog->appendText(tr("TSDF: Integrated cloud %1 to TSDF volume (%2/%3).").arg(iter->first).arg(++i).arg(cloudsWithNormals.size()));
+								}
+								else
+								{
+									_progressDialog->appendText(tr("TSDF: Failed integrating cloud %1 to TSDF volume, valid camera models with image size are required (%2/%3).").arg(iter->first).arg(++i).arg(cloudsWithNormals.size()), Qt::darkYellow);
+									_progressDialog->setAutoClose(false);
+								}
+							}
+							else
 #ifdef RTABMAP_CPUTSDF
 							if(_ui->comboBox_meshingApproach->currentIndex()==2 && _ui->checkBox_assemble->isChecked())
 							{
@@ -1978,6 +2065,41 @@ bool ExportCloudsDialog::getExportedClouds(
 			}
 		}
 #endif
+		if(tsdfVolume.addedNodes().size())
+		{
+			_progressDialog->appendText(tr("TSDF: Creating mesh from TSDF volume (%1 blocks)...").arg(tsdfVolume.blocks()));
+			QApplication::processEvents();
+			uSleep(100);
+			QApplication::processEvents();
+
+			pcl::PolygonMesh::Ptr mesh = tsdfVolume.extractMesh(_ui->doubleSpinBox_tsdf_minWeight->value());
+			tsdfVolume.clear();
+			_progressDialog->appendText(tr("TSDF: Creating mesh from TSDF volume...done! (%1 polygons)").arg(mesh->polygons.size()));
+			meshes.clear();
+
+			if(mesh->polygons.size()>0)
+			{
+				pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr vertices (new pcl::PointCloud<pcl::PointXYZRGBNormal>);
+				pcl::fromPCLPointCloud2(mesh->cloud, *vertices);
+				TexturingState texturingState(_progressDialog, false);
+				util3d::denseMeshPostProcessing<pcl::PointXYZRGBNormal>(
+						mesh,
+						_ui->doubleSpinBox_meshDecimationFactor->isEnabled()?(float)_ui->doubleSpinBox_meshDecimationFactor->value():0.0f,
+						_ui->spinBox_meshMaxPolygons->isEnabled()?_ui->spinBox_meshMaxPolygons->value():0,
+						vertices,
+						(float)_ui->doubleSpinBox_transferColorRadius->value(),
+						!(_ui->checkBox_textureMapping->isEnabled() && _ui->checkBox_textureMapping->isChecked()),
+						_ui->checkBox_cleanMesh->isChecked(),
+						_ui->spinBox_mesh_minClusterSize->value(),
+						&texturingState);
+				meshes.insert(std::make_pair(0, mesh));
+			}
+			else
+			{
+				_progressDialog->appendText(tr("No polygons created TSDF volume!"), Qt::darkYellow);
+				_progressDialog->setAutoClose(false);
+			}
+		}
 
 		UDEBUG("");
 		if(_canceled)
@@ -2069,6 +2191,20 @@ bool ExportCloudsDialog::getExportedClouds(
 									models[i].setImageSize(imageSize);
 								}
 							}
+							else if(getDepth && _ui->doubleSpinBox_meshingTextureChunkSize->value() > 0.0)
+							{
+								// get just the compressed depth, it is uncompressed only when a chunk needs it
+								if(cachedSignatures.contains(jter->first))
+								{
+									depth = cachedSignatures.find(jter->first)->sensorData().depthOrRightCompressed();
+								}
+								if(depth.empty() && _dbDriver)
+								{
+									SensorData data;
+									_dbDriver->getNodeData(jter->first, data, true, false, false, false);
+									depth = data.depthOrRightCompressed();
+								}
+							}
 							else
 							{
 								// get just the depth
@@ -2217,18 +2353,37 @@ bool ExportCloudsDialog::getExportedClouds(
 							}
 						}
 
-						textureMesh = util3d::createTextureMesh(
-								iter->second,
-								cameraPoses,
-								cameraModels,
-								cameraDepths,
-								_ui->doubleSpinBox_meshingTextureMaxDistance->value(),
-								_ui->doubleSpinBox_meshingTextureMaxDepthError->value(),
-								_ui->doubleSpinBox_meshingTextureMaxAngle->value()*M_PI/180.0,
-								_ui->spinBox_mesh_minTextureClusterSize->value(),
-								roiRatios,
-								&texturingState,
-								cameraPoses.size()>1?&textureVertexToPixels:0); // only get vertexToPixels if merged clouds with multi textures
+						if(_ui->doubleSpinBox_meshingTextureChunkSize->value() > 0.0)
+						{
+							textureMesh = util3d::createTextureMeshChunked(
+									iter->second,
+									cameraPoses,
+									cameraModels,
+									cameraDepths,
+									_ui->doubleSpinBox_meshingTextureChunkSize->value(),
+									_ui->doubleSpinBox_meshingTextureMaxDistance->value(),
+									_ui->doubleSpinBox_meshingTextureMaxDepthError->value(),
+									_ui->doubleSpinBox_meshingTextureMaxAngle->value()*M_PI/180.0,
+									_ui->spinBox_mesh_minTextureClusterSize->value(),
+									roiRatios,
+									&texturingState,
+									cameraPoses.size()>1?&textureVertexToPixels:0); // only get vertexToPixels if merged clouds with multi textures
+						}
+						else
+						{
+							textureMesh = util3d::createTextureMesh(
+									iter->second,
+									cameraPoses,
+									cameraModels,
+									cameraDepths,
+									_ui->doubleSpinBox_meshingTextureMaxDistance->value(),
+									_ui->doubleSpinBox_meshingTextureMaxDepthError->value(),
+									_ui->doubleSpinBox_meshingTextureMaxAngle->value()*M_PI/180.0,
+									_ui->spinBox_mesh_minTextureClusterSize->value(),
+									roiRatios,
+									&texturingState,
+									cameraPoses.size()>1?&textureVertexToPixels:0); // only get vertexToPixels if merged clouds with multi textures
+						}
 
 						if(_canceled)
 						{
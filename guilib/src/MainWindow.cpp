@@ -151,6 +151,7 @@ MainWindow::MainWindow(PreferencesDialog * prefDialog, QWidget * parent) :
 	_savedMaximized(false),
 	_waypointsIndex(0),
 	_cachedMemoryUsage(0),
+	_statsGraphSequence(0),
 	_createdCloudsMemoryUsage(0),
 	_occupancyGrid(0),
 	_octomap(0),
@@ -244,7 +245,8 @@ MainWindow::MainWindow(PreferencesDialog * prefDialog, QWidget * parent) :
 	_octomap = new OctoMap(
 			_preferencesDialog->getGridMapResolution(),
 			_preferencesDialog->getOctomapOccupancyThr(),
-			_preferencesDialog->isOctomapFullUpdate());
+			_preferencesDialog->isOctomapFullUpdate(),
+			_preferencesDialog->getOctomapUpdateMovedNodesThr());
 #endif
 
 	// Timer
@@ -1709,14 +1711,33 @@ void MainWindow::processStats(const rtabmap::Statistics & stat)
 		//======================
 		// RGB-D Mapping stuff
 		//======================
+		// With delta statistics, the local graph is maintained here
+		const std::map<int, Transform> * statPoses = &stat.poses();
+		const std::multimap<int, Link> * statConstraints = &stat.constraints();
+		const std::map<int, Signature> * statNodeInfos = &stat.getSignatures();
+		if(stat.graphSequence() > 0)
+		{
+			stat.updateGraph(_statsGraphPoses, _statsGraphLinks, _statsGraphNodeInfos, _statsGraphSequence);
+			statPoses = &_statsGraphPoses;
+			statConstraints = &_statsGraphLinks;
+			statNodeInfos = &_statsGraphNodeInfos;
+		}
+		else if(_statsGraphSequence > 0)
+		{
+			_statsGraphSequence = 0;
+			_statsGraphPoses.clear();
+			_statsGraphLinks.clear();
+			_statsGraphNodeInfos.clear();
+		}
+
 		// update clouds
-		if(stat.poses().size())
+		if(statPoses->size())
 		{
 			// update pose only if odometry is not received
 			std::map<int, int> mapIds;
 			std::map<int, Transform> groundTruth;
 			std::map<int, std::string> labels;
-			for(std::map<int, Signature>::const_iterator iter=stat.getSignatures().begin(); iter!=stat.getSignatures().end();++iter)
+			for(std::map<int, Signature>::const_iterator iter=statNodeInfos->begin(); iter!=statNodeInfos->end();++iter)
 			{
 				mapIds.insert(std::make_pair(iter->first, iter->second.mapId()));
 				if(!iter->second.getGroundTruthPose().isNull())
@@ -1729,7 +1750,7 @@ void MainWindow::processStats(const rtabmap::Statistics & stat)
 				}
 			}
 
-			std::map<int, Transform> poses = stat.poses();
+			std::map<int, Transform> poses = *statPoses;
 			Transform groundTruthOffset = alignPosesToGroundTruth(poses, groundTruth, stat.stamp(), stat.refImageId());
 			UDEBUG("time= %d ms", time.restart());
 
@@ -1774,7 +1795,7 @@ void MainWindow::processStats(const rtabmap::Statistics & stat)
 			std::map<std::string, float> updateCloudSats;
 			updateMapCloud(
 					poses,
-					stat.constraints(),
+					*statConstraints,
 					mapIds,
 					labels,
 					groundTruth,
@@ -1831,7 +1852,7 @@ void MainWindow::processStats(const rtabmap::Statistics & stat)
 			// update current goal id
 			if(stat.currentGoalId() > 0)
 			{
-				_ui->graphicsView_graphView->setCurrentGoalID(stat.currentGoalId(), uValue(stat.poses(), stat.currentGoalId(), Transform()));
+				_ui->graphicsView_graphView->setCurrentGoalID(stat.currentGoalId(), uValue(*statPoses, stat.currentGoalId(), Transform()));
 			}
 		}
 		UDEBUG("");
@@ -2355,6 +2376,9 @@ void MainWindow::updateMapCloud(
 	if(stats)
 	{
 		stats->insert(std::make_pair("GUI/Octomap Update/ms", (float)timer.restart()*1000.0f));
+		stats->insert(std::make_pair("GUI/Octomap Ray Casting/ms", (float)_octomap->lastRayCastingTime()*1000.0f));
+		stats->insert(std::make_pair("GUI/Octomap Nodes Added/", (float)_octomap->lastNodesAdded()));
+		stats->insert(std::make_pair("GUI/Octomap Nodes Moved/", (float)_octomap->lastNodesMoved()));
 	}
 	if(_preferencesDialog->isOctomapShown())
 	{
@@ -2793,7 +2817,18 @@ std::pair<pcl::PointCloud<pcl::PointXYZRGB>::Ptr, pcl::IndicesPtr> MainWindow::c
 
 				output = util3d::extractIndices(cloud, indices, false, true);
 
-				if(cloudWithNormals->size())
+				if(_cloudViewer->isLODEnabled())
+				{
+					if(!_cloudViewer->addCloudLOD(cloudName, output, pose))
+					{
+						UERROR("Adding cloud %d to viewer failed!", nodeId);
+					}
+					else
+					{
+						added = true;
+					}
+				}
+				else if(cloudWithNormals->size())
 				{
 					pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr outputWithNormals;
 					outputWithNormals = util3d::extractIndices(cloudWithNormals, indices, false, false);
@@ -4576,7 +4611,8 @@ void MainWindow::startDetection()
 	_octomap = new OctoMap(
 			_preferencesDialog->getGridMapResolution(),
 			_preferencesDialog->getOctomapOccupancyThr(),
-			_preferencesDialog->isOctomapFullUpdate());
+			_preferencesDialog->isOctomapFullUpdate(),
+			_preferencesDialog->getOctomapUpdateMovedNodesThr());
 #endif
 
 	// clear odometry visual stuff
@@ -5814,6 +5850,10 @@ void MainWindow::clearTheCache()
 	_currentLinksMap.clear();
 	_currentMapIds.clear();
 	_currentLabels.clear();
+	_statsGraphSequence = 0;
+	_statsGraphPoses.clear();
+	_statsGraphLinks.clear();
+	_statsGraphNodeInfos.clear();
 	_odometryCorrection = Transform::getIdentity();
 	_lastOdomPose.setNull();
 	_ui->statsToolBox->clear();
@@ -5853,7 +5893,8 @@ void MainWindow::clearTheCache()
 	_octomap = new OctoMap(
 			_preferencesDialog->getGridMapResolution(),
 			_preferencesDialog->getOctomapOccupancyThr(),
-			_preferencesDialog->isOctomapFullUpdate());
+			_preferencesDialog->isOctomapFullUpdate(),
+			_preferencesDialog->getOctomapUpdateMovedNodesThr());
 #endif
 	_occupancyGrid->clear();
 }
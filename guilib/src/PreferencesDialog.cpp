@@ -434,6 +434,7 @@ PreferencesDialog::PreferencesDialog(QWidget * parent) :
 	connect(_ui->checkBox_octomap_cubeRendering, SIGNAL(stateChanged(int)), this, SLOT(makeObsoleteCloudRenderingPanel()));
 	connect(_ui->spinBox_octomap_pointSize, SIGNAL(valueChanged(int)), this, SLOT(makeObsoleteCloudRenderingPanel()));
 	connect(_ui->doubleSpinBox_octomap_occupancyThr, SIGNAL(valueChanged(double)), this, SLOT(makeObsoleteCloudRenderingPanel()));
+	connect(_ui->doubleSpinBox_octomap_updateMovedNodesThr, SIGNAL(valueChanged(double)), this, SLOT(makeObsoleteCloudRenderingPanel()));
 
 	connect(_ui->groupBox_organized, SIGNAL(toggled(bool)), this, SLOT(makeObsoleteCloudRenderingPanel()));
 	connect(_ui->doubleSpinBox_mesh_angleTolerance, SIGNAL(valueChanged(double)), this, SLOT(makeObsoleteCloudRenderingPanel()));
@@ -851,6 +852,7 @@ PreferencesDialog::PreferencesDialog(QWidget * parent) :
 	_ui->groupBox_grid_3d->setObjectName(Parameters::kGrid3D().c_str());
 	_ui->checkBox_grid_groundObstacle->setObjectName(Parameters::kGridGroundIsObstacle().c_str());
 	_ui->doubleSpinBox_grid_resolution->setObjectName(Parameters::kGridCellSize().c_str());
+	_ui->comboBox_grid_localMapEncoding->setObjectName(Parameters::kGridLocalMapEncoding().c_str());
 	_ui->spinBox_grid_decimation->setObjectName(Parameters::kGridDepthDecimation().c_str());
 	_ui->doubleSpinBox_grid_maxDepth->setObjectName(Parameters::kGridDepthMax().c_str());
 	_ui->doubleSpinBox_grid_minDepth->setObjectName(Parameters::kGridDepthMin().c_str());
@@ -1003,6 +1005,18 @@ PreferencesDialog::PreferencesDialog(QWidget * parent) :
 	_ui->stereobm_tetureThreshold->setObjectName(Parameters::kStereoBMTextureThreshold().c_str());
 	_ui->stereobm_uniquessRatio->setObjectName(Parameters::kStereoBMUniquenessRatio().c_str());
 
+	//StereoSGM
+	_ui->stereodense_strategy->setObjectName(Parameters::kStereoDenseStrategy().c_str());
+	_ui->stereosgm_minDisparity->setObjectName(Parameters::kStereoSGMMinDisparity().c_str());
+	_ui->stereosgm_numDisparities->setObjectName(Parameters::kStereoSGMNumDisparities().c_str());
+	_ui->stereosgm_p1->setObjectName(Parameters::kStereoSGMP1().c_str());
+	_ui->stereosgm_p2->setObjectName(Parameters::kStereoSGMP2().c_str());
+	_ui->stereosgm_paths->setObjectName(Parameters::kStereoSGMPaths().c_str());
+	_ui->stereosgm_uniquenessRatio->setObjectName(Parameters::kStereoSGMUniquenessRatio().c_str());
+	_ui->stereosgm_disp12MaxDiff->setObjectName(Parameters::kStereoSGMDisp12MaxDiff().c_str());
+	_ui->stereosgm_speckleWinSize->setObjectName(Parameters::kStereoSGMSpeckleWindowSize().c_str());
+	_ui->stereosgm_speckleRange->setObjectName(Parameters::kStereoSGMSpeckleRange().c_str());
+
 	// reset default settings for the gui
 	resetSettings(_ui->groupBox_generalSettingsGui0);
 	resetSettings(_ui->groupBox_cloudRendering1);
@@ -1400,6 +1414,7 @@ void PreferencesDialog::resetSettings(QGroupBox * groupBox)
 		_ui->checkBox_octomap_cubeRendering->setChecked(false);
 		_ui->spinBox_octomap_pointSize->setValue(5);
 		_ui->doubleSpinBox_octomap_occupancyThr->setValue(0.5);
+		_ui->doubleSpinBox_octomap_updateMovedNodesThr->setValue(0.0);
 	}
 	else if(groupBox->objectName() == _ui->groupBox_logging1->objectName())
 	{
@@ -1778,6 +1793,7 @@ void PreferencesDialog::readGuiSettings(const QString & filePath)
 	_ui->checkBox_octomap_show3dMap->setChecked(settings.value("octomap_3dmap", _ui->checkBox_octomap_show3dMap->isChecked()).toBool());
 	_ui->checkBox_octomap_cubeRendering->setChecked(settings.value("octomap_cube", _ui->checkBox_octomap_cubeRendering->isChecked()).toBool());
 	_ui->doubleSpinBox_octomap_occupancyThr->setValue(settings.value("octomap_occupancy_thr", _ui->doubleSpinBox_octomap_occupancyThr->value()).toDouble());
+	_ui->doubleSpinBox_octomap_updateMovedNodesThr->setValue(settings.value("octomap_update_moved_nodes_thr", _ui->doubleSpinBox_octomap_updateMovedNodesThr->value()).toDouble());
 	_ui->spinBox_octomap_pointSize->setValue(settings.value("octomap_point_size", _ui->spinBox_octomap_pointSize->value()).toInt());
 
 	_ui->groupBox_organized->setChecked(settings.value("meshing", _ui->groupBox_organized->isChecked()).toBool());
@@ -2164,6 +2180,7 @@ void PreferencesDialog::writeGuiSettings(const QString & filePath) const
 	settings.setValue("octomap_3dmap",               _ui->checkBox_octomap_show3dMap->isChecked());
 	settings.setValue("octomap_cube",                _ui->checkBox_octomap_cubeRendering->isChecked());
 	settings.setValue("octomap_occupancy_thr",       _ui->doubleSpinBox_octomap_occupancyThr->value());
+	settings.setValue("octomap_update_moved_nodes_thr", _ui->doubleSpinBox_octomap_updateMovedNodesThr->value());
 	settings.setValue("octomap_point_size",          _ui->spinBox_octomap_pointSize->value());
 
 
@@ -4196,6 +4213,10 @@ double PreferencesDialog::getOctomapOccupancyThr() const
 {
 	return _ui->doubleSpinBox_octomap_occupancyThr->value();
 }
+double PreferencesDialog::getOctomapUpdateMovedNodesThr() const
+{
+	return _ui->doubleSpinBox_octomap_updateMovedNodesThr->value();
+}
 int PreferencesDialog::getOctomapPointSize() const
 {
 	return _ui->spinBox_octomap_pointSize->value();
@@ -0,0 +1,293 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <rtabmap/core/DBDriver.h>
+#include <rtabmap/core/SensorData.h>
+#include <rtabmap/core/clams/discrete_depth_distortion_model.h>
+#include <rtabmap/utilite/ULogger.h>
+#include <rtabmap/utilite/UConversion.h>
+#include <rtabmap/utilite/UDirectory.h>
+#include <rtabmap/utilite/UFile.h>
+#include <rtabmap/utilite/UStl.h>
+#include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UMath.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <stdio.h>
+#include <string.h>
+
+using namespace rtabmap;
+
+void showUsage()
+{
+	printf("\nUsage:\n"
+			"rtabmap-depthUndistortBenchmark [options] model.bin input\n"
+			"  Time the depth undistortion of real depth images with a distortion\n"
+			"  model (see Depth Calibration dialog). \"Legacy\" is the previous\n"
+			"  implementation (frustum lookup per pixel) reproduced in this tool, so\n"
+			"  both are compared in the same binary. The outputs must be identical.\n"
+			"  input is a database (depth images of all nodes) or a directory of\n"
+			"  depth images (png, pgm, tif, tiff, exr). Images with a size different\n"
+			"  than the model are ignored.\n"
+			"Options:\n"
+			"  --repeat #       Number of undistortions of each image (default 10).\n"
+			"  --max #          Maximum number of images (default 0=all).\n"
+			"Example:\n"
+			"  $ rtabmap-depthUndistortBenchmark ~/distortion_model.bin ~/rtabmap.db\n\n");
+	exit(1);
+}
+
+// Previous undistortion, one frustum lookup per pixel
+class LegacyDistortionModel : public clams::DiscreteDepthDistortionModel
+{
+public:
+	void undistortLegacy(cv::Mat & depth) const
+	{
+		UASSERT(width_ == depth.cols);
+		UASSERT(height_ ==depth.rows);
+		UASSERT(depth.type() == CV_16UC1 || depth.type() == CV_32FC1);
+		if(depth.type() == CV_32FC1)
+		{
+			#pragma omp parallel for
+			for(int v = 0; v < height_; ++v) {
+				for(int u = 0; u < width_; ++u) {
+					float & z = depth.at<float>(v, u);
+					if(uIsNan(z) || z == 0.0f)
+						continue;
+					double zf = z;
+					frustum(v, u).interpolatedUndistort(&zf);
+					z = zf;
+				}
+			}
+		}
+		else
+		{
+			#pragma omp parallel for
+			for(int v = 0; v < height_; ++v) {
+				for(int u = 0; u < width_; ++u) {
+					unsigned short & z = depth.at<unsigned short>(v, u);
+					if(z == 0)
+						continue;
+					double zf = z * 0.001;
+					frustum(v, u).interpolatedUndistort(&zf);
+					z = zf*1000;
+				}
+			}
+		}
+	}
+};
+
+// Compare bits, NaN values included
+bool identical(const cv::Mat & a, const cv::Mat & b)
+{
+	if(a.size() != b.size() || a.type() != b.type())
+	{
+		return false;
+	}
+	for(int v=0; v<a.rows; ++v)
+	{
+		if(memcmp(a.ptr(v), b.ptr(v), a.cols*a.elemSize()) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char * argv[])
+{
+	ULogger::setType(ULogger::kTypeConsole);
+	ULogger::setLevel(ULogger::kWarning);
+
+	if(argc < 3)
+	{
+		showUsage();
+	}
+
+	int repeat = 10;
+	int maxImages = 0;
+	for(int i=1; i<argc-2; ++i)
+	{
+		if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			showUsage();
+		}
+		else if(strcmp(argv[i], "--repeat") == 0 && i+1<argc-2)
+		{
+			repeat = uStr2Int(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--max") == 0 && i+1<argc-2)
+		{
+			maxImages = uStr2Int(argv[++i]);
+		}
+	}
+	if(repeat < 1 || maxImages < 0)
+	{
+		showUsage();
+	}
+
+	std::string modelPath = uReplaceChar(argv[argc-2], '~', UDirectory::homeDir());
+	std::string inputPath = uReplaceChar(argv[argc-1], '~', UDirectory::homeDir());
+	if(!UFile::exists(modelPath))
+	{
+		printf("Distortion model \"%s\" doesn't exist!\n", modelPath.c_str());
+		return -1;
+	}
+	LegacyDistortionModel model;
+	model.load(modelPath);
+	if(!model.isValid())
+	{
+		printf("Failed loading distortion model \"%s\"!\n", modelPath.c_str());
+		return -1;
+	}
+
+	// Depth images
+	std::vector<std::string> names;
+	std::vector<cv::Mat> depths;
+	if(UDirectory::exists(inputPath))
+	{
+		UDirectory dir(inputPath, "png pgm tif tiff exr");
+		std::string path = dir.getNextFilePath();
+		while(!path.empty() && (maxImages == 0 || (int)depths.size() < maxImages))
+		{
+#if CV_MAJOR_VERSION >2 || (CV_MAJOR_VERSION >=2 && CV_MINOR_VERSION >=4)
+			cv::Mat depth = cv::imread(path.c_str(), cv::IMREAD_UNCHANGED);
+#else
+			cv::Mat depth = cv::imread(path.c_str(), -1);
+#endif
+			names.push_back(UFile::getName(path));
+			depths.push_back(depth);
+			path = dir.getNextFilePath();
+		}
+	}
+	else if(UFile::exists(inputPath))
+	{
+		DBDriver * dbDriver = DBDriver::create();
+		if(!dbDriver->openConnection(inputPath))
+		{
+			printf("Failed opening database \"%s\"!\n", inputPath.c_str());
+			delete dbDriver;
+			return -1;
+		}
+		std::set<int> ids;
+		dbDriver->getAllNodeIds(ids);
+		for(std::set<int>::iterator iter=ids.begin(); iter!=ids.end() && (maxImages == 0 || (int)depths.size() < maxImages); ++iter)
+		{
+			SensorData data;
+			dbDriver->getNodeData(*iter, data, true, false, false, false);
+			cv::Mat depth;
+			data.uncompressData(0, &depth);
+			names.push_back(uFormat("node %d", *iter));
+			depths.push_back(depth);
+		}
+		dbDriver->closeConnection(false);
+		delete dbDriver;
+	}
+	else
+	{
+		printf("Input \"%s\" doesn't exist!\n", inputPath.c_str());
+		return -1;
+	}
+
+	printf("Model %dx%d, %d images, %d undistortions per image (mean time per undistortion):\n",
+			model.getWidth(), model.getHeight(), (int)depths.size(), repeat);
+	int benchmarked = 0;
+	int ignored = 0;
+	int different = 0;
+	double legacyTotal = 0.0;
+	double lutTotal = 0.0;
+	for(unsigned int i=0; i<depths.size(); ++i)
+	{
+		const cv::Mat & depth = depths[i];
+		if(depth.cols != model.getWidth() || depth.rows != model.getHeight() ||
+		   (depth.type() != CV_16UC1 && depth.type() != CV_32FC1))
+		{
+			++ignored;
+			continue;
+		}
+
+		// both are timed on fresh copies of the same image, alternately
+		cv::Mat legacy;
+		cv::Mat lut;
+		double legacyTime = 0.0;
+		double lutTime = 0.0;
+		UTimer timer;
+		for(int j=0; j<repeat; ++j)
+		{
+			legacy = depth.clone();
+			timer.start();
+			model.undistortLegacy(legacy);
+			legacyTime += timer.ticks();
+
+			lut = depth.clone();
+			timer.start();
+			model.undistort(lut);
+			lutTime += timer.ticks();
+		}
+		legacyTime /= double(repeat);
+		lutTime /= double(repeat);
+
+		bool same = identical(legacy, lut);
+		if(!same)
+		{
+			++different;
+		}
+		printf("   %-16s %dx%d %s legacy=%.3f ms lut=%.3f ms speedup=%.2fx %s\n",
+				names[i].c_str(),
+				depth.cols,
+				depth.rows,
+				depth.type()==CV_16UC1?"16UC1":"32FC1",
+				legacyTime*1000.0,
+				lutTime*1000.0,
+				lutTime>0.0?legacyTime/lutTime:0.0,
+				same?"identical":"DIFFERENT");
+		legacyTotal += legacyTime;
+		lutTotal += lutTime;
+		++benchmarked;
+	}
+
+	if(benchmarked)
+	{
+		printf("Mean: legacy=%.3f ms lut=%.3f ms speedup=%.2fx (%d images, %d ignored)\n",
+				legacyTotal/double(benchmarked)*1000.0,
+				lutTotal/double(benchmarked)*1000.0,
+				lutTotal>0.0?legacyTotal/lutTotal:0.0,
+				benchmarked,
+				ignored);
+	}
+	else
+	{
+		printf("No depth image of the model size (%dx%d) found, %d ignored.\n", model.getWidth(), model.getHeight(), ignored);
+		return -1;
+	}
+	if(different)
+	{
+		printf("ERROR: %d/%d images are not identical after undistortion!\n", different, benchmarked);
+		return 1;
+	}
+	return 0;
+}
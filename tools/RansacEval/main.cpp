@@ -0,0 +1,298 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <rtabmap/core/Parameters.h>
+#include <rtabmap/core/CameraModel.h>
+#include <rtabmap/core/util3d_motion_estimation.h>
+#include <rtabmap/core/util3d_transforms.h>
+#include <rtabmap/utilite/ULogger.h>
+#include <rtabmap/utilite/UConversion.h>
+#include <rtabmap/utilite/UTimer.h>
+#include <opencv2/core/core.hpp>
+#include <stdio.h>
+#include <string.h>
+
+using namespace rtabmap;
+
+void showUsage()
+{
+	printf("\nUsage:\n"
+			"rtabmap-ransacEval [options] [Parameters]\n"
+			"  Compare the RANSAC implementations (Vis/RansacType=0 and Vis/RansacType=1)\n"
+			"  on the same synthetic correspondences, for PnP (3D->2D) and 3D->3D\n"
+			"  estimation. Inliers, error against ground truth, difference between\n"
+			"  both estimations and time are reported.\n"
+			"Options:\n"
+			"  --points #       Number of correspondences (default 500).\n"
+			"  --outliers #     Ratio of outliers [0,1[ (default 0.5).\n"
+			"  --noise #        Noise std-dev in pixels for PnP (default 0.5), for 3D->3D\n"
+			"                   it is scaled by depth/fx (default fx=525).\n"
+			"  --runs #         Number of random trials (default 20).\n"
+			"  --seed #         Random seed (default 0).\n"
+			"Parameters used: %s, %s, %s, %s, %s, %s and %s.\n"
+			"Example:\n"
+			"  $ rtabmap-ransacEval --points 300 --outliers 0.7 --Vis/Iterations 300\n\n",
+			Parameters::kVisMinInliers().c_str(),
+			Parameters::kVisIterations().c_str(),
+			Parameters::kVisPnPReprojError().c_str(),
+			Parameters::kVisPnPFlags().c_str(),
+			Parameters::kVisPnPRefineIterations().c_str(),
+			Parameters::kVisInlierDistance().c_str(),
+			Parameters::kVisRefineIterations().c_str());
+	exit(1);
+}
+
+struct Result
+{
+	Result() : success(0), inliers(0), errorLin(0), errorAng(0), time(0) {}
+	int success;
+	double inliers;
+	double errorLin;
+	double errorAng;
+	double time;
+};
+
+void addError(Result & result, const Transform & t, const Transform & gt, int inliers, double time)
+{
+	result.time += time;
+	if(!t.isNull())
+	{
+		Transform delta = gt.inverse() * t;
+		++result.success;
+		result.inliers += inliers;
+		result.errorLin += delta.getNorm();
+		result.errorAng += Eigen::AngleAxisf(delta.toEigen3f().rotation()).angle();
+	}
+}
+
+void printResult(const char * name, const Result & result, int runs)
+{
+	int n = result.success>0?result.success:1;
+	printf("   %-16s success=%d/%d inliers=%.1f error=%.4f m %.4f deg time=%.2f ms\n",
+			name,
+			result.success,
+			runs,
+			result.inliers/double(n),
+			result.errorLin/double(n),
+			result.errorAng/double(n)*180.0/CV_PI,
+			result.time/double(runs)*1000.0);
+}
+
+int main(int argc, char * argv[])
+{
+	ULogger::setType(ULogger::kTypeConsole);
+	ULogger::setLevel(ULogger::kWarning);
+
+	int points = 500;
+	float outliers = 0.5f;
+	float noise = 0.5f;
+	int runs = 20;
+	int seed = 0;
+	for(int i=1; i<argc; ++i)
+	{
+		if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			showUsage();
+		}
+		else if(strcmp(argv[i], "--points") == 0 && i+1<argc)
+		{
+			points = uStr2Int(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--outliers") == 0 && i+1<argc)
+		{
+			outliers = uStr2Float(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--noise") == 0 && i+1<argc)
+		{
+			noise = uStr2Float(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--runs") == 0 && i+1<argc)
+		{
+			runs = uStr2Int(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--seed") == 0 && i+1<argc)
+		{
+			seed = uStr2Int(argv[++i]);
+		}
+	}
+	if(points < 10 || outliers < 0.0f || outliers >= 1.0f || noise < 0.0f || runs < 1)
+	{
+		showUsage();
+	}
+
+	ParametersMap parameters = Parameters::parseArguments(argc, argv);
+	int minInliers = Parameters::defaultVisMinInliers();
+	int iterations = Parameters::defaultVisIterations();
+	float reprojError = Parameters::defaultVisPnPReprojError();
+	int flagsPnP = Parameters::defaultVisPnPFlags();
+	int refineIterationsPnP = Parameters::defaultVisPnPRefineIterations();
+	float inlierDistance = Parameters::defaultVisInlierDistance();
+	int refineIterations = Parameters::defaultVisRefineIterations();
+	Parameters::parse(parameters, Parameters::kVisMinInliers(), minInliers);
+	Parameters::parse(parameters, Parameters::kVisIterations(), iterations);
+	Parameters::parse(parameters, Parameters::kVisPnPReprojError(), reprojError);
+	Parameters::parse(parameters, Parameters::kVisPnPFlags(), flagsPnP);
+	Parameters::parse(parameters, Parameters::kVisPnPRefineIterations(), refineIterationsPnP);
+	Parameters::parse(parameters, Parameters::kVisInlierDistance(), inlierDistance);
+	Parameters::parse(parameters, Parameters::kVisRefineIterations(), refineIterations);
+
+	printf("Parameters:\n"
+			"   points=%d outliers=%.2f noise=%.2f px runs=%d seed=%d\n"
+			"   %s=%d %s=%d %s=%f %s=%d %s=%d %s=%f %s=%d\n",
+			points, outliers, noise, runs, seed,
+			Parameters::kVisMinInliers().c_str(), minInliers,
+			Parameters::kVisIterations().c_str(), iterations,
+			Parameters::kVisPnPReprojError().c_str(), reprojError,
+			Parameters::kVisPnPFlags().c_str(), flagsPnP,
+			Parameters::kVisPnPRefineIterations().c_str(), refineIterationsPnP,
+			Parameters::kVisInlierDistance().c_str(), inlierDistance,
+			Parameters::kVisRefineIterations().c_str(), refineIterations);
+
+	// camera looking forward in base frame (x forward)
+	const double fx = 525.0;
+	const int width = 640;
+	const int height = 480;
+	CameraModel model(fx, fx, width/2, height/2, Transform(0,0,1,0, -1,0,0,0, 0,-1,0,0));
+
+	cv::RNG rng(seed);
+	Result pnp[2];
+	Result rigid[2];
+	Result pnpParity;
+	Result rigidParity;
+	for(int r=0; r<runs; ++r)
+	{
+		// ground truth pose of B in A
+		Transform gt(
+				rng.uniform(-0.3f, 0.3f), rng.uniform(-0.1f, 0.1f), rng.uniform(-0.1f, 0.1f),
+				rng.uniform(-0.05f, 0.05f), rng.uniform(-0.05f, 0.05f), rng.uniform(-0.15f, 0.15f));
+		Transform gtInvCamera = (gt * model.localTransform()).inverse();
+
+		std::map<int, cv::Point3f> words3A;
+		std::map<int, cv::Point3f> words3B;
+		std::map<int, cv::KeyPoint> words2B;
+		int id = 1;
+		while((int)words2B.size() < points)
+		{
+			cv::Point3f ptA(rng.uniform(1.0f, 8.0f), rng.uniform(-3.0f, 3.0f), rng.uniform(-2.0f, 2.0f));
+			cv::Point3f ptCam = util3d::transformPoint(ptA, gtInvCamera);
+			if(ptCam.z <= 0.0f)
+			{
+				continue;
+			}
+			float u = fx*ptCam.x/ptCam.z + width/2;
+			float v = fx*ptCam.y/ptCam.z + height/2;
+			if(u < 0 || u >= width || v < 0 || v >= height)
+			{
+				continue;
+			}
+			cv::Point3f ptB = util3d::transformPoint(ptA, gt.inverse());
+			if(rng.uniform(0.0f, 1.0f) < outliers)
+			{
+				// wrong correspondence
+				u = rng.uniform(0.0f, float(width));
+				v = rng.uniform(0.0f, float(height));
+				ptB = cv::Point3f(rng.uniform(1.0f, 8.0f), rng.uniform(-3.0f, 3.0f), rng.uniform(-2.0f, 2.0f));
+			}
+			else
+			{
+				u += rng.gaussian(noise);
+				v += rng.gaussian(noise);
+				float sigma = noise * ptB.x / fx;
+				ptB.x += rng.gaussian(sigma);
+				ptB.y += rng.gaussian(sigma);
+				ptB.z += rng.gaussian(sigma);
+			}
+			words3A.insert(std::make_pair(id, ptA));
+			words3B.insert(std::make_pair(id, ptB));
+			words2B.insert(std::make_pair(id, cv::KeyPoint(u, v, 3)));
+			++id;
+		}
+
+		Transform tPnP[2];
+		Transform tRigid[2];
+		for(int type=0; type<2; ++type)
+		{
+			std::vector<int> inliers;
+			UTimer timer;
+			tPnP[type] = util3d::estimateMotion3DTo2D(
+					words3A,
+					words2B,
+					model,
+					minInliers,
+					iterations,
+					reprojError,
+					flagsPnP,
+					refineIterationsPnP,
+					Transform::getIdentity(),
+					std::map<int, cv::Point3f>(),
+					0,
+					0,
+					&inliers,
+					type);
+			addError(pnp[type], tPnP[type], gt, (int)inliers.size(), timer.ticks());
+
+			tRigid[type] = util3d::estimateMotion3DTo3D(
+					words3A,
+					words3B,
+					minInliers,
+					inlierDistance,
+					iterations,
+					refineIterations,
+					0,
+					0,
+					&inliers,
+					type);
+			addError(rigid[type], tRigid[type], gt, (int)inliers.size(), timer.ticks());
+		}
+		if(!tPnP[0].isNull() && !tPnP[1].isNull())
+		{
+			addError(pnpParity, tPnP[1], tPnP[0], 0, 0);
+		}
+		if(!tRigid[0].isNull() && !tRigid[1].isNull())
+		{
+			addError(rigidParity, tRigid[1], tRigid[0], 0, 0);
+		}
+	}
+
+	int expectedInliers = int(float(points)*(1.0f-outliers));
+	printf("PnP (3D->2D), ~%d inliers expected:\n", expectedInliers);
+	printResult("RansacType=0", pnp[0], runs);
+	printResult("RansacType=1", pnp[1], runs);
+	printf("   1 vs 0: both succeeded=%d/%d difference=%.4f m %.4f deg\n",
+			pnpParity.success, runs,
+			pnpParity.errorLin/double(pnpParity.success>0?pnpParity.success:1),
+			pnpParity.errorAng/double(pnpParity.success>0?pnpParity.success:1)*180.0/CV_PI);
+	printf("3D->3D, ~%d inliers expected:\n", expectedInliers);
+	printResult("RansacType=0", rigid[0], runs);
+	printResult("RansacType=1", rigid[1], runs);
+	printf("   1 vs 0: both succeeded=%d/%d difference=%.4f m %.4f deg\n",
+			rigidParity.success, runs,
+			rigidParity.errorLin/double(rigidParity.success>0?rigidParity.success:1),
+			rigidParity.errorAng/double(rigidParity.success>0?rigidParity.success:1)*180.0/CV_PI);
+
+	return 0;
+}
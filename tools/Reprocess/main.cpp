@@ -0,0 +1,409 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rtabmap/core/Rtabmap.h"
+#include "rtabmap/core/DBReader.h"
+#include "rtabmap/core/DBDriver.h"
+#include "rtabmap/core/Odometry.h"
+#include "rtabmap/core/OdometryInfo.h"
+#include "rtabmap/core/OdometryEvent.h"
+#include "rtabmap/core/CameraInfo.h"
+#include "rtabmap/utilite/ULogger.h"
+#include "rtabmap/utilite/UTimer.h"
+#include "rtabmap/utilite/UThread.h"
+#include "rtabmap/utilite/UMutex.h"
+#include "rtabmap/utilite/USemaphore.h"
+#include "rtabmap/utilite/UConversion.h"
+#include "rtabmap/utilite/UDirectory.h"
+#include "rtabmap/utilite/UFile.h"
+#include "rtabmap/utilite/UStl.h"
+#include <stdio.h>
+#include <signal.h>
+#include <list>
+
+using namespace rtabmap;
+
+void showUsage()
+{
+	printf("\nUsage:\n"
+			"rtabmap-reprocess [options] input.db output.db\n"
+			"  Re-process a database through odometry and RTAB-Map as fast as possible\n"
+			"  (recorded frame rate is ignored). Reading/decompression, odometry and\n"
+			"  SLAM are done in their own thread. Parameters saved in the input database\n"
+			"  are used, overridden by those set on the command line.\n"
+			"  input.db           Input database. Multiple databases can be set with \";\".\n"
+			"  output.db          Output database (overwritten).\n"
+			"Options:\n"
+			"  --db_odom          Use odometry recorded in the database instead of\n"
+			"                       recomputing it.\n"
+			"  --buffer #         Maximum frames buffered between stages (default 10).\n"
+			"  --start #          Start at node index # of the input database (default 0).\n"
+			"  --read_ahead #     Nodes read and uncompressed in advance by the database\n"
+			"                       reader, in parallel (default 0 = disabled).\n"
+			"%s\n"
+			"Example:\n\n"
+			"   $ rtabmap-reprocess \\\n"
+			"       --Vis/EstimationType 1\\\n"
+			"       --Rtabmap/DetectionRate 0\\\n"
+			"       ~/input.db ~/output.db\n\n", rtabmap::Parameters::showUsage());
+	exit(1);
+}
+
+// catch ctrl-c
+bool g_forever = true;
+void sighandler(int sig)
+{
+	printf("\nSignal %d caught...\n", sig);
+	g_forever = false;
+}
+
+struct Frame
+{
+	Frame() : readTime(0.0), odomTime(0.0) {}
+	SensorData data;
+	CameraInfo cameraInfo;
+	OdometryInfo odomInfo;
+	Transform pose;
+	cv::Mat covariance;
+	double readTime;
+	double odomTime;
+};
+
+/**
+ * Bounded FIFO between two stages. push() blocks when the queue is full,
+ * pop() blocks until a frame is available or the producer has finished.
+ */
+class FrameQueue
+{
+public:
+	FrameQueue(int maxSize) : free_(maxSize), finished_(false) {}
+
+	void push(const Frame & frame)
+	{
+		free_.acquire();
+		mutex_.lock();
+		frames_.push_back(frame);
+		mutex_.unlock();
+		available_.release();
+	}
+	void finish()
+	{
+		mutex_.lock();
+		finished_ = true;
+		mutex_.unlock();
+		available_.release();
+	}
+	bool pop(Frame & frame)
+	{
+		available_.acquire();
+		UScopeMutex lock(mutex_);
+		if(frames_.empty())
+		{
+			UASSERT(finished_);
+			available_.release(); // wake up next consumer
+			return false;
+		}
+		frame = frames_.front();
+		frames_.pop_front();
+		free_.release();
+		return true;
+	}
+
+private:
+	UMutex mutex_;
+	USemaphore available_;
+	USemaphore free_;
+	std::list<Frame> frames_;
+	bool finished_;
+};
+
+class ReaderStage : public UThread
+{
+public:
+	ReaderStage(DBReader * reader, FrameQueue * output) : reader_(reader), output_(output) {}
+	virtual ~ReaderStage() {join(true);}
+private:
+	virtual void mainLoop()
+	{
+		Frame frame;
+		UTimer timer;
+		frame.data = reader_->takeImage(&frame.cameraInfo); // read and uncompress
+		frame.readTime = timer.ticks();
+		if(!frame.data.isValid() || !g_forever)
+		{
+			output_->finish();
+			this->kill();
+			return;
+		}
+		frame.pose = frame.cameraInfo.odomPose;
+		frame.covariance = frame.cameraInfo.odomCovariance;
+		output_->push(frame);
+	}
+private:
+	DBReader * reader_;
+	FrameQueue * output_;
+};
+
+class OdometryStage : public UThread
+{
+public:
+	OdometryStage(Odometry * odom, FrameQueue * input, FrameQueue * output) : odom_(odom), input_(input), output_(output) {}
+	virtual ~OdometryStage() {join(true);}
+private:
+	virtual void mainLoop()
+	{
+		Frame frame;
+		if(!input_->pop(frame))
+		{
+			output_->finish();
+			this->kill();
+			return;
+		}
+		UTimer timer;
+		frame.pose = odom_->process(frame.data, &frame.odomInfo);
+		frame.covariance = frame.odomInfo.covariance;
+		frame.odomTime = timer.ticks();
+		output_->push(frame);
+	}
+private:
+	Odometry * odom_;
+	FrameQueue * input_;
+	FrameQueue * output_;
+};
+
+struct StageStats
+{
+	StageStats() : total(0.0), min(0.0), max(0.0), count(0) {}
+	void add(double t)
+	{
+		min = count==0?t:uMin(min, t);
+		max = count==0?t:uMax(max, t);
+		total += t;
+		++count;
+	}
+	void print(const char * name) const
+	{
+		printf("   %-12s mean=%7.2fms min=%7.2fms max=%7.2fms total=%8.2fs\n",
+				name, count?total*1000.0/double(count):0.0, min*1000.0, max*1000.0, total);
+	}
+	double total;
+	double min;
+	double max;
+	int count;
+};
+
+int main(int argc, char * argv[])
+{
+	signal(SIGABRT, &sighandler);
+	signal(SIGTERM, &sighandler);
+	signal(SIGINT, &sighandler);
+
+	ULogger::setType(ULogger::kTypeConsole);
+	ULogger::setLevel(ULogger::kWarning);
+
+	if(argc < 3)
+	{
+		showUsage();
+	}
+
+	bool dbOdom = false;
+	int bufferSize = 10;
+	int startIndex = 0;
+	int readAhead = 0;
+	for(int i=1; i<argc-2; ++i)
+	{
+		if(std::strcmp(argv[i], "--db_odom") == 0)
+		{
+			dbOdom = true;
+		}
+		else if(std::strcmp(argv[i], "--buffer") == 0 && i+1<argc-2)
+		{
+			bufferSize = uStr2Int(argv[++i]);
+			if(bufferSize <= 0)
+			{
+				printf("--buffer should be > 0\n");
+				showUsage();
+			}
+		}
+		else if(std::strcmp(argv[i], "--start") == 0 && i+1<argc-2)
+		{
+			startIndex = uStr2Int(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--read_ahead") == 0 && i+1<argc-2)
+		{
+			readAhead = uStr2Int(argv[++i]);
+		}
+	}
+	std::string inputPath = uReplaceChar(argv[argc-2], '~', UDirectory::homeDir());
+	std::string outputPath = uReplaceChar(argv[argc-1], '~', UDirectory::homeDir());
+	std::list<std::string> inputPaths = uSplit(inputPath, ';');
+	if(inputPaths.empty() || !UFile::exists(inputPaths.front()))
+	{
+		printf("Input database \"%s\" doesn't exist!\n", inputPath.c_str());
+		showUsage();
+	}
+	if(inputPaths.front().compare(outputPath) == 0)
+	{
+		printf("Output database should be different than the input database!\n");
+		showUsage();
+	}
+
+	// parameters of the input database, overridden by the arguments
+	ParametersMap parameters;
+	DBDriver * driver = DBDriver::create();
+	if(driver->openConnection(inputPaths.front()))
+	{
+		parameters = driver->getLastParameters();
+		driver->closeConnection(false);
+	}
+	delete driver;
+	ParametersMap customParameters = Parameters::parseArguments(argc, argv);
+	uInsert(parameters, customParameters);
+
+	printf("Paths:\n"
+			"   Input:  %s\n"
+			"   Output: %s\n"
+			"   Odometry: %s\n"
+			"   Buffer: %d\n"
+			"   Read ahead: %d\n",
+			inputPath.c_str(),
+			outputPath.c_str(),
+			dbOdom?"database":"recomputed",
+			bufferSize,
+			readAhead);
+	if(!customParameters.empty())
+	{
+		printf("Parameters:\n");
+		for(ParametersMap::iterator iter=customParameters.begin(); iter!=customParameters.end(); ++iter)
+		{
+			printf("   %s=%s\n", iter->first.c_str(), iter->second.c_str());
+		}
+	}
+
+	DBReader reader(inputPaths, 0.0f, dbOdom?false:true, true, true, startIndex); // 0 Hz = as fast as possible
+	reader.setReadAheadSize(readAhead);
+	if(!reader.init())
+	{
+		printf("Failed to initialize the database reader!\n");
+		return 1;
+	}
+
+	UFile::erase(outputPath);
+	Rtabmap rtabmap;
+	rtabmap.init(parameters, outputPath);
+
+	Odometry * odom = dbOdom?0:Odometry::create(parameters);
+	FrameQueue readQueue(bufferSize);
+	FrameQueue odomQueue(bufferSize);
+	ReaderStage readerStage(&reader, &readQueue);
+	OdometryStage * odomStage = odom?new OdometryStage(odom, &readQueue, &odomQueue):0;
+	FrameQueue & slamQueue = odom?odomQueue:readQueue;
+
+	StageStats readStats, odomStats, slamStats, waitStats;
+	int processed = 0;
+	int added = 0;
+	int loopClosures = 0;
+	int odomLost = 0;
+
+	UTimer totalTime;
+	readerStage.start();
+	if(odomStage)
+	{
+		odomStage->start();
+	}
+
+	Frame frame;
+	UTimer timer;
+	while(slamQueue.pop(frame))
+	{
+		waitStats.add(timer.ticks());
+		readStats.add(frame.readTime);
+		if(odomStage)
+		{
+			odomStats.add(frame.odomTime);
+		}
+
+		if(frame.pose.isNull())
+		{
+			++odomLost;
+		}
+		else
+		{
+			std::map<std::string, float> externalStats;
+			externalStats.insert(std::make_pair("Camera/TotalTime/ms", frame.readTime*1000.0f));
+			if(odomStage)
+			{
+				externalStats.insert(std::make_pair("Odometry/TotalTime/ms", frame.odomTime*1000.0f));
+				externalStats.insert(std::make_pair("Odometry/Inliers/", frame.odomInfo.inliers));
+				externalStats.insert(std::make_pair("Odometry/Features/", frame.odomInfo.features));
+			}
+			OdometryEvent e(SensorData(), Transform(), frame.odomInfo);
+			if(rtabmap.process(frame.data, frame.pose, frame.covariance, e.velocity(), externalStats))
+			{
+				++added;
+				if(rtabmap.getLoopClosureId()>0)
+				{
+					++loopClosures;
+				}
+			}
+		}
+		++processed;
+		slamStats.add(timer.ticks());
+
+		if(processed % 100 == 0)
+		{
+			printf("Processed %d frames (%.1f Hz), added=%d, loop closures=%d, odom lost=%d\n",
+					processed, double(processed)/totalTime.elapsed(), added, loopClosures, odomLost);
+		}
+	}
+	double total = totalTime.ticks();
+
+	readerStage.join(true);
+	if(odomStage)
+	{
+		odomStage->join(true);
+		delete odomStage;
+	}
+	delete odom;
+
+	printf("Processed %d frames in %.2fs (%.2f Hz)%s\n", processed, total, total>0.0?double(processed)/total:0.0, g_forever?"":" (interrupted)");
+	printf("   Nodes added=%d, loop closures=%d, odometry lost=%d\n", added, loopClosures, odomLost);
+	printf("Per-stage timing:\n");
+	readStats.print("read");
+	if(odomStats.count)
+	{
+		odomStats.print("odometry");
+	}
+	slamStats.print("slam");
+	waitStats.print("slam wait");
+
+	printf("Closing database \"%s\"...\n", outputPath.c_str());
+	rtabmap.close(true);
+	printf("Closing database \"%s\"... done!\n", outputPath.c_str());
+
+	return 0;
+}
@@ -25,7 +25,7 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#include <rtabmap/core/OdometryF2M.h>
+#include <rtabmap/core/Odometry.h>
 #include "rtabmap/core/Rtabmap.h"
 #include "rtabmap/core/CameraRGBD.h"
 #include "rtabmap/core/CameraThread.h"
@@ -191,7 +191,7 @@ int main(int argc, char * argv[])
 	{
 		int totalImages = (int)((CameraRGBDImages*)cameraThread.camera())->filenames().size();
 
-		OdometryF2M odom(parameters);
+		Odometry * odom = Odometry::create(parameters);
 		Rtabmap rtabmap;
 		rtabmap.init(parameters, databasePath);
 
@@ -206,6 +206,8 @@ int main(int argc, char * argv[])
 		/////////////////////////////
 		cv::Mat covariance;
 		double previousStamp = 0.0;
+		double odomTotalTime = 0.0;
+		double slamTotalTime = 0.0;
 		while(data.isValid() && g_forever)
 		{
 			std::map<std::string, float> externalStats;
@@ -223,7 +225,7 @@ int main(int argc, char * argv[])
 			externalStats.insert(std::make_pair("Camera/UndistortDepth/ms", cameraInfo.timeUndistortDepth*1000.0f));
 
 			OdometryInfo odomInfo;
-			Transform pose = odom.process(data, &odomInfo);
+			Transform pose = odom->process(data, &odomInfo);
 			externalStats.insert(std::make_pair("Odometry/LocalBundle/ms", odomInfo.localBundleTime*1000.0f));
 			externalStats.insert(std::make_pair("Odometry/TotalTime/ms", odomInfo.timeEstimation*1000.0f));
 			externalStats.insert(std::make_pair("Odometry/Inliers/ms", odomInfo.inliers));
@@ -266,6 +268,8 @@ int main(int argc, char * argv[])
 				covariance = cv::Mat();
 			}
 			double slamTime = timer.ticks();
+			odomTotalTime += odomInfo.timeEstimation;
+			slamTotalTime += slamTime;
 
 			++iteration;
 			printf("Iteration %d/%d: camera=%dms, odom(quality=%d/%d)=%dms, slam=%dms",
@@ -281,6 +285,11 @@ int main(int argc, char * argv[])
 			data = cameraThread.camera()->takeImage(&cameraInfo);
 		}
 		printf("Total time=%fs\n", totalTime.ticks());
+		if(iteration)
+		{
+			printf("Mean time: odom=%fms, slam=%fms\n", odomTotalTime*1000.0/iteration, slamTotalTime*1000.0/iteration);
+		}
+		delete odom;
 		/////////////////////////////
 		// Processing dataset end
 		/////////////////////////////
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rtabmap/core/util2d.h>
 #include <rtabmap/core/CameraModel.h>
 #include <rtabmap/core/Stereo.h>
+#include <rtabmap/core/StereoDense.h>
 #include <rtabmap/core/StereoCameraModel.h>
 #include <rtabmap/utilite/ULogger.h>
 #include <rtabmap/utilite/UStl.h>
@@ -47,7 +48,8 @@ void showUsage()
 	printf("Usage:\n"
 			"evalStereo.exe left.png right.png calib.txt disp.pfm mask.png [Parameters]\n"
 			"Example (with http://vision.middlebury.edu/stereo datasets):\n"
-			"  $ ./rtabmap-stereoEval im0.png im1.png calib.txt disp0GT.pfm mask0nocc.png -Kp/DetectorStrategy 6 -Stereo/WinSize 5 -Stereo/MaxLevel 2 -Kp/WordsPerImage 1000 -Stereo/OpticalFlow false -Stereo/Iterations 5\n\n");
+			"  $ ./rtabmap-stereoEval im0.png im1.png calib.txt disp0GT.pfm mask0nocc.png -Kp/DetectorStrategy 6 -Stereo/WinSize 5 -Stereo/MaxLevel 2 -Kp/WordsPerImage 1000 -Stereo/OpticalFlow false -Stereo/Iterations 5\n"
+			"  The dense disparity is also evaluated, set -Stereo/DenseStrategy 1 for SGM.\n\n");
 	exit(1);
 }
 
@@ -298,6 +300,12 @@ int main(int argc, char * argv[])
 
 		UINFO("Time: kpts:%f s, subpix=%f s, stereo=%f s", timeKpts, timeSubPixel, timeStereo);
 
+		// Dense disparity
+		StereoDense * stereoDense = StereoDense::create(parameters);
+		cv::Mat denseDisparity = stereoDense->computeDisparity(leftMono, rightMono);
+		delete stereoDense;
+		double timeDense = timer.ticks();
+
 		UDEBUG("Mask = %d", mask.type());
 
 		int inliers = 0;
@@ -408,6 +416,55 @@ int main(int argc, char * argv[])
 				(badRejected*100)/leftCorners.size());
 		UINFO("avg inliers =%f (subInliers=%f)", sumInliers/float(inliers), sumSubInliers/float(subInliers));
 
+		// Dense disparity errors on non-occluded pixels
+		int evaluated = 0;
+		int denseValid = 0;
+		int bad1 = 0;
+		int bad2 = 0;
+		float sumDenseError = 0.0f;
+		for(int y=0; y<denseDisparity.rows; ++y)
+		{
+			for(int x=0; x<denseDisparity.cols; ++x)
+			{
+				float gt = disp.at<float>(y, x);
+				if(uIsFinite(gt) && mask.at<cv::Vec3b>(y, x)[0] == 255)
+				{
+					++evaluated;
+					float d = float(denseDisparity.at<short>(y, x))/16.0f;
+					if(d > 0.0f)
+					{
+						++denseValid;
+						float err = fabs(d-gt);
+						sumDenseError += err;
+						if(err > 1.0f)
+						{
+							++bad1;
+						}
+						if(err > 2.0f)
+						{
+							++bad2;
+						}
+					}
+				}
+			}
+		}
+		int denseStrategy = Parameters::defaultStereoDenseStrategy();
+		Parameters::parse(parameters, Parameters::kStereoDenseStrategy(), denseStrategy);
+		UINFO("Dense disparity (%s): time=%f s, density=%d%% bad1.0=%d%% bad2.0=%d%% avg error=%f",
+				denseStrategy==1?"SGM":"BM",
+				timeDense,
+				evaluated?(denseValid*100)/evaluated:0,
+				denseValid?(bad1*100)/denseValid:0,
+				denseValid?(bad2*100)/denseValid:0,
+				denseValid?sumDenseError/float(denseValid):0.0f);
+
+		double maxDisparity = 0.0;
+		cv::minMaxLoc(denseDisparity, 0, &maxDisparity);
+		cv::Mat denseDisparity8U;
+		denseDisparity.convertTo(denseDisparity8U, CV_8UC1, maxDisparity>0.0?255.0/maxDisparity:1.0);
+		cv::namedWindow( "Dense disparity", cv::WINDOW_AUTOSIZE );
+		cv::imshow( "Dense disparity", denseDisparity8U );
+
 
 		cv::namedWindow( "Right", cv::WINDOW_AUTOSIZE );
 		cv::imshow( "Right", right );
@@ -0,0 +1,83 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rtabmap/utilite/UTrace.h"
+#include "rtabmap/utilite/ULogger.h"
+#include "rtabmap/utilite/UFile.h"
+#include "rtabmap/utilite/UConversion.h"
+#include <stdio.h>
+
+void showUsage()
+{
+	printf("\nUsage:\n"
+			"rtabmap-trace Trace.bin [trace.json]\n"
+			"  Convert a binary trace (see Rtabmap/TraceLogged parameter) to Chrome\n"
+			"  trace event format (JSON), which can be opened in chrome://tracing\n"
+			"  or https://ui.perfetto.dev.\n"
+			"  Trace.bin          Binary trace.\n"
+			"  trace.json         Output file (default: same name as input with json extension).\n\n");
+	exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+	ULogger::setType(ULogger::kTypeConsole);
+	ULogger::setLevel(ULogger::kWarning);
+
+	if(argc < 2 || argc > 3)
+	{
+		showUsage();
+	}
+
+	std::string input = argv[1];
+	if(!UFile::exists(input))
+	{
+		printf("Input trace \"%s\" doesn't exist!\n", input.c_str());
+		return -1;
+	}
+	std::string output;
+	if(argc == 3)
+	{
+		output = argv[2];
+	}
+	else
+	{
+		output = input.substr(0, input.size()-UFile::getExtension(input).size()) + "json";
+		if(UFile::getExtension(input).empty())
+		{
+			output = input + ".json";
+		}
+	}
+
+	if(!UTrace::convertToChromeTrace(input, output))
+	{
+		printf("Failed converting \"%s\"!\n", input.c_str());
+		return -1;
+	}
+	printf("Saved \"%s\".\n", output.c_str());
+	return 0;
+}
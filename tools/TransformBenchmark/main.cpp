@@ -0,0 +1,263 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <rtabmap/core/Parameters.h>
+#include <rtabmap/core/Transform.h>
+#include <rtabmap/core/Link.h>
+#include <rtabmap/core/Optimizer.h>
+#include <rtabmap/utilite/ULogger.h>
+#include <rtabmap/utilite/UConversion.h>
+#include <rtabmap/utilite/UStl.h>
+#include <rtabmap/utilite/UTimer.h>
+#include <rtabmap/utilite/UMath.h>
+#include <opencv2/core/core.hpp>
+#include <stdio.h>
+#include <string.h>
+
+using namespace rtabmap;
+
+void showUsage()
+{
+	printf("\nUsage:\n"
+			"rtabmap-transformBenchmark [options] [Parameters]\n"
+			"  Time Transform copy, composition and inversion, then the optimization\n"
+			"  of a synthetic pose graph. \"Legacy\" is the previous Transform\n"
+			"  implementation (cv::Mat storage, operations through Eigen 4x4 matrices)\n"
+			"  reproduced in this tool, so both are compared in the same binary. The\n"
+			"  graph optimization uses the library's Transform: build this tool on\n"
+			"  the previous revision to compare it.\n"
+			"Options:\n"
+			"  --ops #          Number of operations per Transform test (default 1000000).\n"
+			"  --nodes #        Number of nodes of the graph (default 20000, 0=no graph).\n"
+			"  --seed #         Random seed (default 0).\n"
+			"Parameters used: %s, %s, %s.\n"
+			"Example:\n"
+			"  $ rtabmap-transformBenchmark --nodes 20000 --Optimizer/Strategy 1\n\n",
+			Parameters::kOptimizerStrategy().c_str(),
+			Parameters::kOptimizerIterations().c_str(),
+			Parameters::kOptimizerEpsilon().c_str());
+	exit(1);
+}
+
+// Previous Transform implementation
+class LegacyTransform
+{
+public:
+	LegacyTransform() : data_(cv::Mat::zeros(3,4,CV_32FC1)) {}
+	LegacyTransform(
+			float r11, float r12, float r13, float o14,
+			float r21, float r22, float r23, float o24,
+			float r31, float r32, float r33, float o34)
+	{
+		data_ = (cv::Mat_<float>(3,4) <<
+				r11, r12, r13, o14,
+				r21, r22, r23, o24,
+				r31, r32, r33, o34);
+	}
+	LegacyTransform(const Transform & t)
+	{
+		*this = LegacyTransform(
+				t.r11(), t.r12(), t.r13(), t.x(),
+				t.r21(), t.r22(), t.r23(), t.y(),
+				t.r31(), t.r32(), t.r33(), t.z());
+	}
+	const float * data() const {return (const float *)data_.data;}
+	float x() const {return data()[3];}
+
+	Eigen::Matrix4f toEigen4f() const
+	{
+		Eigen::Matrix4f m;
+		m << data()[0], data()[1], data()[2], data()[3],
+			 data()[4], data()[5], data()[6], data()[7],
+			 data()[8], data()[9], data()[10], data()[11],
+			 0,0,0,1;
+		return m;
+	}
+	static LegacyTransform fromEigen4f(const Eigen::Matrix4f & matrix)
+	{
+		return LegacyTransform(matrix(0,0), matrix(0,1), matrix(0,2), matrix(0,3),
+						 matrix(1,0), matrix(1,1), matrix(1,2), matrix(1,3),
+						 matrix(2,0), matrix(2,1), matrix(2,2), matrix(2,3));
+	}
+	LegacyTransform operator*(const LegacyTransform & t) const
+	{
+		return fromEigen4f(toEigen4f()*t.toEigen4f());
+	}
+	LegacyTransform inverse() const
+	{
+		return fromEigen4f(toEigen4f().inverse());
+	}
+
+private:
+	cv::Mat data_;
+};
+
+template<class T>
+void benchmark(const char * name, const std::vector<T> & transforms, int ops)
+{
+	UTimer timer;
+	double checksum = 0.0;
+
+	// copy
+	int copies = 0;
+	while(copies < ops)
+	{
+		std::vector<T> tmp(transforms);
+		checksum += tmp.back().x();
+		copies += (int)tmp.size();
+	}
+	double copyTime = timer.ticks();
+
+	// compose
+	T acc = transforms[0];
+	for(int i=0; i<ops; ++i)
+	{
+		acc = acc * transforms[i%transforms.size()];
+	}
+	checksum += acc.x();
+	double composeTime = timer.ticks();
+
+	// inverse
+	for(int i=0; i<ops; ++i)
+	{
+		checksum += transforms[i%transforms.size()].inverse().x();
+	}
+	double inverseTime = timer.ticks();
+
+	printf("   %-10s copy=%.1f ns compose=%.1f ns inverse=%.1f ns (checksum=%f)\n",
+			name,
+			copyTime/double(copies)*1e9,
+			composeTime/double(ops)*1e9,
+			inverseTime/double(ops)*1e9,
+			checksum);
+}
+
+int main(int argc, char * argv[])
+{
+	ULogger::setType(ULogger::kTypeConsole);
+	ULogger::setLevel(ULogger::kWarning);
+
+	int ops = 1000000;
+	int nodes = 20000;
+	int seed = 0;
+	for(int i=1; i<argc; ++i)
+	{
+		if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			showUsage();
+		}
+		else if(strcmp(argv[i], "--ops") == 0 && i+1<argc)
+		{
+			ops = uStr2Int(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--nodes") == 0 && i+1<argc)
+		{
+			nodes = uStr2Int(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--seed") == 0 && i+1<argc)
+		{
+			seed = uStr2Int(argv[++i]);
+		}
+	}
+	if(ops < 1 || nodes < 0)
+	{
+		showUsage();
+	}
+	ParametersMap parameters = Parameters::parseArguments(argc, argv);
+
+	cv::RNG rng(seed);
+	std::vector<Transform> transforms(1000);
+	std::vector<LegacyTransform> legacyTransforms(transforms.size());
+	for(unsigned int i=0; i<transforms.size(); ++i)
+	{
+		transforms[i] = Transform(
+				rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f),
+				rng.uniform(-0.1f, 0.1f), rng.uniform(-0.1f, 0.1f), rng.uniform(-0.1f, 0.1f));
+		legacyTransforms[i] = LegacyTransform(transforms[i]);
+	}
+
+	printf("Transform (%d operations, mean time per operation):\n", ops);
+	benchmark("Legacy", legacyTransforms, ops);
+	benchmark("Transform", transforms, ops);
+
+	if(nodes > 1)
+	{
+		// Square laps of 400 nodes (10 cm steps), odometry links with drift, and a
+		// loop closure every 10 nodes with the node at the same place on the previous lap.
+		const int lap = 400;
+		std::map<int, Transform> groundTruth;
+		std::map<int, Transform> poses;
+		std::multimap<int, Link> links;
+		Transform step(0.1f, 0, 0, 0, 0, 0);
+		Transform turn(0.1f, 0, 0, 0, 0, CV_PI/2.0f);
+		groundTruth.insert(std::make_pair(1, Transform::getIdentity()));
+		poses.insert(std::make_pair(1, Transform::getIdentity()));
+		for(int id=2; id<=nodes; ++id)
+		{
+			Transform motion = (id-1)%(lap/4)==0?turn:step;
+			groundTruth.insert(std::make_pair(id, groundTruth.at(id-1) * motion));
+			Transform odom = motion * Transform(
+					rng.gaussian(0.005), rng.gaussian(0.005), rng.gaussian(0.001),
+					rng.gaussian(0.0005), rng.gaussian(0.0005), rng.gaussian(0.002));
+			poses.insert(std::make_pair(id, poses.at(id-1) * odom));
+			links.insert(std::make_pair(id-1, Link(id-1, id, Link::kNeighbor, odom)));
+			if(id > lap && id%10 == 0)
+			{
+				int to = id-lap;
+				links.insert(std::make_pair(id, Link(id, to, Link::kGlobalClosure, groundTruth.at(id).inverse() * groundTruth.at(to))));
+			}
+		}
+
+		Optimizer * optimizer = Optimizer::create(parameters);
+		UTimer timer;
+		double finalError = 0.0;
+		int iterationsDone = 0;
+		std::map<int, Transform> optimizedPoses = optimizer->optimize(1, poses, links, 0, &finalError, &iterationsDone);
+		double time = timer.ticks();
+		delete optimizer;
+
+		float rmse = 0.0f;
+		for(std::map<int, Transform>::iterator iter=optimizedPoses.begin(); iter!=optimizedPoses.end(); ++iter)
+		{
+			rmse += iter->second.getDistanceSquared(groundTruth.at(iter->first));
+		}
+		rmse = optimizedPoses.size()?sqrt(rmse/float(optimizedPoses.size())):0.0f;
+
+		printf("Graph optimization (%d nodes, %d links, %s=%s):\n"
+				"   time=%.3f s iterations=%d error=%f rmse=%.3f m\n",
+				nodes,
+				(int)links.size(),
+				Parameters::kOptimizerStrategy().c_str(),
+				uValue(parameters, Parameters::kOptimizerStrategy(), uNumber2Str(Parameters::defaultOptimizerStrategy())).c_str(),
+				time,
+				iterationsDone,
+				finalError,
+				rmse);
+	}
+
+	return 0;
+}
@@ -0,0 +1,211 @@
+/*
+Copyright (c) 2010-2016, Mathieu Labbe - IntRoLab - Universite de Sherbrooke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Universite de Sherbrooke nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rtabmap/core/DBDriver.h"
+#include "rtabmap/core/Optimizer.h"
+#include "rtabmap/core/TSDFVolume.h"
+#include "rtabmap/core/Link.h"
+#include "rtabmap/utilite/ULogger.h"
+#include "rtabmap/utilite/UTimer.h"
+#include "rtabmap/utilite/UConversion.h"
+#include "rtabmap/utilite/UFile.h"
+#include "rtabmap/utilite/UDirectory.h"
+#include "rtabmap/utilite/UStl.h"
+#include <pcl/io/ply_io.h>
+#include <stdio.h>
+
+using namespace rtabmap;
+
+void showUsage()
+{
+	printf("\nUsage:\n"
+			"rtabmap-tsdf [options] input.db output.ply\n"
+			"  Fuse the depth images of a database in a TSDF volume (voxel hashing)\n"
+			"  using the optimized poses of the last map, then export the mesh.\n"
+			"  Parameters saved in the database are used for the graph optimization,\n"
+			"  overridden by those set on the command line.\n"
+			"Options:\n"
+			"  --voxel #          Voxel size (default 0.01 m).\n"
+			"  --trunc #          Truncation distance (default 0.04 m).\n"
+			"  --max_depth #      Maximum depth integrated (default 4 m, 0=inf).\n"
+			"  --min_weight #     Minimum voxel weight for meshing (default 0).\n"
+			"  --reintegrate      Integrate with odometry poses first, then re-integrate\n"
+			"                       the nodes moved by the graph optimization.\n"
+			"%s\n"
+			"Example:\n\n"
+			"   $ rtabmap-tsdf --voxel 0.02 --trunc 0.08 ~/input.db ~/mesh.ply\n\n", rtabmap::Parameters::showUsage());
+	exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+	ULogger::setType(ULogger::kTypeConsole);
+	ULogger::setLevel(ULogger::kWarning);
+
+	if(argc < 3)
+	{
+		showUsage();
+	}
+
+	float voxelSize = 0.01f;
+	float truncation = 0.04f;
+	float maxDepth = 4.0f;
+	float minWeight = 0.0f;
+	bool reintegrate = false;
+	for(int i=1; i<argc-2; ++i)
+	{
+		if(std::strcmp(argv[i], "--voxel") == 0 && i+1<argc-2)
+		{
+			voxelSize = uStr2Float(argv[++i]);
+			if(voxelSize <= 0.0f)
+			{
+				printf("--voxel should be > 0\n");
+				showUsage();
+			}
+		}
+		else if(std::strcmp(argv[i], "--trunc") == 0 && i+1<argc-2)
+		{
+			truncation = uStr2Float(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--max_depth") == 0 && i+1<argc-2)
+		{
+			maxDepth = uStr2Float(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--min_weight") == 0 && i+1<argc-2)
+		{
+			minWeight = uStr2Float(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--reintegrate") == 0)
+		{
+			reintegrate = true;
+		}
+	}
+	ParametersMap inputParams = Parameters::parseArguments(argc, argv);
+
+	std::string inputDatabasePath = uReplaceChar(argv[argc-2], '~', UDirectory::homeDir());
+	std::string outputPath = uReplaceChar(argv[argc-1], '~', UDirectory::homeDir());
+	if(!UFile::exists(inputDatabasePath))
+	{
+		printf("Input database \"%s\" doesn't exist!\n", inputDatabasePath.c_str());
+		return -1;
+	}
+
+	DBDriver * dbDriver = DBDriver::create();
+	if(!dbDriver->openConnection(inputDatabasePath))
+	{
+		printf("Failed opening database \"%s\"!\n", inputDatabasePath.c_str());
+		delete dbDriver;
+		return -1;
+	}
+	ParametersMap parameters = dbDriver->getLastParameters();
+	uInsert(parameters, inputParams);
+
+	// Graph of the last map
+	std::set<int> ids;
+	dbDriver->getAllNodeIds(ids, false, true);
+	std::map<int, Transform> odomPoses;
+	for(std::set<int>::iterator iter=ids.begin(); iter!=ids.end(); ++iter)
+	{
+		Transform pose, gt;
+		int mapId, weight;
+		std::string label;
+		double stamp;
+		std::vector<float> velocity;
+		if(dbDriver->getNodeInfo(*iter, pose, mapId, weight, label, stamp, gt, velocity) && !pose.isNull())
+		{
+			odomPoses.insert(std::make_pair(*iter, pose));
+		}
+	}
+	if(odomPoses.empty())
+	{
+		printf("No poses found in database \"%s\"!\n", inputDatabasePath.c_str());
+		dbDriver->closeConnection(false);
+		delete dbDriver;
+		return -1;
+	}
+	std::multimap<int, Link> links;
+	dbDriver->getAllLinks(links, true);
+
+	UTimer timer;
+	Optimizer * optimizer = Optimizer::create(parameters);
+	std::map<int, Transform> posesIn;
+	std::multimap<int, Link> linksIn;
+	optimizer->getConnectedGraph(odomPoses.rbegin()->first, odomPoses, links, posesIn, linksIn);
+	std::map<int, Transform> poses = optimizer->optimize(posesIn.begin()->first, posesIn, linksIn);
+	delete optimizer;
+	if(poses.empty())
+	{
+		printf("Graph optimization failed!\n");
+		dbDriver->closeConnection(false);
+		delete dbDriver;
+		return -1;
+	}
+	printf("Optimized %d poses (%d links): %fs\n", (int)poses.size(), (int)linksIn.size(), timer.ticks());
+
+	TSDFVolume volume(voxelSize, truncation, maxDepth, reintegrate);
+	int i=0;
+	for(std::map<int, Transform>::iterator iter=poses.begin(); iter!=poses.end(); ++iter)
+	{
+		SensorData data;
+		dbDriver->getNodeData(iter->first, data, true, false, false, false);
+		data.uncompressData();
+		const Transform & pose = reintegrate?odomPoses.at(iter->first):iter->second;
+		if(!volume.integrate(iter->first, data, pose))
+		{
+			printf("Node %d: no valid depth image or calibration, ignored.\n", iter->first);
+		}
+		if(++i % 100 == 0)
+		{
+			printf("Integrated %d/%d nodes (%d blocks, %ld MB)\n", i, (int)poses.size(), volume.blocks(), volume.memoryUsage()/(1024*1024));
+		}
+	}
+	dbDriver->closeConnection(false);
+	delete dbDriver;
+	printf("Integrated %d nodes (%d blocks, %ld MB): %fs\n", (int)volume.addedNodes().size(), volume.blocks(), volume.memoryUsage()/(1024*1024), timer.ticks());
+
+	if(reintegrate)
+	{
+		int updated = volume.update(poses);
+		printf("Re-integrated %d nodes: %fs\n", updated, timer.ticks());
+	}
+
+	pcl::PolygonMesh::Ptr mesh = volume.extractMesh(minWeight);
+	printf("Extracted mesh (%d vertices, %d polygons): %fs\n", (int)(mesh->cloud.width*mesh->cloud.height), (int)mesh->polygons.size(), timer.ticks());
+	if(mesh->polygons.empty())
+	{
+		printf("Empty mesh, nothing saved.\n");
+		return -1;
+	}
+	if(pcl::io::savePLYFileBinary(outputPath, *mesh) != 0)
+	{
+		printf("Failed saving \"%s\"!\n", outputPath.c_str());
+		return -1;
+	}
+	printf("Saved \"%s\".\n", outputPath.c_str());
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+*  utilite is a cross-platform library with
+*  useful utilities for fast and small developing.
+*  Copyright (C) 2010  Mathieu Labbe
+*
+*  utilite is free library: you can redistribute it and/or modify
+*  it under the terms of the GNU Lesser General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  utilite is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Lesser General Public License for more details.
+*
+*  You should have received a copy of the GNU Lesser General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UTRACE_H
+#define UTRACE_H
+
+#include "rtabmap/utilite/UtiLiteExp.h" // DLL export/import defines
+
+#include <string>
+
+/**
+ * Low overhead tracing of timed scopes (spans) in all threads. Each thread
+ * records its spans in its own ring buffer, without lock (when a buffer is
+ * full, the oldest spans are overwritten). The spans recorded since the
+ * last write() are appended to a compact binary file, which can be
+ * converted to the Chrome trace event format (JSON) to be viewed in
+ * chrome://tracing or https://ui.perfetto.dev. Threads registered with
+ * ULogger::registerCurrentThread() are named in the trace.
+ *
+ * Span names must be string literals (only their address is recorded).
+ * When tracing is disabled, a scope costs only a boolean check.
+ * Example:
+ * @code
+ *      UTrace::setEnabled(true);
+ *      ...
+ *      void Memory::update(...)
+ *      {
+ *          UTRACE("Memory::update");
+ *          ...
+ *      }
+ *      ...
+ *      UTrace::write("trace.bin");
+ *      UTrace::convertToChromeTrace("trace.bin", "trace.json");
+ * @endcode
+ */
+class UTILITE_EXP UTrace
+{
+public:
+	/**
+	 * Enable or disable recording of the spans.
+	 */
+	static void setEnabled(bool enabled) {enabled_ = enabled;}
+	static bool isEnabled() {return enabled_;}
+
+	/**
+	 * Maximum spans kept by a thread between two write() (default 65536).
+	 * Only buffers of threads recording their first span after this call are affected.
+	 */
+	static void setBufferSize(unsigned int spans);
+
+	/**
+	 * Monotonic time in nanoseconds.
+	 */
+	static unsigned long long now();
+
+	/**
+	 * Record a span of the current thread, see UTraceScope.
+	 */
+	static void record(const char * name, unsigned long long start, unsigned long long end);
+
+	/**
+	 * Append the spans recorded since the last call to the binary file.
+	 * @param path the binary file, created if it doesn't exist
+	 * @return false if the file cannot be opened
+	 */
+	static bool write(const std::string & path);
+
+	/**
+	 * Drop the spans recorded so far.
+	 */
+	static void clear();
+
+	/**
+	 * Convert a binary trace file (see write()) to Chrome trace event format (JSON).
+	 * @return false if a file cannot be opened or the binary file is corrupted
+	 */
+	static bool convertToChromeTrace(const std::string & binaryPath, const std::string & jsonPath);
+
+private:
+	static bool enabled_;
+};
+
+/**
+ * Record the time spent in the scope where it is declared, see UTRACE().
+ */
+class UTILITE_EXP UTraceScope
+{
+public:
+	UTraceScope(const char * name) :
+		name_(UTrace::isEnabled()?name:0),
+		start_(name_?UTrace::now():0)
+	{}
+	~UTraceScope()
+	{
+		if(name_)
+		{
+			UTrace::record(name_, start_, UTrace::now());
+		}
+	}
+
+private:
+	const char * name_;
+	unsigned long long start_;
+};
+
+#define UTRACE_CONCAT2(a, b) a##b
+#define UTRACE_CONCAT(a, b) UTRACE_CONCAT2(a, b)
+/**
+ * Trace the current scope, name should be a string literal.
+ * @code
+ *      UTRACE("Odometry::process");
+ * @endcode
+ */
+#define UTRACE(name) UTraceScope UTRACE_CONCAT(uTraceScope, __LINE__)(name)
+
+#endif // UTRACE_H
@@ -247,6 +247,7 @@
 #include "rtabmap/utilite/USemaphore.h"
 #include "rtabmap/utilite/UThreadNode.h"
 #include "rtabmap/utilite/UTimer.h"
+#include "rtabmap/utilite/UTrace.h"
 #include "rtabmap/utilite/UVariant.h"
 #include "rtabmap/utilite/UMath.h"
 
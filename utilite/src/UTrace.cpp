@@ -0,0 +1,455 @@
+/*
+*  utilite is a cross-platform library with
+*  useful utilities for fast and small developing.
+*  Copyright (C) 2010  Mathieu Labbe
+*
+*  utilite is free library: you can redistribute it and/or modify
+*  it under the terms of the GNU Lesser General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  utilite is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Lesser General Public License for more details.
+*
+*  You should have received a copy of the GNU Lesser General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "rtabmap/utilite/UTrace.h"
+#include "rtabmap/utilite/UThread.h"
+#include "rtabmap/utilite/UMutex.h"
+#include "rtabmap/utilite/ULogger.h"
+#include <stdio.h>
+#include <string.h>
+#include <list>
+#include <map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef _MSC_VER
+#define UTRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define UTRACE_THREAD_LOCAL __thread
+#endif
+
+// Full memory barrier: record() publishes a span before the new head, and
+// write() reads the head before the spans (C++11 atomics are not required).
+#ifdef _WIN32
+#define UTRACE_MEMORY_BARRIER() MemoryBarrier()
+#else
+#define UTRACE_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+// Binary file: a sequence of chunks (one per write()), native byte order:
+//   char[4] "UTRC", uint32 version
+//   uint32 names, for each: uint32 length, chars
+//   uint32 threads, for each: uint64 id, uint32 name length, chars,
+//       uint32 spans, for each: uint32 name index, uint64 start (ns), uint64 duration (ns)
+static const char kTraceMagic[4] = {'U', 'T', 'R', 'C'};
+static const unsigned int kTraceVersion = 1;
+
+class UTraceSpan
+{
+public:
+	const char * name;
+	unsigned long long start;
+	unsigned long long duration;
+};
+
+// Written only by its thread, read by write() under the buffers mutex.
+class UTraceBuffer
+{
+public:
+	UTraceBuffer(unsigned int size, unsigned long threadId) :
+		spans(size),
+		mask(size-1),
+		head(0),
+		written(0),
+		threadId(threadId)
+	{}
+	std::vector<UTraceSpan> spans;
+	unsigned long mask;
+	volatile unsigned long head; // spans recorded
+	unsigned long written; // spans already written
+	unsigned long threadId;
+};
+
+bool UTrace::enabled_ = false;
+
+static unsigned int g_traceBufferSize = 65536; // power of 2
+static UMutex g_traceBuffersMutex;
+static std::list<UTraceBuffer*> g_traceBuffers; // never deleted, threads may still use them
+static UTRACE_THREAD_LOCAL UTraceBuffer * g_traceThreadBuffer = 0;
+
+void UTrace::setBufferSize(unsigned int spans)
+{
+	unsigned int size = 1;
+	while(size < spans)
+	{
+		size *= 2;
+	}
+	g_traceBufferSize = size;
+}
+
+unsigned long long UTrace::now()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = {0};
+	if(frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return (unsigned long long)(count.QuadPart / frequency.QuadPart) * 1000000000ULL +
+			(unsigned long long)(count.QuadPart % frequency.QuadPart) * 1000000000ULL / (unsigned long long)frequency.QuadPart;
+#elif defined(__APPLE__)
+	static mach_timebase_info_data_t timebase = {0, 0};
+	if(timebase.denom == 0)
+	{
+		mach_timebase_info(&timebase);
+	}
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+void UTrace::record(const char * name, unsigned long long start, unsigned long long end)
+{
+	UTraceBuffer * buffer = g_traceThreadBuffer;
+	if(buffer == 0)
+	{
+		buffer = new UTraceBuffer(g_traceBufferSize, UThread::currentThreadId());
+		g_traceBuffersMutex.lock();
+		g_traceBuffers.push_back(buffer);
+		g_traceBuffersMutex.unlock();
+		g_traceThreadBuffer = buffer;
+	}
+	UTraceSpan & span = buffer->spans[buffer->head & buffer->mask];
+	span.name = name;
+	span.start = start;
+	span.duration = end>start?end-start:0;
+	UTRACE_MEMORY_BARRIER(); // the span is visible before the new head
+	buffer->head = buffer->head + 1;
+}
+
+static void writeU32(FILE * file, unsigned int value)
+{
+	fwrite(&value, sizeof(unsigned int), 1, file);
+}
+static void writeU64(FILE * file, unsigned long long value)
+{
+	fwrite(&value, sizeof(unsigned long long), 1, file);
+}
+static void writeString(FILE * file, const std::string & value)
+{
+	writeU32(file, (unsigned int)value.size());
+	fwrite(value.c_str(), 1, value.size(), file);
+}
+
+bool UTrace::write(const std::string & path)
+{
+	UScopeMutex lock(g_traceBuffersMutex);
+
+	// Copy the new spans of each thread
+	std::vector<unsigned long> threadIds;
+	std::vector<std::vector<UTraceSpan> > threadSpans;
+	unsigned long dropped = 0;
+	for(std::list<UTraceBuffer*>::iterator iter=g_traceBuffers.begin(); iter!=g_traceBuffers.end(); ++iter)
+	{
+		UTraceBuffer * buffer = *iter;
+		unsigned long size = buffer->spans.size();
+		unsigned long head = buffer->head;
+		UTRACE_MEMORY_BARRIER(); // read the spans published up to head
+		unsigned long first = buffer->written;
+		if(head - first > size)
+		{
+			dropped += head - first - size;
+			first = head - size;
+		}
+		std::vector<UTraceSpan> spans(head - first);
+		for(unsigned long i=first; i!=head; ++i)
+		{
+			spans[i-first] = buffer->spans[i & buffer->mask];
+		}
+
+		// The thread may have recorded while copying: spans up to the new head
+		// (and the one being recorded) overwrote the oldest copied slots.
+		UTRACE_MEMORY_BARRIER();
+		unsigned long overwritten = buffer->head + 1 - first;
+		overwritten = overwritten>size?overwritten-size:0;
+		if(overwritten > spans.size())
+		{
+			overwritten = spans.size();
+		}
+		if(overwritten)
+		{
+			dropped += overwritten;
+			spans.erase(spans.begin(), spans.begin()+overwritten);
+		}
+		if(!spans.empty())
+		{
+			threadIds.push_back(buffer->threadId);
+			threadSpans.push_back(spans);
+		}
+		buffer->written = head;
+	}
+	if(dropped)
+	{
+		UWARN("%lu trace spans were overwritten before being written, "
+			  "increase the buffer size or write the trace more often.", dropped);
+	}
+	if(threadIds.empty())
+	{
+		return true;
+	}
+
+	FILE * file = 0;
+#ifdef _MSC_VER
+	fopen_s(&file, path.c_str(), "ab");
+#else
+	file = fopen(path.c_str(), "ab");
+#endif
+	if(file == 0)
+	{
+		UERROR("Cannot open trace file \"%s\"", path.c_str());
+		return false;
+	}
+
+	// Names are string literals, the same name could have different addresses
+	std::map<const char *, unsigned int> nameIdsByAddress;
+	std::map<std::string, unsigned int> nameIds;
+	std::vector<std::string> names;
+	for(unsigned int i=0; i<threadSpans.size(); ++i)
+	{
+		for(unsigned int j=0; j<threadSpans[i].size(); ++j)
+		{
+			const char * name = threadSpans[i][j].name;
+			if(nameIdsByAddress.find(name) == nameIdsByAddress.end())
+			{
+				std::map<std::string, unsigned int>::iterator jter = nameIds.find(name);
+				if(jter == nameIds.end())
+				{
+					jter = nameIds.insert(std::make_pair(std::string(name), (unsigned int)names.size())).first;
+					names.push_back(name);
+				}
+				nameIdsByAddress.insert(std::make_pair(name, jter->second));
+			}
+		}
+	}
+
+	std::map<unsigned long, std::string> threadNames;
+	std::map<std::string, unsigned long> registeredThreads = ULogger::getRegisteredThreads();
+	for(std::map<std::string, unsigned long>::iterator iter=registeredThreads.begin(); iter!=registeredThreads.end(); ++iter)
+	{
+		threadNames.insert(std::make_pair(iter->second, iter->first));
+	}
+
+	fwrite(kTraceMagic, 1, 4, file);
+	writeU32(file, kTraceVersion);
+	writeU32(file, (unsigned int)names.size());
+	for(unsigned int i=0; i<names.size(); ++i)
+	{
+		writeString(file, names[i]);
+	}
+	writeU32(file, (unsigned int)threadIds.size());
+	for(unsigned int i=0; i<threadIds.size(); ++i)
+	{
+		writeU64(file, threadIds[i]);
+		std::map<unsigned long, std::string>::iterator nameIter = threadNames.find(threadIds[i]);
+		writeString(file, nameIter!=threadNames.end()?nameIter->second:"");
+		writeU32(file, (unsigned int)threadSpans[i].size());
+		for(unsigned int j=0; j<threadSpans[i].size(); ++j)
+		{
+			writeU32(file, nameIdsByAddress.at(threadSpans[i][j].name));
+			writeU64(file, threadSpans[i][j].start);
+			writeU64(file, threadSpans[i][j].duration);
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+void UTrace::clear()
+{
+	UScopeMutex lock(g_traceBuffersMutex);
+	for(std::list<UTraceBuffer*>::iterator iter=g_traceBuffers.begin(); iter!=g_traceBuffers.end(); ++iter)
+	{
+		(*iter)->written = (*iter)->head;
+	}
+}
+
+static bool readU32(FILE * file, unsigned int & value)
+{
+	return fread(&value, sizeof(unsigned int), 1, file) == 1;
+}
+static bool readU64(FILE * file, unsigned long long & value)
+{
+	return fread(&value, sizeof(unsigned long long), 1, file) == 1;
+}
+static bool readString(FILE * file, std::string & value)
+{
+	unsigned int size = 0;
+	if(!readU32(file, size) || size > 4096)
+	{
+		return false;
+	}
+	value.resize(size);
+	return size == 0 || fread(&value[0], 1, size, file) == size;
+}
+
+class UTraceEvent
+{
+public:
+	int name;
+	int tid;
+	unsigned long long start;
+	unsigned long long duration;
+};
+
+static std::string jsonEscape(const std::string & value)
+{
+	std::string out;
+	for(unsigned int i=0; i<value.size(); ++i)
+	{
+		char c = value[i];
+		if(c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if((unsigned char)c < 0x20)
+		{
+			out += ' ';
+		}
+		else
+		{
+			out += c;
+		}
+	}
+	return out;
+}
+
+bool UTrace::convertToChromeTrace(const std::string & binaryPath, const std::string & jsonPath)
+{
+	FILE * in = 0;
+#ifdef _MSC_VER
+	fopen_s(&in, binaryPath.c_str(), "rb");
+#else
+	in = fopen(binaryPath.c_str(), "rb");
+#endif
+	if(in == 0)
+	{
+		UERROR("Cannot open trace file \"%s\"", binaryPath.c_str());
+		return false;
+	}
+
+	std::vector<std::string> names;
+	std::vector<UTraceEvent> events;
+	std::map<unsigned long long, int> tids;
+	std::map<int, std::string> threadNames;
+	unsigned long long origin = 0;
+	bool valid = true;
+	char magic[4];
+	while(valid && fread(magic, 1, 4, in) == 4)
+	{
+		unsigned int version = 0;
+		unsigned int nameCount = 0;
+		unsigned int threadCount = 0;
+		valid = memcmp(magic, kTraceMagic, 4) == 0 && readU32(in, version) && version == kTraceVersion && readU32(in, nameCount);
+		int nameOffset = (int)names.size();
+		for(unsigned int i=0; valid && i<nameCount; ++i)
+		{
+			std::string name;
+			valid = readString(in, name);
+			names.push_back(name);
+		}
+		valid = valid && readU32(in, threadCount);
+		for(unsigned int i=0; valid && i<threadCount; ++i)
+		{
+			unsigned long long threadId = 0;
+			std::string threadName;
+			unsigned int spanCount = 0;
+			valid = readU64(in, threadId) && readString(in, threadName) && readU32(in, spanCount);
+			if(tids.find(threadId) == tids.end())
+			{
+				tids.insert(std::make_pair(threadId, (int)tids.size()+1));
+			}
+			int tid = tids.at(threadId);
+			if(!threadName.empty())
+			{
+				threadNames[tid] = threadName;
+			}
+			for(unsigned int j=0; valid && j<spanCount; ++j)
+			{
+				unsigned int nameId = 0;
+				UTraceEvent event;
+				valid = readU32(in, nameId) && readU64(in, event.start) && readU64(in, event.duration) && nameOffset+nameId < (unsigned int)names.size();
+				event.name = nameOffset+nameId;
+				event.tid = tid;
+				if(valid)
+				{
+					if(events.empty() || event.start < origin)
+					{
+						origin = event.start;
+					}
+					events.push_back(event);
+				}
+			}
+		}
+	}
+	fclose(in);
+	if(!valid)
+	{
+		UERROR("Trace file \"%s\" is corrupted, %d spans read before the error are converted.", binaryPath.c_str(), (int)events.size());
+	}
+
+	FILE * out = 0;
+#ifdef _MSC_VER
+	fopen_s(&out, jsonPath.c_str(), "w");
+#else
+	out = fopen(jsonPath.c_str(), "w");
+#endif
+	if(out == 0)
+	{
+		UERROR("Cannot open file \"%s\"", jsonPath.c_str());
+		return false;
+	}
+	fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	const char * separator = "\n";
+	for(std::map<unsigned long long, int>::iterator iter=tids.begin(); iter!=tids.end(); ++iter)
+	{
+		std::map<int, std::string>::iterator nameIter = threadNames.find(iter->second);
+		fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				separator,
+				iter->second,
+				nameIter!=threadNames.end()?jsonEscape(nameIter->second).c_str():"Thread");
+		separator = ",\n";
+	}
+	for(unsigned int i=0; i<events.size(); ++i)
+	{
+		// timestamps are in microseconds
+		fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				separator,
+				jsonEscape(names[events[i].name]).c_str(),
+				events[i].tid,
+				double(events[i].start - origin)/1000.0,
+				double(events[i].duration)/1000.0);
+		separator = ",\n";
+	}
+	fprintf(out, "\n]}\n");
+	fclose(out);
+	return valid;
+}